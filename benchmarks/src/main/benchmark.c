@@ -113,6 +113,7 @@ connect_to_server(arguments* args, aerospike* client)
 	else {
 		p->retry = AS_POLICY_RETRY_ONCE;
 	}
+	p->max_retries = args->max_retries;
 	
 	p->key = AS_POLICY_KEY_DIGEST;
 	p->gen = AS_POLICY_GEN_IGNORE;
@@ -121,8 +122,25 @@ connect_to_server(arguments* args, aerospike* client)
 	p->write.timeout = args->write_timeout;
 	p->operate.timeout = args->write_timeout;
 	p->remove.timeout = args->write_timeout;
+	p->read.hedge_delay = args->hedge_ms;
 	p->info.timeout = 1000;
 	
+	cfg.write_gather_threshold = args->gather_threshold;
+	cfg.conn_check_idle_ms = args->conn_check_ms;
+	
+	if (cfg.max_threads < (uint32_t)args->threads) {
+		cfg.max_threads = args->threads;
+	}
+	
+	if (args->async_commands > 0) {
+		cfg.async_loops = args->event_loops;
+		cfg.async_io_uring = args->io_uring;
+		
+		if (cfg.async_max_in_flight < (uint32_t)args->async_commands) {
+			cfg.async_max_in_flight = args->async_commands;
+		}
+	}
+	
 	aerospike_init(client, &cfg);
 	
 	as_error err;
@@ -224,6 +242,9 @@ run_benchmark(arguments* args)
 	data.bintype = args->bintype;
 	data.random = args->random;
 	data.latency = args->latency;
+	data.syscalls = args->syscalls;
+	data.hedge = args->hedge_ms > 0;
+	data.async_commands = args->init ? 0 : args->async_commands;
 	data.debug = args->debug;
 	data.valid = 1;
 
@@ -268,6 +289,11 @@ run_benchmark(arguments* args)
 		}
 	}
 	
+	if (data.async_commands) {
+		histogram_init(&data.write_histogram);
+		histogram_init(&data.read_histogram);
+	}
+	
 	if (args->init) {
 		data.records = (int)((double)args->keys / 100.0 * args->init_pct + 0.5);
 		ret = linear_write(&data);
@@ -288,6 +314,11 @@ run_benchmark(arguments* args)
 			latency_free(&data.read_latency);
 		}
 	}
+	
+	if (data.async_commands) {
+		histogram_free(&data.write_histogram);
+		histogram_free(&data.read_histogram);
+	}
 
 	as_error err;
 	aerospike_close(&data.client, &err);
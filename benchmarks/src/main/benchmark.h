@@ -49,6 +49,13 @@ typedef struct arguments_t {
 	int max_retries;
 	bool debug;
 	bool latency;
+	bool syscalls;
+	int gather_threshold;
+	int async_commands;
+	int event_loops;
+	bool io_uring;
+	int conn_check_ms;
+	int hedge_ms;
 	int latency_columns;
 	int latency_shift;
 } arguments;
@@ -65,14 +72,23 @@ typedef struct clientdata_t {
 	as_bin_value fixed_value;
 	
 	latency write_latency;
+	histogram write_histogram;
 	cf_atomic32 write_count;
 	cf_atomic32 write_timeout_count;
 	cf_atomic32 write_error_count;
+	cf_atomic64 write_syscalls;
 	
 	latency read_latency;
+	histogram read_histogram;
 	cf_atomic32 read_count;
 	cf_atomic32 read_timeout_count;
 	cf_atomic32 read_error_count;
+	cf_atomic64 read_syscalls;
+	
+	cf_atomic64 pool_hits;
+	cf_atomic64 pool_misses;
+	cf_atomic64 buf_reuses;
+	cf_atomic64 buf_grows;
 	
 	cf_atomic32 current_key;
 	cf_atomic32 valid;
@@ -80,6 +96,7 @@ typedef struct clientdata_t {
 	
 	int port;
 	int threads;
+	int async_commands;
 	int throughput;
 	int read_pct;
 	int binlen;
@@ -87,14 +104,28 @@ typedef struct clientdata_t {
 	
 	bool random;
 	bool latency;
+	bool syscalls;
+	bool hedge;
 	bool debug;
 } clientdata;
 
+// One of the asynchronous commands kept in flight - each completion starts
+// the next command.
+typedef struct async_stream_t {
+	clientdata* data;
+	uint64_t begin;
+	int key;
+	cf_atomic32 idle;
+} async_stream;
+
 int run_benchmark(arguments* args);
 int linear_write(clientdata* data);
 int random_read_write(clientdata* data);
 int write_record(int key, clientdata* data);
 int read_record(int key, clientdata* data);
+int write_record_async(int key, async_stream* stream);
+int read_record_async(int key, async_stream* stream);
+void async_next(async_stream* stream);
 int gen_value(arguments* args, as_bin_value* val);
 bool is_stop_writes(aerospike* client, const char* host, int port, const char* namespace);
 
@@ -139,3 +139,90 @@ latency_print_results(latency* l, const char* prefix, char* out) {
 	}
 	*p = 0;
 }
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+void
+histogram_init(histogram* h)
+{
+	h->buckets = cf_calloc(HISTOGRAM_BUCKETS, sizeof(cf_atomic32));
+}
+
+void
+histogram_free(histogram* h)
+{
+	cf_free((void*)h->buckets);
+}
+
+static int
+histogram_getindex(uint64_t elapsed_us)
+{
+	if (elapsed_us < HISTOGRAM_SUB_BUCKETS) {
+		return (int)elapsed_us;
+	}
+	
+	// The top bits after the most significant one select the sub-bucket.
+	int msb = 63 - __builtin_clzll(elapsed_us);
+	int sub = (int)(elapsed_us >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+	return (msb - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+static uint64_t
+histogram_getlimit(int index)
+{
+	// Largest value in the bucket.
+	if (index < HISTOGRAM_SUB_BUCKETS) {
+		return index;
+	}
+	
+	int msb = index / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+	uint64_t sub = index % HISTOGRAM_SUB_BUCKETS;
+	uint64_t base = (HISTOGRAM_SUB_BUCKETS + sub) << (msb - HISTOGRAM_SUB_BITS);
+	return base + ((uint64_t)1 << (msb - HISTOGRAM_SUB_BITS)) - 1;
+}
+
+void
+histogram_add(histogram* h, uint64_t elapsed_us)
+{
+	cf_atomic32_incr(&h->buckets[histogram_getindex(elapsed_us)]);
+}
+
+/**
+ * Print latency percentiles since the last call. As with latency_print_results(),
+ * values added during the snapshot may slip into the next period.
+ */
+void
+histogram_print_percentiles(histogram* h, const char* prefix, char* out)
+{
+	static const double percents[] = {50.0, 90.0, 99.0, 99.9};
+	static const char* names[] = {"p50", "p90", "p99", "p99.9"};
+	int n = sizeof(percents) / sizeof(percents[0]);
+	
+	cf_atomic32* array = malloc(HISTOGRAM_BUCKETS * sizeof(cf_atomic32));
+	uint64_t sum = 0;
+	
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		array[i] = cf_atomic32_fas_m(&h->buckets[i], 0);
+		sum += array[i];
+	}
+	
+	char* p = out;
+	p += sprintf(p, "%-6s", prefix);
+	
+	uint64_t count = 0;
+	int index = 0;
+	
+	for (int i = 0; i < n; i++) {
+		// Smallest bucket covering the percentile - ceil so p100 would be the max.
+		uint64_t target = (uint64_t)(percents[i] * sum / 100.0 + 0.999999);
+		
+		while (index < HISTOGRAM_BUCKETS - 1 && count + array[index] < target) {
+			count += array[index++];
+		}
+		p += sprintf(p, " %s=%lluus", names[i], sum ? (unsigned long long)histogram_getlimit(index) : 0ULL);
+	}
+	*p = 0;
+	free((void*)array);
+}
@@ -34,3 +34,14 @@ void latency_free(latency* l);
 void latency_add(latency* l, uint64_t elapsed_ms);
 void latency_set_header(latency* l, char* header);
 void latency_print_results(latency* l, const char* prefix, char* out);
+
+// Microsecond latencies in log-linear buckets - 8 buckets per power of 2, so
+// percentiles are accurate to within 12.5%.
+typedef struct histogram_t {
+	cf_atomic32* buckets;
+} histogram;
+
+void histogram_init(histogram* h);
+void histogram_free(histogram* h);
+void histogram_add(histogram* h, uint64_t elapsed_us);
+void histogram_print_percentiles(histogram* h, const char* prefix, char* out);
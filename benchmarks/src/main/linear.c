@@ -53,12 +53,33 @@ ticker_worker(void* udata)
 		blog_info("write(tps=%d timeouts=%d errors=%d total=%d)",
 			write_tps, write_timeout_current, write_error_current, total_count);
 		
+		if (data->bintype != 'I') {
+			// Value bytes only, to compare large put throughput across settings.
+			blog_line("write throughput: %.1f MB/s",
+				(double)write_tps * data->binlen / (1024 * 1024));
+		}
+		
 		if (latency) {
 			blog_line("%s", latency_header);
 			latency_print_results(write_latency, "write", latency_detail);
 			blog_line("%s", latency_detail);
 		}
 		
+		if (data->syscalls) {
+			int64_t write_syscalls = cf_atomic64_fas_m(&data->write_syscalls, 0);
+			int64_t pool_hits = cf_atomic64_fas_m(&data->pool_hits, 0);
+			int64_t pool_total = pool_hits + cf_atomic64_fas_m(&data->pool_misses, 0);
+			int64_t buf_reuses = cf_atomic64_fas_m(&data->buf_reuses, 0);
+			int64_t buf_total = buf_reuses + cf_atomic64_fas_m(&data->buf_grows, 0);
+			
+			blog_line("syscalls per op: write %.2f",
+				write_current ? (double)write_syscalls / write_current : 0.0);
+			blog_line("connection cache hit rate: %.1f%%",
+				pool_total ? (double)pool_hits * 100 / pool_total : 0.0);
+			blog_line("io buffer reuse rate: %.1f%%",
+				buf_total ? (double)buf_reuses * 100 / buf_total : 0.0);
+		}
+		
 		if (write_timeout_current + write_error_current > 10) {
 			if (is_stop_writes(&data->client, data->host, data->port, data->namespace)) {
 				if (data->valid) {
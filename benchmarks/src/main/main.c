@@ -47,6 +47,13 @@ static struct option long_options[] = {
 	{"maxRetries",   1, 0, 'r'},
 	{"debug",        0, 0, 'd'},
 	{"latency",      1, 0, 'L'},
+	{"syscalls",     0, 0, 'S'},
+	{"gatherThreshold", 1, 0, 'G'},
+	{"async",        1, 0, 'A'},
+	{"eventLoops",   1, 0, 'E'},
+	{"ioUring",      0, 0, 'I'},
+	{"connCheck",    1, 0, 'C'},
+	{"hedge",        1, 0, 'H'},
 	{"usage",        0, 0, 'u'},
 	{0,              0, 0, 0}
 };
@@ -130,8 +137,9 @@ print_usage(const char* program)
 	blog_line("   Write timeout in milliseconds.");
 	blog_line("");
 	
-	blog_line("   --maxRetries {0,1}  # Default: 1");
+	blog_line("   --maxRetries <count> # Default: 1");
 	blog_line("   Maximum number of retries before aborting the current transaction.");
+	blog_line("   Reads are retried on the other replica of a failed node.");
 	blog_line("");
 	
     //blog_line("   --sleepBetweenRetries <count>");
@@ -159,6 +167,49 @@ print_usage(const char* program)
 	blog_line("   included in both the >1ms and >8ms columns.");
 	blog_line("");
 	
+	blog_line("   --syscalls        # Default: syscall display is off.");
+	blog_line("   Show socket system calls per transaction made by the client's timed");
+	blog_line("   socket reads, writes, readiness waits and connection checks, and the");
+	blog_line("   share of connections taken from the client's per thread connection cache,");
+	blog_line("   and the share of request and response buffers reused without allocating.");
+	blog_line("");
+	
+	blog_line("   --gatherThreshold <bytes>  # Default: 16384");
+	blog_line("   Bin values of at least this size are written from the application's");
+	blog_line("   memory instead of being copied into the request buffer. 0 always copies.");
+	blog_line("   Compare large put throughput with e.g. '-o B:500000 -w I,100'.");
+	blog_line("");
+	
+	blog_line("   --async <commands>  # Default: 0");
+	blog_line("   Run the read/update workload with asynchronous commands, keeping this");
+	blog_line("   many in flight instead of using generator threads. 0 is synchronous.");
+	blog_line("   Latency percentiles are shown, and --syscalls shows the event loops'");
+	blog_line("   system calls per transaction.");
+	blog_line("");
+	
+	blog_line("   --eventLoops <count>  # Default: 1");
+	blog_line("   Number of event loop threads running asynchronous commands.");
+	blog_line("");
+	
+	blog_line("   --ioUring           # Default: epoll");
+	blog_line("   Run asynchronous commands on io_uring. The client must be built with");
+	blog_line("   IO_URING=1. Compare with the same options without --ioUring, e.g.");
+	blog_line("   '--async 256 --syscalls'.");
+	blog_line("");
+	
+	blog_line("   --connCheck <ms>    # Default: 1000");
+	blog_line("   Pooled connections used within this many milliseconds are not checked");
+	blog_line("   before use. 0 checks every connection. Compare throughput with many");
+	blog_line("   threads, e.g. '-z 256 --syscalls' against '-z 256 --syscalls --connCheck 0'.");
+	blog_line("");
+	
+	blog_line("   --hedge <ms>        # Default: 0");
+	blog_line("   Also send a read to the partition's other replica if the first has not");
+	blog_line("   responded within this many milliseconds, and show the hedges issued and");
+	blog_line("   won. 0 disables hedging. Set it to around the read p95, and compare the");
+	blog_line("   tail latency with e.g. '--latency 7,1'. Asynchronous reads aren't hedged.");
+	blog_line("");
+	
 	blog_line("-u --usage           # Default: usage not printed.");
 	blog_line("   Display program usage.");
 	blog_line("");
@@ -241,6 +292,18 @@ print_args(arguments* args)
 	else {
 		blog_line("latency:        false");
 	}
+	blog_line("syscalls:       %s", boolstring(args->syscalls));
+	blog_line("gather threshold: %d bytes", args->gather_threshold);
+	blog_line("conn check:     %d ms", args->conn_check_ms);
+	blog_line("hedge delay:    %d ms", args->hedge_ms);
+	
+	if (args->async_commands > 0) {
+		blog_line("async:          %d commands, %d event loops, %s", args->async_commands,
+			args->event_loops, args->io_uring ? "io_uring" : "epoll");
+	}
+	else {
+		blog_line("async:          false");
+	}
 }
 
 static int
@@ -309,6 +372,36 @@ validate_args(arguments* args)
 		blog_line("Invalid latency exponent shift: %d  Valid values: [1-5]", args->latency_shift);
 		return 1;
 	}
+	
+	if (args->gather_threshold < 0) {
+		
+		blog_line("Invalid gather threshold: %d  Valid values: [>= 0]", args->gather_threshold);
+		return 1;
+	}
+	
+	if (args->async_commands < 0) {
+		
+		blog_line("Invalid async commands: %d  Valid values: [>= 0]", args->async_commands);
+		return 1;
+	}
+	
+	if (args->event_loops <= 0 || args->event_loops > 256) {
+		
+		blog_line("Invalid event loops: %d  Valid values: [1-256]", args->event_loops);
+		return 1;
+	}
+	
+	if (args->conn_check_ms < 0) {
+		
+		blog_line("Invalid conn check: %d  Valid values: [>= 0]", args->conn_check_ms);
+		return 1;
+	}
+	
+	if (args->hedge_ms < 0) {
+		
+		blog_line("Invalid hedge delay: %d  Valid values: [>= 0]", args->hedge_ms);
+		return 1;
+	}
 	return 0;
 }
 
@@ -438,8 +531,8 @@ set_args(int argc, char * const * argv, arguments* args)
 			case 'r':
 				args->max_retries = atoi(optarg);
 				
-				if (args->max_retries > 1) {
-					blog_line("maxRetries must be 0 or 1");
+				if (args->max_retries < 0) {
+					blog_line("maxRetries must be >= 0");
 					return 1;
 				}
 				break;
@@ -466,6 +559,34 @@ set_args(int argc, char * const * argv, arguments* args)
 				break;
 			}
 				
+			case 'S':
+				args->syscalls = true;
+				break;
+				
+			case 'G':
+				args->gather_threshold = atoi(optarg);
+				break;
+				
+			case 'A':
+				args->async_commands = atoi(optarg);
+				break;
+				
+			case 'E':
+				args->event_loops = atoi(optarg);
+				break;
+				
+			case 'I':
+				args->io_uring = true;
+				break;
+				
+			case 'C':
+				args->conn_check_ms = atoi(optarg);
+				break;
+				
+			case 'H':
+				args->hedge_ms = atoi(optarg);
+				break;
+				
 			case 'u':
 			default:
 				return 1;
@@ -506,6 +627,13 @@ main(int argc, char * const * argv)
 	args.max_retries = 1;
 	args.debug = false;
 	args.latency = false;
+	args.syscalls = false;
+	args.gather_threshold = 16 * 1024;
+	args.async_commands = 0;
+	args.event_loops = 1;
+	args.io_uring = false;
+	args.conn_check_ms = 1000;
+	args.hedge_ms = 0;
 	args.latency_columns = 4;
 	args.latency_shift = 3;
 	
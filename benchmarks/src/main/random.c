@@ -20,8 +20,12 @@
  * IN THE SOFTWARE.
  ******************************************************************************/
 #include "benchmark.h"
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_event.h>
 #include <pthread.h>
+#include <citrusleaf/alloc.h>
 #include <citrusleaf/cf_clock.h>
+#include <inttypes.h>
 #include <unistd.h>
 
 uint32_t cf_get_rand32();
@@ -35,6 +39,8 @@ ticker_worker(void* udata)
 	bool latency = data->latency;
 	char latency_header[512];
 	char latency_detail[512];
+	uint64_t prev_syscalls = 0;
+	as_cluster_hedge_stats prev_hedges = {0, 0};
 	
 	uint64_t prev_time = cf_getms();
 	data->period_begin = prev_time;
@@ -74,6 +80,50 @@ ticker_worker(void* udata)
 			blog_line("%s", latency_detail);
 		}
 		
+		if (data->async_commands) {
+			histogram_print_percentiles(&data->write_histogram, "write", latency_detail);
+			blog_line("%s", latency_detail);
+			histogram_print_percentiles(&data->read_histogram, "read", latency_detail);
+			blog_line("%s", latency_detail);
+		}
+		
+		if (data->syscalls && data->async_commands) {
+			// Async I/O is done by the event loop threads, which count for
+			// reads and writes together.
+			uint64_t syscalls = as_event_loops_syscalls(data->client.cluster);
+			int32_t total = write_current + read_current;
+			
+			blog_line("syscalls per op: %.2f",
+				total ? (double)(syscalls - prev_syscalls) / total : 0.0);
+			prev_syscalls = syscalls;
+		}
+		else if (data->syscalls) {
+			int64_t write_syscalls = cf_atomic64_fas_m(&data->write_syscalls, 0);
+			int64_t read_syscalls = cf_atomic64_fas_m(&data->read_syscalls, 0);
+			
+			int64_t pool_hits = cf_atomic64_fas_m(&data->pool_hits, 0);
+			int64_t pool_total = pool_hits + cf_atomic64_fas_m(&data->pool_misses, 0);
+			int64_t buf_reuses = cf_atomic64_fas_m(&data->buf_reuses, 0);
+			int64_t buf_total = buf_reuses + cf_atomic64_fas_m(&data->buf_grows, 0);
+			
+			blog_line("syscalls per op: write %.2f read %.2f",
+				write_current ? (double)write_syscalls / write_current : 0.0,
+				read_current ? (double)read_syscalls / read_current : 0.0);
+			blog_line("connection cache hit rate: %.1f%%",
+				pool_total ? (double)pool_hits * 100 / pool_total : 0.0);
+			blog_line("io buffer reuse rate: %.1f%%",
+				buf_total ? (double)buf_reuses * 100 / buf_total : 0.0);
+		}
+		
+		if (data->hedge) {
+			as_cluster_hedge_stats hedges;
+			as_cluster_get_hedge_stats(data->client.cluster, &hedges);
+			
+			blog_line("hedged reads: issued %"PRIu64" won %"PRIu64,
+				hedges.issued - prev_hedges.issued, hedges.won - prev_hedges.won);
+			prev_hedges = hedges;
+		}
+		
 		if (write_timeout_current + write_error_current > 10) {
 			if (is_stop_writes(&data->client, data->host, data->port, data->namespace)) {
 				if (data->valid) {
@@ -127,6 +177,71 @@ random_worker(void* udata)
 	return 0;
 }
 
+static bool
+async_throttled(clientdata* data)
+{
+	return data->throughput > 0 && data->write_count + data->read_count > data->throughput;
+}
+
+void
+async_next(async_stream* stream)
+{
+	clientdata* data = stream->data;
+	
+	if (! data->valid || async_throttled(data)) {
+		// Restarted by async_read_write() when the throttle period ends.
+		cf_atomic32_set(&stream->idle, 1);
+		return;
+	}
+	
+	int key = cf_get_rand32() % data->records + 1;
+	int die = cf_get_rand32() % 100;
+	int status;
+	
+	if (die < data->read_pct) {
+		status = read_record_async(key, stream);
+	}
+	else {
+		status = write_record_async(key, stream);
+	}
+	
+	if (status != AEROSPIKE_OK) {
+		// Not started, so there will be no callback - restart later.
+		cf_atomic32_set(&stream->idle, 1);
+	}
+}
+
+static void
+async_read_write(clientdata* data)
+{
+	int max = data->async_commands;
+	blog_info("Start %d concurrent async commands", max);
+	async_stream* streams = cf_malloc(sizeof(async_stream) * max);
+	
+	for (int i = 0; i < max; i++) {
+		streams[i].data = data;
+		streams[i].idle = 1;
+	}
+	
+	while (data->valid) {
+		for (int i = 0; i < max && ! async_throttled(data); i++) {
+			if (streams[i].idle) {
+				cf_atomic32_set(&streams[i].idle, 0);
+				async_next(&streams[i]);
+			}
+		}
+		usleep(1000);
+	}
+	
+	// Listeners of commands in flight still use their streams.
+	for (int i = 0; i < max; i++) {
+		while (! streams[i].idle) {
+			usleep(1000);
+		}
+	}
+	cf_free(streams);
+}
+
 int
 random_read_write(clientdata* data)
 {
@@ -139,6 +254,12 @@ random_read_write(clientdata* data)
 		return -1;
 	}
 	
+	if (data->async_commands) {
+		async_read_write(data);
+		pthread_join(ticker, 0);
+		return 0;
+	}
+	
 	int max = data->threads;
 	blog_info("Start %d generator threads", max);
 	pthread_t threads[max];
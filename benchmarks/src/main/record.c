@@ -21,7 +21,10 @@
  ******************************************************************************/
 #include "benchmark.h"
 #include "aerospike/aerospike_key.h"
+#include "aerospike/as_io_buffer.h"
+#include "aerospike/as_node.h"
 #include <citrusleaf/cf_clock.h>
+#include <citrusleaf/cf_socket.h>
 
 static const char alphanum[] =
 	"0123456789"
@@ -33,6 +36,31 @@ static int alphanum_len = sizeof(alphanum) - 1;
 uint32_t cf_get_rand32();
 int cf_get_rand_buf(uint8_t *buf, int len);
 
+static inline uint64_t
+socket_syscalls()
+{
+	// Socket I/O is always done on the calling thread, so thread counters suffice.
+	cf_socket_stats* stats = cf_socket_thread_stats();
+	return stats->reads + stats->writes + stats->waits + as_node_fd_thread_stats()->checks;
+}
+
+static inline void
+pool_stats_add(clientdata* data, as_node_fd_stats* begin)
+{
+	// Connection pool thread caches are per thread too.
+	as_node_fd_stats* stats = as_node_fd_thread_stats();
+	cf_atomic64_add(&data->pool_hits, stats->hits - begin->hits);
+	cf_atomic64_add(&data->pool_misses, stats->misses - begin->misses);
+}
+
+static inline void
+buf_stats_add(clientdata* data, as_io_buffer_stats* begin)
+{
+	as_io_buffer_stats* stats = as_io_buffer_thread_stats();
+	cf_atomic64_add(&data->buf_reuses, stats->reuses - begin->reuses);
+	cf_atomic64_add(&data->buf_grows, stats->grows + stats->overflows - begin->grows - begin->overflows);
+}
+
 int
 gen_value(arguments* args, as_bin_value* val)
 {
@@ -75,14 +103,75 @@ gen_value(arguments* args, as_bin_value* val)
 	return 0;
 }
 
+static void
+write_listener(as_error* err, void* udata)
+{
+	async_stream* stream = (async_stream*)udata;
+	clientdata* data = stream->data;
+	uint64_t elapsed = cf_getus() - stream->begin;
+	
+	if (! err) {
+		cf_atomic32_incr(&data->write_count);
+		histogram_add(&data->write_histogram, elapsed);
+		
+		if (data->latency) {
+			latency_add(&data->write_latency, elapsed / 1000);
+		}
+	}
+	else if (err->code == AEROSPIKE_ERR_TIMEOUT) {
+		cf_atomic32_incr(&data->write_timeout_count);
+	}
+	else {
+		cf_atomic32_incr(&data->write_error_count);
+		
+		if (data->debug) {
+			blog_error("Write error: ns=%s set=%s key=%d bin=%s code=%d message=%s",
+				data->namespace, data->set, stream->key, data->bin_name, err->code, err->message);
+		}
+	}
+	async_next(stream);
+}
+
+static as_status
+put_record_async(int keyval, as_record* rec, async_stream* stream)
+{
+	clientdata* data = stream->data;
+	as_key key;
+	as_key_init_int64(&key, data->namespace, data->set, keyval);
+	
+	as_error err;
+	stream->key = keyval;
+	stream->begin = cf_getus();
+	
+	// The request is compiled before the call returns, so rec can be on the stack.
+	as_status status = aerospike_key_put_async(&data->client, &err, 0, &key, rec, write_listener, stream);
+	
+	if (status != AEROSPIKE_OK) {
+		cf_atomic32_incr(&data->write_error_count);
+		
+		if (data->debug) {
+			blog_error("Write error: ns=%s set=%s key=%d bin=%s code=%d message=%s",
+				data->namespace, data->set, keyval, data->bin_name, status, err.message);
+		}
+	}
+	return status;
+}
+
 static as_status
-put_record(int keyval, as_record* rec, clientdata* data)
+put_record(int keyval, as_record* rec, clientdata* data, async_stream* stream)
 {
+	if (stream) {
+		return put_record_async(keyval, rec, stream);
+	}
+	
 	as_key key;
 	as_key_init_int64(&key, data->namespace, data->set, keyval);
 	
 	as_status status;
 	as_error err;
+	uint64_t syscalls = data->syscalls ? socket_syscalls() : 0;
+	as_node_fd_stats pool = *as_node_fd_thread_stats();
+	as_io_buffer_stats bufs = *as_io_buffer_thread_stats();
 
 	if (data->latency) {
 		uint64_t begin = cf_getms();
@@ -92,7 +181,6 @@ put_record(int keyval, as_record* rec, clientdata* data)
 		if (status == AEROSPIKE_OK) {
 			cf_atomic32_incr(&data->write_count);
 			latency_add(&data->write_latency, end - begin);
-			return status;
 		}
 	}
 	else {
@@ -100,9 +188,17 @@ put_record(int keyval, as_record* rec, clientdata* data)
 		
 		if (status == AEROSPIKE_OK) {
 			cf_atomic32_incr(&data->write_count);
-			return status;
 		}
 	}
+	
+	if (status == AEROSPIKE_OK) {
+		if (data->syscalls) {
+			cf_atomic64_add(&data->write_syscalls, socket_syscalls() - syscalls);
+			pool_stats_add(data, &pool);
+			buf_stats_add(data, &bufs);
+		}
+		return status;
+	}
 
 	// Handle error conditions.
 	if (status == AEROSPIKE_ERR_TIMEOUT) {
@@ -119,8 +215,8 @@ put_record(int keyval, as_record* rec, clientdata* data)
 	return status;
 }
 
-int
-write_record(int keyval, clientdata* data)
+static int
+write_record_stream(int keyval, clientdata* data, async_stream* stream)
 {
 	as_record rec;
 	as_record_inita(&rec, 1);
@@ -135,7 +231,7 @@ write_record(int keyval, clientdata* data)
 				// Generate integer.
 				uint32_t i = cf_get_rand32();
 				as_record_set_int64(&rec, data->bin_name, i);
-				status = put_record(keyval, &rec, data);
+				status = put_record(keyval, &rec, data, stream);
 				break;
 			}
 				
@@ -145,7 +241,7 @@ write_record(int keyval, clientdata* data)
 				uint8_t buf[len];
 				cf_get_rand_buf(buf, len);
 				as_record_set_rawp(&rec, data->bin_name, buf, len, false);
-				status = put_record(keyval, &rec, data);
+				status = put_record(keyval, &rec, data, stream);
 				break;
 			}
 				
@@ -160,7 +256,7 @@ write_record(int keyval, clientdata* data)
 				}
 				buf[len] = 0;
 				as_record_set_strp(&rec, data->bin_name, (char*)buf, false);
-				status = put_record(keyval, &rec, data);
+				status = put_record(keyval, &rec, data, stream);
 				break;
 			}
 				
@@ -174,11 +270,23 @@ write_record(int keyval, clientdata* data)
 	else {
 		// Use fixed value.
 		as_record_set(&rec, data->bin_name, &data->fixed_value);
-		status = put_record(keyval, &rec, data);
+		status = put_record(keyval, &rec, data, stream);
 	}
 	return (int)status;
 }
 
+int
+write_record(int keyval, clientdata* data)
+{
+	return write_record_stream(keyval, data, 0);
+}
+
+int
+write_record_async(int keyval, async_stream* stream)
+{
+	return write_record_stream(keyval, stream->data, stream);
+}
+
 int
 read_record(int keyval, clientdata* data)
 {
@@ -188,6 +296,9 @@ read_record(int keyval, clientdata* data)
 	as_record* rec = 0;
 	as_status status;
 	as_error err;
+	uint64_t syscalls = data->syscalls ? socket_syscalls() : 0;
+	as_node_fd_stats pool = *as_node_fd_thread_stats();
+	as_io_buffer_stats bufs = *as_io_buffer_thread_stats();
 	
 	if (data->latency) {
 		uint64_t begin = cf_getms();
@@ -198,8 +309,6 @@ read_record(int keyval, clientdata* data)
 		if (status == AEROSPIKE_OK || status == AEROSPIKE_ERR_RECORD_NOT_FOUND) {
 			cf_atomic32_incr(&data->read_count);
 			latency_add(&data->read_latency, end - begin);
-			as_record_destroy(rec);
-			return status;
 		}
 	}
 	else {
@@ -208,11 +317,19 @@ read_record(int keyval, clientdata* data)
 		// Record may not have been initialized, so not found is ok.
 		if (status == AEROSPIKE_OK|| status == AEROSPIKE_ERR_RECORD_NOT_FOUND) {
 			cf_atomic32_incr(&data->read_count);
-			as_record_destroy(rec);
-			return status;
 		}
 	}
 	
+	if (status == AEROSPIKE_OK || status == AEROSPIKE_ERR_RECORD_NOT_FOUND) {
+		if (data->syscalls) {
+			cf_atomic64_add(&data->read_syscalls, socket_syscalls() - syscalls);
+			pool_stats_add(data, &pool);
+			buf_stats_add(data, &bufs);
+		}
+		as_record_destroy(rec);
+		return status;
+	}
+	
 	// Handle error conditions.
 	if (status == AEROSPIKE_ERR_TIMEOUT) {
 		cf_atomic32_incr(&data->read_timeout_count);
@@ -229,3 +346,57 @@ read_record(int keyval, clientdata* data)
 	as_record_destroy(rec);
 	return status;
 }
+
+static void
+read_listener(as_error* err, as_record* rec, void* udata)
+{
+	async_stream* stream = (async_stream*)udata;
+	clientdata* data = stream->data;
+	uint64_t elapsed = cf_getus() - stream->begin;
+	
+	// Record may not have been initialized, so not found is ok.
+	if (! err || err->code == AEROSPIKE_ERR_RECORD_NOT_FOUND) {
+		cf_atomic32_incr(&data->read_count);
+		histogram_add(&data->read_histogram, elapsed);
+		
+		if (data->latency) {
+			latency_add(&data->read_latency, elapsed / 1000);
+		}
+	}
+	else if (err->code == AEROSPIKE_ERR_TIMEOUT) {
+		cf_atomic32_incr(&data->read_timeout_count);
+	}
+	else {
+		cf_atomic32_incr(&data->read_error_count);
+		
+		if (data->debug) {
+			blog_error("Read error: ns=%s set=%s key=%d bin=%s code=%d message=%s",
+				data->namespace, data->set, stream->key, data->bin_name, err->code, err->message);
+		}
+	}
+	async_next(stream);
+}
+
+int
+read_record_async(int keyval, async_stream* stream)
+{
+	clientdata* data = stream->data;
+	as_key key;
+	as_key_init_int64(&key, data->namespace, data->set, keyval);
+	
+	as_error err;
+	stream->key = keyval;
+	stream->begin = cf_getus();
+	
+	as_status status = aerospike_key_get_async(&data->client, &err, 0, &key, read_listener, stream);
+	
+	if (status != AEROSPIKE_OK) {
+		cf_atomic32_incr(&data->read_error_count);
+		
+		if (data->debug) {
+			blog_error("Read error: ns=%s set=%s key=%d bin=%s code=%d message=%s",
+				data->namespace, data->set, keyval, data->bin_name, status, err.message);
+		}
+	}
+	return status;
+}
@@ -0,0 +1,310 @@
+/*******************************************************************************
+ * Copyright 2008-2013 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *s
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+
+//==========================================================
+// Response decode microbenchmark.
+//
+// Decodes canned read responses of 1, 10 and 100 bins into
+// as_record, both through cl_parse() and the cl_bin shim and
+// straight from the wire with as_record_from_msg(), with and
+// without the record arena. Needs no
+// server. Allocations are counted when linked with
+// -Wl,--wrap=malloc etc. (see the Makefile).
+//
+
+#include <aerospike/as_arraylist.h>
+#include <aerospike/as_buffer.h>
+#include <aerospike/as_msgpack.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_serializer.h>
+#include <citrusleaf/cf_byte_order.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/citrusleaf.h>
+#include <citrusleaf/cl_object.h>
+
+#include "_record.h"
+#include "_shim.h"
+#include "citrusleaf/internal.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//==========================================================
+// Allocation counting.
+//
+
+static uint64_t g_allocs = 0;
+
+#ifdef DECODE_COUNT_ALLOCS
+void* __real_malloc(size_t sz);
+void* __real_calloc(size_t n, size_t sz);
+void* __real_realloc(void* p, size_t sz);
+
+void*
+__wrap_malloc(size_t sz)
+{
+	g_allocs++;
+	return __real_malloc(sz);
+}
+
+void*
+__wrap_calloc(size_t n, size_t sz)
+{
+	g_allocs++;
+	return __real_calloc(n, sz);
+}
+
+void*
+__wrap_realloc(void* p, size_t sz)
+{
+	g_allocs++;
+	return __real_realloc(p, sz);
+}
+#endif
+
+//==========================================================
+// Canned responses.
+//
+
+#define STR_SZ 16
+#define BLOB_SZ 32
+#define LIST_SZ 4
+
+typedef struct {
+	cl_msg msg;		// header, in host order as the decoders expect
+	uint8_t* ops;	// ops, in network order
+	size_t ops_sz;
+} response;
+
+static uint8_t*
+put_op(uint8_t* p, uint32_t i, uint8_t type, const uint8_t* value, uint32_t value_sz)
+{
+	char name[16];
+	uint8_t name_sz = (uint8_t)snprintf(name, sizeof(name), "bin%u", i);
+	cl_msg_op* op = (cl_msg_op*)p;
+
+	op->op_sz = cf_swap_to_be32(4 + name_sz + value_sz);
+	op->op = CL_MSG_OP_READ;
+	op->particle_type = type;
+	op->version = 0;
+	op->name_sz = name_sz;
+	memcpy(op->name, name, name_sz);
+	memcpy(op->name + name_sz, value, value_sz);
+	return op->name + name_sz + value_sz;
+}
+
+// Bins cycle through integer, string, blob and list values.
+static void
+response_init(response* r, uint32_t n_bins)
+{
+	uint8_t str[STR_SZ];
+	uint8_t blob[BLOB_SZ];
+
+	memset(str, 'a', sizeof(str));
+
+	for (int i = 0; i < BLOB_SZ; i++) {
+		blob[i] = (uint8_t)i;
+	}
+
+	as_arraylist list;
+	as_arraylist_inita(&list, LIST_SZ);
+
+	for (int i = 0; i < LIST_SZ; i++) {
+		as_arraylist_append_int64(&list, i * 1000);
+	}
+
+	as_serializer ser;
+	as_msgpack_init(&ser);
+	as_buffer packed;
+	as_buffer_init(&packed);
+	as_serializer_serialize(&ser, (as_val*)&list, &packed);
+	as_serializer_destroy(&ser);
+	as_arraylist_destroy(&list);
+
+	size_t max_op_sz = sizeof(cl_msg_op) + 16 + BLOB_SZ + packed.size;
+	r->ops = malloc(max_op_sz * n_bins);
+
+	uint8_t* p = r->ops;
+
+	for (uint32_t i = 0; i < n_bins; i++) {
+		switch (i % 4) {
+		case 0: {
+			uint64_t v = cf_swap_to_be64((uint64_t)i * 123456789);
+			p = put_op(p, i, CL_INT, (uint8_t*)&v, sizeof(v));
+			break;
+		}
+		case 1:
+			p = put_op(p, i, CL_STR, str, sizeof(str));
+			break;
+		case 2:
+			p = put_op(p, i, CL_BLOB, blob, sizeof(blob));
+			break;
+		default:
+			p = put_op(p, i, CL_LIST, packed.data, packed.size);
+			break;
+		}
+	}
+
+	as_buffer_destroy(&packed);
+
+	r->ops_sz = p - r->ops;
+	memset(&r->msg, 0, sizeof(r->msg));
+	r->msg.header_sz = sizeof(cl_msg);
+	r->msg.generation = 1;
+	r->msg.n_ops = n_bins;
+}
+
+//==========================================================
+// Decoders.
+//
+
+// cl_parse() swaps the ops in place, so every run decodes a fresh copy.
+static int
+decode_shim(response* r, uint8_t* scratch)
+{
+	memcpy(scratch, r->ops, r->ops_sz);
+
+	cl_msg msg = r->msg;
+	cl_bin* values = NULL;
+	int n_values = 0;
+
+	if (cl_parse(&msg, scratch, r->ops_sz, &values, NULL, &n_values, NULL, NULL) != 0) {
+		free(values);
+		return -1;
+	}
+
+	as_record* rec = as_record_new(n_values);
+	clbins_to_asrecord(values, n_values, rec, false);
+
+	if (values) {
+		citrusleaf_bins_free(values, n_values);
+		free(values);
+	}
+
+	int rv = rec->bins.size == n_values ? 0 : -1;
+	as_record_destroy(rec);
+	return rv;
+}
+
+// The copy isn't needed here, but is kept so all runs do the same work.
+static int
+decode_from_msg(response* r, uint8_t* scratch, bool arena)
+{
+	memcpy(scratch, r->ops, r->ops_sz);
+
+	as_record* rec = as_record_new(0);
+	int rv = as_record_from_msg(rec, &r->msg, scratch, r->ops_sz, arena, false);
+
+	if (rv == 0 && rec->bins.size != r->msg.n_ops) {
+		rv = -1;
+	}
+	as_record_destroy(rec);
+	return rv;
+}
+
+static int
+decode_direct(response* r, uint8_t* scratch)
+{
+	return decode_from_msg(r, scratch, false);
+}
+
+static int
+decode_arena(response* r, uint8_t* scratch)
+{
+	return decode_from_msg(r, scratch, true);
+}
+
+//==========================================================
+// Main.
+//
+
+static uint64_t
+now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+run(const char* name, int (*decode)(response*, uint8_t*), response* r, uint8_t* scratch, uint32_t iterations)
+{
+	// Warm up, and check the decoder works before timing it.
+	if (decode(r, scratch) != 0) {
+		fprintf(stderr, "%s decode failed\n", name);
+		return -1;
+	}
+
+	uint64_t allocs = g_allocs;
+	uint64_t begin = now_ns();
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		decode(r, scratch);
+	}
+
+	uint64_t elapsed = now_ns() - begin;
+	allocs = g_allocs - allocs;
+
+#ifdef DECODE_COUNT_ALLOCS
+	printf("%4u bins  %-6s %10.1f ns/record %8.1f allocs/record\n", r->msg.n_ops, name,
+		(double)elapsed / iterations, (double)allocs / iterations);
+#else
+	printf("%4u bins  %-6s %10.1f ns/record\n", r->msg.n_ops, name,
+		(double)elapsed / iterations);
+#endif
+	return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+	// Roughly the same number of bins are decoded for each record size.
+	uint32_t total_bins = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000000;
+	uint32_t sizes[] = {1, 10, 100};
+	int rv = 0;
+
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		response r;
+		response_init(&r, sizes[i]);
+
+		uint8_t* scratch = malloc(r.ops_sz);
+		uint32_t iterations = total_bins / sizes[i];
+
+		if (iterations == 0) {
+			iterations = 1;
+		}
+
+		if (run("shim", decode_shim, &r, scratch, iterations) != 0 ||
+			run("direct", decode_direct, &r, scratch, iterations) != 0 ||
+			run("arena", decode_arena, &r, scratch, iterations) != 0) {
+			rv = -1;
+		}
+
+		free(scratch);
+		free(r.ops);
+	}
+	return rv;
+}
@@ -0,0 +1,312 @@
+/*******************************************************************************
+ * Copyright 2008-2013 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *s
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+
+//==========================================================
+// Request encode microbenchmark.
+//
+// Compiles write requests of 1, 10 and 100 bins, as
+// aerospike_key_put() does through the bins encoder, and from
+// a prepared write which only patches in the key, TTL and
+// values. Needs no server, so only the client's CPU cost is
+// measured. Allocations are counted when linked with
+// -Wl,--wrap=malloc etc. (see the Makefile).
+//
+
+#include <aerospike/as_io_buffer.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_prepared_write.h>
+#include <aerospike/as_record.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cl_write.h>
+
+#include "_prepared_write.h"
+#include "_record.h"
+#include "_shim.h"
+#include "citrusleaf/internal.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//==========================================================
+// Allocation counting.
+//
+
+static uint64_t g_allocs = 0;
+
+#ifdef DECODE_COUNT_ALLOCS
+void* __real_malloc(size_t sz);
+void* __real_calloc(size_t n, size_t sz);
+void* __real_realloc(void* p, size_t sz);
+
+void*
+__wrap_malloc(size_t sz)
+{
+	g_allocs++;
+	return __real_malloc(sz);
+}
+
+void*
+__wrap_calloc(size_t n, size_t sz)
+{
+	g_allocs++;
+	return __real_calloc(n, sz);
+}
+
+void*
+__wrap_realloc(void* p, size_t sz)
+{
+	g_allocs++;
+	return __real_realloc(p, sz);
+}
+#endif
+
+//==========================================================
+// Canned writes.
+//
+
+#define NS "test"
+#define SET "demo"
+#define STR_SZ 16
+#define BLOB_SZ 32
+
+typedef struct {
+	as_policy_write policy;
+	as_prepared_write pw;
+	as_key key;
+	as_record rec;
+	uint8_t blob[BLOB_SZ];
+	char str[STR_SZ + 1];
+} write;
+
+// Bins cycle through integer, string and bytes values.
+static int
+write_init(write* w, uint32_t n_bins)
+{
+	memset(w->str, 'a', STR_SZ);
+	w->str[STR_SZ] = '\0';
+
+	for (int i = 0; i < BLOB_SZ; i++) {
+		w->blob[i] = (uint8_t)i;
+	}
+
+	as_record_init(&w->rec, n_bins);
+	w->rec.ttl = 1000;
+
+	for (uint32_t i = 0; i < n_bins; i++) {
+		char name[16];
+		snprintf(name, sizeof(name), "bin%u", i);
+
+		switch (i % 3) {
+		case 0:
+			as_record_set_int64(&w->rec, name, (int64_t)i * 123456789);
+			break;
+		case 1:
+			as_record_set_str(&w->rec, name, w->str);
+			break;
+		default:
+			as_record_set_raw(&w->rec, name, w->blob, BLOB_SZ);
+			break;
+		}
+	}
+
+	as_key_init(&w->key, NS, SET, "key");
+
+	as_policy_write_init(&w->policy);
+	w->policy.key = AS_POLICY_KEY_DIGEST;
+	w->policy.timeout = 1000;
+
+	as_error err;
+
+	if (as_prepared_write_init(&w->pw, &err, &w->policy, NS, SET, &w->rec) != AEROSPIKE_OK) {
+		fprintf(stderr, "prepare failed: %s\n", err.message);
+		as_record_destroy(&w->rec);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+write_destroy(write* w)
+{
+	as_prepared_write_destroy(&w->pw);
+	as_key_destroy(&w->key);
+	as_record_destroy(&w->rec);
+}
+
+//==========================================================
+// Encoders.
+//
+
+// Each run compiles a new key, so the digest is computed every time.
+
+static int
+encode_put(write* w, uint8_t** buf_r, size_t* buf_sz_r)
+{
+	w->key.digest.init = false;
+
+	cl_write_parameters wp;
+	aspolicywrite_to_clwriteparameters(&w->policy, &w->rec, &wp);
+
+	as_bins_encoder enc;
+	as_bins_encoder_inita_record(&enc, &w->rec);
+
+	as_digest* digest = as_key_digest(&w->key);
+	cf_digest d_ret;
+	*buf_r = NULL;
+
+	int rv = cl_compile_ops(0, CL_MSG_INFO2_WRITE, 0, NS, SET, NULL, (cf_digest*)digest->value,
+		&enc.encoder, buf_r, buf_sz_r, &wp, &d_ret, NULL);
+
+	as_bins_encoder_destroy(&enc);
+	return rv;
+}
+
+static int
+encode_prepared(write* w, uint8_t** buf_r, size_t* buf_sz_r)
+{
+	w->key.digest.init = false;
+
+	// As aerospike_key_put_prepared(), which needs these for the transaction.
+	cl_write_parameters wp;
+	aspolicywrite_to_clwriteparameters(&w->pw.policy, &w->rec, &wp);
+
+	as_error err;
+	return as_prepared_write_compile(&w->pw, &err, &w->key, &w->rec, buf_r, buf_sz_r) == AEROSPIKE_OK ? 0 : -1;
+}
+
+// The requests should only differ in size - the bins encoder's digest field
+// is sized a byte larger than it needs to be.
+static int
+check(write* w)
+{
+	uint8_t* put;
+	uint8_t* prepared;
+	size_t put_sz;
+	size_t prepared_sz;
+
+	if (encode_put(w, &put, &put_sz) != 0) {
+		fprintf(stderr, "put encode failed\n");
+		return -1;
+	}
+
+	if (encode_prepared(w, &prepared, &prepared_sz) != 0) {
+		fprintf(stderr, "prepared encode failed\n");
+		as_io_buffer_put(put);
+		return -1;
+	}
+
+	int rv = 0;
+
+	if (prepared_sz > put_sz ||
+		memcmp(put + sizeof(cl_proto), prepared + sizeof(cl_proto), prepared_sz - sizeof(cl_proto)) != 0) {
+		fprintf(stderr, "%u bins: prepared request doesn't match\n", w->rec.bins.size);
+		rv = -1;
+	}
+
+	as_io_buffer_put(put);
+	as_io_buffer_put(prepared);
+	return rv;
+}
+
+//==========================================================
+// Main.
+//
+
+static uint64_t
+now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+run(const char* name, int (*encode)(write*, uint8_t**, size_t*), write* w, uint32_t iterations)
+{
+	uint8_t* buf;
+	size_t buf_sz;
+
+	// Warm up the thread's I/O buffer.
+	if (encode(w, &buf, &buf_sz) != 0) {
+		fprintf(stderr, "%s encode failed\n", name);
+		return -1;
+	}
+	as_io_buffer_put(buf);
+
+	uint64_t allocs = g_allocs;
+	uint64_t begin = now_ns();
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		encode(w, &buf, &buf_sz);
+		as_io_buffer_put(buf);
+	}
+
+	uint64_t elapsed = now_ns() - begin;
+	allocs = g_allocs - allocs;
+
+#ifdef DECODE_COUNT_ALLOCS
+	printf("%4u bins  %-8s %10.1f ns/write %8.1f allocs/write\n", w->rec.bins.size, name,
+		(double)elapsed / iterations, (double)allocs / iterations);
+#else
+	printf("%4u bins  %-8s %10.1f ns/write\n", w->rec.bins.size, name,
+		(double)elapsed / iterations);
+#endif
+	return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+	// Roughly the same number of bins are encoded for each record size.
+	uint32_t total_bins = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000000;
+	uint32_t sizes[] = {1, 10, 100};
+	int rv = 0;
+
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		write w;
+
+		if (write_init(&w, sizes[i]) != 0) {
+			rv = -1;
+			continue;
+		}
+
+		uint32_t iterations = total_bins / sizes[i];
+
+		if (iterations == 0) {
+			iterations = 1;
+		}
+
+		if (check(&w) != 0 ||
+			run("put", encode_put, &w, iterations) != 0 ||
+			run("prepared", encode_prepared, &w, iterations) != 0) {
+			rv = -1;
+		}
+
+		write_destroy(&w);
+	}
+	return rv;
+}
@@ -0,0 +1,390 @@
+/*******************************************************************************
+ * Copyright 2008-2013 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+
+//==========================================================
+// Partition map microbenchmark.
+//
+// Applies canned replicas-master and replicas-prole responses
+// of 8 nodes for 10 namespaces of 4096 partitions, as the tend
+// thread does, both unchanged ("steady") and with a quarter of
+// each node's partitions moving every time ("churn"). The same
+// updates are also applied bit at a time to a table of node
+// pointers ("bitwise"), as the client used to. Then looks up
+// nodes for random digests. Needs no server. Allocations are
+// counted when linked with -Wl,--wrap=malloc etc. (see the
+// Makefile).
+//
+
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_partition.h>
+#include <citrusleaf/cf_b64.h>
+#include <citrusleaf/cf_digest.h>
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+bool
+as_partition_tables_update(as_cluster* cluster, as_node* node, char* buf, bool master);
+
+//==========================================================
+// Allocation counting.
+//
+
+static uint64_t g_allocs = 0;
+
+#ifdef DECODE_COUNT_ALLOCS
+void* __real_malloc(size_t sz);
+void* __real_calloc(size_t n, size_t sz);
+void* __real_realloc(void* p, size_t sz);
+
+void*
+__wrap_malloc(size_t sz)
+{
+	g_allocs++;
+	return __real_malloc(sz);
+}
+
+void*
+__wrap_calloc(size_t n, size_t sz)
+{
+	g_allocs++;
+	return __real_calloc(n, sz);
+}
+
+void*
+__wrap_realloc(void* p, size_t sz)
+{
+	g_allocs++;
+	return __real_realloc(p, sz);
+}
+#endif
+
+//==========================================================
+// Canned partition maps.
+//
+
+#define N_NODES 8
+#define N_NAMESPACES 10
+#define N_PARTITIONS 4096
+#define BITMAP_SZ (N_PARTITIONS / 8)
+
+// Two maps - the second moves a quarter of each node's partitions to the
+// next node. Responses are parsed destructively, so each update works on a
+// copy.
+typedef struct {
+	char* responses[2][2][N_NODES];	// [map][master][node]
+	size_t sizes[2][2][N_NODES];
+} maps;
+
+static uint32_t
+owner(uint32_t map, bool master, uint32_t ns, uint32_t pid)
+{
+	uint32_t n = (pid + ns + (master ? 0 : 1)) % N_NODES;
+
+	if (map == 1 && pid % 4 == 0) {
+		n = (n + 1) % N_NODES;
+	}
+	return n;
+}
+
+static char*
+response_create(uint32_t map, bool master, uint32_t node, size_t* size)
+{
+	int b64_len = cf_b64_encoded_len(BITMAP_SZ);
+	char* buf = malloc(N_NAMESPACES * (16 + b64_len) + 1);
+	char* p = buf;
+
+	for (uint32_t ns = 0; ns < N_NAMESPACES; ns++) {
+		uint8_t bitmap[BITMAP_SZ];
+		memset(bitmap, 0, sizeof(bitmap));
+
+		for (uint32_t pid = 0; pid < N_PARTITIONS; pid++) {
+			if (owner(map, master, ns, pid) == node) {
+				bitmap[pid >> 3] |= 0x80 >> (pid & 7);
+			}
+		}
+
+		p += sprintf(p, "ns%u:", ns);
+		cf_b64_encode(bitmap, BITMAP_SZ, p);
+		p += b64_len;
+		*p++ = ';';
+	}
+	*p = '\0';
+	*size = p - buf + 1;
+	return buf;
+}
+
+static void
+maps_init(maps* m)
+{
+	for (uint32_t map = 0; map < 2; map++) {
+		for (uint32_t master = 0; master < 2; master++) {
+			for (uint32_t node = 0; node < N_NODES; node++) {
+				m->responses[map][master][node] = response_create(map, master, node,
+					&m->sizes[map][master][node]);
+			}
+		}
+	}
+}
+
+//==========================================================
+// Bit at a time update of node pointers, as the client used to.
+//
+
+typedef struct {
+	char ns[AS_MAX_NAMESPACE_SIZE];
+	as_node* master[N_PARTITIONS];
+	as_node* prole[N_PARTITIONS];
+} bitwise_table;
+
+static bitwise_table g_bitwise[N_NAMESPACES];
+
+static void
+bitwise_update(as_node* node, char* buf, bool master)
+{
+	char* p = buf;
+	char* ns = p;
+
+	while (*p) {
+		if (*p != ':') {
+			p++;
+			continue;
+		}
+
+		*p = 0;
+		char* bitmap_b64 = ++p;
+
+		while (*p && *p != ';') {
+			p++;
+		}
+		*p = 0;
+
+		bitwise_table* table = 0;
+
+		for (uint32_t i = 0; i < N_NAMESPACES; i++) {
+			if (strcmp(g_bitwise[i].ns, ns) == 0) {
+				table = &g_bitwise[i];
+				break;
+			}
+		}
+
+		uint8_t bitmap[BITMAP_SZ + 3];
+		cf_b64_decode(bitmap_b64, (int)(p - bitmap_b64), bitmap, NULL);
+
+		as_node** nodes = master ? table->master : table->prole;
+
+		for (uint32_t i = 0; i < N_PARTITIONS; i++) {
+			bool owns = (bitmap[i >> 3] & (0x80 >> (i & 7))) != 0;
+
+			if (owns) {
+				nodes[i] = node;
+			}
+			else if (nodes[i] == node) {
+				nodes[i] = 0;
+			}
+		}
+		ns = ++p;
+	}
+}
+
+//==========================================================
+// Benchmark.
+//
+
+static as_cluster g_cluster;
+static as_node* g_nodes[N_NODES];
+
+static uint64_t
+now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+cluster_init()
+{
+	memset(&g_cluster, 0, sizeof(g_cluster));
+	g_cluster.n_partitions = N_PARTITIONS;
+	g_cluster.conn_queue_size = 1;
+	g_cluster.partition_tables = as_partition_tables_create(0);
+	g_cluster.gc = as_vector_create(sizeof(as_gc_item), 8);
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		char name[AS_NODE_NAME_MAX_SIZE];
+		snprintf(name, sizeof(name), "BB9%013X", i);
+
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(3000);
+		addr.sin_addr.s_addr = htonl(0x0a000001 + i);
+		g_nodes[i] = as_node_create(&g_cluster, name, &addr);
+	}
+
+	for (uint32_t i = 0; i < N_NAMESPACES; i++) {
+		snprintf(g_bitwise[i].ns, sizeof(g_bitwise[i].ns), "ns%u", i);
+	}
+}
+
+static void
+cluster_gc()
+{
+	as_vector* gc = g_cluster.gc;
+
+	for (uint32_t i = 0; i < gc->size; i++) {
+		as_gc_item* item = as_vector_get(gc, i);
+		item->release_fn(item->data);
+	}
+	as_vector_clear(gc);
+}
+
+// Apply one map from all nodes, masters then proles.
+static void
+apply(maps* m, uint32_t map, bool bitwise, char* scratch)
+{
+	for (uint32_t master = 0; master < 2; master++) {
+		for (uint32_t node = 0; node < N_NODES; node++) {
+			memcpy(scratch, m->responses[map][master][node], m->sizes[map][master][node]);
+
+			if (bitwise) {
+				bitwise_update(g_nodes[node], scratch, master);
+			}
+			else {
+				as_partition_tables_update(&g_cluster, g_nodes[node], scratch, master);
+			}
+		}
+	}
+}
+
+static int
+check(maps* m, char* scratch)
+{
+	apply(m, 0, false, scratch);
+
+	for (uint32_t ns = 0; ns < N_NAMESPACES; ns++) {
+		as_partition_table* table = as_partition_tables_get(g_cluster.partition_tables, g_bitwise[ns].ns);
+
+		for (uint32_t pid = 0; pid < N_PARTITIONS; pid++) {
+			as_partition* p = &table->partitions[pid];
+			as_node* master = g_cluster.partition_nodes.array[p->master];
+			as_node* prole = g_cluster.partition_nodes.array[p->prole];
+
+			if (master != g_nodes[owner(0, true, ns, pid)] || prole != g_nodes[owner(0, false, ns, pid)]) {
+				fprintf(stderr, "ns%u partition %u mapped to the wrong node\n", ns, pid);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+static void
+run_update(const char* name, maps* m, bool bitwise, bool churn, uint32_t iterations, char* scratch)
+{
+	// Start from the first map.
+	apply(m, 0, bitwise, scratch);
+
+	uint64_t allocs = g_allocs;
+	uint64_t begin = now_ns();
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		apply(m, churn ? (i + 1) & 1 : 0, bitwise, scratch);
+
+		if (! bitwise) {
+			cluster_gc();
+		}
+	}
+
+	uint64_t elapsed = now_ns() - begin;
+	allocs = g_allocs - allocs;
+
+	// One tend applies 2 responses per node.
+	double per_tend = (double)elapsed / iterations;
+
+#ifdef DECODE_COUNT_ALLOCS
+	printf("update  %-16s %10.1f us/tend %8.1f ns/partition %6.1f allocs/tend\n", name,
+		per_tend / 1000, per_tend / (N_NAMESPACES * N_PARTITIONS * 2 * N_NODES),
+		(double)allocs / iterations);
+#else
+	printf("update  %-16s %10.1f us/tend %8.1f ns/partition\n", name,
+		per_tend / 1000, per_tend / (N_NAMESPACES * N_PARTITIONS * 2 * N_NODES));
+#endif
+}
+
+static void
+run_lookup(uint32_t iterations)
+{
+	cf_digest* digests = malloc(sizeof(cf_digest) * 4096);
+
+	for (uint32_t i = 0; i < 4096; i++) {
+		for (uint32_t j = 0; j < sizeof(cf_digest); j++) {
+			digests[i].digest[j] = (uint8_t)rand();
+		}
+	}
+
+	uint64_t begin = now_ns();
+
+	for (uint32_t i = 0; i < iterations; i++) {
+		as_partition_table* table = as_cluster_get_partition_table(&g_cluster, g_bitwise[i % N_NAMESPACES].ns);
+		as_node* node = as_partition_table_get_node(&g_cluster, table, &digests[i & 4095], i & 1);
+		as_node_release(node);
+	}
+
+	uint64_t elapsed = now_ns() - begin;
+	printf("lookup  %-16s %10.1f ns/key\n", "table+node", (double)elapsed / iterations);
+	free(digests);
+}
+
+int
+main(int argc, char* argv[])
+{
+	uint32_t iterations = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200;
+	maps m;
+	char* scratch = malloc(N_NAMESPACES * (16 + cf_b64_encoded_len(BITMAP_SZ)) + 1);
+
+	maps_init(&m);
+	cluster_init();
+
+	if (check(&m, scratch) != 0) {
+		return -1;
+	}
+
+	printf("%u nodes, %u namespaces of %u partitions: %zu table bytes, %zu bitwise\n",
+		N_NODES, N_NAMESPACES, N_PARTITIONS,
+		(size_t)N_NAMESPACES * (sizeof(as_partition_table) + sizeof(as_partition) * N_PARTITIONS),
+		sizeof(g_bitwise));
+
+	run_update("steady", &m, false, false, iterations, scratch);
+	run_update("steady bitwise", &m, true, false, iterations, scratch);
+	run_update("churn", &m, false, true, iterations, scratch);
+	run_update("churn bitwise", &m, true, true, iterations, scratch);
+	run_lookup(iterations * 10000);
+	return 0;
+}
@@ -23,12 +23,14 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 
 #if defined(__linux__) || defined(__APPLE__)
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 // Windows send() and recv() parameter types are different.
 #define cf_socket_data_t void
@@ -36,6 +38,16 @@
 
 #define cf_close(fd) (close(fd))
 
+// Monotonic clock in nanoseconds. Deadlines passed to the _ns functions below
+// are absolute times on this clock, 0 meaning no deadline.
+static inline uint64_t
+cf_socket_getns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 //------------------------------------------------
 // The API below is not used by the libevent2
 // client, so we'll postpone the Windows version.
@@ -45,10 +57,43 @@ cf_socket_read_timeout(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_dead
 extern int
 cf_socket_write_timeout(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline, int attempt_ms);
 extern int
+cf_socket_writev_timeout(int fd, const struct iovec *iov, int iovcnt, uint64_t trans_deadline, int attempt_ms);
+extern int
+cf_socket_write_timeout_ns(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline_ns, uint64_t attempt_ns);
+extern int
+cf_socket_writev_timeout_ns(int fd, const struct iovec *iov, int iovcnt, uint64_t trans_deadline_ns, uint64_t attempt_ns);
+extern int
 cf_socket_read_forever(int fd, uint8_t *buf, size_t buf_len);
+
+// Read at least min_len bytes, plus whatever more (up to buf_len) has already
+// arrived, without waiting for it. *read_r is set to the number of bytes read.
+extern int
+cf_socket_read_greedy_timeout(int fd, uint8_t *buf, size_t min_len, size_t buf_len, uint64_t trans_deadline, int attempt_ms, size_t *read_r);
+extern int
+cf_socket_read_greedy_timeout_ns(int fd, uint8_t *buf, size_t min_len, size_t buf_len, uint64_t trans_deadline_ns, uint64_t attempt_ns, size_t *read_r);
+extern int
+cf_socket_read_greedy_forever(int fd, uint8_t *buf, size_t min_len, size_t buf_len, size_t *read_r);
 extern int
 cf_socket_write_forever(int fd, uint8_t *buf, size_t buf_len);
 
+// Count of system calls made by the timed read/write functions on the calling
+// thread. Never reset - take the difference of two snapshots.
+typedef struct cf_socket_stats_s {
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t waits;
+} cf_socket_stats;
+
+extern cf_socket_stats*
+cf_socket_thread_stats();
+
+// Wait until one of the sockets has data to read, or an error condition the
+// read will report, or the deadline (on the cf_socket_getns() clock) passes. A
+// deadline of 0 means wait forever. Return the index of the first ready
+// socket, or -1 if none is.
+extern int
+cf_socket_wait_readable(const int *fds, int n_fds, uint64_t deadline_ns);
+
 extern void
 cf_print_sockaddr_in(char *prefix, struct sockaddr_in *sa_in);
 
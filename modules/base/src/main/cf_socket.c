@@ -36,6 +36,8 @@
 
 #include <fcntl.h>
 #include <netinet/tcp.h>
+#include <poll.h>
+#include <stdbool.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/time.h>
@@ -51,8 +53,6 @@
 #define SOL_TCP IPPROTO_TCP
 #endif // __APPLE__
 
-#define STACK_LIMIT (16 * 1024)
-
 // #define DEBUG_TIME
 
 #ifdef DEBUG_TIME
@@ -523,268 +523,430 @@ cf_socket_write_forever(int fd, uint8_t *buf, size_t buf_len)
 #endif // __linux__
 
 #if defined(__linux__) || defined(__APPLE__)
-// Use select() implementation for both Linux and Mac.
-// #if defined(__APPLE__)
+// Use optimistic non-blocking I/O with a poll() fallback for both Linux and Mac.
+
+#if defined(__APPLE__)
+// Mac sockets are created with SO_NOSIGPIPE instead.
+#define CF_SOCKET_SEND_FLAGS MSG_DONTWAIT
+#else
+#define CF_SOCKET_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#endif
+
+static __thread cf_socket_stats g_socket_stats;
+
+cf_socket_stats*
+cf_socket_thread_stats()
+{
+	return &g_socket_stats;
+}
 
 //
-// There is a conflict even among various versions of
-// linux, because it's common to compile kernels - or set ulimits -
-// where the FD_SETSIZE is much greater than a compiled version.
-// Thus, we can compute the required size of the fdset and use a reasonable size
-// the other option is using epoll, which is a little scary for this kind of
-// "I just want a timeout" usage.
-//
-// The reality is 8 bits per byte, but this calculation is a little more general
+// Errors which mean "no progress yet" rather than failure. It's apparently
+// possible to see ETIMEDOUT and EINPROGRESS here on some platforms, and the
+// select() based version always treated them as transient.
 //
-static inline size_t
-cf_fdset_size(int fd)
+static inline bool
+cf_socket_would_block(int err)
 {
-	// Roundup fd in increments of FD_SETSIZE and convert to bytes.
-	return ((fd / FD_SETSIZE) + 1) * FD_SETSIZE / 8;
+	return err == EAGAIN || err == EWOULDBLOCK || err == EINTR ||
+			err == EINPROGRESS || err == ETIMEDOUT;
 }
 
-// From glibc-2.15 (ubuntu 12.0.4+), the FD_* functions has a check on the 
-// number of fds passed. According to the man page of FD_SET, the behavior
-// is undefined for fd > 1024. But this is enforced from glibc-2.15
-// https://sourceware.org/bugzilla/show_bug.cgi?id=10352
 //
-// So, manipulate the base and the offset of the fd in it
-// 
-static inline void
-cf_fd_set(int fd, fd_set *fdset)
+// Deadline for one attempt - attempt_ns from now, but no later than the
+// transaction deadline.
+//
+static inline uint64_t
+cf_socket_deadline_ns(uint64_t trans_deadline_ns, uint64_t attempt_ns)
 {
-	FD_SET(fd%FD_SETSIZE, &fdset[fd/FD_SETSIZE]);
+	uint64_t deadline = cf_socket_getns() + attempt_ns;
+
+	if (trans_deadline_ns != 0 && trans_deadline_ns < deadline) {
+		deadline = trans_deadline_ns;
+	}
+
+	return deadline;
 }
 
-static inline int
-cf_fd_isset(int fd, fd_set *fdset)
+//
+// Same for the millisecond API. Only the time remaining is carried over, so
+// cf_getms() needn't read the same clock as cf_socket_getns().
+//
+static uint64_t
+cf_socket_deadline_ms(uint64_t trans_deadline, int attempt_ms)
 {
-	return FD_ISSET(fd%FD_SETSIZE, &fdset[fd/FD_SETSIZE]);
+	uint64_t now_ms = cf_getms();
+	uint64_t deadline_ms = now_ms + attempt_ms;
+
+	if (trans_deadline != 0 && trans_deadline < deadline_ms) {
+		deadline_ms = trans_deadline;
+	}
+
+	uint64_t now_ns = cf_socket_getns();
+
+	return deadline_ms > now_ms ? now_ns + (deadline_ms - now_ms) * 1000000 : now_ns;
 }
 
 //
-// Network socket helpers
-// Often, you know the amount you want to read, and you have a timeout.
-// Do the simple of wrapping in a select so we can read or write with timout
+// poll() until the deadline, which is in nanoseconds, 0 meaning wait forever.
+// On Linux ppoll() sleeps until exactly the deadline instead of a whole number
+// of milliseconds, so sub-millisecond budgets work and a wait never ends early
+// only to go round again. Elsewhere the wait is rounded up to the next
+// millisecond.
 //
-// There are two timeouts: the total deadline for the transaction,
-// and the maximum time before making progress on a connection which
-// we consider a failure so we can flip over to another node that might be healthier.
+// Return as poll() does, or -1 with errno ETIMEDOUT if the deadline has
+// already passed.
 //
-// Return the error number, not the number of bytes.
+static int
+cf_socket_poll(struct pollfd *pfds, int n_fds, uint64_t deadline)
+{
+	uint64_t left = 0;
+
+	if (deadline != 0) {
+		uint64_t now = cf_socket_getns();
+
+		if (now >= deadline) {
+			errno = ETIMEDOUT;
+			return -1;
+		}
+
+		left = deadline - now;
+	}
+
+	g_socket_stats.waits++;
+
+#if defined(__linux__)
+	struct timespec ts;
+
+	if (deadline != 0) {
+		ts.tv_sec = left / 1000000000;
+		ts.tv_nsec = left % 1000000000;
+	}
+
+	return ppoll(pfds, n_fds, deadline != 0 ? &ts : NULL, NULL);
+#else
+	return poll(pfds, n_fds, deadline != 0 ? (int)((left + 999999) / 1000000) : -1);
+#endif
+}
+
 //
-// there are two timeouts: the timeout for this attempt, and the deadline
-// for the entire transaction.
+// Block until the socket is ready for the given events or the deadline passes.
+// A deadline of 0 means wait forever. Unlike select(), poll() has no fd_set
+// sizing problems for large fds, and a single pollfd needs no setup or teardown
+// per call.
 //
-int
-cf_socket_read_timeout(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline, int attempt_ms)
+// Return 0 if the socket is ready (or has an error condition the following
+// read/write will report), otherwise the error number.
+//
+static int
+cf_socket_wait(int fd, short events, uint64_t deadline)
 {
-#ifdef DEBUG_TIME
-	uint64_t start = cf_getms();
-#endif
-	struct timeval tv;
-	size_t pos = 0;
-    
-	int flags;
-	if (-1 == (flags = fcntl(fd, F_GETFL, 0)))
-		flags = 0;
-	if (! (flags & O_NONBLOCK)) {
-		if (-1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
-			return(EBADF);
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = events;
+
+	while (true) {
+		pfd.revents = 0;
+
+		int rv = cf_socket_poll(&pfd, 1, deadline);
+
+		if (rv > 0) {
+			// POLLERR and POLLHUP are left for the read/write to report.
+			return (pfd.revents & POLLNVAL) ? EBADF : 0;
+		}
+
+		if (rv < 0 && errno != EINTR) {
+			return errno;
 		}
 	}
-    
-	// between the transaction deadline and the attempt_ms, find the lesser
-	// and create a deadline for this attempt
-	uint64_t deadline = attempt_ms + cf_getms();
-    if ((trans_deadline != 0) && (trans_deadline < deadline))
-		deadline = trans_deadline;
-    
-	// Setup fdset. This looks weird, but there's no guarantee that compiled
-	// FD_SETSIZE has much to do with the machine we're running on.
-	size_t rset_size = cf_fdset_size(fd);
-	fd_set* rset = (fd_set*)(rset_size > STACK_LIMIT ? cf_malloc(rset_size) : alloca(rset_size));
-	
-	if (!rset) {
-		cf_warn("fdset allocation error: %d", rset_size);
-		return -1;
+}
+
+int
+cf_socket_wait_readable(const int *fds, int n_fds, uint64_t deadline_ns)
+{
+	struct pollfd pfds[n_fds];
+
+	for (int i = 0; i < n_fds; i++) {
+		pfds[i].fd = fds[i];
+		pfds[i].events = POLLIN;
 	}
 
-	int rv = 0;
-	int try = 0;
+	while (true) {
+		for (int i = 0; i < n_fds; i++) {
+			pfds[i].revents = 0;
+		}
+
+		int rv = cf_socket_poll(pfds, n_fds, deadline_ns);
+
+		if (rv > 0) {
+			for (int i = 0; i < n_fds; i++) {
+				if (pfds[i].revents) {
+					return i;
+				}
+			}
+		}
+
+		if (rv < 0 && errno != EINTR) {
+			return -1;
+		}
+	}
+}
+
+//
+// Read at least min_len bytes, and whatever else up to buf_len has already
+// arrived. Set *read_r to the number of bytes read, even on failure.
+//
+static int
+cf_socket_read_range(int fd, uint8_t *buf, size_t min_len, size_t buf_len, uint64_t deadline, size_t *read_r)
+{
 #ifdef DEBUG_TIME
-	int select_busy = 0;
+	uint64_t start = cf_socket_getns();
+	int try = 0;
 #endif
-    
-	do {
-		uint64_t now = cf_getms();
-		if (now > deadline) {
+	size_t pos = 0;
+	int rv = 0;
+
+	while (pos < min_len) {
+		g_socket_stats.reads++;
+
+		ssize_t r_bytes = recv(fd, buf + pos, buf_len - pos, MSG_DONTWAIT);
+
+		if (r_bytes > 0) {
+			pos += r_bytes;
+			continue;
+		}
+
+		if (r_bytes == 0) {
+			// We believe this means that the server has closed this socket.
+			rv = EBADF;
+			break;
+		}
+
+		if (! cf_socket_would_block(errno)) {
 #ifdef DEBUG_TIME
-			debug_time_printf("socket readselect timeout", try, select_busy, start, now, deadline);
+			debug_time_printf("socket read error", try, 0, start, cf_socket_getns(), deadline);
 #endif
-			rv = ETIMEDOUT;
-			goto Out;
-        }
-        
-		uint64_t ms_left = deadline - now;
-		tv.tv_sec = ms_left / 1000;
-		tv.tv_usec = (ms_left % 1000) * 1000;
-        
-		memset((void*)rset, 0, rset_size);
-		cf_fd_set(fd, rset);
-		rv = select(fd +1, rset /*readfd*/, 0 /*writefd*/, 0 /*oobfd*/, &tv);
-        
-		// we only have one fd, so we know it's ours?
-		if ((rv > 0) && cf_fd_isset(fd, rset)) {
-            
-			int r_bytes = (int)read(fd, buf + pos, buf_len - pos );
-            
-			if (r_bytes > 0) {
-				pos += r_bytes;
-            }
-			else if (r_bytes == 0) {
-				// We believe this means that the server has closed this socket.
-				rv = EBADF;
-				goto Out;
-			}
-            else if (errno != ETIMEDOUT
-                     // It's apparently possible that select() returns successfully yet
-                     // the socket is not ready for reading.
-                     && errno != EWOULDBLOCK && errno != EINPROGRESS && errno != EAGAIN) {
+			rv = errno;
+			break;
+		}
+
+		rv = cf_socket_wait(fd, POLLIN, deadline);
+
+		if (rv != 0) {
 #ifdef DEBUG_TIME
-    			debug_time_printf("socket read timeout", try, select_busy, start, now, deadline);
+			debug_time_printf("socket read timeout", try, 0, start, cf_socket_getns(), deadline);
 #endif
-				rv = errno;
-				goto Out;
-            }
+			break;
 		}
-		else if (rv == 0) {
 #ifdef DEBUG_TIME
-			select_busy++;
+		try++;
 #endif
-        }
-        else {
-			if (rv == -1)  {
-				rv = errno;
-				goto Out;
-			}
-        }
-        
-        try++;
-        
-	} while( pos < buf_len );
-    
-	rv = 0; // success!
-    
-Out:
-	if (rset_size > STACK_LIMIT) {
-		cf_free(rset);
 	}
-	return( rv );
-}
 
+	*read_r = pos;
+	return rv;
+}
 
-int
-cf_socket_write_timeout(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline, int attempt_ms)
+static int
+cf_socket_write_range(int fd, uint8_t *buf, size_t buf_len, uint64_t deadline)
 {
 #ifdef DEBUG_TIME
-	uint64_t start = cf_getms();
+	uint64_t start = cf_socket_getns();
+	int try = 0;
 #endif
-	struct timeval tv;
 	size_t pos = 0;
-    
-	int flags;
-	if (-1 == (flags = fcntl(fd, F_GETFL, 0)))
-		flags = 0;
-	if (! (flags & O_NONBLOCK)) {
-		if (-1 == fcntl(fd, F_SETFL, flags | O_NONBLOCK)) {
-			return(ENOENT);
+
+	while (pos < buf_len) {
+		g_socket_stats.writes++;
+
+		ssize_t w_bytes = send(fd, buf + pos, buf_len - pos, CF_SOCKET_SEND_FLAGS);
+
+		if (w_bytes > 0) {
+			pos += w_bytes;
+			continue;
 		}
-	}
-    
-	// between the transaction deadline and the attempt_ms, find the lesser
-	// and create a deadline for this attempt
-	uint64_t deadline = attempt_ms + cf_getms();
-    if ((trans_deadline != 0) && (trans_deadline < deadline))
-		deadline = trans_deadline;
-    
-	// Setup fdset. This looks weird, but there's no guarantee that compiled
-	// FD_SETSIZE has much to do with the machine we're running on.
-	size_t wset_size = cf_fdset_size(fd);
-	fd_set* wset = (fd_set*)(wset_size > STACK_LIMIT ? cf_malloc(wset_size) : alloca(wset_size));
-	   
-	if (!wset) {
-		cf_warn("fdset allocation error: %d", wset_size);
-		return -1;
-	}
 
-	int rv = 0;
-	int try = 0;
+		if (w_bytes == 0) {
+			// We shouldn't see 0 returned unless we try to write 0 bytes, which we don't.
+			return EBADF;
+		}
+
+		if (! cf_socket_would_block(errno)) {
 #ifdef DEBUG_TIME
-	int select_busy = 0;
+			debug_time_printf("socket write error", try, 0, start, cf_socket_getns(), deadline);
 #endif
-    
-	do {
-		uint64_t now = cf_getms();
-		if (now > deadline) {
+			return errno;
+		}
+
+		int rv = cf_socket_wait(fd, POLLOUT, deadline);
+
+		if (rv != 0) {
 #ifdef DEBUG_TIME
-			debug_time_printf("socket writeselect timeout", try, select_busy, start, now, deadline);
+			debug_time_printf("socket write timeout", try, 0, start, cf_socket_getns(), deadline);
 #endif
-			rv = ETIMEDOUT;
-			goto Out;
-        }
-        
-		uint64_t ms_left = deadline - now;
-		tv.tv_sec = ms_left / 1000;
-		tv.tv_usec = (ms_left % 1000) * 1000;
-        
-		memset((void*)wset, 0, wset_size);
-		cf_fd_set(fd, wset);
-        
-		rv = select(fd +1, 0 /*readfd*/, wset /*writefd*/, 0/*oobfd*/, &tv);
-        
-		// we only have one fd, so we know it's ours, but select seems confused sometimes - do the safest thing
-		if ((rv > 0) && cf_fd_isset(fd, wset)) {
-            
-			int r_bytes = (int)write(fd, buf + pos, buf_len - pos );
-            
-			if (r_bytes > 0) {
-				pos += r_bytes;
-				if (pos >= buf_len)	{ rv = 0; goto Out; } // done happily
-            }
-			else if (r_bytes == 0) {
-				// We shouldn't see 0 returned unless we try to write 0 bytes, which we don't.
-				rv = EBADF;
-				goto Out;
-			}
-            else if (errno != ETIMEDOUT
-                     && errno != EWOULDBLOCK && errno != EINPROGRESS && errno != EAGAIN) {
+			return rv;
+		}
 #ifdef DEBUG_TIME
-    			debug_time_printf("socket write timeout", try, select_busy, start, now, deadline);
+		try++;
 #endif
-                rv = errno;
-                goto Out;
-			}
+	}
+
+	return 0;
+}
+
+//
+// The iovec array isn't modified - progress through it is tracked on a copy.
+// Keep iovcnt small, it must not exceed IOV_MAX.
+//
+static int
+cf_socket_writev_range(int fd, const struct iovec *iov, int iovcnt, uint64_t deadline)
+{
+#ifdef DEBUG_TIME
+	uint64_t start = cf_socket_getns();
+	int try = 0;
+#endif
+	struct iovec v[iovcnt];
+	memcpy(v, iov, sizeof(struct iovec) * iovcnt);
+
+	struct iovec *cur = v;
+	int n = iovcnt;
+	size_t written = 0;
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+
+	while (true) {
+		// Skip what's been written, including any empty buffers.
+		while (n > 0 && written >= cur->iov_len) {
+			written -= cur->iov_len;
+			cur++;
+			n--;
+		}
+
+		if (n == 0) {
+			break;
+		}
+
+		cur->iov_base = (uint8_t *)cur->iov_base + written;
+		cur->iov_len -= written;
+		written = 0;
+
+		msg.msg_iov = cur;
+		msg.msg_iovlen = n;
+
+		g_socket_stats.writes++;
+
+		ssize_t w_bytes = sendmsg(fd, &msg, CF_SOCKET_SEND_FLAGS);
+
+		if (w_bytes > 0) {
+			written = w_bytes;
+			continue;
 		}
-        else if (rv == 0) {
+
+		if (w_bytes == 0) {
+			// We shouldn't see 0 returned unless we try to write 0 bytes, which we don't.
+			return EBADF;
+		}
+
+		if (! cf_socket_would_block(errno)) {
 #ifdef DEBUG_TIME
-        	select_busy++;
+			debug_time_printf("socket writev error", try, 0, start, cf_socket_getns(), deadline);
 #endif
-    	}
-        else {
-			if (rv == -1)	{ rv = errno; goto Out; }
-        }
-        
+			return errno;
+		}
+
+		int rv = cf_socket_wait(fd, POLLOUT, deadline);
+
+		if (rv != 0) {
+#ifdef DEBUG_TIME
+			debug_time_printf("socket writev timeout", try, 0, start, cf_socket_getns(), deadline);
+#endif
+			return rv;
+		}
+#ifdef DEBUG_TIME
 		try++;
-        
-	} while( pos < buf_len );
-    rv = 0;
-    
-Out:
-	if (wset_size > STACK_LIMIT) {
-		cf_free(wset);
+#endif
 	}
-	return( rv );
+
+	return 0;
+}
+
+//
+// Network socket helpers
+// Often, you know the amount you want to read, and you have a timeout.
+//
+// The socket is read or written first, with MSG_DONTWAIT, and we only wait
+// for readiness if that would block. A write to a pooled socket and the read
+// of a small response usually complete without waiting at all, so the common
+// case is one system call per read or write instead of fcntl() + select() +
+// read(). MSG_DONTWAIT also means we don't depend on (or change) the socket's
+// O_NONBLOCK flag.
+//
+// There are two timeouts: the total deadline for the transaction,
+// and the maximum time before making progress on a connection which
+// we consider a failure so we can flip over to another node that might be healthier.
+// The _ns versions take both in nanoseconds, the transaction deadline being
+// on the cf_socket_getns() clock. Waits are in nanoseconds either way.
+//
+// Return the error number, not the number of bytes.
+//
+int
+cf_socket_read_timeout(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline, int attempt_ms)
+{
+	size_t read;
+	return cf_socket_read_range(fd, buf, buf_len, buf_len, cf_socket_deadline_ms(trans_deadline, attempt_ms), &read);
+}
+
+
+int
+cf_socket_read_greedy_timeout(int fd, uint8_t *buf, size_t min_len, size_t buf_len, uint64_t trans_deadline, int attempt_ms, size_t *read_r)
+{
+	return cf_socket_read_range(fd, buf, min_len, buf_len, cf_socket_deadline_ms(trans_deadline, attempt_ms), read_r);
+}
+
+
+int
+cf_socket_read_greedy_timeout_ns(int fd, uint8_t *buf, size_t min_len, size_t buf_len, uint64_t trans_deadline_ns, uint64_t attempt_ns, size_t *read_r)
+{
+	return cf_socket_read_range(fd, buf, min_len, buf_len, cf_socket_deadline_ns(trans_deadline_ns, attempt_ns), read_r);
+}
+
+
+int
+cf_socket_read_greedy_forever(int fd, uint8_t *buf, size_t min_len, size_t buf_len, size_t *read_r)
+{
+	return cf_socket_read_range(fd, buf, min_len, buf_len, 0, read_r);
+}
+
+
+int
+cf_socket_write_timeout(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline, int attempt_ms)
+{
+	return cf_socket_write_range(fd, buf, buf_len, cf_socket_deadline_ms(trans_deadline, attempt_ms));
+}
+
+
+int
+cf_socket_write_timeout_ns(int fd, uint8_t *buf, size_t buf_len, uint64_t trans_deadline_ns, uint64_t attempt_ns)
+{
+	return cf_socket_write_range(fd, buf, buf_len, cf_socket_deadline_ns(trans_deadline_ns, attempt_ns));
+}
+
+//
+// Gathered versions of cf_socket_write_timeout(), so a message can be sent
+// from several buffers without first copying them into one.
+//
+int
+cf_socket_writev_timeout(int fd, const struct iovec *iov, int iovcnt, uint64_t trans_deadline, int attempt_ms)
+{
+	return cf_socket_writev_range(fd, iov, iovcnt, cf_socket_deadline_ms(trans_deadline, attempt_ms));
+}
+
+
+int
+cf_socket_writev_timeout_ns(int fd, const struct iovec *iov, int iovcnt, uint64_t trans_deadline_ns, uint64_t attempt_ns)
+{
+	return cf_socket_writev_range(fd, iov, iovcnt, cf_socket_deadline_ns(trans_deadline_ns, attempt_ns));
 }
 
 //
@@ -830,8 +992,8 @@ int
 cf_socket_write_forever(int fd, uint8_t *buf, size_t buf_len)
 {
 	// MacOS will return "socket not connected" errors even when connection is
-	// blocking.  Therefore, select() is required before writing.  Since write
-	// timeout function also calls select(), use write timeout function with
+	// blocking.  Therefore, we must wait for writability before writing.  Since
+	// write timeout function also waits, use write timeout function with
 	// 1 minute timeout.
 	return cf_socket_write_timeout(fd, buf, buf_len, 0, 60000);
 }
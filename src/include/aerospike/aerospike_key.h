@@ -36,10 +36,12 @@
 
 #include <aerospike/aerospike.h>
 #include <aerospike/as_error.h>
+#include <aerospike/as_event.h>
 #include <aerospike/as_key.h>
 #include <aerospike/as_list.h>
 #include <aerospike/as_operations.h>
 #include <aerospike/as_policy.h>
+#include <aerospike/as_prepared_write.h>
 #include <aerospike/as_record.h>
 #include <aerospike/as_status.h>
 #include <aerospike/as_val.h>
@@ -182,6 +184,49 @@ as_status aerospike_key_put(
 	const as_key * key, as_record * rec
 	);
 
+/**
+ *	Prepare repeated writes of records with the same bins as rec. The request
+ *	header, namespace and set, and the bin names are compiled once - see
+ *	as_prepared_write.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if an error occurs.
+ *	@param policy		The policy to use for the writes. If NULL, then the default policy will be used.
+ *	@param ns			The namespace of the records.
+ *	@param set			The set of the records.
+ *	@param rec 			A record with the bins to be written.
+ *	@param pw			The prepared write to initialize. Destroy with as_prepared_write_destroy().
+ *
+ *	@return AEROSPIKE_OK if successful. Otherwise an error.
+ *
+ *	@ingroup key_operations
+ */
+as_status aerospike_key_put_prepare(
+	aerospike * as, as_error * err, const as_policy_write * policy,
+	const char * ns, const char * set, const as_record * rec, as_prepared_write * pw
+	);
+
+/**
+ *	Store a record in the cluster, as aerospike_key_put() with the prepared
+ *	write's policy. The record must have the prepared bins, in the same order
+ *	and with values of the same types, and the key must be in the prepared
+ *	namespace and set.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if an error occurs.
+ *	@param pw			The prepared write.
+ *	@param key			The key of the record.
+ *	@param rec 			The record containing the data to be written.
+ *
+ *	@return AEROSPIKE_OK if successful. Otherwise an error.
+ *
+ *	@ingroup key_operations
+ */
+as_status aerospike_key_put_prepared(
+	aerospike * as, as_error * err, const as_prepared_write * pw,
+	const as_key * key, as_record * rec
+	);
+
 /**
  *	Remove a record from the cluster.
  *
@@ -294,3 +339,122 @@ as_status aerospike_key_apply(
 	const char * module, const char * function, as_list * arglist, 
 	as_val ** result
 	);
+
+/******************************************************************************
+ *	ASYNCHRONOUS FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Asynchronously look up a record by key, then return all bins.
+ *
+ *	The command runs on one of the client's event loops - see as_config.async_loops.
+ *	If this function returns an error, the listener is not called.  Otherwise the
+ *	listener is called on an event loop thread when the command completes, fails
+ *	or times out.
+ *
+ *	~~~~~~~~~~{.c}
+ *	void my_listener(as_error * err, as_record * rec, void * udata)
+ *	{
+ *		if ( err ) {
+ *			fprintf(stderr, "error(%d) %s\n", err->code, err->message);
+ *		}
+ *		else {
+ *			// rec is destroyed after the listener returns.
+ *		}
+ *	}
+ *
+ *	as_key key;
+ *	as_key_init(&key, "ns", "set", "key");
+ *	
+ *	if ( aerospike_key_get_async(&as, &err, NULL, &key, my_listener, NULL) != AEROSPIKE_OK ) {
+ *		fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+ *	}
+ *	~~~~~~~~~~
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param listener		Called with the result.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ *
+ *	@ingroup key_operations
+ */
+as_status aerospike_key_get_async(
+	aerospike * as, as_error * err, const as_policy_read * policy, 
+	const as_key * key, 
+	as_async_record_listener listener, void * udata
+	);
+
+/**
+ *	Asynchronously store a record in the cluster.
+ *
+ *	The record's bins are copied into the request, so the record may be
+ *	destroyed as soon as this function returns.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param rec 			The record containing the data to be written.
+ *	@param listener		Called with the result.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ *
+ *	@ingroup key_operations
+ */
+as_status aerospike_key_put_async(
+	aerospike * as, as_error * err, const as_policy_write * policy, 
+	const as_key * key, as_record * rec,
+	as_async_write_listener listener, void * udata
+	);
+
+/**
+ *	Asynchronously look up a record by key, then perform specified operations.
+ *
+ *	The record passed to the listener holds the results of AS_OPERATOR_READ operations.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param ops			The operations to perform on the record.
+ *	@param listener		Called with the result.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ *
+ *	@ingroup key_operations
+ */
+as_status aerospike_key_operate_async(
+	aerospike * as, as_error * err, const as_policy_operate * policy, 
+	const as_key * key, const as_operations * ops,
+	as_async_record_listener listener, void * udata
+	);
+
+/**
+ *	Asynchronously look up a record by key, then apply the UDF.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param module		The module containing the function to execute.
+ *	@param function 	The function to execute.
+ *	@param arglist 		The arguments for the function.
+ *	@param listener		Called with the return value from the function.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ *
+ *	@ingroup key_operations
+ */
+as_status aerospike_key_apply_async(
+	aerospike * as, as_error * err, const as_policy_apply * policy, 
+	const as_key * key,
+	const char * module, const char * function, as_list * arglist, 
+	as_async_value_listener listener, void * udata
+	);
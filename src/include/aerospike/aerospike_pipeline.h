@@ -0,0 +1,202 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+
+/**
+ *	@defgroup pipeline_operations Pipeline Operations
+ *	@ingroup client_operations
+ *
+ *	The pipeline API sends many independent single record commands to each
+ *	node back-to-back on one connection, then reads the responses in order.
+ *	A pipeline of K commands to a node costs about one write, a few reads and
+ *	one round trip instead of K of each.
+ */
+
+#pragma once 
+
+#include <aerospike/aerospike.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	Type of pipelined command.
+ *
+ *	@ingroup pipeline_operations
+ */
+typedef enum as_pipeline_type_e {
+	/**
+	 *	Read all bins of the record.
+	 */
+	AS_PIPELINE_GET,
+	
+	/**
+	 *	Write the bins of rec.
+	 */
+	AS_PIPELINE_PUT,
+	
+	/**
+	 *	Perform ops on the record.
+	 */
+	AS_PIPELINE_OPERATE
+} as_pipeline_type;
+
+/**
+ *	Pipelined command and its result.  Initialize with as_pipeline_get(),
+ *	as_pipeline_put() or as_pipeline_operate().
+ *
+ *	@ingroup pipeline_operations
+ */
+typedef struct as_pipeline_command_s {
+	/**
+	 *	Key of the record.  Must stay valid until aerospike_pipeline() returns.
+	 */
+	const as_key * key;
+	
+	/**
+	 *	Command type.
+	 */
+	as_pipeline_type type;
+	
+	/**
+	 *	Record to write, for AS_PIPELINE_PUT.
+	 */
+	as_record * rec;
+	
+	/**
+	 *	Operations to perform, for AS_PIPELINE_OPERATE.
+	 */
+	const as_operations * ops;
+	
+	/**
+	 *	Result of the command.
+	 */
+	as_status status;
+	
+	/**
+	 *	Record read by AS_PIPELINE_GET, or bins returned by AS_PIPELINE_OPERATE,
+	 *	if status is AEROSPIKE_OK.  Otherwise NULL.  The caller must destroy it
+	 *	with as_record_destroy().
+	 */
+	as_record * result;
+} as_pipeline_command;
+
+/******************************************************************************
+ *	INLINE FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Initialize a command that reads all bins of a record.
+ *
+ *	@ingroup pipeline_operations
+ */
+static inline void as_pipeline_get(as_pipeline_command * cmd, const as_key * key)
+{
+	cmd->key = key;
+	cmd->type = AS_PIPELINE_GET;
+	cmd->rec = NULL;
+	cmd->ops = NULL;
+	cmd->status = AEROSPIKE_OK;
+	cmd->result = NULL;
+}
+
+/**
+ *	Initialize a command that writes a record.  The record must stay valid
+ *	until aerospike_pipeline() returns.
+ *
+ *	@ingroup pipeline_operations
+ */
+static inline void as_pipeline_put(as_pipeline_command * cmd, const as_key * key, as_record * rec)
+{
+	as_pipeline_get(cmd, key);
+	cmd->type = AS_PIPELINE_PUT;
+	cmd->rec = rec;
+}
+
+/**
+ *	Initialize a command that performs operations on a record.  The operations
+ *	must stay valid until aerospike_pipeline() returns.
+ *
+ *	@ingroup pipeline_operations
+ */
+static inline void as_pipeline_operate(as_pipeline_command * cmd, const as_key * key, const as_operations * ops)
+{
+	as_pipeline_get(cmd, key);
+	cmd->type = AS_PIPELINE_OPERATE;
+	cmd->ops = ops;
+}
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Run independent single record commands, pipelining them per node.
+ *
+ *	Commands are grouped by the node that owns each key.  Each group is
+ *	compiled and written to one connection to its node without waiting, then
+ *	the responses are read in order.  The status of each command, and the
+ *	record for reads and operates, is set in the command.
+ *
+ *	Commands are not retried.  If a node's connection fails, commands that got
+ *	no response are set to the failure status, and may or may not have been
+ *	applied.
+ *
+ *	~~~~~~~~~~{.c}
+ *	as_pipeline_command cmds[2];
+ *	as_pipeline_put(&cmds[0], &key1, &rec1);
+ *	as_pipeline_put(&cmds[1], &key2, &rec2);
+ *	
+ *	if ( aerospike_pipeline(&as, &err, NULL, cmds, 2) != AEROSPIKE_OK ) {
+ *		fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+ *	}
+ *	for ( int i = 0; i < 2; i++ ) {
+ *		if ( cmds[i].status != AEROSPIKE_OK ) {
+ *			// handle failed command
+ *		}
+ *	}
+ *	~~~~~~~~~~
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if an error occurs.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *						Its timeout bounds the whole call.  Its key, exists and gen settings apply to puts,
+ *						its key and gen settings to operates.
+ *	@param cmds			The commands to run.
+ *	@param n_cmds		The number of commands.
+ *
+ *	@return AEROSPIKE_OK if every command got a response, even if the response was an error.
+ *	Otherwise the first failure to get a response.
+ *
+ *	@ingroup pipeline_operations
+ */
+as_status aerospike_pipeline(
+	aerospike * as, as_error * err, const as_policy_write * policy, 
+	as_pipeline_command * cmds, uint32_t n_cmds
+	);
@@ -28,6 +28,8 @@
 #include <citrusleaf/cl_types.h>
 #include "ck_pr.h"
 
+struct as_event_loop_s;
+
 /******************************************************************************
  *	MACROS
  *****************************************************************************/
@@ -103,6 +105,97 @@ typedef struct as_gc_item_s {
 	as_release_fn release_fn;
 } as_gc_item;
 
+/**
+ *	Hedged read counts of a cluster.  Never reset - take the difference of
+ *	two snapshots.
+ */
+typedef struct as_cluster_hedge_stats_s {
+	/**
+	 *	Reads also sent to the partition's other replica, because the first
+	 *	had not responded within the read policy's hedge_delay.
+	 */
+	uint64_t issued;
+	
+	/**
+	 *	Hedged reads the other replica responded to first.
+	 */
+	uint64_t won;
+} as_cluster_hedge_stats;
+
+/**
+ *	Read cache counts of a cluster.  Hits, misses, evictions and
+ *	invalidations are never reset - take the difference of two snapshots.
+ */
+typedef struct as_cluster_read_cache_stats_s {
+	/**
+	 *	Reads served from the cache.
+	 */
+	uint64_t hits;
+	
+	/**
+	 *	Reads which found no entry, or one that was too old or expired.
+	 */
+	uint64_t misses;
+	
+	/**
+	 *	Entries dropped to stay within the memory cap.
+	 */
+	uint64_t evictions;
+	
+	/**
+	 *	Entries dropped because this client wrote or removed the record.
+	 */
+	uint64_t invalidations;
+	
+	/**
+	 *	Entries in the cache now.
+	 */
+	uint64_t entries;
+	
+	/**
+	 *	Bytes used by the cache now.
+	 */
+	uint64_t bytes;
+} as_cluster_read_cache_stats;
+
+/**
+ *	Cluster tend timings.  Counts and totals are never reset - take the
+ *	difference of two snapshots.
+ */
+typedef struct as_cluster_tend_stats_s {
+	/**
+	 *	Cluster tends completed.
+	 */
+	uint64_t tends;
+	
+	/**
+	 *	Microseconds spent in all tends.
+	 */
+	uint64_t total_us;
+	
+	/**
+	 *	Microseconds taken by the longest tend.
+	 */
+	uint64_t max_us;
+	
+	/**
+	 *	Microseconds taken by the most recent tend.
+	 */
+	uint64_t last_us;
+	
+	/**
+	 *	Microseconds taken by the slowest node refresh in the most recent tend.
+	 */
+	uint64_t last_refresh_max_us;
+	
+	/**
+	 *	Node refreshes that failed.
+	 */
+	uint64_t refresh_failures;
+} as_cluster_tend_stats;
+
+struct as_read_cache_s;
+
 /**
  *	Cluster of server nodes.
  */
@@ -119,6 +212,12 @@ typedef struct as_cluster_s {
 	 */
 	as_partition_tables* partition_tables;
 	
+	/**
+	 *	@private
+	 *	Nodes partition tables refer to by index.
+	 */
+	as_partition_nodes partition_nodes;
+	
 	/**
 	 *	@private
 	 *	Batch process queue.
@@ -184,6 +283,30 @@ typedef struct as_cluster_s {
 	 */
 	as_addr_map* ip_map;
 	
+	/**
+	 *	@private
+	 *	Event loops running asynchronous commands.
+	 */
+	struct as_event_loop_s* event_loops;
+	
+	/**
+	 *	@private
+	 *	Length of event_loops array.  0 if asynchronous commands are disabled.
+	 */
+	uint32_t event_loops_size;
+	
+	/**
+	 *	@private
+	 *	Round-robin event loop index.
+	 */
+	uint32_t event_loop_index;
+	
+	/**
+	 *	@private
+	 *	Maximum asynchronous commands in flight per node, 0 if unlimited.
+	 */
+	uint32_t async_max_in_flight;
+	
 	/**
 	 *	@private
 	 *	Size of node's synchronous connection pool.
@@ -202,12 +325,30 @@ typedef struct as_cluster_s {
 	 */
 	uint32_t max_socket_idle;
 	
+	/**
+	 *	@private
+	 *	Pooled sockets used within this many milliseconds skip the liveness check.
+	 */
+	uint32_t conn_check_idle_ms;
+	
+	/**
+	 *	@private
+	 *	Connections the tend thread keeps open in each node's pool.
+	 */
+	uint32_t min_conns_per_node;
+	
 	/**
 	 *	@private
 	 *	Milliseconds between cluster tends.
 	 */
 	uint32_t tend_interval;
 	
+	/**
+	 *	@private
+	 *	Smallest bin value written from the caller's memory, 0 if disabled.
+	 */
+	uint32_t write_gather_threshold;
+	
 	/**
 	 *	@private
 	 *	Random node index.
@@ -244,6 +385,67 @@ typedef struct as_cluster_s {
 	 */
 	volatile bool valid;
 	
+	/**
+	 *	@private
+	 *	Maximum retries of a single record command.
+	 */
+	uint32_t max_retries;
+	
+	/**
+	 *	@private
+	 *	Milliseconds to sleep before the first retry, doubled for each further retry.
+	 */
+	uint32_t retry_sleep_ms;
+	
+	/**
+	 *	@private
+	 *	Decode records into a per-record arena.
+	 */
+	bool record_arena;
+	
+	/**
+	 *	@private
+	 *	Hedged read counts.
+	 */
+	as_cluster_hedge_stats hedge_stats;
+	
+	/**
+	 *	@private
+	 *	Read cache, or NULL if disabled.
+	 */
+	struct as_read_cache_s* read_cache;
+	
+	/**
+	 *	@private
+	 *	Tend timings.
+	 */
+	as_cluster_tend_stats tend_stats;
+	
+	/**
+	 *	@private
+	 *	Node refreshes for tend workers, NULL if nodes are refreshed on the
+	 *	tend thread.
+	 */
+	cf_queue* tend_q;
+	
+	/**
+	 *	@private
+	 *	Node refreshes completed by tend workers.
+	 */
+	cf_queue* tend_complete_q;
+	
+	/**
+	 *	@private
+	 *	Tend worker threads.
+	 */
+	pthread_t* tend_threads;
+	
+	/**
+	 *	@private
+	 *	Number of tend worker threads.
+	 */
+	uint32_t tend_threads_size;
+	
 	/**
 	 *	@private
 	 *	Batch transaction lock.
@@ -303,6 +505,24 @@ as_cluster_is_connected(as_cluster* cluster);
 void
 as_cluster_get_node_names(as_cluster* cluster, int* n_nodes, char** node_names);
 
+/**
+ *	Get the cluster's hedged read counts.
+ */
+void
+as_cluster_get_hedge_stats(as_cluster* cluster, as_cluster_hedge_stats* stats);
+
+/**
+ *	Get the cluster's read cache counts.  All are 0 if the cache is disabled.
+ */
+void
+as_cluster_get_read_cache_stats(as_cluster* cluster, as_cluster_read_cache_stats* stats);
+
+/**
+ *	Get the cluster's tend timings.
+ */
+void
+as_cluster_get_tend_stats(as_cluster* cluster, as_cluster_tend_stats* stats);
+
 /**
  *	Reserve reference counted access to cluster nodes.
  */
@@ -419,3 +639,46 @@ as_node_get(as_cluster* cluster, const char* ns, const cf_digest* d, bool write)
 	as_partition_table* table = as_cluster_get_partition_table(cluster, ns);
 	return as_partition_table_get_node(cluster, table, d, write);
 }
+
+/**
+ *	@private
+ *	Get the replica of the digest's partition to read from with AS_POLICY_REPLICA_FASTEST.  If
+ *	there is no mapped node, a random node is used instead.
+ *	as_nodes_release() must be called when done with node.
+ */
+as_node*
+as_partition_table_get_fastest(as_cluster* cluster, as_partition_table* table, const cf_digest* d);
+
+/**
+ *	@private
+ *	Get the replica of the digest's partition to read from with AS_POLICY_REPLICA_FASTEST.  If
+ *	there is no mapped node, a random node is used instead.
+ *	as_nodes_release() must be called when done with node.
+ */
+static inline as_node*
+as_node_get_fastest(as_cluster* cluster, const char* ns, const cf_digest* d)
+{
+	as_partition_table* table = as_cluster_get_partition_table(cluster, ns);
+	return as_partition_table_get_fastest(cluster, table, d);
+}
+
+/**
+ *	@private
+ *	Get the replica of the digest's partition other than node, or NULL if the partition has no
+ *	other active replica.
+ *	as_nodes_release() must be called when done with node.
+ */
+as_node*
+as_partition_table_get_other(as_cluster* cluster, as_partition_table* table, const cf_digest* d, as_node* node);
+
+/**
+ *	@private
+ *	Get the replica of the digest's partition other than node, or NULL if there is none.
+ *	as_nodes_release() must be called when done with node.
+ */
+static inline as_node*
+as_node_get_other(as_cluster* cluster, const char* ns, const cf_digest* d, as_node* node)
+{
+	as_partition_table* table = as_cluster_get_partition_table(cluster, ns);
+	return table ? as_partition_table_get_other(cluster, table, d, node) : 0;
+}
@@ -281,14 +281,34 @@ typedef struct as_config_s {
 	uint32_t max_threads;
 	
 	/**
-	 *	@private
-	 *	Not currently used.
 	 *	Maximum socket idle in seconds.  Socket connection pools will discard sockets
-	 *	that have been idle longer than the maximum.
+	 *	that have been idle longer than the maximum.  Should be below the server's
+	 *	proto-fd-idle-ms.  Set to 0 to keep idle sockets.
 	 *	Default: 14
 	 */
 	uint32_t max_socket_idle_sec;
 	
+	/**
+	 *	Pooled sockets used within this many milliseconds are handed out to single
+	 *	record commands without first checking that the server hasn't closed them,
+	 *	saving a system call per command.  A command that finds its socket closed
+	 *	before any response arrives is sent once more on a new connection.  Set to 0
+	 *	to check every pooled socket.
+	 *	Default: 1000
+	 */
+	uint32_t conn_check_idle_ms;
+	
+	/**
+	 *	Minimum number of synchronous connections to keep open to each server node.
+	 *	The cluster tend thread opens (and authenticates) them when a node is added,
+	 *	including during aerospike_connect(), and tops the pool back up on every
+	 *	tend, so the first commands don't each pay for a new connection.  Idle
+	 *	connections are still closed after max_socket_idle_sec and replaced on the
+	 *	next tend.  Limited to max_threads + 1.
+	 *	Default: 0
+	 */
+	uint32_t min_conns_per_node;
+	
 	/**
 	 *	Initial host connection timeout in milliseconds.  The timeout when opening a connection
 	 *	to the server host for the first time.
@@ -302,6 +322,85 @@ typedef struct as_config_s {
 	 */
 	uint32_t tender_interval;
 
+	/**
+	 *	Threads refreshing nodes concurrently during a cluster tend, so one slow
+	 *	or unreachable node does not delay detecting changes on the others.
+	 *	Results are applied in node order once all refreshes have completed.
+	 *	0 or 1 refreshes nodes one after another on the tend thread.
+	 *	Default: 8
+	 */
+	uint32_t tend_threads;
+
+	/**
+	 *	Size in bytes from which string and blob bin values are written to the
+	 *	socket directly from the application's memory, instead of being copied
+	 *	into the request buffer first.  Set to 0 to always copy.
+	 *	Default: 16384
+	 */
+	uint32_t write_gather_threshold;
+
+	/**
+	 *	Milliseconds after which a thread's request and response buffers are
+	 *	trimmed if unused, or if much larger than the messages that used them.
+	 *	Each thread keeps its buffers between transactions, grown to the largest
+	 *	message, so large records don't cost an allocation per transaction.
+	 *	Set to 0 to never trim.
+	 *
+	 *	The buffers are shared by all clusters, so this is a process-wide
+	 *	setting: each aerospike_connect() sets it for every cluster in the
+	 *	process, and the last one connected wins.  Give all clusters the same
+	 *	value.
+	 *	Default: 60000
+	 */
+	uint32_t io_buffer_idle_ms;
+
+	/**
+	 *	Decode records read from the server into a per-record arena, so a
+	 *	record's bins and their string and blob values are allocated once and
+	 *	freed in one shot by as_record_destroy().  Bin values of an arena-backed
+	 *	record must not outlive it - use as_record_detach() to keep one.
+	 *	Default: false
+	 */
+	bool record_arena;
+
+	/**
+	 *	Memory cap in bytes of the client's read cache, which holds records
+	 *	read with a read policy's cache_staleness set.  The cache is split
+	 *	into shards, each with its own lock and least recently used list, and
+	 *	each limited to its share of the cap.  Hits, misses and evictions are
+	 *	counted in as_cluster_get_read_cache_stats().  Set to 0 to disable
+	 *	the cache.
+	 *	Default: 0
+	 */
+	uint32_t read_cache_max_bytes;
+
+	/**
+	 *	Number of event loop threads running asynchronous commands, such as
+	 *	aerospike_key_get_async().  Each loop has its own connections to every
+	 *	server node.  Set to 0 to disable asynchronous commands.
+	 *	Default: 0
+	 */
+	uint32_t async_loops;
+
+	/**
+	 *	Maximum asynchronous commands queued or running on a server node.  Commands
+	 *	beyond the limit fail immediately with AEROSPIKE_ERR_THROTTLED.  Set to 0 for
+	 *	no limit.
+	 *	Default: 5000
+	 */
+	uint32_t async_max_in_flight;
+
+	/**
+	 *	Run asynchronous commands on io_uring instead of epoll.  Requests and
+	 *	responses of all commands started by a loop are submitted with a single
+	 *	system call per loop iteration, with pooled connections and response
+	 *	buffers registered with the kernel.  Requires Linux 5.11 or later and a
+	 *	client built with IO_URING=1.  Loops fall back to epoll when io_uring
+	 *	is not available.
+	 *	Default: false
+	 */
+	bool async_io_uring;
+
 	/**
 	 *	Count of entries in hosts array.
 	 */
@@ -0,0 +1,401 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+#pragma once
+
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+#include <aerospike/as_val.h>
+#include <aerospike/as_vector.h>
+#include <citrusleaf/cf_digest.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Resolution of command deadlines in milliseconds.
+ */
+#define AS_EVENT_TICK_MS 10
+
+/**
+ *	@private
+ *	Number of slots in the deadline timer wheel.  Must be a power of 2.
+ */
+#define AS_EVENT_WHEEL_SIZE 512
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	Callback for asynchronous commands that return a record.
+ *
+ *	On success err is NULL and record holds the result, which is destroyed
+ *	after the callback returns.  On failure err describes the failure and
+ *	record is NULL.  Called on an event loop thread, so it should not block.
+ */
+typedef void (*as_async_record_listener)(as_error* err, as_record* record, void* udata);
+
+/**
+ *	Callback for asynchronous commands that only return a status.
+ *
+ *	On success err is NULL.  Called on an event loop thread, so it should not block.
+ */
+typedef void (*as_async_write_listener)(as_error* err, void* udata);
+
+/**
+ *	Callback for asynchronous commands that return a value.
+ *
+ *	On success err is NULL and val holds the result, which is destroyed after
+ *	the callback returns.  Called on an event loop thread, so it should not block.
+ */
+typedef void (*as_async_value_listener)(as_error* err, as_val* val, void* udata);
+
+struct as_cluster_s;
+struct as_event_loop_s;
+struct as_event_uring_s;
+struct as_event_command_s;
+struct as_msg_s;
+
+/**
+ *	@private
+ *	Parse a response and notify the listener.  Called on the event loop
+ *	thread with the message header in host byte order.
+ */
+typedef void (*as_event_parse_fn)(struct as_event_command_s* cmd, struct as_msg_s* msg);
+
+/**
+ *	@private
+ *	Listener type of asynchronous command.
+ */
+typedef enum as_event_type_e {
+	AS_EVENT_TYPE_RECORD,
+	AS_EVENT_TYPE_WRITE,
+	AS_EVENT_TYPE_VALUE
+} as_event_type;
+
+/**
+ *	@private
+ *	Asynchronous command.  The compiled request is stored after the struct,
+ *	and the buffer is reused for the response if it is large enough.
+ */
+typedef struct as_event_command_s {
+	/**
+	 *	@private
+	 *	Deadline timer list links.
+	 */
+	struct as_event_command_s* prev;
+	struct as_event_command_s* next;
+
+	/**
+	 *	@private
+	 *	Loop running the command.
+	 */
+	struct as_event_loop_s* loop;
+
+	/**
+	 *	@private
+	 *	Reserved target node.
+	 */
+	as_node* node;
+
+	/**
+	 *	@private
+	 *	Absolute deadline in milliseconds, 0 if none.
+	 */
+	uint64_t deadline_ms;
+
+	/**
+	 *	@private
+	 *	Request, then response buffer.
+	 */
+	uint8_t* buf;
+
+	/**
+	 *	@private
+	 *	Size of buf.
+	 */
+	size_t capacity;
+
+	/**
+	 *	@private
+	 *	Bytes to write or read.
+	 */
+	size_t len;
+
+	/**
+	 *	@private
+	 *	Bytes written or read so far.
+	 */
+	size_t pos;
+
+	/**
+	 *	@private
+	 *	Response parser.
+	 */
+	as_event_parse_fn parse;
+
+	/**
+	 *	@private
+	 *	User callback.
+	 */
+	union {
+		as_async_record_listener record;
+		as_async_write_listener write;
+		as_async_value_listener value;
+	} listener;
+
+	/**
+	 *	@private
+	 *	User data passed to listener.
+	 */
+	void* udata;
+
+	/**
+	 *	@private
+	 *	Socket, -1 until a connection is assigned.
+	 */
+	int fd;
+
+	/**
+	 *	@private
+	 *	io_uring registered file index of fd, or -1 if not registered.
+	 */
+	int32_t file;
+
+	/**
+	 *	@private
+	 *	io_uring registered buffer holding the response, or -1 if none.
+	 */
+	int16_t fixed;
+
+	/**
+	 *	@private
+	 *	io_uring operations submitted and not yet completed.  The command is
+	 *	only freed once they have all completed.
+	 */
+	uint8_t pending;
+
+	/**
+	 *	@private
+	 *	as_event_type of listener.
+	 */
+	uint8_t type;
+
+	/**
+	 *	@private
+	 *	Command state.
+	 */
+	uint8_t state;
+
+	/**
+	 *	@private
+	 *	Events socket is registered for, 0 if not registered.
+	 */
+	uint8_t events;
+
+	/**
+	 *	@private
+	 *	Deadline timer wheel slot, or -1 if not in the wheel.
+	 */
+	int16_t slot;
+
+	/**
+	 *	@private
+	 *	Set for writes, which drop the record from the read cache when they
+	 *	finish, whether they succeeded or not.
+	 */
+	bool invalidate;
+
+	/**
+	 *	@private
+	 *	Namespace and digest of the record written, if invalidate is set.
+	 */
+	as_namespace ns;
+	cf_digest digest;
+
+	/**
+	 *	@private
+	 *	Compiled request.
+	 */
+	uint8_t space[];
+} as_event_command;
+
+/**
+ *	@private
+ *	Event loop thread with its own connection pools and deadline timers.
+ */
+typedef struct as_event_loop_s {
+	/**
+	 *	@private
+	 *	Cluster the loop serves.
+	 */
+	struct as_cluster_s* cluster;
+
+	/**
+	 *	@private
+	 *	Commands submitted by other threads, not yet started.
+	 */
+	as_vector /* <as_event_command*> */ queue;
+
+	/**
+	 *	@private
+	 *	Commands being started by the loop thread.  Swapped with queue.
+	 */
+	as_vector /* <as_event_command*> */ batch;
+
+	/**
+	 *	@private
+	 *	Lock on queue.
+	 */
+	pthread_mutex_t lock;
+
+	/**
+	 *	@private
+	 *	Per node connection pools.  Only used by loop thread.
+	 */
+	as_vector /* <as_event_pool> */ pools;
+
+	/**
+	 *	@private
+	 *	Deadline timer wheel, one list per tick.
+	 */
+	as_event_command* wheel[AS_EVENT_WHEEL_SIZE];
+
+	/**
+	 *	@private
+	 *	Commands without a deadline.
+	 */
+	as_event_command* unbounded;
+
+	/**
+	 *	@private
+	 *	Last tick processed.
+	 */
+	uint64_t tick;
+
+	/**
+	 *	@private
+	 *	Commands in the wheel.
+	 */
+	uint32_t wheel_count;
+
+	/**
+	 *	@private
+	 *	io_uring state, or NULL if the loop uses epoll.
+	 */
+	struct as_event_uring_s* uring;
+
+	/**
+	 *	@private
+	 *	System calls made by the loop thread.  Never reset.
+	 */
+	uint64_t syscalls;
+
+	/**
+	 *	@private
+	 *	epoll instance, or -1 if the loop uses io_uring.
+	 */
+	int epoll_fd;
+
+	/**
+	 *	@private
+	 *	eventfd used to wake the loop.
+	 */
+	int wake_fd;
+
+	/**
+	 *	@private
+	 *	Loop thread.
+	 */
+	pthread_t thread;
+
+	/**
+	 *	@private
+	 *	Should loop keep running.
+	 */
+	volatile bool valid;
+} as_event_loop;
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Create and start cluster's event loops.  Loops use io_uring if requested
+ *	and available, otherwise epoll.  Returns false on failure.
+ */
+bool
+as_event_loops_create(struct as_cluster_s* cluster, uint32_t size, bool io_uring);
+
+/**
+ *	@private
+ *	Stop event loops.  Commands not yet completed are failed.
+ */
+void
+as_event_loops_destroy(struct as_cluster_s* cluster);
+
+/**
+ *	@private
+ *	Allocate command with room for a request of size bytes.
+ */
+as_event_command*
+as_event_command_create(size_t size);
+
+/**
+ *	@private
+ *	Free command and its buffer, and release its node if it has one.
+ */
+void
+as_event_command_free(as_event_command* cmd);
+
+/**
+ *	@private
+ *	Queue command on one of the cluster's event loops.  The command takes
+ *	ownership of the node reservation.  If an error is returned, the command
+ *	has been freed, the node released and the listener will not be called.
+ */
+as_status
+as_event_command_execute(struct as_cluster_s* cluster, as_event_command* cmd, as_error* err);
+
+/**
+ *	@private
+ *	Notify listener of failure.
+ */
+void
+as_event_notify_error(as_event_command* cmd, as_error* err);
+
+/**
+ *	Count of system calls made by the cluster's event loop threads, including
+ *	socket I/O, readiness waits and io_uring submissions.  Never reset - take
+ *	the difference of two snapshots.
+ */
+uint64_t
+as_event_loops_syscalls(struct as_cluster_s* cluster);
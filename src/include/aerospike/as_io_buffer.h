@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+#pragma once
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	I/O buffers kept by each thread.  A transaction normally holds two at a
+ *	time - request and response - so four cover a multi-response transaction
+ *	whose callback makes transactions of its own.
+ */
+#define AS_IO_BUFFER_SLOTS 4
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	I/O buffer counters of the calling thread.  Requests and responses are
+ *	built and read in buffers each thread keeps between transactions, grown to
+ *	the largest message seen and trimmed when idle.  Never reset - take the
+ *	difference of two snapshots.
+ */
+typedef struct as_io_buffer_stats_s {
+	/**
+	 *	Buffers handed out without allocating.
+	 */
+	uint64_t reuses;
+	
+	/**
+	 *	Buffers allocated or reallocated larger.
+	 */
+	uint64_t grows;
+	
+	/**
+	 *	Buffers freed, or shrunk back, for being idle or oversized.
+	 */
+	uint64_t trims;
+	
+	/**
+	 *	Buffers allocated from the heap, and freed after use, because all of
+	 *	the thread's buffers were in use.
+	 */
+	uint64_t overflows;
+	
+	/**
+	 *	Bytes currently held by the thread's buffers.
+	 */
+	uint64_t bytes;
+} as_io_buffer_stats;
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Get one of the calling thread's I/O buffers with room for at least size
+ *	bytes.  If all the thread's buffers are in use, a heap buffer is returned
+ *	instead.  Either way it must be given back with as_io_buffer_put().  Returns
+ *	NULL if allocation fails.
+ */
+uint8_t*
+as_io_buffer_get(size_t size, size_t* capacity);
+
+/**
+ *	@private
+ *	Grow a buffer from as_io_buffer_get() to at least size bytes, keeping the
+ *	keep_size bytes at keep, which must be in the buffer, at the front.  On
+ *	failure NULL is returned and the original buffer is still valid.
+ */
+uint8_t*
+as_io_buffer_grow(uint8_t* buf, size_t size, const uint8_t* keep, size_t keep_size, size_t* capacity);
+
+/**
+ *	@private
+ *	Give back a buffer from as_io_buffer_get().
+ */
+void
+as_io_buffer_put(uint8_t* buf);
+
+/**
+ *	@private
+ *	Set how long a thread's buffers may go unused, or stay much larger than
+ *	needed, before being trimmed.  Applies to all threads.  0 never trims.
+ */
+void
+as_io_buffer_set_idle_ms(uint32_t idle_ms);
+
+/**
+ *	I/O buffer counters of the calling thread.
+ */
+as_io_buffer_stats*
+as_io_buffer_thread_stats();
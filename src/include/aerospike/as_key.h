@@ -659,3 +659,20 @@ void as_key_destroy(as_key * key);
  *	@ingroup as_key_object
  */
 as_digest * as_key_digest(as_key * key);
+
+/**
+ *	Compute the digests of many keys at once. Keys are digested several at a
+ *	time, which is quicker than calling as_key_digest() for each. Keys whose
+ *	digest has already been computed are skipped.
+ *
+ *	~~~~~~~~~~{.c}
+ *	as_keys_digest_many(keys, n_keys);
+ *	~~~~~~~~~~
+ *
+ *	@param keys The keys to compute the digests of.
+ *	@param n The number of keys.
+ *
+ *	@relates as_key
+ *	@ingroup as_key_object
+ */
+void as_keys_digest_many(as_key ** keys, uint32_t n);
@@ -24,6 +24,9 @@
 #include <aerospike/as_vector.h>
 #include <citrusleaf/cf_queue.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include "ck_pr.h"
 
 /******************************************************************************
@@ -56,6 +59,65 @@ typedef struct as_address_s {
 
 struct as_cluster_s;
 
+/**
+ *	@private
+ *	Pooled connection.
+ */
+typedef struct as_node_conn_s {
+	/**
+	 *	@private
+	 *	Socket.
+	 */
+	int fd;
+	
+	/**
+	 *	@private
+	 *	Time connection was last put back into a pool in milliseconds.
+	 */
+	uint64_t last_used;
+} as_node_conn;
+
+/**
+ *	@private
+ *	Node's pool of synchronous connections, in order of last use.  The most
+ *	recently used connections are handed out first, so connections not needed
+ *	after a burst collect at the front where the tend thread closes them once
+ *	they have been idle too long.
+ */
+typedef struct as_conn_pool_s {
+	/**
+	 *	@private
+	 *	Lock on pool.
+	 */
+	pthread_mutex_t lock;
+	
+	/**
+	 *	@private
+	 *	Connections, least recently used first.
+	 */
+	as_node_conn* conns;
+	
+	/**
+	 *	@private
+	 *	Number of connections in pool.
+	 */
+	uint32_t size;
+	
+	/**
+	 *	@private
+	 *	Maximum number of idle connections, counting those in threads'
+	 *	connection caches - the cluster's conn_queue_size.
+	 */
+	uint32_t capacity;
+	
+	/**
+	 *	@private
+	 *	Connections reserved for threads' connection caches - a fixed share
+	 *	for each thread caching connections to the node.
+	 */
+	uint32_t cached;
+} as_conn_pool;
+
 /**
  *	Server node representation.
  */
@@ -66,6 +128,21 @@ typedef struct as_node_s {
 	 */
 	uint32_t ref_count;
 	
+	/**
+	 *	@private
+	 *	Number of AS_POLICY_REPLICA_FASTEST reads waiting on this node.  Kept
+	 *	next to ref_count, whose cache line every command already writes.
+	 */
+	uint32_t in_flight;
+	
+	/**
+	 *	@private
+	 *	Moving average of AS_POLICY_REPLICA_FASTEST read round trip times in
+	 *	microseconds, 0 until the first such read completes.  Updates from concurrent commands may
+	 *	overwrite each other - a lost sample only slows the average down.
+	 */
+	uint32_t latency_us;
+	
 	/**
 	 *	@private
 	 *	Server's generation count for partition management.
@@ -96,7 +173,7 @@ typedef struct as_node_s {
 	 *	@private
 	 *	Pool of current, cached FDs.
 	 */
-	cf_queue* conn_q;
+	as_conn_pool conn_pool;
 	
 	/**
 	 *	@private
@@ -128,11 +205,24 @@ typedef struct as_node_s {
 	 */
 	uint32_t failures;
 	
+	/**
+	 *	@private
+	 *	Number of asynchronous commands queued or running on this node.
+	 */
+	uint32_t async_in_flight;
+	
 	/**
 	 *	@private
 	 *	Is node currently active.
 	 */
 	uint8_t active;
+	
+	/**
+	 *	@private
+	 *	Index in cluster's partition nodes, 0 if not mapped to any partition.
+	 *	Only used by tend thread.
+	 */
+	uint8_t partition_index;
 } as_node;
 
 /**
@@ -159,6 +249,79 @@ typedef struct as_friend_s {
 	in_port_t port;
 } as_friend;
 
+/**
+ *	@private
+ *	Info responses fetched from a node during a cluster tend.  Fetched on a
+ *	tend worker thread, then applied on the tend thread.
+ */
+typedef struct as_node_info_s {
+	/**
+	 *	@private
+	 *	Node, partition generation and services response, NULL if the
+	 *	request failed.
+	 */
+	char* check;
+	
+	/**
+	 *	@private
+	 *	Partition generation and replicas response, NULL if the node's
+	 *	partition generation had not changed or the request failed.
+	 */
+	char* replicas;
+	
+	/**
+	 *	@private
+	 *	Name value pairs parsed from check, pointing into it.
+	 */
+	as_vector /* <as_name_value> */ check_values;
+	
+	/**
+	 *	@private
+	 *	Name value pairs parsed from replicas, pointing into it.
+	 */
+	as_vector /* <as_name_value> */ replicas_values;
+	
+	/**
+	 *	@private
+	 *	Microseconds the requests took.
+	 */
+	uint64_t elapsed_us;
+	
+	/**
+	 *	@private
+	 *	Replicas were needed but the request failed.
+	 */
+	bool replicas_failed;
+} as_node_info;
+
+/**
+ *	Connection pool counters of the calling thread.  Each thread keeps a few
+ *	connections per node ahead of the node's shared pool.  Never reset - take
+ *	the difference of two snapshots.
+ */
+typedef struct as_node_fd_stats_s {
+	/**
+	 *	Connections taken from the thread's cache.
+	 */
+	uint64_t hits;
+	
+	/**
+	 *	Connections taken from the shared pool or newly created.
+	 */
+	uint64_t misses;
+	
+	/**
+	 *	Connections returned to the shared pool instead of the thread's cache.
+	 */
+	uint64_t spills;
+	
+	/**
+	 *	Liveness checks (one system call each) made on pooled connections
+	 *	before handing them out.
+	 */
+	uint64_t checks;
+} as_node_fd_stats;
+
 /******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
@@ -216,6 +379,38 @@ as_node_release(as_node* node)
 	}
 }
 
+/**
+ *	@private
+ *	Count a command sent to the node as waiting on it.
+ */
+static inline void
+as_node_attempt_begin(as_node* node)
+{
+	ck_pr_inc_32(&node->in_flight);
+}
+
+/**
+ *	@private
+ *	Finish a command started with as_node_attempt_begin(), and fold the time
+ *	it waited on the node into the node's latency average.
+ */
+static inline void
+as_node_attempt_end(as_node* node, uint64_t elapsed_ns)
+{
+	ck_pr_dec_32(&node->in_flight);
+	
+	uint64_t sample = elapsed_ns / 1000 + 1;
+	
+	if (sample > UINT32_MAX) {
+		sample = UINT32_MAX;
+	}
+	
+	// Each sample moves the average 1/8 of the way towards it.
+	int64_t latency = ck_pr_load_32(&node->latency_us);
+	latency = latency ? latency + ((int64_t)sample - latency) / 8 : (int64_t)sample;
+	ck_pr_store_32(&node->latency_us, (uint32_t)latency);
+}
+
 /**
  *	@private
  *	Add socket address to node addresses.
@@ -250,9 +445,58 @@ as_node_get_address_full(as_node* node)
 int
 as_node_fd_get(as_node* node);
 
+/**
+ *	@private
+ *	As as_node_fd_get(), but connections used within the cluster's
+ *	conn_check_idle_ms are handed out without a liveness check, and unchecked is
+ *	set.  If such a connection turns out to have been closed by the server before
+ *	any response is read, the caller should retry once on a new connection.
+ */
+int
+as_node_fd_get_unchecked(as_node* node, bool* unchecked);
+
+/**
+ *	@private
+ *	Create a new connection to the given node, bypassing the pool.  The connect is
+ *	started but may not have completed.  Return fd on success and -1 on error.
+ */
+int
+as_node_fd_create(as_node* node);
+
 /**
  *	@private
  *	Put connection back into pool.
  */
 void
 as_node_fd_put(as_node* node, int fd);
+
+/**
+ *	@private
+ *	Close pooled and thread cached connections that have been idle longer than
+ *	the cluster's max_socket_idle.  Called by the cluster tend thread.
+ */
+void
+as_node_close_idle_connections(as_node* node);
+
+/**
+ *	@private
+ *	Open connections in parallel until the node's pool holds the cluster's
+ *	min_conns_per_node.  Called by the cluster tend thread.
+ */
+void
+as_node_fill_connections(as_node* node);
+
+/**
+ *	@private
+ *	Pooled connections last used before the returned time in milliseconds have
+ *	been idle too long and should be closed.  Returns 0 if idle connections are
+ *	never closed.
+ */
+uint64_t
+as_node_idle_limit(struct as_cluster_s* cluster);
+
+/**
+ *	Connection pool counters of the calling thread.
+ */
+as_node_fd_stats*
+as_node_fd_thread_stats();
@@ -33,29 +33,64 @@
  */
 #define AS_MAX_NAMESPACE_SIZE 32
 
+/**
+ *	@private
+ *	Size of partition node index space.  Index 0 means no node, so up to 255
+ *	nodes can be mapped to partitions at once.
+ */
+#define AS_PARTITION_NODES_SIZE 256
+
 /******************************************************************************
  *	TYPES
  *****************************************************************************/
 
 /**
  *	@private
- *  Map of namespace data partitions to nodes.
+ *  Map of namespace data partitions to nodes.  Nodes are referred to by their
+ *	index in the cluster's partition nodes, so a partition fits in two bytes.
  */
 typedef struct as_partition_s {
 	/**
 	 *	@private
-	 *  Master node for this partition.
+	 *  Index of master node for this partition, 0 if none.
 	 */
-	as_node* master;
+	uint8_t master;
 	
 	/**
 	 *	@private
-	 *  Prole node for this partition.
+	 *  Index of prole node for this partition, 0 if none.
 	 *  TODO - not ideal for replication factor > 2.
 	 */
-	as_node* prole;
+	uint8_t prole;
 } as_partition;
 
+/**
+ *	@private
+ *	Nodes mapped to partitions of any namespace, by index.  A node gets an
+ *	index when it is first mapped to a partition and keeps it until no
+ *	partition is mapped to it.
+ */
+typedef struct as_partition_nodes_s {
+	/**
+	 *	@private
+	 *	Reserved nodes by index, NULL where free.  Index 0 is never used.
+	 */
+	as_node* array[AS_PARTITION_NODES_SIZE];
+	
+	/**
+	 *	@private
+	 *	Number of partitions mapped to each index, as master or prole.
+	 *	Only used by tend thread.
+	 */
+	uint32_t refs[AS_PARTITION_NODES_SIZE];
+	
+	/**
+	 *	@private
+	 *	Last index handed out.  Only used by tend thread.
+	 */
+	uint32_t next;
+} as_partition_nodes;
+
 /**
  *	@private
  *  Map of namespace to data partitions.
@@ -72,6 +107,15 @@ typedef struct as_partition_table_s {
 	 *  Fixed length of partition array.
 	 */
 	uint32_t size;
+	
+	/**
+	 *	@private
+	 *	Bitmaps of the partitions mapped to each node index, master at
+	 *	index * 2 and prole at index * 2 + 1, NULL until the index is first
+	 *	mapped.  64 partitions per word, the first in bit 63.  Lets replica
+	 *	updates be diffed without reading partitions.  Only used by tend thread.
+	 */
+	uint64_t** owned;
 
 	/**
 	 *	@private
@@ -96,6 +140,20 @@ typedef struct as_partition_tables_s {
 	 *  Length of partition table array.
 	 */
 	uint32_t size;
+	
+	/**
+	 *	@private
+	 *	Number of hash slots minus one.  The number of slots is a power of 2
+	 *	at least twice size.
+	 */
+	uint32_t slots_mask;
+	
+	/**
+	 *	@private
+	 *	Open addressed index of array by namespace hash, NULL where empty.
+	 *	Stored in the same allocation, after array.
+	 */
+	as_partition_table** slots;
 
 	/**
 	 *	@private
@@ -115,6 +173,14 @@ typedef struct as_partition_tables_s {
 as_partition_tables*
 as_partition_tables_create(uint32_t capacity);
 
+/**
+ *	@private
+ *	Index partition tables by namespace once array has been filled, before
+ *	the tables are shared with other threads.
+ */
+void
+as_partition_tables_index(as_partition_tables* tables);
+
 /**
  *	@private
  *	Destroy and release memory for partition table.
@@ -129,9 +195,19 @@ as_partition_table_destroy(as_partition_table* table);
 as_partition_table*
 as_partition_tables_get(as_partition_tables* tables, const char* ns);
 
+/**
+ *	@private
+ *	Release nodes mapped to partitions.
+ */
+void
+as_partition_nodes_destroy(as_partition_nodes* nodes);
+
 /**
  *	@private
  *	Is node referenced in any partition table.
  */
-bool
-as_partition_tables_find_node(as_partition_tables* tables, as_node* node);
+static inline bool
+as_partition_tables_find_node(as_node* node)
+{
+	return node->partition_index != 0;
+}
@@ -78,6 +78,20 @@
  */
 #define AS_POLICY_RETRY_DEFAULT AS_POLICY_RETRY_NONE
 
+/**
+ *	Default maximum number of retries of a failed command
+ *
+ *	@ingroup client_policies
+ */
+#define AS_POLICY_MAX_RETRIES_DEFAULT 1
+
+/**
+ *	Default milliseconds to sleep before the first retry
+ *
+ *	@ingroup client_policies
+ */
+#define AS_POLICY_SLEEP_BETWEEN_RETRIES_DEFAULT 1
+
 /**
  *	Default as_policy_gen value
  *
@@ -99,6 +113,13 @@
  */
 #define AS_POLICY_EXISTS_DEFAULT AS_POLICY_EXISTS_IGNORE
 
+/**
+ *	Default as_policy_replica value
+ *
+ *	@ingroup client_policies
+ */
+#define AS_POLICY_REPLICA_DEFAULT AS_POLICY_REPLICA_ANY
+
 /******************************************************************************
  *	TYPES
  *****************************************************************************/
@@ -128,7 +149,8 @@ typedef enum as_policy_retry_e {
 
 	/**
 	 *	If an operation fails, attempt the operation
-	 *	one more time.
+	 *	again, up to as_config.policies.max_retries
+	 *	times - by default one more time.
 	 */
 	AS_POLICY_RETRY_ONCE, 
 
@@ -221,6 +243,38 @@ typedef enum as_policy_key_e {
 
 } as_policy_key;
 
+/**
+ *	Replica Policy
+ *
+ *	Specifies which replica of a record's partition a read is sent to.
+ *
+ *	@ingroup client_policies
+ */
+typedef enum as_policy_replica_e {
+
+	/**
+	 *	The policy is undefined.
+	 *
+	 *	If set, then the value will default to
+	 *	as_config.policies.read.replica or `AS_POLICY_REPLICA_DEFAULT`.
+	 */
+	AS_POLICY_REPLICA_UNDEF,
+
+	/**
+	 *	Alternate reads between the master and the prole.
+	 */
+	AS_POLICY_REPLICA_ANY,
+
+	/**
+	 *	Read from whichever of the master and the prole currently has the
+	 *	lower recent latency, weighted by the number of commands in flight
+	 *	on it.  A small share of reads still goes to the other replica, so
+	 *	a node that was slow is noticed once it recovers.
+	 */
+	AS_POLICY_REPLICA_FASTEST,
+
+} as_policy_replica;
+
 /**
  *	Existence Policy.
  *	
@@ -315,6 +369,17 @@ typedef struct as_policy_write_s {
 	 */
 	uint32_t timeout;
 
+	/**
+	 *	Maximum time in microseconds to wait for the operation to complete,
+	 *	for budgets too tight to give in milliseconds.  Takes precedence
+	 *	over timeout.
+	 *
+	 *	If 0 (zero), then the value will default to
+	 *	as_config.policies.write.timeout_us, and timeout is used if that
+	 *	is 0 (zero) too.
+	 */
+	uint32_t timeout_us;
+
 	/**
 	 *	Specifies the behavior for failed operations.
 	 */
@@ -356,11 +421,59 @@ typedef struct as_policy_read_s {
 	 */
 	uint32_t timeout;
 
+	/**
+	 *	Maximum time in microseconds to wait for the operation to complete,
+	 *	for budgets too tight to give in milliseconds.  Takes precedence
+	 *	over timeout.
+	 *
+	 *	If 0 (zero), then the value will default to
+	 *	as_config.policies.read.timeout_us, and timeout is used if that
+	 *	is 0 (zero) too.
+	 */
+	uint32_t timeout_us;
+
 	/**
 	 *	Specifies the behavior for the key.
 	 */
 	as_policy_key key;
 
+	/**
+	 *	Milliseconds to wait for a response before also sending the read to
+	 *	the partition's other replica, and taking whichever response arrives
+	 *	first.  Set it to around the p95 read latency, so a single slow node
+	 *	doesn't set the tail latency.  Hedged reads are counted in
+	 *	as_cluster_get_hedge_stats().
+	 *
+	 *	If 0 (zero), then the value will default to
+	 *	as_config.policies.read.hedge_delay, and reads are not hedged if
+	 *	that is 0 (zero) too.
+	 */
+	uint32_t hedge_delay;
+
+	/**
+	 *	Serve the read from the client's read cache if the record was
+	 *	fetched no more than this many milliseconds ago, and cache the record
+	 *	otherwise.  Cached records are dropped when their TTL runs out, and
+	 *	when this client writes or removes them.  Writes by other clients are
+	 *	only seen once the entry is older than this.  Requires
+	 *	as_config.read_cache_max_bytes.  Only aerospike_key_get() uses the
+	 *	cache.
+	 *
+	 *	If 0 (zero), then the value will default to
+	 *	as_config.policies.read.cache_staleness, and the cache is not used if
+	 *	that is 0 (zero) too.
+	 */
+	uint32_t cache_staleness;
+
+	/**
+	 *	Specifies which replica to read from.  Used by aerospike_key_get()
+	 *	and aerospike_key_select().
+	 *
+	 *	If AS_POLICY_REPLICA_UNDEF, then the value will default to
+	 *	as_config.policies.read.replica or `AS_POLICY_REPLICA_DEFAULT`.
+	 */
+	as_policy_replica replica;
+
 } as_policy_read;
 
 /**
@@ -404,6 +517,17 @@ typedef struct as_policy_operate_s {
 	 */
 	uint32_t timeout;
 
+	/**
+	 *	Maximum time in microseconds to wait for the operation to complete,
+	 *	for budgets too tight to give in milliseconds.  Takes precedence
+	 *	over timeout.
+	 *
+	 *	If 0 (zero), then the value will default to
+	 *	as_config.policies.operate.timeout_us, and timeout is used if that
+	 *	is 0 (zero) too.
+	 */
+	uint32_t timeout_us;
+
 	/**
 	 *	Specifies the behavior for failed operations.
 	 */
@@ -439,6 +563,17 @@ typedef struct as_policy_remove_s {
 	 */
 	uint32_t timeout;
 
+	/**
+	 *	Maximum time in microseconds to wait for the operation to complete,
+	 *	for budgets too tight to give in milliseconds.  Takes precedence
+	 *	over timeout.
+	 *
+	 *	If 0 (zero), then the value will default to
+	 *	as_config.policies.remove.timeout_us, and timeout is used if that
+	 *	is 0 (zero) too.
+	 */
+	uint32_t timeout_us;
+
 	/**
 	 *	The generation of the record.
 	 */
@@ -601,6 +736,27 @@ typedef struct as_policies_s {
 	 *	The default value is `AS_POLICY_RETRY_DEFAULT`.
 	 */
 	as_policy_retry retry;
+
+	/**
+	 *	Maximum number of times a single record command is retried after
+	 *	a network error or timeout, within the command's timeout.  Reads
+	 *	are always retried, and retried on the partition's other replica
+	 *	if the error came from the node.  Writes are only retried if their
+	 *	retry policy is `AS_POLICY_RETRY_ONCE`.  0 never retries.
+	 *
+	 *	The default value is `AS_POLICY_MAX_RETRIES_DEFAULT`.
+	 */
+	uint32_t max_retries;
+
+	/**
+	 *	Milliseconds to sleep before the first retry.  The sleep doubles
+	 *	with every further retry, with random jitter so that clients retrying
+	 *	together spread out, and never takes a command past its timeout.
+	 *	0 retries immediately.
+	 *
+	 *	The default value is `AS_POLICY_SLEEP_BETWEEN_RETRIES_DEFAULT`.
+	 */
+	uint32_t sleep_between_retries;
 	
 	/**
 	 *	Specifies the behavior for the key.
@@ -0,0 +1,170 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+#pragma once
+
+#include <aerospike/as_key.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_record.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Bin of a prepared write.
+ */
+typedef struct as_prepared_bin_s {
+
+	/**
+	 *	as_val_t of the bin's values.
+	 */
+	uint8_t type;
+
+	/**
+	 *	Particle type the values are sent as.
+	 */
+	uint8_t particle_type;
+
+	/**
+	 *	Length of the bin name.
+	 */
+	uint8_t name_sz;
+
+} as_prepared_bin;
+
+/**
+ *	A put compiled ahead of time, for writing many records with the same
+ *	namespace, set, bin names and value types.  The message header, the
+ *	namespace and set fields and the bin names are laid out once, and each
+ *	aerospike_key_put_prepared() only copies them and fills in the key,
+ *	values, generation and ttl.
+ *
+ *	Integer, string and bytes values are supported.  Records written with it
+ *	must have the same bins, set in the same order and with values of the
+ *	same types, as the record it was prepared from - only the values change.
+ *	Keys must be in the namespace and set it was prepared for.  Records and
+ *	keys that don't match are rejected with AEROSPIKE_ERR_PARAM.
+ *
+ *	~~~~~~~~~~{.c}
+ *	as_record rec;
+ *	as_record_inita(&rec, 2);
+ *	as_record_set_int64(&rec, "count", 0);
+ *	as_record_set_str(&rec, "name", "");
+ *
+ *	as_prepared_write pw;
+ *	if ( aerospike_key_put_prepare(&as, &err, NULL, "test", "demo", &rec, &pw) != AEROSPIKE_OK ) {
+ *		fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+ *	}
+ *
+ *	for ( int i = 0; i < 1000; i++ ) {
+ *		as_key key;
+ *		as_key_init_int64(&key, "test", "demo", i);
+ *		as_record_set_int64(&rec, "count", i);
+ *		as_record_set_str(&rec, "name", names[i]);
+ *		aerospike_key_put_prepared(&as, &err, &pw, &key, &rec);
+ *	}
+ *
+ *	as_prepared_write_destroy(&pw);
+ *	~~~~~~~~~~
+ *
+ *	A prepared write isn't changed by writing with it, so threads can share
+ *	one.
+ */
+typedef struct as_prepared_write_s {
+
+	/**
+	 *	@private
+	 *	Resolved write policy.
+	 */
+	as_policy_write policy;
+
+	/**
+	 *	@private
+	 *	Namespace, for finding the key's node.
+	 */
+	as_namespace ns;
+
+	/**
+	 *	@private
+	 *	Set, "" for none.
+	 */
+	as_set set;
+
+	/**
+	 *	@private
+	 *	Message header and namespace and set fields, in network order.
+	 */
+	uint8_t * header;
+
+	/**
+	 *	@private
+	 *	Op headers and bin names, back to back, in network order.  Records
+	 *	written are checked against the bin names here.
+	 */
+	uint8_t * ops;
+
+	/**
+	 *	@private
+	 *	One entry per bin.
+	 */
+	as_prepared_bin * bins;
+
+	/**
+	 *	@private
+	 *	Size of header.
+	 */
+	uint32_t header_sz;
+
+	/**
+	 *	@private
+	 *	Size of ops.
+	 */
+	uint32_t ops_sz;
+
+	/**
+	 *	@private
+	 *	Number of bins.
+	 */
+	uint16_t n_bins;
+
+	/**
+	 *	@private
+	 *	If true, the record's generation is sent.
+	 */
+	bool use_generation;
+
+} as_prepared_write;
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Release the resources of a prepared write.
+ *
+ *	@relates as_prepared_write
+ */
+void as_prepared_write_destroy(as_prepared_write * pw);
@@ -0,0 +1,251 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+#pragma once
+
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_key.h>
+#include <citrusleaf/cf_digest.h>
+#include <citrusleaf/cf_proto.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Number of read cache shards, each with its own lock.  Must be a power of 2.
+ */
+#define AS_READ_CACHE_SHARDS 32
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Cached record, as the server sent it.  Each hit decodes its own copy, so
+ *	callers never share values.
+ */
+typedef struct as_read_cache_entry_s {
+	/**
+	 *	@private
+	 *	Next entry in the hash bucket.
+	 */
+	struct as_read_cache_entry_s* next;
+	
+	/**
+	 *	@private
+	 *	Least recently used list links - prev is more recently used.
+	 */
+	struct as_read_cache_entry_s* lru_prev;
+	struct as_read_cache_entry_s* lru_next;
+	
+	/**
+	 *	@private
+	 *	When the record was read, in milliseconds.
+	 */
+	uint64_t fetched_ms;
+	
+	/**
+	 *	@private
+	 *	When the record's TTL runs out, in milliseconds, 0 if never.
+	 */
+	uint64_t expires_ms;
+	
+	/**
+	 *	@private
+	 *	Bytes counted against the cache's memory cap.
+	 */
+	size_t size;
+	
+	/**
+	 *	@private
+	 *	Size of buf.
+	 */
+	size_t buf_size;
+	
+	/**
+	 *	@private
+	 *	Response header, in host order.
+	 */
+	cl_msg msg;
+	
+	/**
+	 *	@private
+	 *	Record digest.
+	 */
+	cf_digest digest;
+	
+	/**
+	 *	@private
+	 *	Record namespace.
+	 */
+	as_namespace ns;
+	
+	/**
+	 *	@private
+	 *	References - one while in the cache, and one per hit being decoded.
+	 */
+	uint32_t ref_count;
+	
+	/**
+	 *	@private
+	 *	Response fields and ops.
+	 */
+	uint8_t buf[];
+} as_read_cache_entry;
+
+/**
+ *	@private
+ *	Shard of the read cache.
+ */
+typedef struct as_read_cache_shard_s {
+	/**
+	 *	@private
+	 *	Lock on everything in the shard.
+	 */
+	pthread_mutex_t lock;
+	
+	/**
+	 *	@private
+	 *	Hash buckets.
+	 */
+	as_read_cache_entry** table;
+	
+	/**
+	 *	@private
+	 *	Most and least recently used entries.
+	 */
+	as_read_cache_entry* head;
+	as_read_cache_entry* tail;
+	
+	/**
+	 *	@private
+	 *	Bytes used, and the shard's share of the memory cap.
+	 */
+	size_t bytes;
+	size_t max_bytes;
+	
+	/**
+	 *	@private
+	 *	Number of hash buckets, a power of 2.
+	 */
+	uint32_t n_buckets;
+	
+	/**
+	 *	@private
+	 *	Number of entries.
+	 */
+	uint32_t n_entries;
+	
+	/**
+	 *	@private
+	 *	Bumped by every invalidation.  A read only caches its record if no
+	 *	write to the shard finished while it was in flight.
+	 */
+	uint64_t epoch;
+	
+	/**
+	 *	@private
+	 *	Counts, see as_cluster_read_cache_stats.
+	 */
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t invalidations;
+} as_read_cache_shard;
+
+/**
+ *	@private
+ *	Bounded cache of records read by digest, split into shards.
+ */
+typedef struct as_read_cache_s {
+	/**
+	 *	@private
+	 *	Shards, picked by digest.
+	 */
+	as_read_cache_shard shards[AS_READ_CACHE_SHARDS];
+} as_read_cache;
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	@private
+ *	Create a read cache using up to max_bytes.
+ */
+as_read_cache*
+as_read_cache_create(uint32_t max_bytes);
+
+/**
+ *	@private
+ *	Free a read cache and its entries.  No other thread may be using it.
+ */
+void
+as_read_cache_destroy(as_read_cache* cache);
+
+/**
+ *	@private
+ *	Find a record read no more than max_staleness_ms ago, and not expired.
+ *	Returns NULL on a miss - *epoch is then to be passed to
+ *	as_read_cache_put() with the record read from the server.  A hit must be
+ *	given back with as_read_cache_release().
+ */
+as_read_cache_entry*
+as_read_cache_get(as_read_cache* cache, const char* ns, const cf_digest* digest, uint32_t max_staleness_ms,
+	uint64_t* epoch);
+
+/**
+ *	@private
+ *	Give back an entry from as_read_cache_get().
+ */
+void
+as_read_cache_release(as_read_cache_entry* entry);
+
+/**
+ *	@private
+ *	Cache a record read from the server - msg is the response header in host
+ *	order, and buf the fields and ops after it.  Not cached if the shard was
+ *	invalidated since epoch was got, or a later generation is cached.
+ */
+void
+as_read_cache_put(as_read_cache* cache, const char* ns, const cf_digest* digest, uint64_t epoch,
+	const cl_msg* msg, const uint8_t* buf, size_t buf_size);
+
+/**
+ *	@private
+ *	Drop a record this client wrote or removed, and stop reads in flight from
+ *	caching it.  Call once the write has finished, whether it succeeded or not.
+ */
+void
+as_read_cache_remove(as_read_cache* cache, const char* ns, const cf_digest* digest);
+
+/**
+ *	@private
+ *	Sum the shards' counts.
+ */
+void
+as_read_cache_get_stats(as_read_cache* cache, as_cluster_read_cache_stats* stats);
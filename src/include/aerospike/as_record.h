@@ -40,6 +40,47 @@
  *	TYPES
  *****************************************************************************/
 
+/**
+ *	@private
+ *	Block of memory the bins and values of an arena-backed record are carved
+ *	from. Blocks are chained, newest first, and all freed with the record.
+ */
+typedef struct as_record_arena_s {
+
+	/**
+	 *	@private
+	 *	Previous block, which had no room left.
+	 */
+	struct as_record_arena_s * next;
+
+	/**
+	 *	@private
+	 *	Size of data.
+	 */
+	uint32_t capacity;
+
+	/**
+	 *	@private
+	 *	Bytes of data handed out.
+	 */
+	uint32_t used;
+
+	/**
+	 *	@private
+	 *	If true, bins may hold values allocated outside the arena, such as
+	 *	lists, maps and values set after decoding, which must be destroyed one
+	 *	by one.
+	 */
+	bool heap_values;
+
+	/**
+	 *	@private
+	 *	Memory handed out, 8 byte aligned.
+	 */
+	uint64_t data[];
+
+} as_record_arena;
+
 /**
  *	Records in Aerospike are collections of named bins. 
  *
@@ -158,6 +199,13 @@
  *	- as_record_foreach() — Calls a function for each bin traversed.
  *	- as_record_iterator — Uses an iterator pattern to traverse bins.
  *
+ *	## Arena-backed Records
+ *
+ *	If `as_config.record_arena` is set, records the client creates for reads
+ *	keep their bins and string and blob values in a single arena owned by the
+ *	record, so `as_record_destroy()` frees them in one go. Values taken from
+ *	such a record must not outlive it - use `as_record_detach()` to keep one.
+ *
  *	@extends as_rec
  *	@ingroup client_objects
  */
@@ -200,6 +248,13 @@ typedef struct as_record_s {
 	 */
 	as_bins bins;
 
+	/**
+	 *	@private
+	 *	If set, the bins and their values live in this arena, and are freed
+	 *	together by as_record_destroy().
+	 */
+	as_record_arena * arena;
+
 } as_record;
 
 /**
@@ -301,6 +356,43 @@ as_record * as_record_init(as_record * rec, uint16_t nbins);
  */
 void as_record_destroy(as_record * rec);
 
+/**
+ *	@private
+ *	Allocate size bytes, aligned for any value, from the record's arena,
+ *	creating the arena or chaining a new block to it as needed. The memory is
+ *	freed with the record.
+ *
+ *	@param rec		The record owning the arena.
+ *	@param size		The number of bytes to allocate.
+ *
+ *	@return the memory, or NULL if allocation failed.
+ *
+ *	@relates as_record
+ */
+void * as_record_arena_alloc(as_record * rec, size_t size);
+
+/**
+ *	Take the value of a bin out of the record, leaving the bin nil. The value
+ *	is moved or copied to the heap as needed, so it stays valid after the
+ *	record is destroyed - use this to keep a value of an arena-backed record.
+ *
+ *	~~~~~~~~~~{.c}
+ *	as_val * value = as_record_detach(rec, "bin");
+ *	as_record_destroy(rec);
+ *	...
+ *	as_val_destroy(value);
+ *	~~~~~~~~~~
+ *
+ *	@param rec		The record containing the bin.
+ *	@param name		The name of the bin.
+ *
+ *	@return the value, to be destroyed by the caller, or NULL if the bin does
+ *	not exist or the value could not be copied.
+ *
+ *	@relates as_record
+ */
+as_val * as_record_detach(as_record * rec, const as_bin_name name);
+
 /**
  *	Get the number of bins in the record.
  *
@@ -48,8 +48,11 @@ typedef struct cl_write_parameters_s {
     bool            use_generation_dup;     // on generation collision, create a duplicate
     uint32_t        generation;
     int             timeout_ms;
+    uint32_t        timeout_us;             // if set, used instead of timeout_ms
     uint32_t        record_ttl;             // seconds, from now, when the record would be auto-removed from the DBcd 
     cl_write_policy w_pol;
+    uint32_t        hedge_delay_ms;         // reads only - also send to the other replica if no response by then, 0 for never
+    bool            read_fastest;           // reads only - use the replica with lower latency and load rather than alternating
 } cl_write_parameters;
 
 /******************************************************************************
@@ -67,8 +70,19 @@ static inline void cl_write_parameters_set_default(cl_write_parameters *cl_w_p)
     cl_w_p->use_generation_gt = false;
     cl_w_p->use_generation_dup = false;
     cl_w_p->timeout_ms = 0;
+    cl_w_p->timeout_us = 0;
     cl_w_p->record_ttl = 0;
     cl_w_p->w_pol = CL_WRITE_RETRY;
+    cl_w_p->hedge_delay_ms = 0;
+    cl_w_p->read_fastest = false;
+}
+
+// Transaction timeout in microseconds, 0 for none.
+static inline uint64_t cl_write_parameters_timeout_us(const cl_write_parameters *cl_w_p) {
+    if (! cl_w_p) {
+        return 0;
+    }
+    return cl_w_p->timeout_us ? cl_w_p->timeout_us : (uint64_t)cl_w_p->timeout_ms * 1000;
 }
 
 static inline void cl_write_parameters_set_generation( cl_write_parameters *cl_w_p, uint32_t generation) {
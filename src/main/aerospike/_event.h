@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#pragma once
+
+#include <aerospike/as_event.h>
+#include <aerospike/as_status.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+// Command states.
+#define AS_EVENT_WRITE 1
+#define AS_EVENT_READ_HEADER 2
+#define AS_EVENT_READ_BODY 3
+#define AS_EVENT_CANCELLED 4
+
+// Interval between connection pool trims.
+#define AS_EVENT_TRIM_INTERVAL_MS 1000
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+// as_event.c - shared by the epoll and io_uring loops.
+
+void
+as_event_command_fail(as_event_command* cmd, as_status status, const char* message);
+
+void
+as_event_command_complete(as_event_command* cmd);
+
+bool
+as_event_command_read_header(as_event_command* cmd);
+
+void
+as_event_conn_close(as_event_loop* loop, int fd, int32_t file);
+
+void
+as_event_loop_start_queued(as_event_loop* loop);
+
+void
+as_event_loop_check_deadlines(as_event_loop* loop);
+
+void
+as_event_pools_trim(as_event_loop* loop);
+
+void
+as_event_loop_close(as_event_loop* loop);
+
+// as_event_uring.c - io_uring loop. Only the create function may be called
+// if the client was not built with io_uring, and it returns false.
+
+bool
+as_event_uring_create(as_event_loop* loop);
+
+void
+as_event_uring_destroy(as_event_loop* loop);
+
+void*
+as_event_uring_run(void* data);
+
+void
+as_event_uring_send(as_event_command* cmd);
+
+int32_t
+as_event_uring_file_add(as_event_loop* loop, int fd);
+
+void
+as_event_uring_file_remove(as_event_loop* loop, int32_t file);
+
+void
+as_event_uring_cancel(as_event_command* cmd);
+
+void
+as_event_uring_buffer_put(as_event_loop* loop, int16_t fixed);
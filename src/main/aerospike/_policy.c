@@ -30,7 +30,11 @@
 as_policy_read * as_policy_read_resolve(as_policy_read * p, const as_policies * global, const as_policy_read * local)
 {
 	p->timeout		= as_policy_resolve(timeout, global->read, local, global->timeout);
+	p->timeout_us	= as_policy_resolve(timeout_us, global->read, local, 0);
 	p->key			= as_policy_resolve(key, global->read, local, global->key);
+	p->hedge_delay	= as_policy_resolve(hedge_delay, global->read, local, 0);
+	p->cache_staleness	= as_policy_resolve(cache_staleness, global->read, local, 0);
+	p->replica		= as_policy_resolve(replica, global->read, local, AS_POLICY_REPLICA_DEFAULT);
 	return p;
 }
 
@@ -50,6 +54,7 @@ as_policy_apply * as_policy_apply_resolve(as_policy_apply * p, const as_policies
 as_policy_write * as_policy_write_resolve(as_policy_write * p, const as_policies * global, const as_policy_write * local)
 {
 	p->timeout	= as_policy_resolve(timeout, global->write, local, global->timeout);
+	p->timeout_us = as_policy_resolve(timeout_us, global->write, local, 0);
 	p->retry	= as_policy_resolve(retry, global->write, local, global->retry);
 	p->key		= as_policy_resolve(key, global->write, local, global->key);
 	p->gen		= as_policy_resolve(gen, global->write, local, global->gen);
@@ -63,6 +68,7 @@ as_policy_write * as_policy_write_resolve(as_policy_write * p, const as_policies
 as_policy_operate * as_policy_operate_resolve(as_policy_operate * p, const as_policies * global, const as_policy_operate * local)
 {
 	p->timeout		= as_policy_resolve(timeout, global->operate, local, global->timeout);
+	p->timeout_us	= as_policy_resolve(timeout_us, global->operate, local, 0);
 	p->retry		= as_policy_resolve(retry, global->operate, local, global->retry);
 	p->key			= as_policy_resolve(key, global->operate, local, global->key);
 	p->gen			= as_policy_resolve(gen, global->operate, local, global->gen);
@@ -75,6 +81,7 @@ as_policy_operate * as_policy_operate_resolve(as_policy_operate * p, const as_po
 as_policy_remove * as_policy_remove_resolve(as_policy_remove * p, const as_policies * global, const as_policy_remove * local)
 {
 	p->timeout		= as_policy_resolve(timeout, global->operate, local, global->timeout);
+	p->timeout_us	= as_policy_resolve(timeout_us, global->remove, local, 0);
 	p->generation	= local ? local->generation : 0;
 	p->retry		= as_policy_resolve(retry, global->operate, local, global->retry);
 	p->key			= as_policy_resolve(key, global->operate, local, global->key);
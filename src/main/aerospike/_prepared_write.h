@@ -0,0 +1,63 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+#pragma once 
+
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_prepared_write.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Lay out the parts of a put that are the same for every record like rec.
+ *
+ *	@param pw		The prepared write to initialize.
+ *	@param err		The as_error to be populated if an error occurs.
+ *	@param policy	The resolved write policy.
+ *	@param ns		The namespace of the records.
+ *	@param set		The set of the records.
+ *	@param rec		A record with the bins to be written.
+ *
+ *	@return AEROSPIKE_OK if successful. Otherwise an error.
+ */
+as_status as_prepared_write_init(as_prepared_write * pw, as_error * err, const as_policy_write * policy,
+	const char * ns, const char * set, const as_record * rec);
+
+/**
+ *	Compile a put of rec into one of the thread's I/O buffers, to be given
+ *	back with as_io_buffer_put(*buf_r) - or sent with
+ *	do_the_full_monte_compiled(), which gives it back.
+ *
+ *	@return AEROSPIKE_OK if successful. AEROSPIKE_ERR_PARAM if rec or the key
+ *	doesn't match the prepared write. Otherwise an error.
+ */
+as_status as_prepared_write_compile(const as_prepared_write * pw, as_error * err, as_key * key, const as_record * rec,
+	uint8_t ** buf_r, size_t * buf_sz_r);
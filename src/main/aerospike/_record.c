@@ -0,0 +1,497 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/as_bin.h>
+#include <aerospike/as_buffer.h>
+#include <aerospike/as_bytes.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_msgpack.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_serializer.h>
+#include <aerospike/as_string.h>
+#include <aerospike/as_val.h>
+#include <citrusleaf/cf_byte_order.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cl_object.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "_bin.h"
+#include "_record.h"
+
+/******************************************************************************
+ *	STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Read the op at p, which must lie within end. Returns the op following it,
+ *	or NULL if the op is truncated or its bin name is too long.
+ */
+static const uint8_t * as_record_op_read(const uint8_t * p, const uint8_t * end, const cl_msg_op ** op_r, uint32_t * value_sz_r)
+{
+	if ( (size_t) (end - p) < sizeof(cl_msg_op) ) {
+		return NULL;
+	}
+
+	const cl_msg_op * op = (const cl_msg_op *) p;
+	uint32_t op_sz = cf_swap_from_be32(op->op_sz);
+
+	if ( op_sz < 4 + op->name_sz || op_sz > (size_t) (end - p) - sizeof(op->op_sz) ) {
+		return NULL;
+	}
+
+	if ( op->name_sz >= AS_BIN_NAME_MAX_SIZE ) {
+		return NULL;
+	}
+
+	*op_r = op;
+	*value_sz_r = op_sz - (4 + op->name_sz);
+	return p + sizeof(op->op_sz) + op_sz;
+}
+
+static bool as_record_type_is_blob(uint8_t type)
+{
+	switch ( type ) {
+		case CL_BLOB:
+		case CL_JAVA_BLOB:
+		case CL_CSHARP_BLOB:
+		case CL_PYTHON_BLOB:
+		case CL_RUBY_BLOB:
+		case CL_PHP_BLOB:
+		case CL_ERLANG_BLOB:
+		case CL_LUA_BLOB:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ *	Integers are sent big endian in up to 8 bytes, sign extended from the
+ *	top byte.
+ */
+static int64_t as_record_int_from_be(const uint8_t * p, uint32_t sz)
+{
+	uint64_t v = (sz != 0 && (p[0] & 0x80)) ? UINT64_MAX : 0;
+	for ( uint32_t i = 0; i < sz; i++ ) {
+		v = (v << 8) | p[i];
+	}
+	return (int64_t) v;
+}
+
+/**
+ *	The record's bin with the name, its value destroyed so it can be set
+ *	again. Returns NULL if the record has no such bin.
+ */
+static as_bin * as_record_bin_reuse(as_record * rec, const char * name)
+{
+	for ( int i = 0; i < rec->bins.size; i++ ) {
+		as_bin * bin = &rec->bins.entries[i];
+		if ( strcmp(bin->name, name) == 0 ) {
+			as_val_destroy((as_val *) bin->valuep);
+			bin->valuep = NULL;
+			return bin;
+		}
+	}
+	return NULL;
+}
+
+/**
+ *	Find the bin to set for name, appending it if the record doesn't have it
+ *	yet - as as_record_set() does. Returns NULL if the record is full.
+ */
+static as_bin * as_record_bin_slot(as_record * rec, const char * name)
+{
+	if ( rec->arena ) {
+		// Values set this way are allocated on their own.
+		rec->arena->heap_values = true;
+	}
+
+	as_bin * bin = as_record_bin_reuse(rec, name);
+	if ( bin ) {
+		return bin;
+	}
+
+	if ( rec->bins.size < rec->bins.capacity ) {
+		return &rec->bins.entries[rec->bins.size++];
+	}
+
+	return NULL;
+}
+
+static int as_bins_encoder_op(const as_binop * binop)
+{
+	if ( ! binop ) {
+		return CL_MSG_OP_WRITE;
+	}
+
+	switch ( binop->op ) {
+		case AS_OPERATOR_WRITE:		return CL_MSG_OP_WRITE;
+		case AS_OPERATOR_READ:		return CL_MSG_OP_READ;
+		case AS_OPERATOR_INCR:		return CL_MSG_OP_INCR;
+		case AS_OPERATOR_PREPEND:	return CL_MSG_OP_PREPEND;
+		case AS_OPERATOR_APPEND:	return CL_MSG_OP_APPEND;
+		case AS_OPERATOR_TOUCH:		return CL_MSG_OP_TOUCH;
+		default:					return -1;
+	}
+}
+
+/**
+ *	Work out how each bin goes on the wire. List and map values are
+ *	serialized here, once.
+ */
+static int as_bins_encoder_size(cl_ops_encoder * encoder, const cl_gather * gather, size_t * msg_sz, size_t * gather_sz)
+{
+	as_bins_encoder * enc = (as_bins_encoder *) encoder;
+	int n_refs = 0;
+
+	for ( int i = 0; i < encoder->n_ops; i++ ) {
+		const as_binop * binop = enc->binops ? &enc->binops[i] : NULL;
+		const as_bin * bin = binop ? &binop->bin : &enc->bins[i];
+		as_bins_encoder_entry * e = &enc->entries[i];
+		as_val * val = (as_val *) bin->valuep;
+
+		int op = as_bins_encoder_op(binop);
+		if ( op < 0 ) {
+			return -1;
+		}
+
+		e->op = (uint8_t) op;
+		e->name_sz = (uint8_t) strlen(bin->name);
+		e->ref = false;
+
+		switch ( val ? val->type : AS_NIL ) {
+			case AS_NIL: {
+				e->type = CL_NULL;
+				e->value_sz = 0;
+				break;
+			}
+			case AS_INTEGER: {
+				e->type = CL_INT;
+				e->value_sz = sizeof(uint64_t);
+				break;
+			}
+			case AS_STRING: {
+				e->type = CL_STR;
+				e->value_sz = (uint32_t) as_string_len((as_string *) val);
+				break;
+			}
+			case AS_BYTES: {
+				e->type = (uint8_t) ((as_bytes *) val)->type;
+				e->value_sz = ((as_bytes *) val)->size;
+				break;
+			}
+			case AS_LIST:
+			case AS_MAP: {
+				if ( e->packed.data == NULL ) {
+					if ( ! enc->ser_init ) {
+						as_msgpack_init(&enc->ser);
+						enc->ser_init = true;
+					}
+					as_serializer_serialize(&enc->ser, val, &e->packed);
+				}
+				e->type = val->type == AS_LIST ? CL_LIST : CL_MAP;
+				e->value_sz = e->packed.size;
+				break;
+			}
+			default: {
+				return -1;
+			}
+		}
+
+		*msg_sz += sizeof(cl_msg_op) + e->name_sz + e->value_sz;
+
+		if ( e->type != CL_NULL && e->type != CL_INT && cl_gather_check(gather, n_refs, e->value_sz) ) {
+			*gather_sz += e->value_sz;
+			e->ref = true;
+			n_refs++;
+		}
+	}
+
+	return 0;
+}
+
+static uint8_t * as_bins_encoder_write(cl_ops_encoder * encoder, uint8_t * buf, cl_gather * gather, uint8_t ** seg)
+{
+	as_bins_encoder * enc = (as_bins_encoder *) encoder;
+
+	for ( int i = 0; i < encoder->n_ops; i++ ) {
+		const as_bin * bin = enc->binops ? &enc->binops[i].bin : &enc->bins[i];
+		as_bins_encoder_entry * e = &enc->entries[i];
+		as_val * val = (as_val *) bin->valuep;
+		cl_msg_op * op = (cl_msg_op *) buf;
+
+		op->op_sz = cf_swap_to_be32(4 + e->name_sz + e->value_sz);
+		op->op = e->op;
+		op->particle_type = e->type;
+		op->version = 0;
+		op->name_sz = e->name_sz;
+		memcpy(op->name, bin->name, e->name_sz);
+
+		uint8_t * value_p = op->name + e->name_sz;
+		const void * value = NULL;
+
+		switch ( e->type ) {
+			case CL_NULL: {
+				break;
+			}
+			case CL_INT: {
+				uint64_t v = cf_swap_to_be64((uint64_t) ((as_integer *) val)->value);
+				memcpy(value_p, &v, sizeof(v));
+				break;
+			}
+			case CL_STR: {
+				value = ((as_string *) val)->value;
+				break;
+			}
+			case CL_LIST:
+			case CL_MAP: {
+				value = e->packed.data;
+				break;
+			}
+			default: {
+				value = ((as_bytes *) val)->value;
+				break;
+			}
+		}
+
+		if ( e->ref ) {
+			cl_gather_ref(gather, seg, value_p, value, e->value_sz);
+			buf = value_p;
+			continue;
+		}
+
+		if ( value ) {
+			memcpy(value_p, value, e->value_sz);
+		}
+		buf = value_p + e->value_sz;
+	}
+
+	return buf;
+}
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+void as_bins_encoder_init(as_bins_encoder * enc, const as_bin * bins, const as_binop * binops, uint16_t n, as_bins_encoder_entry * entries)
+{
+	enc->encoder.n_ops = n;
+	enc->encoder.size = as_bins_encoder_size;
+	enc->encoder.write = as_bins_encoder_write;
+	enc->bins = bins;
+	enc->binops = binops;
+	enc->entries = entries;
+	enc->ser_init = false;
+
+	for ( int i = 0; i < n; i++ ) {
+		as_buffer_init(&entries[i].packed);
+	}
+}
+
+void as_bins_encoder_destroy(as_bins_encoder * enc)
+{
+	for ( int i = 0; i < enc->encoder.n_ops; i++ ) {
+		as_buffer_destroy(&enc->entries[i].packed);
+	}
+
+	if ( enc->ser_init ) {
+		as_serializer_destroy(&enc->ser);
+	}
+}
+
+int as_record_from_msg(as_record * rec, const cl_msg * msg, const uint8_t * buf, size_t buf_sz, bool arena, bool repeats)
+{
+	const uint8_t * p = buf;
+	const uint8_t * end = buf + buf_sz;
+
+	for ( int i = 0; i < msg->n_fields; i++ ) {
+		if ( (size_t) (end - p) < sizeof(cl_msg_field) ) {
+			return -1;
+		}
+		uint32_t field_sz = cf_swap_from_be32(((const cl_msg_field *) p)->field_sz);
+		if ( field_sz > (size_t) (end - p) - sizeof(uint32_t) ) {
+			return -1;
+		}
+		p += sizeof(uint32_t) + field_sz;
+	}
+
+	if ( msg->n_ops == 0 ) {
+		return 0;
+	}
+
+	// First pass - validate the ops and size the string and blob values.
+	const uint8_t * ops = p;
+	const cl_msg_op * op;
+	uint32_t value_sz;
+	size_t data_sz = 0;
+
+	for ( int i = 0; i < msg->n_ops; i++ ) {
+		p = as_record_op_read(p, end, &op, &value_sz);
+		if ( ! p ) {
+			return -1;
+		}
+
+		switch ( op->particle_type ) {
+			case CL_NULL:
+			case CL_LIST:
+			case CL_MAP:
+				break;
+			case CL_INT:
+				if ( value_sz > 8 ) {
+					return -1;
+				}
+				break;
+			case CL_STR:
+				data_sz += value_sz + 1;
+				break;
+			default:
+				if ( ! as_record_type_is_blob(op->particle_type) ) {
+					return -1;
+				}
+				data_sz += value_sz;
+				break;
+		}
+	}
+
+	// Take over an empty record's bins, so the values can share their block.
+	uint8_t * data = NULL;
+
+	if ( rec->bins.entries == NULL || (rec->bins.size == 0 && rec->bins._free) ) {
+		size_t block_sz = sizeof(as_bin) * msg->n_ops + data_sz;
+		uint8_t * block = arena ? (uint8_t *) as_record_arena_alloc(rec, block_sz) : (uint8_t *) malloc(block_sz);
+		if ( ! block ) {
+			return -1;
+		}
+		if ( rec->bins._free ) {
+			free(rec->bins.entries);
+		}
+		rec->bins._free = ! arena;
+		rec->bins.capacity = msg->n_ops;
+		rec->bins.size = 0;
+		rec->bins.entries = (as_bin *) block;
+		data = block + sizeof(as_bin) * msg->n_ops;
+	}
+
+	// Second pass - set the bins. Values in the block are never freed alone.
+	as_serializer ser;
+	bool ser_init = false;
+	int rv = 0;
+
+	p = ops;
+
+	for ( int i = 0; i < msg->n_ops; i++ ) {
+		p = as_record_op_read(p, end, &op, &value_sz);
+
+		as_bin_name name;
+		memcpy(name, op->name, op->name_sz);
+		name[op->name_sz] = '\0';
+
+		// Several ops on a bin - e.g. read, incr, read - each return a value,
+		// and the record keeps the last one, as as_record_set() would.
+		as_bin * bin;
+		if ( data ) {
+			bin = repeats ? as_record_bin_reuse(rec, name) : NULL;
+			if ( ! bin ) {
+				bin = &rec->bins.entries[rec->bins.size++];
+			}
+		}
+		else {
+			bin = as_record_bin_slot(rec, name);
+			if ( ! bin ) {
+				continue;
+			}
+		}
+
+		const uint8_t * value = op->name + op->name_sz;
+
+		switch ( op->particle_type ) {
+			case CL_NULL: {
+				as_bin_init_nil(bin, name);
+				break;
+			}
+			case CL_INT: {
+				as_bin_init_int64(bin, name, as_record_int_from_be(value, value_sz));
+				break;
+			}
+			case CL_STR: {
+				char * str = data ? (char *) data : (char *) malloc(value_sz + 1);
+				memcpy(str, value, value_sz);
+				str[value_sz] = '\0';
+				as_string_init_wlen((as_string *) &bin->value, str, value_sz, data == NULL);
+				as_bin_init(bin, name, &bin->value);
+				if ( data ) {
+					data += value_sz + 1;
+				}
+				break;
+			}
+			case CL_LIST:
+			case CL_MAP: {
+				if ( ! ser_init ) {
+					as_msgpack_init(&ser);
+					ser_init = true;
+				}
+
+				// The deserializer only reads the buffer, so it is used in place.
+				as_buffer buffer = {
+					.capacity = value_sz,
+					.size = value_sz,
+					.data = (uint8_t *) value
+				};
+
+				as_val * val = NULL;
+				as_serializer_deserialize(&ser, &buffer, &val);
+
+				if ( val ) {
+					as_bin_init(bin, name, (as_bin_value *) val);
+					if ( rec->arena ) {
+						rec->arena->heap_values = true;
+					}
+				}
+				else {
+					as_bin_init_nil(bin, name);
+					rv = -1;
+				}
+				break;
+			}
+			default: {
+				uint8_t * bytes = data ? data : (uint8_t *) malloc(value_sz);
+				memcpy(bytes, value, value_sz);
+				as_bin_init_raw(bin, name, bytes, value_sz, data == NULL);
+				((as_bytes *) &bin->value)->type = (as_bytes_type) op->particle_type;
+				if ( data ) {
+					data += value_sz;
+				}
+				break;
+			}
+		}
+	}
+
+	if ( ser_init ) {
+		as_serializer_destroy(&ser);
+	}
+
+	return rv;
+}
@@ -0,0 +1,179 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+#pragma once 
+
+#include <aerospike/as_bin.h>
+#include <aerospike/as_buffer.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_serializer.h>
+#include <citrusleaf/cf_proto.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../citrusleaf/internal.h"
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	Encoding of one bin, worked out when the request is sized.
+ */
+typedef struct as_bins_encoder_entry_s {
+
+	/**
+	 *	List or map value, serialized once.
+	 */
+	as_buffer packed;
+
+	/**
+	 *	Size of the value on the wire.
+	 */
+	uint32_t value_sz;
+
+	/**
+	 *	Length of the bin name.
+	 */
+	uint8_t name_sz;
+
+	/**
+	 *	CL_MSG_OP_* operation.
+	 */
+	uint8_t op;
+
+	/**
+	 *	Particle type of the value.
+	 */
+	uint8_t type;
+
+	/**
+	 *	If true, the value is sent from where it is rather than copied.
+	 */
+	bool ref;
+
+} as_bins_encoder_entry;
+
+/**
+ *	Writes the bins of an as_record, or the bin operations of an
+ *	as_operations, straight into a request - pass the encoder member to
+ *	cl_compile_ops(). Values may be referenced by the compiled request, so the
+ *	encoder must outlive it.
+ */
+typedef struct as_bins_encoder_s {
+
+	/**
+	 *	Callbacks used by the compile.
+	 */
+	cl_ops_encoder encoder;
+
+	/**
+	 *	Record bins, or NULL.
+	 */
+	const as_bin * bins;
+
+	/**
+	 *	Bin operations, or NULL.
+	 */
+	const as_binop * binops;
+
+	/**
+	 *	One entry per bin.
+	 */
+	as_bins_encoder_entry * entries;
+
+	/**
+	 *	Serializer shared by list and map values.
+	 */
+	as_serializer ser;
+
+	/**
+	 *	If true, ser has been initialized.
+	 */
+	bool ser_init;
+
+} as_bins_encoder;
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+/**
+ *	Initialize an encoder for the bins of a record, with its entries on the
+ *	stack.
+ */
+#define as_bins_encoder_inita_record(__enc, __rec) \
+	as_bins_encoder_init(__enc, (__rec)->bins.entries, NULL, (__rec)->bins.size, \
+		(as_bins_encoder_entry *) alloca(sizeof(as_bins_encoder_entry) * (__rec)->bins.size))
+
+/**
+ *	Initialize an encoder for the bin operations of an as_operations, with its
+ *	entries on the stack.
+ */
+#define as_bins_encoder_inita_operations(__enc, __ops) \
+	as_bins_encoder_init(__enc, NULL, (__ops)->binops.entries, (__ops)->binops.size, \
+		(as_bins_encoder_entry *) alloca(sizeof(as_bins_encoder_entry) * (__ops)->binops.size))
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Decode the bins of a response message straight into a record.
+ *
+ *	The message header must already be in host byte order, and buf holds the
+ *	fields and ops that follow it, which are left untouched. Generation and
+ *	ttl are not set.
+ *
+ *	If the record has no bins yet and its entries are not stack allocated, the
+ *	bins and the string and blob values are placed in a single allocation,
+ *	freed with the record - carved from the record's arena if arena is set.
+ *	Otherwise each value is allocated as it is set. List and map values share
+ *	one deserializer, and are always allocated on their own.
+ *
+ *	@param rec		The record to populate.
+ *	@param msg		The response message header.
+ *	@param buf		The response fields and ops.
+ *	@param buf_sz	The size of buf.
+ *	@param arena	If true, decode into the record's arena.
+ *	@param repeats	If true, the response may hold several values for a bin,
+ *					as operate responses do, and the last one is kept.
+ *					Otherwise each op of a record with no bins yet is taken
+ *					to be a different bin.
+ *
+ *	@return 0 on success. Otherwise -1 if the message is malformed or holds
+ *	a value of an unknown type - bins decoded before the failure are kept.
+ */
+int as_record_from_msg(as_record * rec, const cl_msg * msg, const uint8_t * buf, size_t buf_sz, bool arena, bool repeats);
+
+/**
+ *	Initialize an encoder for either bins or binops, using n entries.
+ */
+void as_bins_encoder_init(as_bins_encoder * enc, const as_bin * bins, const as_binop * binops, uint16_t n, as_bins_encoder_entry * entries);
+
+/**
+ *	Release the serialized values, once the request has been sent.
+ */
+void as_bins_encoder_destroy(as_bins_encoder * enc);
@@ -0,0 +1,288 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <citrusleaf/cf_digest.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "_ripemd160.h"
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+// RIPEMD-160 is run on GCC vector types, one key per 32-bit lane - the
+// compiler lowers them to SSE2, AVX2 or NEON. Without GCC extensions, keys
+// are digested one at a time.
+#if defined(__GNUC__) && ! defined(AS_RIPEMD160_SCALAR)
+#define RIPEMD160_VECTOR
+#endif
+
+#if defined(RIPEMD160_VECTOR) && (defined(__x86_64__) || defined(__i386__))
+#define RIPEMD160_AVX2
+#endif
+
+#define RIPEMD160_BLOCK_SZ 64
+
+/******************************************************************************
+ *	STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Digest one key with cf_digest_compute2().
+ */
+static void ripemd160_key(const as_ripemd160_key * key, cf_digest * digest)
+{
+	uint8_t k[key->value_sz + 1];
+	k[0] = key->type;
+	memcpy(&k[1], key->value, key->value_sz);
+	cf_digest_compute2((void *) key->set, key->set_sz, k, key->value_sz + 1, digest);
+}
+
+#ifdef RIPEMD160_VECTOR
+
+typedef uint32_t ripemd160_lanes __attribute__((vector_size(AS_RIPEMD160_LANES * sizeof(uint32_t))));
+
+// Message word and rotation of each step, left and right lines.
+static const uint8_t RL[80] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+	3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+	1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+	4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13
+};
+
+static const uint8_t RR[80] = {
+	5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+	6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+	15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+	8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+	12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11
+};
+
+static const uint8_t SL[80] = {
+	11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+	7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+	11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+	11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+	9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6
+};
+
+static const uint8_t SR[80] = {
+	8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+	9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+	9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+	15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+	8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11
+};
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define F1(x, y, z) ((x) ^ (y) ^ (z))
+#define F2(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define F3(x, y, z) (((x) | ~(y)) ^ (z))
+#define F4(x, y, z) (((x) & (z)) | ((y) & ~(z)))
+#define F5(x, y, z) ((x) ^ ((y) | ~(z)))
+
+// Sixteen steps of both lines.
+#define ROUND(j0, fl, kl, fr, kr) \
+	for ( int j = j0; j < j0 + 16; j++ ) { \
+		t = ROL(al + fl(bl, cl, dl) + x[RL[j]] + (uint32_t) (kl), SL[j]) + el; \
+		al = el; el = dl; dl = ROL(cl, 10); cl = bl; bl = t; \
+		t = ROL(ar + fr(br, cr, dr) + x[RR[j]] + (uint32_t) (kr), SR[j]) + er; \
+		ar = er; er = dr; dr = ROL(cr, 10); cr = br; br = t; \
+	}
+
+/**
+ *	Compress one block of each lane into h.
+ */
+static inline __attribute__((always_inline)) void ripemd160_compress(ripemd160_lanes * h, const ripemd160_lanes * x)
+{
+	ripemd160_lanes al = h[0], bl = h[1], cl = h[2], dl = h[3], el = h[4];
+	ripemd160_lanes ar = al, br = bl, cr = cl, dr = dl, er = el;
+	ripemd160_lanes t;
+
+	ROUND(0, F1, 0x00000000, F5, 0x50A28BE6)
+	ROUND(16, F2, 0x5A827999, F4, 0x5C4DD124)
+	ROUND(32, F3, 0x6ED9EBA1, F3, 0x6D703EF3)
+	ROUND(48, F4, 0x8F1BBCDC, F2, 0x7A6D76E9)
+	ROUND(64, F5, 0xA953FD4E, F1, 0x00000000)
+
+	t = h[1] + cl + dr;
+	h[1] = h[2] + dl + er;
+	h[2] = h[3] + el + ar;
+	h[3] = h[4] + al + br;
+	h[4] = h[0] + bl + cr;
+	h[0] = t;
+}
+
+/**
+ *	Copy the part of a message piece starting at message offset start which
+ *	falls in the block starting at message offset off.
+ */
+static inline void ripemd160_copy(uint8_t * block, uint32_t off, const uint8_t * src, uint32_t start, uint32_t sz)
+{
+	uint32_t begin = start > off ? start : off;
+	uint32_t end = start + sz < off + RIPEMD160_BLOCK_SZ ? start + sz : off + RIPEMD160_BLOCK_SZ;
+
+	if ( begin < end ) {
+		memcpy(block + begin - off, src + begin - start, end - begin);
+	}
+}
+
+/**
+ *	Lay out block b of a key's padded message.
+ */
+static void ripemd160_block(const as_ripemd160_key * key, uint32_t total, uint32_t b, uint8_t * block)
+{
+	uint32_t off = b * RIPEMD160_BLOCK_SZ;
+
+	memset(block, 0, RIPEMD160_BLOCK_SZ);
+	ripemd160_copy(block, off, key->set, 0, key->set_sz);
+	ripemd160_copy(block, off, &key->type, key->set_sz, 1);
+	ripemd160_copy(block, off, key->value, key->set_sz + 1, key->value_sz);
+
+	if ( total >= off && total < off + RIPEMD160_BLOCK_SZ ) {
+		block[total - off] = 0x80;
+	}
+
+	// The last block ends with the message length in bits, little-endian.
+	if ( (total + 8) / RIPEMD160_BLOCK_SZ == b ) {
+		uint64_t bits = (uint64_t) total * 8;
+
+		for ( int i = 0; i < 8; i++ ) {
+			block[RIPEMD160_BLOCK_SZ - 8 + i] = (uint8_t) (bits >> (i * 8));
+		}
+	}
+}
+
+/**
+ *	Digest up to AS_RIPEMD160_LANES keys. Lanes whose message is shorter
+ *	than the longest keep their state once they run out of blocks.
+ */
+static inline __attribute__((always_inline)) void ripemd160_lanes_run(const as_ripemd160_key * keys, uint32_t n, cf_digest * digests)
+{
+	uint32_t total[AS_RIPEMD160_LANES];
+	uint32_t n_blocks[AS_RIPEMD160_LANES];
+	uint32_t max_blocks = 0;
+
+	for ( uint32_t l = 0; l < n; l++ ) {
+		total[l] = keys[l].set_sz + 1 + keys[l].value_sz;
+		n_blocks[l] = (total[l] + 8) / RIPEMD160_BLOCK_SZ + 1;
+
+		if ( n_blocks[l] > max_blocks ) {
+			max_blocks = n_blocks[l];
+		}
+	}
+
+	ripemd160_lanes zero = { 0 };
+	ripemd160_lanes h[5] = {
+		zero + 0x67452301, zero + 0xEFCDAB89, zero + 0x98BADCFE, zero + 0x10325476, zero + 0xC3D2E1F0
+	};
+
+	for ( uint32_t b = 0; b < max_blocks; b++ ) {
+		uint32_t w[16][AS_RIPEMD160_LANES];
+		ripemd160_lanes active = zero;
+
+		for ( uint32_t l = 0; l < AS_RIPEMD160_LANES; l++ ) {
+			if ( l >= n || b >= n_blocks[l] ) {
+				for ( int j = 0; j < 16; j++ ) {
+					w[j][l] = 0;
+				}
+				continue;
+			}
+
+			uint8_t block[RIPEMD160_BLOCK_SZ];
+			ripemd160_block(&keys[l], total[l], b, block);
+
+			for ( int j = 0; j < 16; j++ ) {
+				const uint8_t * p = &block[j * 4];
+				w[j][l] = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+			}
+			active[l] = 0xFFFFFFFF;
+		}
+
+		ripemd160_lanes x[16];
+		memcpy(x, w, sizeof(x));
+
+		ripemd160_lanes s[5] = { h[0], h[1], h[2], h[3], h[4] };
+		ripemd160_compress(s, x);
+
+		for ( int i = 0; i < 5; i++ ) {
+			h[i] = (s[i] & active) | (h[i] & ~active);
+		}
+	}
+
+	for ( uint32_t l = 0; l < n; l++ ) {
+		uint8_t * d = (uint8_t *) &digests[l];
+
+		for ( int i = 0; i < 5; i++ ) {
+			uint32_t v = h[i][l];
+			d[i * 4] = (uint8_t) v;
+			d[i * 4 + 1] = (uint8_t) (v >> 8);
+			d[i * 4 + 2] = (uint8_t) (v >> 16);
+			d[i * 4 + 3] = (uint8_t) (v >> 24);
+		}
+	}
+}
+
+static void ripemd160_lanes_default(const as_ripemd160_key * keys, uint32_t n, cf_digest * digests)
+{
+	ripemd160_lanes_run(keys, n, digests);
+}
+
+#ifdef RIPEMD160_AVX2
+__attribute__((target("avx2")))
+static void ripemd160_lanes_avx2(const as_ripemd160_key * keys, uint32_t n, cf_digest * digests)
+{
+	ripemd160_lanes_run(keys, n, digests);
+}
+#endif
+
+#endif // RIPEMD160_VECTOR
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+void as_ripemd160_keys(const as_ripemd160_key * keys, uint32_t n, cf_digest * digests)
+{
+#ifdef RIPEMD160_VECTOR
+	// A lone key is quicker through the scalar code.
+	if ( n > 1 ) {
+#ifdef RIPEMD160_AVX2
+		if ( __builtin_cpu_supports("avx2") ) {
+			ripemd160_lanes_avx2(keys, n, digests);
+			return;
+		}
+#endif
+		ripemd160_lanes_default(keys, n, digests);
+		return;
+	}
+#endif
+
+	for ( uint32_t i = 0; i < n; i++ ) {
+		ripemd160_key(&keys[i], &digests[i]);
+	}
+}
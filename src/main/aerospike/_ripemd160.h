@@ -0,0 +1,84 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+#pragma once 
+
+#include <citrusleaf/cf_digest.h>
+
+#include <stdint.h>
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+/**
+ *	Most keys digested by one as_ripemd160_keys() pass.
+ */
+#define AS_RIPEMD160_LANES 8
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+/**
+ *	A key laid out for digesting, as cf_digest_compute2() would be given it -
+ *	the set, then the particle type, then the key value.
+ */
+typedef struct as_ripemd160_key_s {
+
+	/**
+	 *	Set name, not null-terminated.
+	 */
+	const uint8_t * set;
+
+	/**
+	 *	Key value as sent on the wire.
+	 */
+	const uint8_t * value;
+
+	/**
+	 *	Length of set.
+	 */
+	uint32_t set_sz;
+
+	/**
+	 *	Length of value.
+	 */
+	uint32_t value_sz;
+
+	/**
+	 *	Particle type of value.
+	 */
+	uint8_t type;
+
+} as_ripemd160_key;
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Compute the RIPEMD-160 digests of up to AS_RIPEMD160_LANES keys, one per
+ *	vector lane. Keys needn't be the same length. Digests are bit-identical
+ *	to cf_digest_compute2()'s.
+ */
+void as_ripemd160_keys(const as_ripemd160_key * keys, uint32_t n, cf_digest * digests);
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <errno.h>
 
+#include "_bin.h"
 #include "_shim.h"
 
 /******************************************************************************
@@ -377,9 +378,114 @@ void clbin_to_asrecord(cl_bin * bin, as_record * r)
 }
 
 
-void clbins_to_asrecord(cl_bin * bins, uint32_t nbins, as_record * r) 
+/**
+ *	Copy the bins into the record's arena. The string and blob values share
+ *	one arena block, and the cl_bin values are left for the caller to free.
+ *	Returns false if the block couldn't be allocated.
+ */
+static bool clbins_to_asrecord_arena(cl_bin * bins, uint32_t n, as_record * r)
+{
+	size_t data_sz = 0;
+
+	for ( int i = 0; i < n; i++ ) {
+		switch(bins[i].object.type) {
+			case CL_NULL:
+			case CL_INT:
+			case CL_LIST:
+			case CL_MAP:
+				break;
+			case CL_STR:
+				data_sz += bins[i].object.sz + 1;
+				break;
+			default:
+				data_sz += bins[i].object.sz;
+				break;
+		}
+	}
+
+	uint8_t * data = NULL;
+
+	if ( data_sz > 0 && ! (data = (uint8_t *) as_record_arena_alloc(r, data_sz)) ) {
+		return false;
+	}
+
+	as_serializer ser;
+	bool ser_init = false;
+
+	for ( int i = 0; i < n; i++ ) {
+		cl_bin * clbin = &bins[i];
+		as_bin * bin = &r->bins.entries[r->bins.size++];
+
+		switch(clbin->object.type) {
+			case CL_NULL: {
+				as_bin_init_nil(bin, clbin->bin_name);
+				break;
+			}
+			case CL_INT: {
+				as_bin_init_int64(bin, clbin->bin_name, clbin->object.u.i64);
+				break;
+			}
+			case CL_STR: {
+				char * str = (char *) data;
+				memcpy(str, clbin->object.u.str, clbin->object.sz);
+				str[clbin->object.sz] = '\0';
+				as_string_init_wlen((as_string *) &bin->value, str, clbin->object.sz, false);
+				as_bin_init(bin, clbin->bin_name, &bin->value);
+				data += clbin->object.sz + 1;
+				break;
+			}
+			case CL_LIST:
+			case CL_MAP: {
+				if ( ! ser_init ) {
+					as_msgpack_init(&ser);
+					ser_init = true;
+				}
+
+				as_val * val = NULL;
+
+				as_buffer buffer;
+				buffer.data = (uint8_t *) clbin->object.u.blob;
+				buffer.size = (uint32_t)clbin->object.sz;
+
+				as_serializer_deserialize(&ser, &buffer, &val);
+
+				if ( val ) {
+					// The deserializer allocates the value on its own.
+					as_bin_init(bin, clbin->bin_name, (as_bin_value *) val);
+					if ( r->arena ) {
+						r->arena->heap_values = true;
+					}
+				}
+				else {
+					as_bin_init_nil(bin, clbin->bin_name);
+				}
+				break;
+			}
+			default: {
+				memcpy(data, clbin->object.u.blob, clbin->object.sz);
+				as_bin_init_raw(bin, clbin->bin_name, data, (uint32_t)clbin->object.sz, false);
+				((as_bytes *) &bin->value)->type = (as_bytes_type) clbin->object.type;
+				data += clbin->object.sz;
+				break;
+			}
+		}
+	}
+
+	if ( ser_init ) {
+		as_serializer_destroy(&ser);
+	}
+	return true;
+}
+
+void clbins_to_asrecord(cl_bin * bins, uint32_t nbins, as_record * r, bool arena) 
 {
 	uint32_t n = nbins < r->bins.capacity ? nbins : r->bins.capacity;
+
+	// Only an empty record's bins can be appended to without a name lookup.
+	if ( arena && r->bins.size == 0 && clbins_to_asrecord_arena(bins, n, r) ) {
+		return;
+	}
+
 	for ( int i = 0; i < n; i++ ) {
 		clbin_to_asrecord(&bins[i], r);
 	}
@@ -404,7 +510,10 @@ void aspolicywrite_to_clwriteparameters(const as_policy_write * policy, const as
 	wp->use_generation_dup = false;
 	
 	wp->timeout_ms = policy->timeout == UINT32_MAX ? 0 : policy->timeout;
+	wp->timeout_us = policy->timeout_us;
 	wp->record_ttl = rec->ttl;
+	wp->hedge_delay_ms = 0;
+	wp->read_fastest = false;
 
 	switch(policy->gen) {
 		case AS_POLICY_GEN_EQ:
@@ -453,7 +562,10 @@ void aspolicyoperate_to_clwriteparameters(const as_policy_operate * policy, cons
 	wp->use_generation_dup = false;
 	
 	wp->timeout_ms = policy->timeout == UINT32_MAX ? 0 : policy->timeout;
+	wp->timeout_us = policy->timeout_us;
 	wp->record_ttl = ops->ttl;
+	wp->hedge_delay_ms = 0;
+	wp->read_fastest = false;
 
 	switch(policy->gen) {
 		case AS_POLICY_GEN_EQ:
@@ -502,7 +614,10 @@ void aspolicyremove_to_clwriteparameters(const as_policy_remove * policy, cl_wri
 	wp->use_generation_dup = false;
 	
 	wp->timeout_ms = policy->timeout == UINT32_MAX ? 0 : policy->timeout;
+	wp->timeout_us = policy->timeout_us;
 	wp->record_ttl = 0;
+	wp->hedge_delay_ms = 0;
+	wp->read_fastest = false;
 
 	switch(policy->gen) {
 		case AS_POLICY_GEN_EQ:
@@ -21,7 +21,12 @@ void clbin_to_asval(cl_bin * bin, as_serializer * ser, as_val ** val);
 
 void clbin_to_asrecord(cl_bin * bin, as_record * r);
 
-void clbins_to_asrecord(cl_bin * bins, uint32_t nbins, as_record * rec);
+/**
+ *	Set the bins in the record. The string and blob values are handed off to
+ *	the record, unless arena is set - then all values are copied into the
+ *	record's arena and the bins still own theirs.
+ */
+void clbins_to_asrecord(cl_bin * bins, uint32_t nbins, as_record * rec, bool arena);
 
 void aspolicywrite_to_clwriteparameters(const as_policy_write * policy, const as_record * rec, cl_write_parameters * wp);
 
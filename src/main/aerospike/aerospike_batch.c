@@ -101,7 +101,9 @@ cl_batch_cb(char *ns, cf_digest *keyd, char *set, cl_object *key, int result,
 
 	// There may be bin data.
 	if (n_bins != 0) {
-		clbins_to_asrecord(bins, (uint32_t)n_bins, &p_r->record);
+		clbins_to_asrecord(bins, (uint32_t)n_bins, &p_r->record, as->cluster->record_arena);
+		// Values not handed off to the record are still owned by the bins.
+		citrusleaf_bins_free(bins, (int)n_bins);
 	}
 
 	return 0;
@@ -151,8 +153,19 @@ static as_status batch_read(
 		p_r->result = -1; // TODO - make an 'undefined' error
 		as_record_init(&p_r->record, 0);
 		p_r->key = (const as_key*)as_batch_keyat(batch, i);
+	}
+
+	// Digest the keys several at a time.
+	as_key** keys = (as_key**)alloca(sizeof(as_key*) * n);
 
-		memcpy(&digests[i], as_key_digest((as_key*)p_r->key)->value,
+	for (uint32_t i = 0; i < n; i++) {
+		keys[i] = (as_key*)results[i].key;
+	}
+
+	as_keys_digest_many(keys, n);
+
+	for (uint32_t i = 0; i < n; i++) {
+		memcpy(&digests[i], as_key_digest(keys[i])->value,
 				AS_DIGEST_VALUE_SIZE);
 	}
 
@@ -26,10 +26,12 @@
 #include <aerospike/as_bin.h>
 #include <aerospike/as_buffer.h>
 #include <aerospike/as_error.h>
+#include <aerospike/as_event.h>
 #include <aerospike/as_key.h>
 #include <aerospike/as_list.h>
 #include <aerospike/as_operations.h>
 #include <aerospike/as_policy.h>
+#include <aerospike/as_read_cache.h>
 #include <aerospike/as_record.h>
 #include <aerospike/as_status.h>
 
@@ -39,15 +41,119 @@
 #include <citrusleaf/citrusleaf.h>
 #include <citrusleaf/cl_object.h>
 #include <citrusleaf/cl_write.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
 #include <citrusleaf/cf_proto.h>
 #include <citrusleaf/cf_log_internal.h>
 
 #include "_log.h"
 #include "_policy.h"
+#include "_prepared_write.h"
+#include "_record.h"
 #include "_shim.h"
 
 #include "../citrusleaf/internal.h"
 
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Caller's record and how to decode into it.
+ */
+typedef struct key_record_udata_s {
+	as_record ** rec;
+	bool arena;
+
+	/**
+	 *	If true, the response may hold several values for a bin, as operate
+	 *	responses do.
+	 */
+	bool repeats;
+
+	/**
+	 *	Read cache to put the record in, or NULL - with the key and the
+	 *	shard epoch from the cache miss.
+	 */
+	as_read_cache * cache;
+	const as_key * key;
+	uint64_t epoch;
+} key_record_udata;
+
+/**
+ *	Decode a successful response into the caller's record, creating the
+ *	record if the caller didn't pass one.
+ */
+static int key_record_parse(cl_msg * msg, uint8_t * buf, size_t buf_sz, void * udata)
+{
+	key_record_udata * ud = (key_record_udata *) udata;
+	as_record ** rec = ud->rec;
+
+	if ( ud->cache ) {
+		as_read_cache_put(ud->cache, ud->key->ns, (cf_digest *) ud->key->digest.value, ud->epoch, msg, buf, buf_sz);
+	}
+
+	if ( rec == NULL ) {
+		return 0;
+	}
+
+	as_record * r = *rec;
+
+	if ( r == NULL ) {
+		r = as_record_new(0);
+	}
+
+	if ( as_record_from_msg(r, msg, buf, buf_sz, ud->arena, ud->repeats) != 0 ) {
+		if ( r != *rec ) {
+			as_record_destroy(r);
+		}
+		return -1;
+	}
+
+	r->gen = (uint16_t) msg->generation;
+	r->ttl = cf_server_void_time_to_ttl(msg->record_ttl);
+	*rec = r;
+	return 0;
+}
+
+/**
+ *	Decode a record from the read cache, if it's there and recent enough.
+ *	On a miss, ud is set up to put the record read from the server in the
+ *	cache.
+ */
+static bool key_cache_get(as_read_cache * cache, const as_key * key, uint32_t max_staleness_ms, key_record_udata * ud)
+{
+	as_digest * digest = as_key_digest((as_key *) key);
+	uint64_t epoch;
+	as_read_cache_entry * e = as_read_cache_get(cache, key->ns, (cf_digest *) digest->value, max_staleness_ms, &epoch);
+
+	if ( e ) {
+		cl_msg msg = e->msg;
+		int rv = key_record_parse(&msg, e->buf, e->buf_size, ud);
+		as_read_cache_release(e);
+
+		if ( rv == 0 ) {
+			return true;
+		}
+	}
+
+	ud->cache = cache;
+	ud->key = key;
+	ud->epoch = epoch;
+	return false;
+}
+
+/**
+ *	Drop a record this client has written from the read cache.
+ */
+static inline void key_cache_remove(aerospike * as, const as_key * key)
+{
+	if ( as->cluster->read_cache ) {
+		as_digest * digest = as_key_digest((as_key *) key);
+		as_read_cache_remove(as->cluster->read_cache, key->ns, (cf_digest *) digest->value);
+	}
+}
+
 /******************************************************************************
  * FUNCTIONS
  *****************************************************************************/
@@ -75,27 +181,35 @@ as_status aerospike_key_get(
 	as_policy_read p;
 	as_policy_read_resolve(&p, &as->config.policies, policy);
 
-	uint32_t    timeout = p.timeout == UINT32_MAX ? 0 : p.timeout;          
-	uint32_t    gen = 0;
-	uint32_t 	ttl = 0;
-	int         nvalues = 0;
-	cl_bin *    values = NULL;
+	cl_write_parameters wp;
+	cl_write_parameters_set_default(&wp);
+	wp.timeout_ms = p.timeout == UINT32_MAX ? 0 : p.timeout;
+	wp.timeout_us = p.timeout_us;
+	wp.hedge_delay_ms = p.hedge_delay;
+	wp.read_fastest = p.replica == AS_POLICY_REPLICA_FASTEST;
 
+	int info1 = CL_MSG_INFO1_READ | CL_MSG_INFO1_GET_ALL;
+	key_record_udata ud = { rec, as->cluster->record_arena, false, NULL, NULL, 0 };
 	cl_rv rc = CITRUSLEAF_OK;
 
+	if ( p.cache_staleness && as->cluster->read_cache &&
+			key_cache_get(as->cluster->read_cache, key, p.cache_staleness, &ud) ) {
+		return AEROSPIKE_OK;
+	}
+
 	switch ( p.key ) {
 		case AS_POLICY_KEY_DIGEST: {
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_get_all_digest_getsetname(as->cluster, key->ns, (cf_digest *) digest->value,
-					&values, &nvalues, timeout, &gen, NULL, &ttl);
+			rc = do_the_full_monte_parse(as->cluster, info1, 0, 0, key->ns, NULL, NULL, (cf_digest *) digest->value,
+					NULL, CL_OP_READ, NULL, 0, NULL, &wp, key_record_parse, &ud);
 			break;
 		}
 		case AS_POLICY_KEY_SEND: {
 			cl_object okey;
 			asval_to_clobject((as_val *) key->valuep, &okey);
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_get_all(as->cluster, key->ns, key->set, &okey, (cf_digest*)digest->value,
-					&values, &nvalues, timeout, &gen, &ttl);
+			rc = do_the_full_monte_parse(as->cluster, info1, 0, 0, key->ns, key->set, &okey, (cf_digest *) digest->value,
+					NULL, CL_OP_READ, NULL, 0, NULL, &wp, key_record_parse, &ud);
 			break;
 		}
 		default: {
@@ -103,29 +217,6 @@ as_status aerospike_key_get(
 			break;
 		}
 	}
-	
-	if ( rc == CITRUSLEAF_OK && rec != NULL ) {
-		as_record * r = *rec;
-		if ( r == NULL ) {
-			r = as_record_new(0);
-		}
-		if ( r->bins.entries == NULL ) {
-			r->bins.capacity = nvalues;
-			r->bins.size = 0;
-			r->bins.entries = malloc(sizeof(as_bin) * nvalues);
-			r->bins._free = true;
-		}
-		clbins_to_asrecord(values, nvalues, r);
-		r->gen = (uint16_t) gen;
-		r->ttl = ttl;
-		*rec = r;
-	}
-
-	if ( values != NULL ) {
-		// We are freeing the bins' objects, as opposed to bins themselves.
-		citrusleaf_bins_free(values, nvalues);
-		free(values);
-	}
 
 	return as_error_fromrc(err,rc);
 }
@@ -154,9 +245,13 @@ as_status aerospike_key_select(
 	as_policy_read p;
 	as_policy_read_resolve(&p, &as->config.policies, policy);
 
-	uint32_t    timeout = p.timeout == UINT32_MAX ? 0 : p.timeout;
-	uint32_t    gen = 0;
-	uint32_t 	ttl = 0;
+	cl_write_parameters wp;
+	cl_write_parameters_set_default(&wp);
+	wp.timeout_ms = p.timeout == UINT32_MAX ? 0 : p.timeout;
+	wp.timeout_us = p.timeout_us;
+	wp.hedge_delay_ms = p.hedge_delay;
+	wp.read_fastest = p.replica == AS_POLICY_REPLICA_FASTEST;
+
 	int         nvalues = 0;
 	cl_bin *    values = NULL;
 
@@ -173,21 +268,22 @@ as_status aerospike_key_select(
 		citrusleaf_object_init(&values[i].object);
 	}
 
+	key_record_udata ud = { rec, as->cluster->record_arena };
 	cl_rv rc = CITRUSLEAF_OK;
 
 	switch ( p.key ) {
 		case AS_POLICY_KEY_DIGEST: {
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_get_digest(as->cluster, key->ns, (cf_digest *) digest->value,
-					values, nvalues, timeout, &gen, &ttl);
+			rc = do_the_full_monte_parse(as->cluster, CL_MSG_INFO1_READ, 0, 0, key->ns, NULL, NULL, (cf_digest *) digest->value,
+					values, CL_OP_READ, NULL, nvalues, NULL, &wp, key_record_parse, &ud);
 			break;
 		}
 		case AS_POLICY_KEY_SEND: {
 			cl_object okey;
 			asval_to_clobject((as_val *) key->valuep, &okey);
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_get(as->cluster, key->ns, key->set, &okey, (cf_digest*)digest->value,
-					values, nvalues, timeout, &gen, &ttl);
+			rc = do_the_full_monte_parse(as->cluster, CL_MSG_INFO1_READ, 0, 0, key->ns, key->set, &okey, (cf_digest *) digest->value,
+					values, CL_OP_READ, NULL, nvalues, NULL, &wp, key_record_parse, &ud);
 			break;
 		}
 		default: {
@@ -196,28 +292,6 @@ as_status aerospike_key_select(
 		}
 	}
 
-	if ( rc == CITRUSLEAF_OK && rec != NULL ) {
-		as_record * r = *rec;
-		if ( r == NULL ) {
-			r = as_record_new(0);
-		}
-		if ( r->bins.entries == NULL ) {
-			r->bins.capacity = nvalues;
-			r->bins.size = 0;
-			r->bins.entries = malloc(sizeof(as_bin) * nvalues);
-			r->bins._free = true;
-		}
-		clbins_to_asrecord(values, nvalues, r);
-		r->gen = (uint16_t) gen;
-		r->ttl = ttl;
-		*rec = r;
-	}
-
-	if ( values != NULL ) {
-		// We are freeing the bins' objects, as opposed to bins themselves.
-		citrusleaf_bins_free(values, nvalues);
-	}
-
 	return as_error_fromrc(err,rc);
 }
 
@@ -326,24 +400,25 @@ as_status aerospike_key_put(
 	cl_write_parameters wp;
 	aspolicywrite_to_clwriteparameters(&p, rec, &wp);
 
-	int			nvalues	= rec->bins.size;
-	cl_bin *	values	= (cl_bin *) alloca(sizeof(cl_bin) * nvalues);
-
-	asrecord_to_clbins(rec, values, nvalues);
+	// The bins are written straight into the request.
+	as_bins_encoder enc;
+	as_bins_encoder_inita_record(&enc, rec);
 
 	cl_rv rc = CITRUSLEAF_OK;
 
 	switch ( p.key ) {
 		case AS_POLICY_KEY_DIGEST: {
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_put_digest_with_setname(as->cluster, key->ns, key->set, (cf_digest *) digest->value, values, nvalues, &wp);
+			rc = do_the_full_monte_parse(as->cluster, 0, CL_MSG_INFO2_WRITE, 0, key->ns, key->set, NULL, (cf_digest *) digest->value,
+					NULL, 0, NULL, 0, &enc.encoder, &wp, NULL, NULL);
 			break;
 		}
 		case AS_POLICY_KEY_SEND: {
 			cl_object okey;
 			asval_to_clobject((as_val *) key->valuep, &okey);
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_put(as->cluster, key->ns, key->set, &okey, (cf_digest*)digest->value, values, nvalues, &wp);
+			rc = do_the_full_monte_parse(as->cluster, 0, CL_MSG_INFO2_WRITE, 0, key->ns, key->set, &okey, (cf_digest *) digest->value,
+					NULL, 0, NULL, 0, &enc.encoder, &wp, NULL, NULL);
 			break;
 		}
 		default: {
@@ -352,12 +427,77 @@ as_status aerospike_key_put(
 		}
 	}
 
-	// We are freeing the bins' objects, as opposed to bins themselves.
-	citrusleaf_bins_free(values, nvalues);
+	as_bins_encoder_destroy(&enc);
+	key_cache_remove(as, key);
 
 	return as_error_fromrc(err,rc); 
 }
 
+/**
+ *	Prepare repeated writes of records with the same bins as rec.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if an error occurs.
+ *	@param policy		The policy to use for the writes. If NULL, then the default policy will be used.
+ *	@param ns			The namespace of the records.
+ *	@param set			The set of the records.
+ *	@param rec 			A record with the bins to be written.
+ *	@param pw			The prepared write to initialize.
+ *
+ *	@return AEROSPIKE_OK if successful. Otherwise an error.
+ */
+as_status aerospike_key_put_prepare(
+	aerospike * as, as_error * err, const as_policy_write * policy,
+	const char * ns, const char * set, const as_record * rec, as_prepared_write * pw)
+{
+	as_error_reset(err);
+
+	as_policy_write p;
+	as_policy_write_resolve(&p, &as->config.policies, policy);
+
+	if ( p.key != AS_POLICY_KEY_DIGEST && p.key != AS_POLICY_KEY_SEND ) {
+		return as_error_update(err, AEROSPIKE_ERR_PARAM, "invalid key policy");
+	}
+
+	return as_prepared_write_init(pw, err, &p, ns, set, rec);
+}
+
+/**
+ *	Store a record in the cluster, using a prepared write.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if an error occurs.
+ *	@param pw			The prepared write.
+ *	@param key			The key of the record.
+ *	@param rec 			The record containing the data to be written.
+ *
+ *	@return AEROSPIKE_OK if successful. Otherwise an error.
+ */
+as_status aerospike_key_put_prepared(
+	aerospike * as, as_error * err, const as_prepared_write * pw,
+	const as_key * key, as_record * rec)
+{
+	as_error_reset(err);
+
+	cl_write_parameters wp;
+	aspolicywrite_to_clwriteparameters(&pw->policy, rec, &wp);
+
+	// Only the key, generation, TTL and values are written - the rest of the
+	// request is copied from the prepared write.
+	cl_compiled compiled;
+
+	if ( as_prepared_write_compile(pw, err, (as_key *) key, rec, &compiled.buf, &compiled.buf_sz) != AEROSPIKE_OK ) {
+		return err->code;
+	}
+
+	as_digest * digest = as_key_digest((as_key *) key);
+	cl_rv rc = do_the_full_monte_compiled(as->cluster, 0, CL_MSG_INFO2_WRITE, pw->ns, (cf_digest *) digest->value,
+			&compiled, &wp, NULL, NULL);
+	key_cache_remove(as, key);
+
+	return as_error_fromrc(err,rc);
+}
+
 /**
  *	Remove a record from the cluster.
  *
@@ -412,6 +552,8 @@ as_status aerospike_key_remove(
 		}
 	}
 
+	key_cache_remove(as, key);
+
 	return as_error_fromrc(err,rc);
 }
 
@@ -456,50 +598,42 @@ as_status aerospike_key_operate(
 	cl_write_parameters wp;
 	aspolicyoperate_to_clwriteparameters(&p, ops, &wp);
 
-	uint32_t 		gen = 0;
-	uint32_t 		ttl = 0;
-	int 			n_operations = ops->binops.size;
-	cl_operation * 	operations = (cl_operation *) alloca(sizeof(cl_operation) * n_operations);
-	int				n_read_ops = 0;
-	as_bin_name *	read_op_bins = alloca(sizeof(as_bin_name) * n_operations);
+	int				info1 = 0;
+	int				info2 = 0;
 
-	for(int i=0; i<n_operations; i++) {
-		cl_operation * clop = &operations[i];
-		as_binop * op = &ops->binops.entries[i];
-
-		// Length check already done on as_bin name length. For performance we
-		// we'll leave out this down-size check since this is a temporary shim
-		// and we know the CL and AS limits are the same...
-//		if ( strlen(op->bin.name) > CL_BINNAME_SIZE - 1 ) {
-//			return as_error_update(err, AEROSPIKE_ERR_PARAM, "bin name too long: %s", op->bin.name);
-//		}
-
-		strcpy(clop->bin.bin_name, op->bin.name);
-		clop->op = (cl_operator)op->op;
-
-		// Collect bin names that are read.
-		if (op->op == AS_OPERATOR_READ) {
-			strcpy(read_op_bins[n_read_ops++], op->bin.name);
+	for(int i=0; i<ops->binops.size; i++) {
+		if (ops->binops.entries[i].op == AS_OPERATOR_READ) {
+			info1 = CL_MSG_INFO1_READ;
+		}
+		else {
+			info2 = CL_MSG_INFO2_WRITE;
 		}
-
-		asbinvalue_to_clobject(op->bin.valuep, &clop->bin.object);
 	}
 
+	// The operations are written straight into the request.
+	as_bins_encoder enc;
+	as_bins_encoder_inita_operations(&enc, ops);
+
+	// The server only returns bins for read operations, so the response is
+	// only decoded into a record if there are any.  It always goes through
+	// key_record_parse(), which drops it when there's no record to fill -
+	// cl_parse() would allocate bins nobody frees.
+	key_record_udata ud = { info1 ? rec : NULL, as->cluster->record_arena, true };
 	cl_rv rc = CITRUSLEAF_OK;
 
 	switch ( p.key ) {
 		case AS_POLICY_KEY_DIGEST: {
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_operate_digest(as->cluster, key->ns, key->set, (cf_digest *) digest->value,
-					operations, n_operations, &wp, &gen, &ttl);
+			rc = do_the_full_monte_parse(as->cluster, info1, info2, 0, key->ns, key->set, NULL, (cf_digest *) digest->value,
+					NULL, 0, NULL, 0, &enc.encoder, &wp, key_record_parse, &ud);
 			break;
 		}
 		case AS_POLICY_KEY_SEND: {
 			cl_object okey;
 			asval_to_clobject((as_val *) key->valuep, &okey);
 			as_digest * digest = as_key_digest((as_key *) key);
-			rc = citrusleaf_operate(as->cluster, key->ns, key->set, &okey, (cf_digest*)digest->value,
-					operations, n_operations, &wp, &gen, &ttl);
+			rc = do_the_full_monte_parse(as->cluster, info1, info2, 0, key->ns, key->set, &okey, (cf_digest *) digest->value,
+					NULL, 0, NULL, 0, &enc.encoder, &wp, key_record_parse, &ud);
 			break;
 		}
 		default: {
@@ -508,34 +642,10 @@ as_status aerospike_key_operate(
 		}
 	}
 
-	if ( n_read_ops != 0 && rc == CITRUSLEAF_OK && rec != NULL ) {
-		as_record * r = *rec;
-		if ( r == NULL ) {
-			r = as_record_new(0);
-		}
-		if ( r->bins.entries == NULL ) {
-			r->bins.capacity = n_read_ops;
-			r->bins.size = 0;
-			r->bins.entries = malloc(sizeof(as_bin) * n_read_ops);
-			r->bins._free = true;
-		}
-		r->gen = (uint16_t) gen;
-		r->ttl = ttl;
-
-		// This works around an existing client bug where the data returned for
-		// a read operation is stored in the first bin struct with that bin
-		// name, not necessarily the bin struct corresponding to the read.
-		for (int i = 0; i < n_read_ops; i++) {
-			for (int j = 0; j < n_operations; j++) {
-				if (strcmp(read_op_bins[i], operations[j].bin.bin_name) == 0) {
-					clbin_to_asrecord(&operations[j].bin, r);
-					citrusleaf_object_free(&operations[j].bin.object);
-					break;
-				}
-			}
-		}
+	as_bins_encoder_destroy(&enc);
 
-		*rec = r;
+	if ( info2 ) {
+		key_cache_remove(as, key);
 	}
 
 	return as_error_fromrc(err,rc);
@@ -651,6 +761,7 @@ as_status aerospike_key_apply(
 	}
 
 	as_buffer_destroy(&args);
+	key_cache_remove(as, key);
 
 	if (! (rc == CITRUSLEAF_OK || rc == CITRUSLEAF_FAIL_UDF_BAD_RESPONSE)) {
 		as_error_fromrc(err, rc);
@@ -702,3 +813,433 @@ as_status aerospike_key_apply(
 	
 	return err->code;
 }
+
+/******************************************************************************
+ * ASYNCHRONOUS FUNCTIONS
+ *****************************************************************************/
+
+static void key_async_record_decode(as_event_command * cmd, as_msg * msg, bool repeats)
+{
+	as_error err;
+	as_error_init(&err);
+
+	if ( msg->m.result_code != CITRUSLEAF_OK ) {
+		as_error_fromrc(&err, msg->m.result_code);
+		cmd->listener.record(&err, NULL, cmd->udata);
+		return;
+	}
+
+	uint8_t *	buf = (uint8_t *) msg + sizeof(as_msg);
+	size_t		buf_sz = msg->proto.sz - msg->m.header_sz;
+
+	as_record rec;
+	as_record_init(&rec, 0);
+
+	if ( as_record_from_msg(&rec, &msg->m, buf, buf_sz, cmd->loop->cluster->record_arena, repeats) != 0 ) {
+		as_record_destroy(&rec);
+		as_error_update(&err, AEROSPIKE_ERR_CLIENT, "failed to parse response");
+		cmd->listener.record(&err, NULL, cmd->udata);
+		return;
+	}
+
+	rec.gen = (uint16_t) msg->m.generation;
+	rec.ttl = cf_server_void_time_to_ttl(msg->m.record_ttl);
+
+	cmd->listener.record(NULL, &rec, cmd->udata);
+	as_record_destroy(&rec);
+}
+
+static void key_async_record_parse(as_event_command * cmd, as_msg * msg)
+{
+	key_async_record_decode(cmd, msg, false);
+}
+
+static void key_async_operate_parse(as_event_command * cmd, as_msg * msg)
+{
+	key_async_record_decode(cmd, msg, true);
+}
+
+static void key_async_write_parse(as_event_command * cmd, as_msg * msg)
+{
+	if ( msg->m.result_code != CITRUSLEAF_OK ) {
+		as_error err;
+		as_error_init(&err);
+		as_error_fromrc(&err, msg->m.result_code);
+		cmd->listener.write(&err, cmd->udata);
+		return;
+	}
+
+	cmd->listener.write(NULL, cmd->udata);
+}
+
+static void key_async_value_parse(as_event_command * cmd, as_msg * msg)
+{
+	as_error err;
+	as_error_init(&err);
+
+	int rc = msg->m.result_code;
+
+	if (! (rc == CITRUSLEAF_OK || rc == CITRUSLEAF_FAIL_UDF_BAD_RESPONSE)) {
+		as_error_fromrc(&err, rc);
+		cmd->listener.value(&err, NULL, cmd->udata);
+		return;
+	}
+
+	uint8_t *	buf = (uint8_t *) msg + sizeof(as_msg);
+	size_t		buf_sz = msg->proto.sz - msg->m.header_sz;
+	cl_bin *	bins = NULL;
+	int			n_bins = 0;
+
+	if ( cl_parse(&msg->m, buf, buf_sz, &bins, NULL, &n_bins, NULL, NULL) != 0 ) {
+		free(bins);
+		as_error_update(&err, AEROSPIKE_ERR_CLIENT, "failed to parse response");
+		cmd->listener.value(&err, NULL, cmd->udata);
+		return;
+	}
+
+	as_serializer ser;
+	as_msgpack_init(&ser);
+
+	as_val * val = NULL;
+
+	if ( n_bins == 1 ) {
+		cl_bin * bin = &bins[0];
+
+		if ( strcmp(bin->bin_name,"SUCCESS") == 0 ) {
+			clbin_to_asval(bin, &ser, &val);
+		}
+		else if ( strcmp(bin->bin_name,"FAILURE") == 0 ) {
+			as_val * fval = NULL;
+			clbin_to_asval(bin, &ser, &fval);
+			if ( fval && fval->type == AS_STRING ) {
+				as_string * s = as_string_fromval(fval);
+				as_error_update(&err, AEROSPIKE_ERR_UDF, as_string_tostring(s));
+			}
+			else {
+				as_error_update(&err, AEROSPIKE_ERR_SERVER, "unexpected failure bin type");
+			}
+			as_val_destroy(fval);
+		}
+		else {
+			as_error_update(&err, AEROSPIKE_ERR_SERVER, "unexpected bin name");
+		}
+	}
+	else {
+		as_error_update(&err, AEROSPIKE_ERR_SERVER, "unexpected number of bins");
+	}
+
+	if ( bins ) {
+		citrusleaf_bins_free(bins, n_bins);
+		free(bins);
+	}
+
+	as_serializer_destroy(&ser);
+
+	if ( err.code == AEROSPIKE_OK ) {
+		cmd->listener.value(NULL, val, cmd->udata);
+	}
+	else {
+		cmd->listener.value(&err, NULL, cmd->udata);
+	}
+
+	as_val_destroy(val);
+}
+
+/**
+ *	Compile the request on the calling thread, then hand it to an event loop.
+ *	The listener is only called if AEROSPIKE_OK is returned.
+ */
+static as_status key_async_execute(
+	aerospike * as, as_error * err, const as_key * key, as_policy_key policy_key, uint32_t timeout,
+	int info1, int info2, cl_bin * values, cl_operator operator, cl_operation * operations, int n_values,
+	cl_ops_encoder * encoder, const cl_write_parameters * wp, as_call * call,
+	as_event_type type, as_event_parse_fn parse, void * udata, as_event_command ** cmd_r)
+{
+	as_digest * digest = as_key_digest((as_key *) key);
+
+	cl_object	okey;
+	cl_object *	okeyp = NULL;
+
+	if ( policy_key == AS_POLICY_KEY_SEND ) {
+		asval_to_clobject((as_val *) key->valuep, &okey);
+		okeyp = &okey;
+	}
+
+	as_event_command * cmd = as_event_command_create(0);
+
+	if ( ! cmd ) {
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate command");
+	}
+
+	// Compile straight into the command if the request fits - cl_compile()
+	// allocates a buffer of its own if it doesn't, which the command then
+	// owns.
+	uint8_t *	wr_buf = cmd->buf;
+	size_t		wr_buf_sz = cmd->capacity;
+	cf_digest	d_ret;
+
+	int rv = encoder ?
+		cl_compile_ops(info1, info2, 0, key->ns, key->set, okeyp, (cf_digest *) digest->value,
+			encoder, &wr_buf, &wr_buf_sz, wp, &d_ret, NULL) :
+		cl_compile(info1, info2, 0, key->ns, key->set, okeyp, (cf_digest *) digest->value,
+			values, operator, operations, n_values, &wr_buf, &wr_buf_sz, wp, &d_ret, 0, NULL, call, 0);
+
+	if ( rv != 0 ) {
+		as_event_command_free(cmd);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to compile request");
+	}
+
+	if ( wr_buf != cmd->buf ) {
+		cmd->buf = wr_buf;
+		cmd->capacity = wr_buf_sz;
+	}
+	cmd->len = wr_buf_sz;
+
+	cmd->node = as_node_get(as->cluster, key->ns, (cf_digest *) digest->value, (info2 & CL_MSG_INFO2_WRITE) ? true : false);
+
+	// Dropped from the read cache when queued, and again when done - reads
+	// in flight meanwhile may have cached the old record.
+	if ( info2 & CL_MSG_INFO2_WRITE ) {
+		key_cache_remove(as, key);
+		cmd->invalidate = true;
+		strcpy(cmd->ns, key->ns);
+		memcpy(&cmd->digest, digest->value, sizeof(cf_digest));
+	}
+
+	if ( ! cmd->node ) {
+		as_event_command_free(cmd);
+		return as_error_update(err, AEROSPIKE_ERR_CLUSTER, "no node available for key");
+	}
+
+	// Async deadlines are in milliseconds, so a microsecond timeout is
+	// rounded up.
+	if ( wp && wp->timeout_us ) {
+		timeout = (wp->timeout_us + 999) / 1000;
+	}
+
+	cmd->deadline_ms = timeout ? cf_getms() + timeout : 0;
+	cmd->type = type;
+	cmd->parse = parse;
+	cmd->udata = udata;
+	*cmd_r = cmd;
+	return AEROSPIKE_OK;
+}
+
+/**
+ *	Asynchronously look up a record by key, then return all bins.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param listener		Called with the result.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ */
+as_status aerospike_key_get_async(
+	aerospike * as, as_error * err, const as_policy_read * policy, 
+	const as_key * key, 
+	as_async_record_listener listener, void * udata)
+{
+	// we want to reset the error so, we have a clean state
+	as_error_reset(err);
+	
+	// resolve policies
+	as_policy_read p;
+	as_policy_read_resolve(&p, &as->config.policies, policy);
+
+	uint32_t timeout = p.timeout == UINT32_MAX ? 0 : p.timeout;
+
+	cl_write_parameters wp;
+	cl_write_parameters_set_default(&wp);
+	wp.timeout_ms = timeout;
+	wp.timeout_us = p.timeout_us;
+
+	as_event_command * cmd = NULL;
+	as_status status = key_async_execute(as, err, key, p.key, timeout,
+			CL_MSG_INFO1_READ | CL_MSG_INFO1_GET_ALL, 0, NULL, CL_OP_READ, NULL, 0, NULL, &wp, NULL,
+			AS_EVENT_TYPE_RECORD, key_async_record_parse, udata, &cmd);
+
+	if ( status != AEROSPIKE_OK ) {
+		return status;
+	}
+
+	cmd->listener.record = listener;
+	return as_event_command_execute(as->cluster, cmd, err);
+}
+
+/**
+ *	Asynchronously store a record in the cluster.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param rec 			The record containing the data to be written.
+ *	@param listener		Called with the result.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ */
+as_status aerospike_key_put_async(
+	aerospike * as, as_error * err, const as_policy_write * policy, 
+	const as_key * key, as_record * rec,
+	as_async_write_listener listener, void * udata)
+{
+	// we want to reset the error so, we have a clean state
+	as_error_reset(err);
+	
+	// resolve policies
+	as_policy_write p;
+	as_policy_write_resolve(&p, &as->config.policies, policy);
+
+	cl_write_parameters wp;
+	aspolicywrite_to_clwriteparameters(&p, rec, &wp);
+
+	as_bins_encoder enc;
+	as_bins_encoder_inita_record(&enc, rec);
+
+	// The values are copied into the request.
+	as_event_command * cmd = NULL;
+	as_status status = key_async_execute(as, err, key, p.key, wp.timeout_ms,
+			0, CL_MSG_INFO2_WRITE, NULL, 0, NULL, 0, &enc.encoder, &wp, NULL,
+			AS_EVENT_TYPE_WRITE, key_async_write_parse, udata, &cmd);
+
+	as_bins_encoder_destroy(&enc);
+
+	if ( status != AEROSPIKE_OK ) {
+		return status;
+	}
+
+	cmd->listener.write = listener;
+	return as_event_command_execute(as->cluster, cmd, err);
+}
+
+/**
+ *	Asynchronously look up a record by key, then perform specified operations.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param ops			The operations to perform on the record.
+ *	@param listener		Called with the result.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ */
+as_status aerospike_key_operate_async(
+	aerospike * as, as_error * err, const as_policy_operate * policy, 
+	const as_key * key, const as_operations * ops,
+	as_async_record_listener listener, void * udata)
+{
+	// we want to reset the error so, we have a clean state
+	as_error_reset(err);
+	
+	// resolve policies
+	as_policy_operate p;
+	as_policy_operate_resolve(&p, &as->config.policies, policy);
+
+	cl_write_parameters wp;
+	aspolicyoperate_to_clwriteparameters(&p, ops, &wp);
+
+	int				info1 = 0;
+	int				info2 = 0;
+
+	for(int i=0; i<ops->binops.size; i++) {
+		if (ops->binops.entries[i].op == AS_OPERATOR_READ) {
+			info1 = CL_MSG_INFO1_READ;
+		}
+		else {
+			info2 = CL_MSG_INFO2_WRITE;
+		}
+	}
+
+	as_bins_encoder enc;
+	as_bins_encoder_inita_operations(&enc, ops);
+
+	// The server only returns bins for read operations, so the response is
+	// parsed as a record.
+	as_event_command * cmd = NULL;
+	as_status status = key_async_execute(as, err, key, p.key, wp.timeout_ms,
+			info1, info2, NULL, 0, NULL, 0, &enc.encoder, &wp, NULL,
+			AS_EVENT_TYPE_RECORD, key_async_operate_parse, udata, &cmd);
+
+	as_bins_encoder_destroy(&enc);
+
+	if ( status != AEROSPIKE_OK ) {
+		return status;
+	}
+
+	cmd->listener.record = listener;
+	return as_event_command_execute(as->cluster, cmd, err);
+}
+
+/**
+ *	Asynchronously look up a record by key, then apply the UDF.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if the command can not be started.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param key			The key of the record.
+ *	@param module		The module containing the function to execute.
+ *	@param function 	The function to execute.
+ *	@param arglist 		The arguments for the function.
+ *	@param listener		Called with the return value from the function.
+ *	@param udata		User data passed to the listener.
+ *
+ *	@return AEROSPIKE_OK if the command was started. Otherwise an error.
+ */
+as_status aerospike_key_apply_async(
+	aerospike * as, as_error * err, const as_policy_apply * policy, 
+	const as_key * key,
+	const char * module, const char * function, as_list * arglist, 
+	as_async_value_listener listener, void * udata)
+{
+	// we want to reset the error so, we have a clean state
+	as_error_reset(err);
+	
+	// resolve policies
+	as_policy_apply p;
+	as_policy_apply_resolve(&p, &as->config.policies, policy);
+
+	cl_write_parameters wp;
+	cl_write_parameters_set_default(&wp);
+	wp.timeout_ms = p.timeout == UINT32_MAX ? 0 : p.timeout;
+
+	as_serializer ser;
+	as_msgpack_init(&ser);
+
+	as_string file;
+	as_string_init(&file, (char *) module, true /*ismalloc*/);
+
+	as_string func;
+	as_string_init(&func, (char *) function, true /*ismalloc*/);
+	
+	as_buffer args;
+	as_buffer_init(&args);
+
+	as_serializer_serialize(&ser, (as_val *) arglist, &args);
+	as_serializer_destroy(&ser);
+
+	as_call call = {
+		.file = &file,
+		.func = &func,
+		.args = &args
+	};
+
+	as_event_command * cmd = NULL;
+	as_status status = key_async_execute(as, err, key, p.key, wp.timeout_ms,
+			0, CL_MSG_INFO2_WRITE, NULL, CL_OP_WRITE, NULL, 0, NULL, &wp, &call,
+			AS_EVENT_TYPE_VALUE, key_async_value_parse, udata, &cmd);
+
+	as_buffer_destroy(&args);
+
+	if ( status != AEROSPIKE_OK ) {
+		return status;
+	}
+
+	cmd->listener.value = listener;
+	return as_event_command_execute(as->cluster, cmd, err);
+}
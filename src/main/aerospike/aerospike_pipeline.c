@@ -0,0 +1,493 @@
+/******************************************************************************
+ * Copyright 2008-2013 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to 
+ * deal in the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in 
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_pipeline.h>
+
+#include <aerospike/as_bin.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_read_cache.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include <citrusleaf/citrusleaf.h>
+#include <citrusleaf/cl_object.h>
+#include <citrusleaf/cl_write.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cf_socket.h>
+#include <citrusleaf/cf_log_internal.h>
+
+#include "_policy.h"
+#include "_record.h"
+#include "_shim.h"
+
+#include "../citrusleaf/internal.h"
+
+#include <errno.h>
+
+/******************************************************************************
+ * CONSTANTS
+ *****************************************************************************/
+
+// Most commands written to a connection before reading their responses.
+#define PIPELINE_WINDOW 256
+
+// A window is also closed once its requests pass this many bytes. The whole
+// window is written before any response is read, so if the server's responses
+// back up and it stops reading, the rest of the requests must still fit in the
+// socket buffers - this is well under their default sizes. A single larger
+// command goes in a window of its own.
+#define PIPELINE_WINDOW_SZ (32 * 1024)
+
+// Without a timeout, a connection that makes no progress for this long fails.
+#define PIPELINE_PROGRESS_TIMEOUT_MS 1000
+
+// Initial size of the buffer the requests of a window are compiled into.
+#define PIPELINE_BUF_SZ (64 * 1024)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+// Requests of one window, compiled back-to-back.
+typedef struct pipeline_buf_s {
+	uint8_t *	data;
+	size_t		size;
+	size_t		capacity;
+} pipeline_buf;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static bool pipeline_buf_reserve(pipeline_buf * pb, size_t sz)
+{
+	if ( pb->size + sz <= pb->capacity ) {
+		return true;
+	}
+
+	size_t capacity = pb->capacity * 2;
+
+	while ( capacity < pb->size + sz ) {
+		capacity *= 2;
+	}
+
+	uint8_t * data = cf_realloc(pb->data, capacity);
+
+	if ( ! data ) {
+		return false;
+	}
+
+	pb->data = data;
+	pb->capacity = capacity;
+	return true;
+}
+
+/**
+ *	Compile a command onto the end of the buffer.
+ */
+static as_status pipeline_compile(
+	as_error * err, const as_policy_write * p, as_policy_operate * po, as_pipeline_command * cmd, pipeline_buf * pb)
+{
+	const as_key *	key = cmd->key;
+	as_digest *		digest = as_key_digest((as_key *) key);
+	as_policy_key	policy_key = p->key;
+	cl_write_parameters wp;
+	as_bins_encoder	enc;
+	cl_ops_encoder *	encoder = NULL;
+	int				info1 = 0;
+	int				info2 = 0;
+
+	switch ( cmd->type ) {
+		case AS_PIPELINE_GET: {
+			cl_write_parameters_set_default(&wp);
+			info1 = CL_MSG_INFO1_READ | CL_MSG_INFO1_GET_ALL;
+			break;
+		}
+		case AS_PIPELINE_PUT: {
+			aspolicywrite_to_clwriteparameters(p, cmd->rec, &wp);
+			as_bins_encoder_inita_record(&enc, cmd->rec);
+			encoder = &enc.encoder;
+			info2 = CL_MSG_INFO2_WRITE;
+			break;
+		}
+		case AS_PIPELINE_OPERATE: {
+			aspolicyoperate_to_clwriteparameters(po, cmd->ops, &wp);
+			policy_key = po->key;
+
+			for ( int i = 0; i < cmd->ops->binops.size; i++ ) {
+				if ( cmd->ops->binops.entries[i].op == AS_OPERATOR_READ ) {
+					info1 = CL_MSG_INFO1_READ;
+				}
+				else {
+					info2 = CL_MSG_INFO2_WRITE;
+				}
+			}
+
+			as_bins_encoder_inita_operations(&enc, cmd->ops);
+			encoder = &enc.encoder;
+			break;
+		}
+		default: {
+			return as_error_update(err, AEROSPIKE_ERR_PARAM, "invalid pipeline command type %d", cmd->type);
+		}
+	}
+
+	cl_object	okey;
+	cl_object *	okeyp = NULL;
+
+	if ( policy_key == AS_POLICY_KEY_SEND ) {
+		asval_to_clobject((as_val *) key->valuep, &okey);
+		okeyp = &okey;
+	}
+
+	// Compile straight into the buffer if the request fits - cl_compile()
+	// allocates a buffer of its own if it doesn't.
+	uint8_t *	buf = pb->data + pb->size;
+	size_t		buf_sz = pb->capacity - pb->size;
+	cf_digest	d_ret;
+
+	int rv = encoder ?
+		cl_compile_ops(info1, info2, 0, key->ns, key->set, okeyp, (cf_digest *) digest->value,
+			encoder, &buf, &buf_sz, &wp, &d_ret, NULL) :
+		cl_compile(info1, info2, 0, key->ns, key->set, okeyp, (cf_digest *) digest->value,
+			NULL, CL_OP_READ, NULL, 0, &buf, &buf_sz, &wp, &d_ret, 0, NULL, NULL, 0);
+
+	if ( encoder ) {
+		as_bins_encoder_destroy(&enc);
+	}
+
+	if ( rv != 0 ) {
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to compile request");
+	}
+
+	if ( buf != pb->data + pb->size ) {
+		bool ok = pipeline_buf_reserve(pb, buf_sz);
+
+		if ( ok ) {
+			memcpy(pb->data + pb->size, buf, buf_sz);
+		}
+		free(buf);
+
+		if ( ! ok ) {
+			return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate request buffer");
+		}
+	}
+
+	pb->size += buf_sz;
+	return AEROSPIKE_OK;
+}
+
+/**
+ *	Set a command's status and record from its response.
+ */
+static void pipeline_parse(as_pipeline_command * cmd, cl_proto * proto, bool arena)
+{
+	as_msg * msg = (as_msg *) proto;
+	cl_msg_swap_header_from_be(&msg->m);
+
+	as_error err;
+	as_error_init(&err);
+
+	if ( msg->m.result_code != CITRUSLEAF_OK ) {
+		cmd->status = as_error_fromrc(&err, msg->m.result_code);
+		return;
+	}
+
+	cmd->status = AEROSPIKE_OK;
+
+	if ( cmd->type == AS_PIPELINE_PUT ) {
+		return;
+	}
+
+	uint8_t *	buf = (uint8_t *) msg + sizeof(as_msg);
+	size_t		buf_sz = msg->proto.sz - msg->m.header_sz;
+
+	as_record * rec = as_record_new(0);
+
+	if ( as_record_from_msg(rec, &msg->m, buf, buf_sz, arena, cmd->type == AS_PIPELINE_OPERATE) != 0 ) {
+		as_record_destroy(rec);
+		cmd->status = AEROSPIKE_ERR_CLIENT;
+		return;
+	}
+
+	rec->gen = (uint16_t) msg->m.generation;
+	rec->ttl = cf_server_void_time_to_ttl(msg->m.record_ttl);
+	cmd->result = rec;
+}
+
+/**
+ *	Run one window of commands on a connection: write all the requests, then
+ *	read the responses in order.  The commands must already be compiled into
+ *	the buffer.  Returns false if the connection failed, in which case status
+ *	is set for the commands that got no response.
+ */
+static bool pipeline_exchange(
+	as_error * err, int fd, pipeline_buf * pb, as_pipeline_command ** cmds, uint32_t n_cmds,
+	uint64_t deadline_ns, uint64_t progress_ns, bool arena)
+{
+	int rv = cf_socket_write_timeout_ns(fd, pb->data, pb->size, deadline_ns, progress_ns);
+	uint32_t i = 0;
+
+	if ( rv == 0 ) {
+		// Responses are parsed into records before the next read, so one of
+		// the thread's I/O buffers can hold them.
+		cl_recv_buf rb;
+		cl_recv_buf_init(&rb, NULL, 0);
+
+		for ( ; i < n_cmds; i++ ) {
+			cl_proto * proto;
+
+			if ( (rv = cl_recv_proto(&rb, fd, deadline_ns, progress_ns, &proto)) != 0 ) {
+				break;
+			}
+
+			if ( proto->sz < sizeof(cl_msg) ) {
+				rv = EPROTO;
+				break;
+			}
+			pipeline_parse(cmds[i], proto, arena);
+		}
+		cl_recv_buf_destroy(&rb);
+	}
+
+	if ( i == n_cmds ) {
+		return true;
+	}
+
+	as_status status = rv == ETIMEDOUT ? AEROSPIKE_ERR_TIMEOUT : AEROSPIKE_ERR_CLIENT;
+
+	for ( ; i < n_cmds; i++ ) {
+		cmds[i]->status = status;
+	}
+
+	if ( err->code == AEROSPIKE_OK ) {
+		as_error_update(err, status, "pipeline connection failed: %d", rv);
+	}
+	return false;
+}
+
+/**
+ *	Run commands that all go to the same node, a window at a time.
+ */
+static void pipeline_node(
+	as_error * err, as_node * node, const as_policy_write * p, as_policy_operate * po,
+	as_pipeline_command ** cmds, uint32_t n_cmds, uint64_t deadline_ns, uint64_t progress_ns, pipeline_buf * pb)
+{
+	int fd = -1;
+	uint32_t begin = 0;
+
+	while ( begin < n_cmds ) {
+		uint32_t i = begin;
+		uint32_t n = 0;
+
+		pb->size = 0;
+
+		// Commands that can't be compiled are failed on their own.
+		as_pipeline_command * window[PIPELINE_WINDOW];
+
+		for ( ; i < n_cmds && n < PIPELINE_WINDOW && pb->size < PIPELINE_WINDOW_SZ; i++ ) {
+			as_error cerr;
+			as_error_init(&cerr);
+
+			if ( pipeline_compile(&cerr, p, po, cmds[i], pb) == AEROSPIKE_OK ) {
+				window[n++] = cmds[i];
+			}
+			else {
+				cmds[i]->status = cerr.code;
+
+				if ( err->code == AEROSPIKE_OK ) {
+					*err = cerr;
+				}
+			}
+		}
+		begin = i;
+
+		if ( n == 0 ) {
+			continue;
+		}
+
+		if ( deadline_ns && cf_socket_getns() >= deadline_ns ) {
+			for ( uint32_t i = 0; i < n; i++ ) {
+				window[i]->status = AEROSPIKE_ERR_TIMEOUT;
+			}
+			if ( err->code == AEROSPIKE_OK ) {
+				as_error_update(err, AEROSPIKE_ERR_TIMEOUT, "pipeline timed out");
+			}
+			continue;
+		}
+
+		if ( fd == -1 && (fd = as_node_fd_get(node)) == -1 ) {
+			for ( uint32_t i = 0; i < n; i++ ) {
+				window[i]->status = AEROSPIKE_ERR_CLIENT;
+			}
+			if ( err->code == AEROSPIKE_OK ) {
+				as_error_update(err, AEROSPIKE_ERR_CLIENT, "no connection to node %s", node->name);
+			}
+			continue;
+		}
+
+		if ( ! pipeline_exchange(err, fd, pb, window, n, deadline_ns, progress_ns, node->cluster->record_arena) ) {
+			// Responses may still be on their way - don't reuse the connection.
+			cf_close(fd);
+			fd = -1;
+		}
+	}
+
+	if ( fd != -1 ) {
+		as_node_fd_put(node, fd);
+	}
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Run independent single record commands, pipelining them per node.
+ *
+ *	@param as			The aerospike instance to use for this operation.
+ *	@param err			The as_error to be populated if an error occurs.
+ *	@param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ *	@param cmds			The commands to run.
+ *	@param n_cmds		The number of commands.
+ *
+ *	@return AEROSPIKE_OK if every command got a response. Otherwise an error.
+ */
+as_status aerospike_pipeline(
+	aerospike * as, as_error * err, const as_policy_write * policy, 
+	as_pipeline_command * cmds, uint32_t n_cmds)
+{
+	// we want to reset the error so, we have a clean state
+	as_error_reset(err);
+	
+	// resolve policies
+	as_policy_write p;
+	as_policy_write_resolve(&p, &as->config.policies, policy);
+
+	// Operates take the write policy's key and gen settings.
+	as_policy_operate po;
+	as_policy_operate_resolve(&po, &as->config.policies, NULL);
+	po.timeout = p.timeout;
+	po.timeout_us = p.timeout_us;
+	po.key = p.key;
+	po.gen = p.gen;
+
+	uint32_t	timeout = p.timeout == UINT32_MAX ? 0 : p.timeout;
+	uint64_t	timeout_us = p.timeout_us ? p.timeout_us : (uint64_t)timeout * 1000;
+	uint64_t	deadline_ns = timeout_us ? cf_socket_getns() + timeout_us * 1000 : 0;
+	uint64_t	progress_ns = timeout_us ? timeout_us * 1000 : PIPELINE_PROGRESS_TIMEOUT_MS * 1000000ULL;
+
+	if ( n_cmds == 0 ) {
+		return AEROSPIKE_OK;
+	}
+
+	as_node **				nodes = cf_malloc(sizeof(as_node *) * n_cmds);
+	as_pipeline_command **	group = cf_malloc(sizeof(as_pipeline_command *) * n_cmds);
+	pipeline_buf			pb;
+
+	pb.data = cf_malloc(PIPELINE_BUF_SZ);
+	pb.size = 0;
+	pb.capacity = PIPELINE_BUF_SZ;
+
+	if ( ! nodes || ! group || ! pb.data ) {
+		cf_free(nodes);
+		cf_free(group);
+		cf_free(pb.data);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate pipeline");
+	}
+
+	// Digest the keys several at a time - nodes is free until it's filled in.
+	as_key ** keys = (as_key **) nodes;
+
+	for ( uint32_t i = 0; i < n_cmds; i++ ) {
+		keys[i] = (as_key *) cmds[i].key;
+	}
+
+	as_keys_digest_many(keys, n_cmds);
+
+	// Find each key's node.
+	for ( uint32_t i = 0; i < n_cmds; i++ ) {
+		as_pipeline_command * cmd = &cmds[i];
+		as_digest * digest = as_key_digest((as_key *) cmd->key);
+		bool write = cmd->type != AS_PIPELINE_GET;
+
+		cmd->status = AEROSPIKE_OK;
+		cmd->result = NULL;
+		nodes[i] = as_node_get(as->cluster, cmd->key->ns, (cf_digest *) digest->value, write);
+
+		if ( ! nodes[i] ) {
+			cmd->status = AEROSPIKE_ERR_CLUSTER;
+
+			if ( err->code == AEROSPIKE_OK ) {
+				as_error_update(err, AEROSPIKE_ERR_CLUSTER, "no node available for key");
+			}
+		}
+	}
+
+	// Pipeline each node's commands in the order given.
+	for ( uint32_t i = 0; i < n_cmds; i++ ) {
+		as_node * node = nodes[i];
+
+		if ( ! node ) {
+			continue;
+		}
+
+		uint32_t n = 0;
+
+		for ( uint32_t j = i; j < n_cmds; j++ ) {
+			if ( nodes[j] == node ) {
+				group[n++] = &cmds[j];
+
+				if ( j != i ) {
+					// Release the extra reservations as they're grouped.
+					as_node_release(node);
+					nodes[j] = NULL;
+				}
+			}
+		}
+
+		pipeline_node(err, node, &p, &po, group, n, deadline_ns, progress_ns, &pb);
+		as_node_release(node);
+		nodes[i] = NULL;
+	}
+
+	// Drop written records from the read cache.
+	if ( as->cluster->read_cache ) {
+		for ( uint32_t i = 0; i < n_cmds; i++ ) {
+			if ( cmds[i].type != AS_PIPELINE_GET ) {
+				as_read_cache_remove(as->cluster->read_cache, cmds[i].key->ns, (cf_digest *) cmds[i].key->digest.value);
+			}
+		}
+	}
+
+	cf_free(nodes);
+	cf_free(group);
+	cf_free(pb.data);
+	return err->code;
+}
@@ -48,6 +48,9 @@ typedef struct scan_bridge_s {
 	// user-provided callback
 	aerospike_scan_foreach_callback	callback;
 
+	// decode records into their arena
+	bool arena;
+
 } scan_bridge;
 
 /******************************************************************************
@@ -135,7 +138,7 @@ static int simplescan_cb(char *ns, cf_digest *keyd, char *set, cl_object *key,
 	// Fill the bin data
 	as_record _rec, * rec = &_rec;
 	as_record_inita(rec, n_bins);
-	clbins_to_asrecord(bins, (uint32_t)n_bins, rec);
+	clbins_to_asrecord(bins, (uint32_t)n_bins, rec, bridge->arena);
 
 	// Fill the metadata
 	askey_from_clkey(&rec->key, ns, set, key);
@@ -204,7 +207,8 @@ static as_status aerospike_scan_generic(
 
 		scan_bridge bridge_udata = {
 			.udata = udata,
-			.callback = callback
+			.callback = callback,
+			.arena = as->cluster->record_arena
 		};
 
 		struct cl_scan_parameters_s params = {
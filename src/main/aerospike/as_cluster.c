@@ -22,13 +22,17 @@
 
 #include <aerospike/as_cluster.h>
 #include <aerospike/as_admin.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_io_buffer.h>
 #include <aerospike/as_password.h>
 #include <aerospike/as_lookup.h>
+#include <aerospike/as_read_cache.h>
 #include <aerospike/as_vector.h>
 #include <citrusleaf/as_scan.h>
 #include <citrusleaf/cl_info.h>
 #include <citrusleaf/cl_batch.h>
 #include <citrusleaf/cf_byte_order.h>
+#include <citrusleaf/cf_clock.h>
 #include <citrusleaf/cl_query.h>
 #include <citrusleaf/cf_socket.h>
 #include <citrusleaf/cf_log_internal.h>
@@ -37,8 +41,21 @@
  *	Function declarations
  *****************************************************************************/
 
+void
+as_node_info_fetch(as_cluster* cluster, as_node* node, as_node_info* info);
+
 bool
-as_node_refresh(as_cluster* cluster, as_node* node, as_vector* /* <as_friend> */ friends);
+as_node_info_apply(as_cluster* cluster, as_node* node, as_node_info* info, as_vector* /* <as_friend> */ friends);
+
+/******************************************************************************
+ *	Types
+ *****************************************************************************/
+
+typedef struct as_tend_work_s {
+	as_cluster* cluster;
+	as_node* node;
+	as_node_info* info;
+} as_tend_work;
 
 /******************************************************************************
  *	Functions
@@ -325,7 +342,7 @@ as_cluster_find_nodes_to_remove(as_cluster* cluster, uint32_t refresh_count, as_
 					// Check if node responded to info request.
 					if (node->failures == 0) {
 						// Node is alive, but not referenced by other nodes.  Check if mapped.
-						if (! as_partition_tables_find_node(cluster->partition_tables, node)) {
+						if (! as_partition_tables_find_node(node)) {
 							// Node doesn't have any partitions mapped to it.
 							// There is not point in keeping it in the cluster.
 							as_vector_append(nodes_to_remove, &node);
@@ -478,11 +495,95 @@ as_cluster_gc(as_vector* /* <as_gc_item> */ vector)
 	as_vector_clear(vector);
 }
 
+static void*
+as_tend_worker(void* data)
+{
+	as_cluster* cluster = (as_cluster*)data;
+	as_tend_work work;
+	
+	// A work item without a node tells the worker to stop.
+	while (cf_queue_pop(cluster->tend_q, &work, CF_QUEUE_FOREVER) == CF_QUEUE_OK && work.node) {
+		as_node_info_fetch(cluster, work.node, work.info);
+		cf_queue_push(cluster->tend_complete_q, &work.info);
+	}
+	return NULL;
+}
+
+static void
+as_tend_workers_create(as_cluster* cluster, uint32_t size)
+{
+	if (size <= 1) {
+		return;
+	}
+	
+	cluster->tend_q = cf_queue_create(sizeof(as_tend_work), true);
+	cluster->tend_complete_q = cf_queue_create(sizeof(as_node_info*), true);
+	cluster->tend_threads = cf_malloc(sizeof(pthread_t) * size);
+	
+	for (uint32_t i = 0; i < size; i++) {
+		if (pthread_create(&cluster->tend_threads[i], 0, as_tend_worker, cluster) != 0) {
+			cf_warn("Failed to create tend thread %u", i);
+			break;
+		}
+		cluster->tend_threads_size++;
+	}
+}
+
+static void
+as_tend_workers_destroy(as_cluster* cluster)
+{
+	if (! cluster->tend_q) {
+		return;
+	}
+	
+	as_tend_work work = {cluster, NULL, NULL};
+	
+	for (uint32_t i = 0; i < cluster->tend_threads_size; i++) {
+		cf_queue_push(cluster->tend_q, &work);
+	}
+	
+	for (uint32_t i = 0; i < cluster->tend_threads_size; i++) {
+		pthread_join(cluster->tend_threads[i], NULL);
+	}
+	cf_free(cluster->tend_threads);
+	cf_queue_destroy(cluster->tend_q);
+	cf_queue_destroy(cluster->tend_complete_q);
+}
+
+/**
+ * Fetch info responses from nodes, on tend workers if there is more than one node.
+ */
+static void
+as_cluster_fetch_nodes(as_cluster* cluster, as_node** nodes, as_node_info* infos, uint32_t size)
+{
+	if (cluster->tend_threads_size == 0 || size <= 1) {
+		for (uint32_t i = 0; i < size; i++) {
+			as_node_info_fetch(cluster, nodes[i], &infos[i]);
+		}
+		return;
+	}
+	
+	as_tend_work work;
+	work.cluster = cluster;
+	
+	for (uint32_t i = 0; i < size; i++) {
+		work.node = nodes[i];
+		work.info = &infos[i];
+		cf_queue_push(cluster->tend_q, &work);
+	}
+	
+	as_node_info* info;
+	
+	for (uint32_t i = 0; i < size; i++) {
+		cf_queue_pop(cluster->tend_complete_q, &info, CF_QUEUE_FOREVER);
+	}
+}
+
 /**
  * Check health of all nodes in the cluster.
  */
 static bool
-as_cluster_tend(as_cluster* cluster, bool enable_seed_warnings)
+as_cluster_tend_nodes(as_cluster* cluster, bool enable_seed_warnings)
 {
 	// All node additions/deletions are performed in tend thread.
 	// Garbage collect data structures released in previous tend.
@@ -514,25 +615,47 @@ as_cluster_tend(as_cluster* cluster, bool enable_seed_warnings)
 		node->friends = 0;
 	}
 	
-	// Refresh all known nodes.
-	as_vector friends;
-	as_vector_inita(&friends, sizeof(as_friend), 8);
-	uint32_t refresh_count = 0;
+	// Refresh all active nodes. Fetches may run concurrently, but responses
+	// are applied in node order, so the outcome does not depend on which
+	// node answered first.
+	as_node** active = alloca(sizeof(as_node*) * nodes->size);
+	uint32_t active_size = 0;
 	
 	for (uint32_t i = 0; i < nodes->size; i++) {
 		as_node* node = nodes->array[i];
 		
 		if (node->active) {
-			if (as_node_refresh(cluster, node, &friends)) {
-				node->failures = 0;
-				refresh_count++;
-			}
-			else {
-				node->failures++;
-			}
+			active[active_size++] = node;
 		}
 	}
 	
+	as_node_info* infos = alloca(sizeof(as_node_info) * active_size);
+	as_cluster_fetch_nodes(cluster, active, infos, active_size);
+	
+	as_vector friends;
+	as_vector_inita(&friends, sizeof(as_friend), 8);
+	uint32_t refresh_count = 0;
+	uint64_t refresh_max_us = 0;
+	
+	for (uint32_t i = 0; i < active_size; i++) {
+		as_node* node = active[i];
+		as_node_info* info = &infos[i];
+		
+		if (info->elapsed_us > refresh_max_us) {
+			refresh_max_us = info->elapsed_us;
+		}
+		
+		if (as_node_info_apply(cluster, node, info, &friends)) {
+			node->failures = 0;
+			refresh_count++;
+		}
+		else {
+			node->failures++;
+			ck_pr_inc_64(&cluster->tend_stats.refresh_failures);
+		}
+	}
+	ck_pr_store_64(&cluster->tend_stats.last_refresh_max_us, refresh_max_us);
+	
 	// Handle nodes changes determined from refreshes.
 	as_vector nodes_to_add;
 	as_vector_inita(&nodes_to_add, sizeof(as_node*), friends.size);
@@ -556,9 +679,42 @@ as_cluster_tend(as_cluster* cluster, bool enable_seed_warnings)
 	as_vector_destroy(&nodes_to_add);
 	as_vector_destroy(&nodes_to_remove);
 	as_vector_destroy(&friends);
+	
+	// Close connections left idle since a burst of traffic, then top pools
+	// back up to the minimum - new nodes get theirs on their first tend.
+	nodes = cluster->nodes;
+	for (uint32_t i = 0; i < nodes->size; i++) {
+		as_node* node = nodes->array[i];
+		as_node_close_idle_connections(node);
+		
+		if (cluster->min_conns_per_node && node->active) {
+			as_node_fill_connections(node);
+		}
+	}
 	return true;
 }
 
+/**
+ * Check health of all nodes in the cluster and record how long it took.
+ */
+static bool
+as_cluster_tend(as_cluster* cluster, bool enable_seed_warnings)
+{
+	uint64_t begin = cf_getus();
+	bool status = as_cluster_tend_nodes(cluster, enable_seed_warnings);
+	uint64_t elapsed = cf_getus() - begin;
+	
+	as_cluster_tend_stats* stats = &cluster->tend_stats;
+	ck_pr_store_64(&stats->last_us, elapsed);
+	ck_pr_store_64(&stats->total_us, stats->total_us + elapsed);
+	
+	if (elapsed > stats->max_us) {
+		ck_pr_store_64(&stats->max_us, elapsed);
+	}
+	ck_pr_store_64(&stats->tends, stats->tends + 1);
+	return status;
+}
+
 /**
  * Tend the cluster until it has stabilized and return control.
  * This helps avoid initial database request timeout issues when
@@ -782,6 +938,36 @@ as_cluster_is_connected(as_cluster* cluster)
 	return connected;
 }
 
+void
+as_cluster_get_hedge_stats(as_cluster* cluster, as_cluster_hedge_stats* stats)
+{
+	stats->issued = ck_pr_load_64(&cluster->hedge_stats.issued);
+	stats->won = ck_pr_load_64(&cluster->hedge_stats.won);
+}
+
+void
+as_cluster_get_read_cache_stats(as_cluster* cluster, as_cluster_read_cache_stats* stats)
+{
+	if (cluster->read_cache) {
+		as_read_cache_get_stats(cluster->read_cache, stats);
+	}
+	else {
+		memset(stats, 0, sizeof(as_cluster_read_cache_stats));
+	}
+}
+
+void
+as_cluster_get_tend_stats(as_cluster* cluster, as_cluster_tend_stats* stats)
+{
+	as_cluster_tend_stats* src = &cluster->tend_stats;
+	stats->tends = ck_pr_load_64(&src->tends);
+	stats->total_us = ck_pr_load_64(&src->total_us);
+	stats->max_us = ck_pr_load_64(&src->max_us);
+	stats->last_us = ck_pr_load_64(&src->last_us);
+	stats->last_refresh_max_us = ck_pr_load_64(&src->last_refresh_max_us);
+	stats->refresh_failures = ck_pr_load_64(&src->refresh_failures);
+}
+
 void
 as_cluster_change_password(as_cluster* cluster, const char* user, const char* password)
 {
@@ -814,6 +1000,15 @@ as_cluster_create(as_config* config)
 	cluster->tend_interval = (config->tender_interval < 1000)? 1000 : config->tender_interval;
 	cluster->conn_queue_size = config->max_threads + 1;  // Add one connection for tend thread.
 	cluster->conn_timeout_ms = (config->conn_timeout_ms == 0) ? 1000 : config->conn_timeout_ms;
+	cluster->max_socket_idle = config->max_socket_idle_sec;
+	cluster->conn_check_idle_ms = config->conn_check_idle_ms;
+	cluster->min_conns_per_node = config->min_conns_per_node;
+	cluster->write_gather_threshold = config->write_gather_threshold;
+	as_io_buffer_set_idle_ms(config->io_buffer_idle_ms);
+	cluster->record_arena = config->record_arena;
+	cluster->max_retries = config->policies.max_retries;
+	cluster->retry_sleep_ms = config->policies.sleep_between_retries;
+	cluster->async_max_in_flight = config->async_max_in_flight;
 	
 	// Initialize seed hosts.
 	cluster->seeds_size = seeds_size(config);
@@ -836,7 +1031,26 @@ as_cluster_create(as_config* config)
 	
 	// Initialize batch.
 	pthread_mutex_init(&cluster->batch_init_lock, 0);
+	
+	// Initialize read cache.
+	if (config->read_cache_max_bytes > 0) {
+		cluster->read_cache = as_read_cache_create(config->read_cache_max_bytes);
 		
+		if (! cluster->read_cache) {
+			as_cluster_destroy(cluster);
+			return 0;
+		}
+	}
+	
+	// Run asynchronous command event loops.
+	if (config->async_loops > 0 && ! as_event_loops_create(cluster, config->async_loops, config->async_io_uring)) {
+		as_cluster_destroy(cluster);
+		return 0;
+	}
+		
+	// Run tend workers, used from the first tend.
+	as_tend_workers_create(cluster, config->tend_threads);
+	
 	// Run cluster tend thread.
 	if (! as_init_tend_thread(cluster, config->fail_if_not_connected)) {
 		as_cluster_destroy(cluster);
@@ -848,6 +1062,9 @@ as_cluster_create(as_config* config)
 void
 as_cluster_destroy(as_cluster* cluster)
 {
+	// Stop event loops - failing asynchronous commands still in progress.
+	as_event_loops_destroy(cluster);
+	
 	// Shutdown work queues.
 	cl_cluster_batch_shutdown(cluster);
 	cl_cluster_scan_shutdown(cluster);
@@ -859,6 +1076,9 @@ as_cluster_destroy(as_cluster* cluster)
 		pthread_join(cluster->tend_thread, NULL);
 	}
 	
+	// Stop tend workers - the tend thread no longer queues refreshes.
+	as_tend_workers_destroy(cluster);
+	
 	// Release everything in garbage collector.
 	as_cluster_gc(cluster->gc);
 	as_vector_destroy(cluster->gc);
@@ -870,9 +1090,14 @@ as_cluster_destroy(as_cluster* cluster)
 	}
 	as_partition_tables_release(tables);
 	
-	// Release nodes.
+	// Release nodes partition tables referred to.
+	as_partition_nodes_destroy(&cluster->partition_nodes);
+	
+	// Release nodes. Deactivate them first, so threads holding cached
+	// connections close them and drop their node reservations.
 	as_nodes* nodes = cluster->nodes;
 	for (uint32_t i = 0; i < nodes->size; i++) {
+		as_node_deactivate(nodes->array[i]);
 		as_node_release(nodes->array[i]);
 	}
 	as_nodes_release(nodes);
@@ -899,6 +1124,11 @@ as_cluster_destroy(as_cluster* cluster)
 	// Destroy batch lock.
 	pthread_mutex_destroy(&cluster->batch_init_lock);
 	
+	// Destroy read cache.
+	if (cluster->read_cache) {
+		as_read_cache_destroy(cluster->read_cache);
+	}
+	
 	cf_free(cluster->user);
 	cf_free(cluster->password);
 	
@@ -24,8 +24,18 @@ as_config * as_config_init(as_config * c)
 	c->ip_map_size = 0;
 	c->max_threads = 300;
 	c->max_socket_idle_sec = 14;
+	c->conn_check_idle_ms = 1000;
+	c->min_conns_per_node = 0;
 	c->conn_timeout_ms = 1000;
 	c->tender_interval = 1000;
+	c->tend_threads = 8;
+	c->write_gather_threshold = 16 * 1024;
+	c->io_buffer_idle_ms = 60000;
+	c->record_arena = false;
+	c->read_cache_max_bytes = 0;
+	c->async_loops = 0;
+	c->async_max_in_flight = 5000;
+	c->async_io_uring = false;
 	c->hosts_size = 0;
 	memset(c->user, 0, sizeof(c->user));
 	memset(c->password, 0, sizeof(c->password));
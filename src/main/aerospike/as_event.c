@@ -0,0 +1,993 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/as_event.h>
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_read_cache.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <citrusleaf/cf_log_internal.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cf_socket.h>
+#include <errno.h>
+#include <string.h>
+#include "_event.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+// I/O step results.
+#define AS_EVENT_DONE 0
+#define AS_EVENT_WOULD_BLOCK 1
+#define AS_EVENT_ERROR 2
+
+// Smallest command buffer, so most responses are read in place.
+#define AS_EVENT_BUF_MIN_SIZE 1024
+
+// Largest response accepted.
+#define AS_EVENT_MAX_RESPONSE_SIZE (128 * 1024 * 1024)
+
+#define AS_EVENT_MAX_EVENTS 64
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+typedef struct as_event_conn_s {
+	int fd;
+	int32_t file;
+	uint64_t last_used;
+} as_event_conn;
+
+typedef struct as_event_pool_s {
+	as_node* node;
+	as_vector /* <as_event_conn> */ conns;
+} as_event_pool;
+
+/******************************************************************************
+ *	COMMON FUNCTIONS
+ *****************************************************************************/
+
+as_event_command*
+as_event_command_create(size_t size)
+{
+	size_t capacity = size < AS_EVENT_BUF_MIN_SIZE ? AS_EVENT_BUF_MIN_SIZE : size;
+	as_event_command* cmd = cf_malloc(sizeof(as_event_command) + capacity);
+
+	if (! cmd) {
+		return 0;
+	}
+
+	memset(cmd, 0, sizeof(as_event_command));
+	cmd->buf = cmd->space;
+	cmd->capacity = capacity;
+	cmd->len = size;
+	cmd->fd = -1;
+	cmd->file = -1;
+	cmd->fixed = -1;
+	cmd->slot = -1;
+	return cmd;
+}
+
+void
+as_event_command_free(as_event_command* cmd)
+{
+	if (cmd->fixed >= 0) {
+		as_event_uring_buffer_put(cmd->loop, cmd->fixed);
+	}
+	else if (cmd->buf != cmd->space) {
+		cf_free(cmd->buf);
+	}
+	if (cmd->node) {
+		as_node_release(cmd->node);
+	}
+	cf_free(cmd);
+}
+
+void
+as_event_notify_error(as_event_command* cmd, as_error* err)
+{
+	switch (cmd->type) {
+		case AS_EVENT_TYPE_RECORD:
+			cmd->listener.record(err, 0, cmd->udata);
+			break;
+		case AS_EVENT_TYPE_WRITE:
+			cmd->listener.write(err, cmd->udata);
+			break;
+		case AS_EVENT_TYPE_VALUE:
+			cmd->listener.value(err, 0, cmd->udata);
+			break;
+	}
+}
+
+#if defined(__linux__)
+
+/******************************************************************************
+ *	DEADLINE TIMERS
+ *****************************************************************************/
+
+static inline as_event_command**
+as_event_timer_list(as_event_loop* loop, as_event_command* cmd)
+{
+	return cmd->slot >= 0 ? &loop->wheel[cmd->slot] : &loop->unbounded;
+}
+
+static void
+as_event_timer_add(as_event_loop* loop, as_event_command* cmd)
+{
+	if (cmd->deadline_ms) {
+		// Round up, so the deadline has passed by the time the slot is checked.
+		// Slots up to loop->tick have already been checked.
+		uint64_t tick = (cmd->deadline_ms + AS_EVENT_TICK_MS - 1) / AS_EVENT_TICK_MS;
+
+		if (tick <= loop->tick) {
+			tick = loop->tick + 1;
+		}
+		cmd->slot = (int16_t)(tick & (AS_EVENT_WHEEL_SIZE - 1));
+		loop->wheel_count++;
+	}
+	else {
+		cmd->slot = -1;
+	}
+
+	as_event_command** head = as_event_timer_list(loop, cmd);
+	cmd->prev = 0;
+	cmd->next = *head;
+
+	if (*head) {
+		(*head)->prev = cmd;
+	}
+	*head = cmd;
+}
+
+static void
+as_event_timer_remove(as_event_loop* loop, as_event_command* cmd)
+{
+	if (cmd->prev) {
+		cmd->prev->next = cmd->next;
+	}
+	else {
+		*as_event_timer_list(loop, cmd) = cmd->next;
+	}
+
+	if (cmd->next) {
+		cmd->next->prev = cmd->prev;
+	}
+
+	if (cmd->slot >= 0) {
+		loop->wheel_count--;
+	}
+	cmd->prev = 0;
+	cmd->next = 0;
+}
+
+/******************************************************************************
+ *	CONNECTION POOLS
+ *****************************************************************************/
+
+static as_event_pool*
+as_event_pool_find(as_event_loop* loop, as_node* node)
+{
+	as_vector* pools = &loop->pools;
+
+	for (uint32_t i = 0; i < pools->size; i++) {
+		as_event_pool* pool = as_vector_get(pools, i);
+
+		if (pool->node == node) {
+			return pool;
+		}
+	}
+	return 0;
+}
+
+static bool
+as_event_conn_valid(as_event_loop* loop, int fd)
+{
+	// The server may have closed the connection while it was pooled.
+	uint8_t b;
+	loop->syscalls++;
+	ssize_t rv = recv(fd, &b, sizeof(b), MSG_PEEK | MSG_DONTWAIT);
+	return rv < 0 && (errno == EWOULDBLOCK || errno == EAGAIN);
+}
+
+void
+as_event_conn_close(as_event_loop* loop, int fd, int32_t file)
+{
+	if (file >= 0) {
+		as_event_uring_file_remove(loop, file);
+	}
+	cf_close(fd);
+}
+
+static int
+as_event_conn_get(as_event_loop* loop, as_node* node, int32_t* file)
+{
+	as_event_pool* pool = as_event_pool_find(loop, node);
+
+	if (pool) {
+		// Most recently used first - least likely to have been closed.
+		as_vector* conns = &pool->conns;
+		uint64_t limit = as_node_idle_limit(loop->cluster);
+
+		while (conns->size > 0) {
+			as_event_conn* conn = as_vector_get(conns, --conns->size);
+
+			if (conn->last_used >= limit && as_event_conn_valid(loop, conn->fd)) {
+				*file = conn->file;
+				return conn->fd;
+			}
+			as_event_conn_close(loop, conn->fd, conn->file);
+		}
+	}
+
+	int fd = as_node_fd_create(node);
+	*file = fd >= 0 && loop->uring ? as_event_uring_file_add(loop, fd) : -1;
+	return fd;
+}
+
+static void
+as_event_conn_put(as_event_loop* loop, as_node* node, int fd, int32_t file)
+{
+	as_event_pool* pool = as_event_pool_find(loop, node);
+
+	if (! pool) {
+		as_event_pool p;
+		as_node_reserve(node);
+		p.node = node;
+		as_vector_init(&p.conns, sizeof(as_event_conn), 8);
+		as_vector_append(&loop->pools, &p);
+		pool = as_vector_get(&loop->pools, loop->pools.size - 1);
+	}
+
+	as_event_conn conn;
+	conn.fd = fd;
+	conn.file = file;
+	conn.last_used = cf_getms();
+	as_vector_append(&pool->conns, &conn);
+}
+
+static void
+as_event_pool_close(as_event_loop* loop, as_event_pool* pool)
+{
+	for (uint32_t i = 0; i < pool->conns.size; i++) {
+		as_event_conn* conn = as_vector_get(&pool->conns, i);
+		as_event_conn_close(loop, conn->fd, conn->file);
+	}
+	as_vector_destroy(&pool->conns);
+	as_node_release(pool->node);
+}
+
+void
+as_event_pools_trim(as_event_loop* loop)
+{
+	as_vector* pools = &loop->pools;
+	uint64_t limit = as_node_idle_limit(loop->cluster);
+	uint32_t i = 0;
+
+	while (i < pools->size) {
+		as_event_pool* pool = as_vector_get(pools, i);
+
+		if (! ck_pr_load_8(&pool->node->active)) {
+			// Node has left the cluster - drop its pool.
+			as_event_pool_close(loop, pool);
+
+			if (i < --pools->size) {
+				memcpy(pool, as_vector_get(pools, pools->size), sizeof(as_event_pool));
+			}
+			continue;
+		}
+
+		// Connections are in order of last use - close the idle ones at the front.
+		as_vector* conns = &pool->conns;
+		uint32_t n = 0;
+
+		while (n < conns->size) {
+			as_event_conn* conn = as_vector_get(conns, n);
+
+			if (conn->last_used >= limit) {
+				break;
+			}
+			as_event_conn_close(loop, conn->fd, conn->file);
+			n++;
+		}
+
+		if (n > 0) {
+			conns->size -= n;
+			memmove(conns->list, as_vector_get(conns, n), conns->size * sizeof(as_event_conn));
+		}
+		i++;
+	}
+}
+
+/******************************************************************************
+ *	COMMAND EXECUTION
+ *****************************************************************************/
+
+static bool
+as_event_watch(as_event_command* cmd, uint32_t events)
+{
+	if (cmd->events == events) {
+		return true;
+	}
+
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.ptr = cmd;
+
+	int op = cmd->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	cmd->loop->syscalls++;
+
+	if (epoll_ctl(cmd->loop->epoll_fd, op, cmd->fd, &ev) < 0) {
+		cf_warn("Async epoll_ctl failed: fd %d errno %d", cmd->fd, errno);
+		return false;
+	}
+	cmd->events = (uint8_t)events;
+	return true;
+}
+
+static void
+as_event_unwatch(as_event_command* cmd)
+{
+	if (cmd->events) {
+		cmd->loop->syscalls++;
+		epoll_ctl(cmd->loop->epoll_fd, EPOLL_CTL_DEL, cmd->fd, 0);
+		cmd->events = 0;
+	}
+}
+
+static void
+as_event_command_finish(as_event_command* cmd)
+{
+	if (cmd->loop) {
+		as_event_timer_remove(cmd->loop, cmd);
+	}
+	ck_pr_dec_32(&cmd->node->async_in_flight);
+
+	// Before the listener, so reads it starts don't see the old record.
+	if (cmd->invalidate && cmd->loop && cmd->loop->cluster->read_cache) {
+		as_read_cache_remove(cmd->loop->cluster->read_cache, cmd->ns, &cmd->digest);
+	}
+}
+
+void
+as_event_command_fail(as_event_command* cmd, as_status status, const char* message)
+{
+	if (cmd->fd >= 0) {
+		// State of the connection is unknown - don't reuse it.
+		if (cmd->pending) {
+			// io_uring operations still refer to the socket. It is closed
+			// and the command freed when they complete.
+			as_event_uring_cancel(cmd);
+		}
+		else {
+			as_event_unwatch(cmd);
+			as_event_conn_close(cmd->loop, cmd->fd, cmd->file);
+			cmd->fd = -1;
+		}
+	}
+	as_event_command_finish(cmd);
+
+	as_error err;
+	as_error_init(&err);
+	as_error_update(&err, status, "%s: %s", message, cmd->node->name);
+	as_event_notify_error(cmd, &err);
+
+	if (! cmd->pending) {
+		as_event_command_free(cmd);
+	}
+}
+
+void
+as_event_command_complete(as_event_command* cmd)
+{
+	as_msg* msg = (as_msg*)cmd->buf;
+
+	if (msg->proto.sz < sizeof(cl_msg)) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Response too short");
+		return;
+	}
+	cl_msg_swap_header_from_be(&msg->m);
+
+	// Response fully read - connection can be reused.
+	as_event_unwatch(cmd);
+	as_event_conn_put(cmd->loop, cmd->node, cmd->fd, cmd->file);
+	cmd->fd = -1;
+	as_event_command_finish(cmd);
+
+	cmd->parse(cmd, msg);
+	as_event_command_free(cmd);
+}
+
+static int
+as_event_write(as_event_command* cmd)
+{
+	while (cmd->pos < cmd->len) {
+		cmd->loop->syscalls++;
+		ssize_t rv = send(cmd->fd, cmd->buf + cmd->pos, cmd->len - cmd->pos, MSG_NOSIGNAL);
+
+		if (rv > 0) {
+			cmd->pos += rv;
+		}
+		else if (rv < 0 && errno == EINTR) {
+			continue;
+		}
+		else if (rv < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+			return AS_EVENT_WOULD_BLOCK;
+		}
+		else {
+			cf_debug("Async write failed: fd %d errno %d", cmd->fd, errno);
+			return AS_EVENT_ERROR;
+		}
+	}
+	return AS_EVENT_DONE;
+}
+
+//
+// Read at least up to len, greedily - the header read also picks up as much
+// of the body as has arrived.
+//
+static int
+as_event_read(as_event_command* cmd)
+{
+	while (cmd->pos < cmd->len) {
+		cmd->loop->syscalls++;
+		ssize_t rv = recv(cmd->fd, cmd->buf + cmd->pos, cmd->capacity - cmd->pos, 0);
+
+		if (rv > 0) {
+			cmd->pos += rv;
+		}
+		else if (rv < 0 && errno == EINTR) {
+			continue;
+		}
+		else if (rv < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+			return AS_EVENT_WOULD_BLOCK;
+		}
+		else {
+			cf_debug("Async read failed: fd %d rv %zd errno %d", cmd->fd, rv, errno);
+			return AS_EVENT_ERROR;
+		}
+	}
+	return AS_EVENT_DONE;
+}
+
+//
+// Validate the proto header and make room for the body. On failure the
+// command has been failed.
+//
+bool
+as_event_command_read_header(as_event_command* cmd)
+{
+	cl_proto* proto = (cl_proto*)cmd->buf;
+	cl_proto_swap_from_be(proto);
+
+	if (proto->version != CL_PROTO_VERSION || proto->sz > AS_EVENT_MAX_RESPONSE_SIZE) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Invalid response header");
+		return false;
+	}
+
+	size_t size = sizeof(cl_proto) + proto->sz;
+
+	if (size > cmd->capacity) {
+		uint8_t* buf = cf_malloc(size);
+
+		if (! buf) {
+			as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Response buffer allocation failed");
+			return false;
+		}
+		memcpy(buf, cmd->buf, cmd->pos);
+
+		if (cmd->fixed >= 0) {
+			as_event_uring_buffer_put(cmd->loop, cmd->fixed);
+			cmd->fixed = -1;
+		}
+		else if (cmd->buf != cmd->space) {
+			cf_free(cmd->buf);
+		}
+		cmd->buf = buf;
+		cmd->capacity = size;
+	}
+	cmd->len = size;
+	cmd->state = AS_EVENT_READ_BODY;
+	return true;
+}
+
+static void
+as_event_command_read(as_event_command* cmd)
+{
+	if (cmd->state == AS_EVENT_READ_HEADER) {
+		int rv = as_event_read(cmd);
+
+		if (rv == AS_EVENT_WOULD_BLOCK) {
+			return;
+		}
+
+		if (rv == AS_EVENT_ERROR) {
+			as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket read failed");
+			return;
+		}
+
+		if (! as_event_command_read_header(cmd)) {
+			return;
+		}
+	}
+
+	int rv = as_event_read(cmd);
+
+	if (rv == AS_EVENT_DONE) {
+		as_event_command_complete(cmd);
+	}
+	else if (rv == AS_EVENT_ERROR) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket read failed");
+	}
+}
+
+static void
+as_event_command_write(as_event_command* cmd)
+{
+	int rv = as_event_write(cmd);
+
+	if (rv == AS_EVENT_WOULD_BLOCK) {
+		if (! as_event_watch(cmd, EPOLLOUT)) {
+			as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket registration failed");
+		}
+		return;
+	}
+
+	if (rv == AS_EVENT_ERROR) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket write failed");
+		return;
+	}
+
+	// Request sent - the buffer is free for the response.
+	cmd->state = AS_EVENT_READ_HEADER;
+	cmd->pos = 0;
+	cmd->len = sizeof(cl_proto);
+
+	if (! as_event_watch(cmd, EPOLLIN)) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket registration failed");
+	}
+}
+
+static void
+as_event_command_start(as_event_loop* loop, as_event_command* cmd)
+{
+	cmd->loop = loop;
+	as_event_timer_add(loop, cmd);
+
+	if (cmd->deadline_ms && cf_getms() >= cmd->deadline_ms) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_TIMEOUT, "Timeout before command started");
+		return;
+	}
+
+	cmd->fd = as_event_conn_get(loop, cmd->node, &cmd->file);
+
+	if (cmd->fd < 0) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Failed to connect");
+		return;
+	}
+
+	cmd->state = AS_EVENT_WRITE;
+	cmd->pos = 0;
+
+	if (loop->uring) {
+		as_event_uring_send(cmd);
+		return;
+	}
+
+	// Optimistic write - a pooled connection can usually take the whole
+	// request without waiting.
+	as_event_command_write(cmd);
+}
+
+static void
+as_event_command_event(as_event_command* cmd, uint32_t events)
+{
+	if ((events & (EPOLLERR | EPOLLHUP)) && ! (events & EPOLLIN)) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket error");
+		return;
+	}
+
+	if (cmd->state == AS_EVENT_WRITE) {
+		as_event_command_write(cmd);
+	}
+	else {
+		as_event_command_read(cmd);
+	}
+}
+
+/******************************************************************************
+ *	EVENT LOOP
+ *****************************************************************************/
+
+//
+// Start commands queued by other threads. The eventfd must have been reset
+// before, so a wake written after the queue is taken is not lost.
+//
+void
+as_event_loop_start_queued(as_event_loop* loop)
+{
+	pthread_mutex_lock(&loop->lock);
+	as_vector tmp = loop->queue;
+	loop->queue = loop->batch;
+	loop->batch = tmp;
+	pthread_mutex_unlock(&loop->lock);
+
+	for (uint32_t i = 0; i < loop->batch.size; i++) {
+		as_event_command_start(loop, as_vector_get_ptr(&loop->batch, i));
+	}
+	as_vector_clear(&loop->batch);
+}
+
+void
+as_event_loop_check_deadlines(as_event_loop* loop)
+{
+	uint64_t now = cf_getms();
+	uint64_t tick = now / AS_EVENT_TICK_MS;
+
+	if (tick <= loop->tick) {
+		return;
+	}
+
+	// A full turn covers every slot.
+	uint64_t begin = tick - loop->tick > AS_EVENT_WHEEL_SIZE ? tick - AS_EVENT_WHEEL_SIZE + 1 : loop->tick + 1;
+	loop->tick = tick;
+
+	for (uint64_t t = begin; t <= tick && loop->wheel_count > 0; t++) {
+		as_event_command* cmd = loop->wheel[t & (AS_EVENT_WHEEL_SIZE - 1)];
+
+		while (cmd) {
+			as_event_command* next = cmd->next;
+
+			// Deadlines more than a turn away stay for the next turn.
+			if (cmd->deadline_ms <= now) {
+				as_event_command_fail(cmd, AEROSPIKE_ERR_TIMEOUT, "Timeout");
+			}
+			cmd = next;
+		}
+	}
+}
+
+static void
+as_event_loop_fail_list(as_event_command* cmd)
+{
+	while (cmd) {
+		as_event_command* next = cmd->next;
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Event loop shut down");
+		cmd = next;
+	}
+}
+
+void
+as_event_loop_close(as_event_loop* loop)
+{
+	// No more commands can be queued once valid is cleared. Already clear
+	// unless the loop stopped on an error.
+	pthread_mutex_lock(&loop->lock);
+	loop->valid = false;
+	as_vector tmp = loop->queue;
+	loop->queue = loop->batch;
+	loop->batch = tmp;
+	pthread_mutex_unlock(&loop->lock);
+
+	for (uint32_t i = 0; i < loop->batch.size; i++) {
+		as_event_command* cmd = as_vector_get_ptr(&loop->batch, i);
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Event loop shut down");
+	}
+	as_vector_clear(&loop->batch);
+
+	for (uint32_t i = 0; i < AS_EVENT_WHEEL_SIZE; i++) {
+		as_event_loop_fail_list(loop->wheel[i]);
+	}
+	as_event_loop_fail_list(loop->unbounded);
+
+	for (uint32_t i = 0; i < loop->pools.size; i++) {
+		as_event_pool_close(loop, as_vector_get(&loop->pools, i));
+	}
+	as_vector_clear(&loop->pools);
+}
+
+static void
+as_event_loop_wake(as_event_loop* loop)
+{
+	uint64_t value;
+	loop->syscalls++;
+
+	if (read(loop->wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+		cf_warn("Async wake read failed: errno %d", errno);
+	}
+	as_event_loop_start_queued(loop);
+}
+
+static void*
+as_event_loop_run(void* data)
+{
+	as_event_loop* loop = (as_event_loop*)data;
+	struct epoll_event events[AS_EVENT_MAX_EVENTS];
+	uint64_t trim_ms = cf_getms() + AS_EVENT_TRIM_INTERVAL_MS;
+
+	loop->tick = cf_getms() / AS_EVENT_TICK_MS;
+
+	while (loop->valid) {
+		int timeout = loop->wheel_count > 0 ? AS_EVENT_TICK_MS : AS_EVENT_TRIM_INTERVAL_MS;
+		loop->syscalls++;
+		int n = epoll_wait(loop->epoll_fd, events, AS_EVENT_MAX_EVENTS, timeout);
+
+		if (n < 0 && errno != EINTR) {
+			cf_error("Async epoll_wait failed: errno %d", errno);
+			break;
+		}
+
+		for (int i = 0; i < n; i++) {
+			if (events[i].data.ptr) {
+				as_event_command_event(events[i].data.ptr, events[i].events);
+			}
+			else {
+				as_event_loop_wake(loop);
+			}
+		}
+
+		as_event_loop_check_deadlines(loop);
+
+		if (cf_getms() >= trim_ms) {
+			as_event_pools_trim(loop);
+			trim_ms = cf_getms() + AS_EVENT_TRIM_INTERVAL_MS;
+		}
+	}
+
+	as_event_loop_close(loop);
+	return NULL;
+}
+
+static bool
+as_event_loop_init_epoll(as_event_loop* loop)
+{
+	loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (loop->epoll_fd < 0) {
+		cf_error("Failed to create epoll instance: errno %d", errno);
+		return false;
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+
+	if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev) < 0) {
+		cf_error("Failed to register eventfd: errno %d", errno);
+		close(loop->epoll_fd);
+		return false;
+	}
+	return true;
+}
+
+static bool
+as_event_loop_init(as_event_loop* loop, as_cluster* cluster, bool io_uring)
+{
+	memset(loop, 0, sizeof(as_event_loop));
+	loop->cluster = cluster;
+	loop->epoll_fd = -1;
+
+	if (io_uring && ! as_event_uring_create(loop)) {
+		cf_warn("io_uring not available - event loop using epoll");
+	}
+
+	// io_uring reads the eventfd itself and would fail the read with EAGAIN
+	// if it were non-blocking.
+	loop->wake_fd = eventfd(0, loop->uring ? EFD_CLOEXEC : EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (loop->wake_fd < 0) {
+		cf_error("Failed to create eventfd: errno %d", errno);
+		as_event_uring_destroy(loop);
+		return false;
+	}
+
+	if (! loop->uring && ! as_event_loop_init_epoll(loop)) {
+		close(loop->wake_fd);
+		return false;
+	}
+
+	as_vector_init(&loop->queue, sizeof(as_event_command*), 64);
+	as_vector_init(&loop->batch, sizeof(as_event_command*), 64);
+	as_vector_init(&loop->pools, sizeof(as_event_pool), 8);
+	pthread_mutex_init(&loop->lock, 0);
+	loop->valid = true;
+
+	void* (*run)(void*) = loop->uring ? as_event_uring_run : as_event_loop_run;
+
+	if (pthread_create(&loop->thread, 0, run, loop) != 0) {
+		cf_error("Failed to create event loop thread: errno %d", errno);
+		loop->valid = false;
+		return false;
+	}
+	return true;
+}
+
+static void
+as_event_loop_destroy(as_event_loop* loop)
+{
+	as_vector_destroy(&loop->queue);
+	as_vector_destroy(&loop->batch);
+	as_vector_destroy(&loop->pools);
+	pthread_mutex_destroy(&loop->lock);
+	close(loop->wake_fd);
+
+	if (loop->uring) {
+		as_event_uring_destroy(loop);
+	}
+	else {
+		close(loop->epoll_fd);
+	}
+}
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+bool
+as_event_loops_create(as_cluster* cluster, uint32_t size, bool io_uring)
+{
+	as_event_loop* loops = cf_malloc(sizeof(as_event_loop) * size);
+
+	if (! loops) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < size; i++) {
+		if (! as_event_loop_init(&loops[i], cluster, io_uring)) {
+			// Loops before this one are running.
+			cluster->event_loops = loops;
+			cluster->event_loops_size = i;
+			as_event_loops_destroy(cluster);
+			return false;
+		}
+	}
+
+	cluster->event_loops = loops;
+	cluster->event_loops_size = size;
+	return true;
+}
+
+void
+as_event_loops_destroy(as_cluster* cluster)
+{
+	as_event_loop* loops = cluster->event_loops;
+	uint32_t size = cluster->event_loops_size;
+
+	if (! loops) {
+		return;
+	}
+
+	// Stop accepting commands and wake the loops so they see it.
+	for (uint32_t i = 0; i < size; i++) {
+		as_event_loop* loop = &loops[i];
+		pthread_mutex_lock(&loop->lock);
+		loop->valid = false;
+		pthread_mutex_unlock(&loop->lock);
+
+		uint64_t value = 1;
+		if (write(loop->wake_fd, &value, sizeof(value)) < 0) {
+			cf_warn("Async wake write failed: errno %d", errno);
+		}
+	}
+
+	for (uint32_t i = 0; i < size; i++) {
+		pthread_join(loops[i].thread, NULL);
+		as_event_loop_destroy(&loops[i]);
+	}
+
+	cf_free(loops);
+	cluster->event_loops = 0;
+	cluster->event_loops_size = 0;
+}
+
+as_status
+as_event_command_execute(as_cluster* cluster, as_event_command* cmd, as_error* err)
+{
+	as_node* node = cmd->node;
+
+	if (cluster->event_loops_size == 0) {
+		as_event_command_free(cmd);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Async commands not enabled - see as_config.async_loops");
+	}
+
+	uint32_t in_flight = ck_pr_faa_32(&node->async_in_flight, 1);
+
+	if (cluster->async_max_in_flight && in_flight >= cluster->async_max_in_flight) {
+		ck_pr_dec_32(&node->async_in_flight);
+		as_event_command_free(cmd);
+		return as_error_update(err, AEROSPIKE_ERR_THROTTLED, "Async commands in flight to node %s at limit %u",
+				node->name, cluster->async_max_in_flight);
+	}
+
+	uint32_t index = ck_pr_faa_32(&cluster->event_loop_index, 1);
+	as_event_loop* loop = &cluster->event_loops[index % cluster->event_loops_size];
+
+	pthread_mutex_lock(&loop->lock);
+
+	if (! loop->valid) {
+		pthread_mutex_unlock(&loop->lock);
+		ck_pr_dec_32(&node->async_in_flight);
+		as_event_command_free(cmd);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Event loop shut down");
+	}
+
+	// The loop drains the whole queue on each wake, so only wake it when
+	// the queue was empty.
+	bool wake = loop->queue.size == 0;
+	as_vector_append(&loop->queue, &cmd);
+	pthread_mutex_unlock(&loop->lock);
+
+	if (wake) {
+		uint64_t value = 1;
+
+		if (write(loop->wake_fd, &value, sizeof(value)) < 0) {
+			cf_warn("Async wake write failed: errno %d", errno);
+		}
+	}
+	return AEROSPIKE_OK;
+}
+
+uint64_t
+as_event_loops_syscalls(as_cluster* cluster)
+{
+	uint64_t syscalls = 0;
+
+	for (uint32_t i = 0; i < cluster->event_loops_size; i++) {
+		syscalls += ck_pr_load_64(&cluster->event_loops[i].syscalls);
+	}
+	return syscalls;
+}
+
+#else // not __linux__
+
+bool
+as_event_loops_create(as_cluster* cluster, uint32_t size, bool io_uring)
+{
+	cf_error("Async commands are only supported on Linux");
+	return false;
+}
+
+void
+as_event_loops_destroy(as_cluster* cluster)
+{
+}
+
+as_status
+as_event_command_execute(as_cluster* cluster, as_event_command* cmd, as_error* err)
+{
+	as_event_command_free(cmd);
+	return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Async commands not supported on this platform");
+}
+
+uint64_t
+as_event_loops_syscalls(as_cluster* cluster)
+{
+	return 0;
+}
+
+#endif
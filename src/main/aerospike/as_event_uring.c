@@ -0,0 +1,798 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/as_event.h>
+#include <aerospike/as_cluster.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <citrusleaf/cf_log_internal.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cf_socket.h>
+#include "_event.h"
+
+#if defined(AS_USE_IO_URING)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Not all C libraries define these yet - the numbers are the same on every
+// architecture.
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#define __NR_io_uring_enter 426
+#define __NR_io_uring_register 427
+#endif
+
+/******************************************************************************
+ *	MACROS
+ *****************************************************************************/
+
+// Submission queue size. The completion queue is larger, since each command
+// can have a send and a receive outstanding.
+#define AS_URING_SQ_ENTRIES 1024
+#define AS_URING_CQ_ENTRIES 8192
+
+// Registered file table size. Connections beyond it use their plain fd.
+#define AS_URING_FILES 4096
+
+// Registered response buffers. Larger responses are copied to a heap buffer
+// once the header has been read.
+#define AS_URING_BUFFERS 256
+#define AS_URING_BUFFER_SIZE 4096
+
+// Command operations are identified by the command pointer, which is 8 byte
+// aligned, with the operation in the low bits. Loop operations use values
+// below any pointer.
+#define AS_URING_OP_SEND 0
+#define AS_URING_OP_RECV 1
+#define AS_URING_OP_MASK 3
+#define AS_URING_WAKE 1
+
+/******************************************************************************
+ *	TYPES
+ *****************************************************************************/
+
+typedef struct as_event_uring_s {
+	int fd;
+
+	// Submission queue.
+	uint32_t* sq_head;
+	uint32_t* sq_tail;
+	uint32_t* sq_array;
+	uint32_t sq_mask;
+	uint32_t sq_entries;
+	uint32_t sqe_tail;
+	struct io_uring_sqe* sqes;
+
+	// Completion queue.
+	uint32_t* cq_head;
+	uint32_t* cq_tail;
+	uint32_t cq_mask;
+	struct io_uring_cqe* cqes;
+
+	void* sq_ring;
+	size_t sq_ring_size;
+	void* cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	// Free registered file indexes, NULL if files could not be registered.
+	int32_t* free_files;
+	uint32_t free_files_size;
+
+	// Free registered buffers, NULL if buffers could not be registered.
+	uint8_t* buffers;
+	int16_t* free_buffers;
+	uint32_t free_buffers_size;
+
+	// Failed commands waiting for their operations to complete.
+	uint32_t cancelled;
+
+	uint64_t wake_value;
+	bool wake_armed;
+} as_event_uring;
+
+/******************************************************************************
+ *	RING
+ *****************************************************************************/
+
+static inline int
+as_uring_setup(uint32_t entries, struct io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int
+as_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags, void* arg, size_t size)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, size);
+}
+
+static inline int
+as_uring_register(int fd, uint32_t opcode, void* arg, uint32_t nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+//
+// Submit queued entries and, if wait_ms is not negative, wait up to wait_ms
+// for at least one completion. Returns -1 on failure.
+//
+static int
+as_event_uring_enter(as_event_loop* loop, int wait_ms)
+{
+	as_event_uring* u = loop->uring;
+
+	ck_pr_fence_store();
+	ck_pr_store_32(u->sq_tail, u->sqe_tail);
+
+	uint32_t to_submit = u->sqe_tail - ck_pr_load_32(u->sq_head);
+
+	if (wait_ms < 0 && to_submit == 0) {
+		return 0;
+	}
+
+	uint32_t min_complete = 0;
+	uint32_t flags = 0;
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	void* argp = 0;
+	size_t arg_size = 0;
+
+	if (wait_ms >= 0) {
+		ts.tv_sec = wait_ms / 1000;
+		ts.tv_nsec = (wait_ms % 1000) * 1000000L;
+		memset(&arg, 0, sizeof(arg));
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+		argp = &arg;
+		arg_size = sizeof(arg);
+		min_complete = 1;
+		flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+	}
+
+	loop->syscalls++;
+	int rv = as_uring_enter(u->fd, to_submit, min_complete, flags, argp, arg_size);
+
+	if (rv < 0 && (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+		// Timed out, or the kernel is short of resources - completions will
+		// be reaped and the rest submitted on the next call.
+		return 0;
+	}
+	return rv;
+}
+
+//
+// Make sure n submission entries are free, submitting queued ones if not.
+//
+static bool
+as_event_uring_reserve(as_event_loop* loop, uint32_t n)
+{
+	as_event_uring* u = loop->uring;
+
+	if (u->sq_entries - (u->sqe_tail - ck_pr_load_32(u->sq_head)) >= n) {
+		return true;
+	}
+
+	if (as_event_uring_enter(loop, -1) < 0) {
+		cf_warn("Async io_uring submit failed: errno %d", errno);
+	}
+	return u->sq_entries - (u->sqe_tail - ck_pr_load_32(u->sq_head)) >= n;
+}
+
+static struct io_uring_sqe*
+as_event_uring_next(as_event_uring* u)
+{
+	uint32_t index = u->sqe_tail & u->sq_mask;
+	struct io_uring_sqe* sqe = &u->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	u->sq_array[index] = index;
+	u->sqe_tail++;
+	return sqe;
+}
+
+/******************************************************************************
+ *	COMMANDS
+ *****************************************************************************/
+
+static inline uint8_t*
+as_event_uring_buffer(as_event_uring* u, int16_t fixed)
+{
+	return u->buffers + (size_t)fixed * AS_URING_BUFFER_SIZE;
+}
+
+static void
+as_event_uring_prep(as_event_command* cmd, struct io_uring_sqe* sqe, uint8_t op, uint64_t tag)
+{
+	sqe->opcode = op;
+
+	if (cmd->file >= 0) {
+		sqe->fd = cmd->file;
+		sqe->flags |= IOSQE_FIXED_FILE;
+	}
+	else {
+		sqe->fd = cmd->fd;
+	}
+	sqe->user_data = (uint64_t)(uintptr_t)cmd | tag;
+	cmd->pending++;
+}
+
+//
+// Receive the response from offset pos, as much as fits.
+//
+static void
+as_event_uring_prep_recv(as_event_command* cmd, struct io_uring_sqe* sqe, size_t pos)
+{
+	if (cmd->fixed >= 0) {
+		as_event_uring_prep(cmd, sqe, IORING_OP_READ_FIXED, AS_URING_OP_RECV);
+		sqe->addr = (uint64_t)(uintptr_t)(as_event_uring_buffer(cmd->loop->uring, cmd->fixed) + pos);
+		sqe->len = (uint32_t)(AS_URING_BUFFER_SIZE - pos);
+		sqe->buf_index = (uint16_t)cmd->fixed;
+	}
+	else {
+		as_event_uring_prep(cmd, sqe, IORING_OP_RECV, AS_URING_OP_RECV);
+		sqe->addr = (uint64_t)(uintptr_t)(cmd->buf + pos);
+		sqe->len = (uint32_t)(cmd->capacity - pos);
+	}
+}
+
+//
+// Queue the rest of the request, with the response receive linked behind it
+// so both go to the kernel together.
+//
+static bool
+as_event_uring_write(as_event_command* cmd)
+{
+	if (! as_event_uring_reserve(cmd->loop, 2)) {
+		return false;
+	}
+
+	as_event_uring* u = cmd->loop->uring;
+	struct io_uring_sqe* sqe = as_event_uring_next(u);
+	as_event_uring_prep(cmd, sqe, IORING_OP_SEND, AS_URING_OP_SEND);
+	sqe->addr = (uint64_t)(uintptr_t)(cmd->buf + cmd->pos);
+	sqe->len = (uint32_t)(cmd->len - cmd->pos);
+	sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+	sqe->flags |= IOSQE_IO_LINK;
+
+	as_event_uring_prep_recv(cmd, as_event_uring_next(u), 0);
+	return true;
+}
+
+static bool
+as_event_uring_read(as_event_command* cmd)
+{
+	if (! as_event_uring_reserve(cmd->loop, 1)) {
+		return false;
+	}
+	as_event_uring_prep_recv(cmd, as_event_uring_next(cmd->loop->uring), cmd->pos);
+	return true;
+}
+
+static void
+as_event_uring_sent(as_event_command* cmd, int32_t res)
+{
+	if (res <= 0) {
+		cf_debug("Async write failed: fd %d res %d", cmd->fd, res);
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket write failed");
+		return;
+	}
+	cmd->pos += res;
+
+	if (cmd->pos < cmd->len) {
+		// A short send breaks the link, so the receive is cancelled too.
+		if (! as_event_uring_write(cmd)) {
+			as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "io_uring submission queue full");
+		}
+		return;
+	}
+
+	// Request sent - the linked receive is reading the response.
+	cmd->state = AS_EVENT_READ_HEADER;
+	cmd->pos = 0;
+	cmd->len = sizeof(cl_proto);
+
+	if (cmd->fixed >= 0) {
+		cmd->buf = as_event_uring_buffer(cmd->loop->uring, cmd->fixed);
+		cmd->capacity = AS_URING_BUFFER_SIZE;
+	}
+}
+
+static void
+as_event_uring_received(as_event_command* cmd, int32_t res)
+{
+	if (res == -ECANCELED && cmd->state == AS_EVENT_WRITE) {
+		// Link broken by a short send, which has been queued again.
+		return;
+	}
+
+	if (res <= 0) {
+		cf_debug("Async read failed: fd %d res %d", cmd->fd, res);
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "Socket read failed");
+		return;
+	}
+	cmd->pos += res;
+
+	if (cmd->state == AS_EVENT_READ_HEADER && cmd->pos >= cmd->len) {
+		if (! as_event_command_read_header(cmd)) {
+			return;
+		}
+	}
+
+	if (cmd->pos < cmd->len) {
+		if (! as_event_uring_read(cmd)) {
+			as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "io_uring submission queue full");
+		}
+		return;
+	}
+	as_event_command_complete(cmd);
+}
+
+void
+as_event_uring_send(as_event_command* cmd)
+{
+	as_event_uring* u = cmd->loop->uring;
+
+	// Receive the response into a registered buffer if one is free - the
+	// kernel does not have to map its pages for each read.
+	if (cmd->fixed < 0 && u->free_buffers_size > 0) {
+		cmd->fixed = u->free_buffers[--u->free_buffers_size];
+	}
+
+	if (! as_event_uring_write(cmd)) {
+		as_event_command_fail(cmd, AEROSPIKE_ERR_CLIENT, "io_uring submission queue full");
+	}
+}
+
+void
+as_event_uring_cancel(as_event_command* cmd)
+{
+	// Operations still queued on the socket complete once it is shut down.
+	cmd->loop->syscalls++;
+	shutdown(cmd->fd, SHUT_RDWR);
+	cmd->state = AS_EVENT_CANCELLED;
+	cmd->loop->uring->cancelled++;
+}
+
+/******************************************************************************
+ *	REGISTERED FILES AND BUFFERS
+ *****************************************************************************/
+
+int32_t
+as_event_uring_file_add(as_event_loop* loop, int fd)
+{
+	// io_uring waits for readiness itself. Operations on a non-blocking
+	// socket may fail with EAGAIN instead.
+	int flags = fcntl(fd, F_GETFL, 0);
+
+	if (flags >= 0) {
+		fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+	}
+
+	as_event_uring* u = loop->uring;
+
+	if (u->free_files_size == 0) {
+		return -1;
+	}
+
+	int32_t file = u->free_files[--u->free_files_size];
+	struct io_uring_files_update update;
+	memset(&update, 0, sizeof(update));
+	update.offset = file;
+	update.fds = (uint64_t)(uintptr_t)&fd;
+	loop->syscalls++;
+
+	if (as_uring_register(u->fd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+		cf_debug("Async io_uring file register failed: errno %d", errno);
+		u->free_files[u->free_files_size++] = file;
+		return -1;
+	}
+	return file;
+}
+
+void
+as_event_uring_file_remove(as_event_loop* loop, int32_t file)
+{
+	as_event_uring* u = loop->uring;
+	int fd = -1;
+	struct io_uring_files_update update;
+	memset(&update, 0, sizeof(update));
+	update.offset = file;
+	update.fds = (uint64_t)(uintptr_t)&fd;
+	loop->syscalls++;
+
+	if (as_uring_register(u->fd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+		cf_warn("Async io_uring file unregister failed: errno %d", errno);
+	}
+	u->free_files[u->free_files_size++] = file;
+}
+
+void
+as_event_uring_buffer_put(as_event_loop* loop, int16_t fixed)
+{
+	as_event_uring* u = loop->uring;
+	u->free_buffers[u->free_buffers_size++] = fixed;
+}
+
+static void
+as_event_uring_register_files(as_event_uring* u)
+{
+	// Start with an empty table - connections are added as they are opened.
+	int32_t* files = cf_malloc(AS_URING_FILES * sizeof(int32_t));
+
+	for (uint32_t i = 0; i < AS_URING_FILES; i++) {
+		files[i] = -1;
+	}
+
+	if (as_uring_register(u->fd, IORING_REGISTER_FILES, files, AS_URING_FILES) < 0) {
+		cf_info("io_uring registered files not available: errno %d", errno);
+		cf_free(files);
+		return;
+	}
+
+	// Reuse the array as the free list - lowest index on top.
+	for (uint32_t i = 0; i < AS_URING_FILES; i++) {
+		files[i] = AS_URING_FILES - 1 - i;
+	}
+	u->free_files = files;
+	u->free_files_size = AS_URING_FILES;
+}
+
+static void
+as_event_uring_register_buffers(as_event_uring* u)
+{
+	size_t size = AS_URING_BUFFERS * AS_URING_BUFFER_SIZE;
+	uint8_t* buffers = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (buffers == MAP_FAILED) {
+		cf_info("io_uring buffer allocation failed: errno %d", errno);
+		return;
+	}
+
+	struct iovec iov[AS_URING_BUFFERS];
+
+	for (uint32_t i = 0; i < AS_URING_BUFFERS; i++) {
+		iov[i].iov_base = buffers + i * AS_URING_BUFFER_SIZE;
+		iov[i].iov_len = AS_URING_BUFFER_SIZE;
+	}
+
+	if (as_uring_register(u->fd, IORING_REGISTER_BUFFERS, iov, AS_URING_BUFFERS) < 0) {
+		// Usually RLIMIT_MEMLOCK on kernels before 5.12.
+		cf_info("io_uring registered buffers not available: errno %d", errno);
+		munmap(buffers, size);
+		return;
+	}
+
+	u->buffers = buffers;
+	u->free_buffers = cf_malloc(AS_URING_BUFFERS * sizeof(int16_t));
+
+	for (uint32_t i = 0; i < AS_URING_BUFFERS; i++) {
+		u->free_buffers[i] = (int16_t)(AS_URING_BUFFERS - 1 - i);
+	}
+	u->free_buffers_size = AS_URING_BUFFERS;
+}
+
+/******************************************************************************
+ *	EVENT LOOP
+ *****************************************************************************/
+
+static void
+as_event_uring_arm_wake(as_event_loop* loop)
+{
+	if (! as_event_uring_reserve(loop, 1)) {
+		// Retried at the top of the loop.
+		return;
+	}
+
+	as_event_uring* u = loop->uring;
+	struct io_uring_sqe* sqe = as_event_uring_next(u);
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = loop->wake_fd;
+	sqe->addr = (uint64_t)(uintptr_t)&u->wake_value;
+	sqe->len = sizeof(u->wake_value);
+	sqe->user_data = AS_URING_WAKE;
+	u->wake_armed = true;
+}
+
+static void
+as_event_uring_complete(as_event_loop* loop, uint64_t user_data, int32_t res)
+{
+	as_event_uring* u = loop->uring;
+
+	if (user_data == AS_URING_WAKE) {
+		if (res < 0) {
+			cf_warn("Async wake read failed: errno %d", -res);
+		}
+
+		// The eventfd has been reset - re-arm before taking the queue.
+		u->wake_armed = false;
+		as_event_uring_arm_wake(loop);
+		as_event_loop_start_queued(loop);
+		return;
+	}
+
+	as_event_command* cmd = (as_event_command*)(uintptr_t)(user_data & ~(uint64_t)AS_URING_OP_MASK);
+	cmd->pending--;
+
+	if (cmd->state == AS_EVENT_CANCELLED) {
+		if (cmd->pending == 0) {
+			as_event_conn_close(loop, cmd->fd, cmd->file);
+			u->cancelled--;
+			as_event_command_free(cmd);
+		}
+		return;
+	}
+
+	if ((user_data & AS_URING_OP_MASK) == AS_URING_OP_SEND) {
+		as_event_uring_sent(cmd, res);
+	}
+	else {
+		as_event_uring_received(cmd, res);
+	}
+}
+
+static void
+as_event_uring_reap(as_event_loop* loop)
+{
+	as_event_uring* u = loop->uring;
+	uint32_t head = *u->cq_head;
+	uint32_t tail = ck_pr_load_32(u->cq_tail);
+	ck_pr_fence_load();
+
+	while (head != tail) {
+		struct io_uring_cqe* cqe = &u->cqes[head & u->cq_mask];
+		uint64_t user_data = cqe->user_data;
+		int32_t res = cqe->res;
+
+		// Release the entry before handling it - handlers may submit.
+		ck_pr_fence_load_store();
+		ck_pr_store_32(u->cq_head, ++head);
+
+		as_event_uring_complete(loop, user_data, res);
+
+		if (head == tail) {
+			tail = ck_pr_load_32(u->cq_tail);
+			ck_pr_fence_load();
+		}
+	}
+}
+
+void*
+as_event_uring_run(void* data)
+{
+	as_event_loop* loop = (as_event_loop*)data;
+	as_event_uring* u = loop->uring;
+	uint64_t trim_ms = cf_getms() + AS_EVENT_TRIM_INTERVAL_MS;
+
+	loop->tick = cf_getms() / AS_EVENT_TICK_MS;
+
+	while (loop->valid) {
+		if (! u->wake_armed) {
+			as_event_uring_arm_wake(loop);
+		}
+
+		// Submit everything queued since the last iteration and wait for
+		// completions, in one system call.
+		int timeout = loop->wheel_count > 0 ? AS_EVENT_TICK_MS : AS_EVENT_TRIM_INTERVAL_MS;
+
+		if (as_event_uring_enter(loop, timeout) < 0) {
+			cf_error("Async io_uring_enter failed: errno %d", errno);
+			break;
+		}
+
+		as_event_uring_reap(loop);
+		as_event_loop_check_deadlines(loop);
+
+		if (cf_getms() >= trim_ms) {
+			as_event_pools_trim(loop);
+			trim_ms = cf_getms() + AS_EVENT_TRIM_INTERVAL_MS;
+		}
+	}
+
+	as_event_loop_close(loop);
+
+	// Failed commands are freed once their operations complete.
+	while (u->cancelled > 0) {
+		if (as_event_uring_enter(loop, AS_EVENT_TRIM_INTERVAL_MS) < 0) {
+			cf_error("Async io_uring_enter failed: errno %d", errno);
+			break;
+		}
+		as_event_uring_reap(loop);
+	}
+	return NULL;
+}
+
+static void
+as_event_uring_free(as_event_uring* u)
+{
+	if (u->sqes) {
+		munmap(u->sqes, u->sqes_size);
+	}
+
+	if (u->cq_ring && u->cq_ring != u->sq_ring) {
+		munmap(u->cq_ring, u->cq_ring_size);
+	}
+
+	if (u->sq_ring) {
+		munmap(u->sq_ring, u->sq_ring_size);
+	}
+
+	// Closing the ring cancels any operations still outstanding.
+	close(u->fd);
+
+	if (u->buffers) {
+		munmap(u->buffers, AS_URING_BUFFERS * AS_URING_BUFFER_SIZE);
+		cf_free(u->free_buffers);
+	}
+
+	if (u->free_files) {
+		cf_free(u->free_files);
+	}
+	cf_free(u);
+}
+
+static void*
+as_event_uring_map(int fd, size_t size, off_t offset)
+{
+	void* p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+	return p == MAP_FAILED ? 0 : p;
+}
+
+bool
+as_event_uring_create(as_event_loop* loop)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = AS_URING_CQ_ENTRIES;
+
+	int fd = as_uring_setup(AS_URING_SQ_ENTRIES, &params);
+
+	if (fd < 0) {
+		cf_warn("io_uring_setup failed: errno %d", errno);
+		return false;
+	}
+
+	// NODROP keeps completions that overflow the queue. EXT_ARG (5.11) allows
+	// waiting with a timeout without a timeout operation.
+	uint32_t required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+	if ((params.features & required) != required) {
+		cf_warn("io_uring features 0x%x missing 0x%x", params.features, required);
+		close(fd);
+		return false;
+	}
+
+	as_event_uring* u = cf_malloc(sizeof(as_event_uring));
+
+	if (! u) {
+		close(fd);
+		return false;
+	}
+
+	memset(u, 0, sizeof(as_event_uring));
+	u->fd = fd;
+	u->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	u->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	u->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (u->cq_ring_size > u->sq_ring_size) {
+			u->sq_ring_size = u->cq_ring_size;
+		}
+		u->sq_ring = as_event_uring_map(fd, u->sq_ring_size, IORING_OFF_SQ_RING);
+		u->cq_ring = u->sq_ring;
+	}
+	else {
+		u->sq_ring = as_event_uring_map(fd, u->sq_ring_size, IORING_OFF_SQ_RING);
+		u->cq_ring = as_event_uring_map(fd, u->cq_ring_size, IORING_OFF_CQ_RING);
+	}
+	u->sqes = as_event_uring_map(fd, u->sqes_size, IORING_OFF_SQES);
+
+	if (! u->sq_ring || ! u->cq_ring || ! u->sqes) {
+		cf_warn("io_uring mmap failed: errno %d", errno);
+		as_event_uring_free(u);
+		return false;
+	}
+
+	uint8_t* sq = u->sq_ring;
+	u->sq_head = (uint32_t*)(sq + params.sq_off.head);
+	u->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+	u->sq_array = (uint32_t*)(sq + params.sq_off.array);
+	u->sq_mask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+	u->sq_entries = *(uint32_t*)(sq + params.sq_off.ring_entries);
+	u->sqe_tail = *u->sq_tail;
+
+	uint8_t* cq = u->cq_ring;
+	u->cq_head = (uint32_t*)(cq + params.cq_off.head);
+	u->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+	u->cq_mask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	// Both are optimizations - the loop works without them.
+	as_event_uring_register_files(u);
+	as_event_uring_register_buffers(u);
+
+	loop->uring = u;
+	return true;
+}
+
+void
+as_event_uring_destroy(as_event_loop* loop)
+{
+	if (loop->uring) {
+		as_event_uring_free(loop->uring);
+		loop->uring = 0;
+	}
+}
+
+#else // not AS_USE_IO_URING
+
+bool
+as_event_uring_create(as_event_loop* loop)
+{
+	cf_warn("Client not built with io_uring support - build with IO_URING=1");
+	return false;
+}
+
+void
+as_event_uring_destroy(as_event_loop* loop)
+{
+}
+
+void*
+as_event_uring_run(void* data)
+{
+	return NULL;
+}
+
+void
+as_event_uring_send(as_event_command* cmd)
+{
+}
+
+int32_t
+as_event_uring_file_add(as_event_loop* loop, int fd)
+{
+	return -1;
+}
+
+void
+as_event_uring_file_remove(as_event_loop* loop, int32_t file)
+{
+}
+
+void
+as_event_uring_cancel(as_event_command* cmd)
+{
+}
+
+void
+as_event_uring_buffer_put(as_event_loop* loop, int16_t fixed)
+{
+}
+
+#endif
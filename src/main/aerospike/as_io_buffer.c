@@ -0,0 +1,273 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/as_io_buffer.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <citrusleaf/cf_log_internal.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ck_pr.h"
+
+// Smallest buffer, and the granularity buffers grow by.
+#define AS_IO_BUFFER_MIN_SIZE (16 * 1024)
+#define AS_IO_BUFFER_ROUND (4 * 1024)
+
+// Uses between checks of the trim window - reading the clock on every use
+// would cost more than the buffers save.  Must be a power of 2.
+#define AS_IO_BUFFER_TRIM_USES 64
+
+/******************************************************************************
+ *	Types.
+ *****************************************************************************/
+
+typedef struct as_io_buffer_slot_s {
+	uint8_t* buf;
+	size_t capacity;
+	size_t peak;	// largest size asked for in the current trim window
+	bool busy;
+} as_io_buffer_slot;
+
+typedef struct as_io_buffers_s {
+	as_io_buffer_slot slots[AS_IO_BUFFER_SLOTS];
+	as_io_buffer_stats stats;
+	uint64_t window_start;
+	uint32_t uses;
+	bool registered;
+} as_io_buffers;
+
+/******************************************************************************
+ *	Globals.
+ *****************************************************************************/
+
+// Buffers stay with the thread between transactions, so a thread moving
+// records larger than a stack buffer doesn't allocate for every one.
+static __thread as_io_buffers g_io_buffers;
+
+static pthread_key_t g_io_buffers_key;
+static pthread_once_t g_io_buffers_once = PTHREAD_ONCE_INIT;
+
+static uint32_t g_io_buffer_idle_ms = 60000;
+
+/******************************************************************************
+ *	Functions.
+ *****************************************************************************/
+
+static void
+as_io_buffers_destroy(void* p)
+{
+	as_io_buffers* buffers = p;
+	
+	for (uint32_t i = 0; i < AS_IO_BUFFER_SLOTS; i++) {
+		cf_free(buffers->slots[i].buf);
+		buffers->slots[i].buf = 0;
+		buffers->slots[i].capacity = 0;
+	}
+	buffers->stats.bytes = 0;
+}
+
+static void
+as_io_buffers_key_create()
+{
+	pthread_key_create(&g_io_buffers_key, as_io_buffers_destroy);
+}
+
+static inline size_t
+as_io_buffer_round(size_t size)
+{
+	return size < AS_IO_BUFFER_MIN_SIZE ? AS_IO_BUFFER_MIN_SIZE :
+		(size + AS_IO_BUFFER_ROUND - 1) & ~(size_t)(AS_IO_BUFFER_ROUND - 1);
+}
+
+static as_io_buffer_slot*
+as_io_buffer_find(uint8_t* buf)
+{
+	for (uint32_t i = 0; i < AS_IO_BUFFER_SLOTS; i++) {
+		as_io_buffer_slot* slot = &g_io_buffers.slots[i];
+		
+		if (slot->busy && slot->buf == buf) {
+			return slot;
+		}
+	}
+	return 0;
+}
+
+// At the end of each idle period, free buffers that weren't used during it,
+// and buffers more than twice the size of anything asked of them.  They are
+// allocated again at the size needed when next used.
+static void
+as_io_buffers_trim(as_io_buffers* buffers, uint64_t now)
+{
+	uint32_t idle_ms = ck_pr_load_32(&g_io_buffer_idle_ms);
+	
+	if (idle_ms == 0 || now - buffers->window_start < idle_ms) {
+		return;
+	}
+	
+	for (uint32_t i = 0; i < AS_IO_BUFFER_SLOTS; i++) {
+		as_io_buffer_slot* slot = &buffers->slots[i];
+		
+		if (! slot->busy && slot->buf &&
+			(slot->peak == 0 || slot->capacity > as_io_buffer_round(slot->peak) * 2)) {
+			cf_free(slot->buf);
+			buffers->stats.bytes -= slot->capacity;
+			buffers->stats.trims++;
+			slot->buf = 0;
+			slot->capacity = 0;
+		}
+		slot->peak = slot->busy ? slot->capacity : 0;
+	}
+	buffers->window_start = now;
+}
+
+uint8_t*
+as_io_buffer_get(size_t size, size_t* capacity)
+{
+	as_io_buffers* buffers = &g_io_buffers;
+	as_io_buffer_slot* slot = 0;
+	
+	// Take the largest free buffer - the one least likely to need growing.
+	for (uint32_t i = 0; i < AS_IO_BUFFER_SLOTS; i++) {
+		as_io_buffer_slot* s = &buffers->slots[i];
+		
+		if (! s->busy && (! slot || s->capacity > slot->capacity)) {
+			slot = s;
+		}
+	}
+	
+	if (! slot) {
+		size_t cap = as_io_buffer_round(size);
+		uint8_t* buf = cf_malloc(cap);
+		
+		if (! buf) {
+			cf_error("io buffer malloc fail: trying %zu", cap);
+			return 0;
+		}
+		buffers->stats.overflows++;
+		*capacity = cap;
+		return buf;
+	}
+	
+	if (! buffers->registered) {
+		// Make sure the buffers are freed when the thread exits.
+		buffers->registered = true;
+		buffers->window_start = cf_getms();
+		pthread_once(&g_io_buffers_once, as_io_buffers_key_create);
+		pthread_setspecific(g_io_buffers_key, buffers);
+	}
+	
+	bool grown = false;
+	
+	if (! slot->buf || slot->capacity < size) {
+		size_t cap = as_io_buffer_round(size);
+		uint8_t* buf = cf_malloc(cap);
+		
+		if (! buf) {
+			cf_error("io buffer malloc fail: trying %zu", cap);
+			return 0;
+		}
+		cf_free(slot->buf);
+		buffers->stats.bytes += cap - slot->capacity;
+		buffers->stats.grows++;
+		slot->buf = buf;
+		slot->capacity = cap;
+		grown = true;
+	}
+	else {
+		buffers->stats.reuses++;
+	}
+	
+	if (size > slot->peak) {
+		slot->peak = size;
+	}
+	slot->busy = true;
+	
+	// Growing is when memory piles up, so the window is checked then too.
+	if (grown || (++buffers->uses & (AS_IO_BUFFER_TRIM_USES - 1)) == 0) {
+		as_io_buffers_trim(buffers, cf_getms());
+	}
+	
+	*capacity = slot->capacity;
+	return slot->buf;
+}
+
+uint8_t*
+as_io_buffer_grow(uint8_t* buf, size_t size, const uint8_t* keep, size_t keep_size, size_t* capacity)
+{
+	size_t cap = as_io_buffer_round(size);
+	uint8_t* p = cf_malloc(cap);
+	
+	if (! p) {
+		cf_error("io buffer malloc fail: trying %zu", cap);
+		return 0;
+	}
+	
+	if (keep_size) {
+		memcpy(p, keep, keep_size);
+	}
+	
+	as_io_buffer_slot* slot = as_io_buffer_find(buf);
+	cf_free(buf);
+	
+	if (slot) {
+		g_io_buffers.stats.bytes += cap - slot->capacity;
+		g_io_buffers.stats.grows++;
+		slot->buf = p;
+		slot->capacity = cap;
+		
+		if (size > slot->peak) {
+			slot->peak = size;
+		}
+	}
+	*capacity = cap;
+	return p;
+}
+
+void
+as_io_buffer_put(uint8_t* buf)
+{
+	if (! buf) {
+		return;
+	}
+	
+	as_io_buffer_slot* slot = as_io_buffer_find(buf);
+	
+	if (! slot) {
+		// Overflow buffer.
+		cf_free(buf);
+		return;
+	}
+	slot->busy = false;
+}
+
+void
+as_io_buffer_set_idle_ms(uint32_t idle_ms)
+{
+	ck_pr_store_32(&g_io_buffer_idle_ms, idle_ms);
+}
+
+as_io_buffer_stats*
+as_io_buffer_thread_stats()
+{
+	return &g_io_buffers.stats;
+}
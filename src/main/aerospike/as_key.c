@@ -25,12 +25,15 @@
 #include <aerospike/as_string.h>
 #include <aerospike/as_bytes.h>
 
+#include <citrusleaf/cf_byte_order.h>
 #include <citrusleaf/cf_digest.h>
 #include <citrusleaf/cl_object.h>
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
+#include "_ripemd160.h"
 #include "_shim.h"
 
 /******************************************************************************
@@ -241,3 +244,83 @@ as_digest * as_key_digest(as_key * key)
 
 	return NULL;
 }
+
+/**
+ *	Compute the digests of pending keys.
+ */
+static void as_keys_digest_flush(as_key ** pending, const as_ripemd160_key * in, uint32_t n)
+{
+	cf_digest digests[AS_RIPEMD160_LANES];
+	as_ripemd160_keys(in, n, digests);
+
+	for ( uint32_t i = 0; i < n; i++ ) {
+		memcpy(pending[i]->digest.value, &digests[i], AS_DIGEST_VALUE_SIZE);
+		pending[i]->digest.init = true;
+	}
+}
+
+/**
+ *	Compute the digests of many keys at once.
+ */
+void as_keys_digest_many(as_key ** keys, uint32_t n)
+{
+	as_ripemd160_key in[AS_RIPEMD160_LANES];
+	as_key * pending[AS_RIPEMD160_LANES];
+	uint64_t ints[AS_RIPEMD160_LANES];
+	uint32_t n_pending = 0;
+
+	for ( uint32_t i = 0; i < n; i++ ) {
+		as_key * key = keys[i];
+
+		if ( ! key || key->digest.init || ! key->valuep ) {
+			continue;
+		}
+
+		as_val * val = (as_val *) key->valuep;
+		as_ripemd160_key * k = &in[n_pending];
+
+		// Keys are laid out as citrusleaf_calculate_digest() does.
+		switch ( val->type ) {
+			case AS_INTEGER: {
+				ints[n_pending] = cf_swap_to_be64((uint64_t) ((as_integer *) val)->value);
+				k->type = CL_INT;
+				k->value = (const uint8_t *) &ints[n_pending];
+				k->value_sz = sizeof(uint64_t);
+				break;
+			}
+			case AS_STRING: {
+				k->type = CL_STR;
+				k->value = (const uint8_t *) ((as_string *) val)->value;
+				k->value_sz = (uint32_t) as_string_len((as_string *) val);
+				break;
+			}
+			case AS_BYTES: {
+				k->type = (uint8_t) ((as_bytes *) val)->type;
+				k->value = ((as_bytes *) val)->value;
+				k->value_sz = ((as_bytes *) val)->size;
+
+				if ( k->type == CL_BLOB ) {
+					break;
+				}
+				// Other blob types are rare - leave them to as_key_digest().
+			}
+			default: {
+				as_key_digest(key);
+				continue;
+			}
+		}
+
+		k->set = (const uint8_t *) key->set;
+		k->set_sz = (uint32_t) strlen(key->set);
+		pending[n_pending++] = key;
+
+		if ( n_pending == AS_RIPEMD160_LANES ) {
+			as_keys_digest_flush(pending, in, n_pending);
+			n_pending = 0;
+		}
+	}
+
+	if ( n_pending ) {
+		as_keys_digest_flush(pending, in, n_pending);
+	}
+}
@@ -26,14 +26,64 @@
 #include <aerospike/as_info.h>
 #include <aerospike/as_string.h>
 #include <citrusleaf/cf_byte_order.h>
+#include <citrusleaf/cf_clock.h>
 #include <citrusleaf/cf_log_internal.h>
 #include <citrusleaf/cf_proto.h>
 #include <citrusleaf/cf_socket.h>
 #include <errno.h> //errno
+#include <poll.h>
+#include <pthread.h>
 
 // Replicas take ~2K per namespace, so this will cover most deployments:
 #define INFO_STACK_BUF_SIZE (16 * 1024)
 
+// Nodes and connections per node kept in each thread's connection cache.
+// A thread normally holds one connection per node at a time, so two per node
+// cover nested use such as a query callback issuing its own commands.
+#define AS_NODE_CACHE_NODES 16
+#define AS_NODE_CACHE_FDS 2
+
+// Idle connections closed per pool lock by the tend thread.
+#define AS_NODE_REAP_BATCH 32
+
+/******************************************************************************
+ *	Types.
+ *****************************************************************************/
+
+typedef struct as_node_cache_entry_s {
+	as_node* node;	// reserved while cached, 0 if entry is free
+	uint32_t size;
+	as_node_conn conns[AS_NODE_CACHE_FDS];
+} as_node_cache_entry;
+
+typedef struct as_node_cache_s {
+	// Set while the owning thread, or the tend thread reaping idle
+	// connections, is using the entries.  Whichever finds it set goes
+	// without - the owner uses the node's pool, the tend thread tries again
+	// on its next tend.
+	uint32_t busy;
+	as_node_cache_entry entries[AS_NODE_CACHE_NODES];
+	as_node_fd_stats stats;
+	struct as_node_cache_s* prev;
+	struct as_node_cache_s* next;
+	bool registered;
+} as_node_cache;
+
+/******************************************************************************
+ *	Globals.
+ *****************************************************************************/
+
+// Connections are taken from and returned to the calling thread's cache
+// first, so most transactions don't touch the node's locked pool at all.
+static __thread as_node_cache g_node_cache;
+
+// Caches in use, so the tend thread can close connections idle threads hold.
+static pthread_mutex_t g_node_caches_lock = PTHREAD_MUTEX_INITIALIZER;
+static as_node_cache* g_node_caches = 0;
+
+static pthread_key_t g_node_cache_key;
+static pthread_once_t g_node_cache_once = PTHREAD_ONCE_INIT;
+
 /******************************************************************************
  *	Function declarations.
  *****************************************************************************/
@@ -55,6 +105,8 @@ as_node_create(as_cluster* cluster, const char* name, struct sockaddr_in* addr)
 	}
 	
 	node->ref_count = 1;
+	node->in_flight = 0;
+	node->latency_us = 0;
 	node->partition_generation = 0xFFFFFFFF;
 	node->cluster = cluster;
 			
@@ -64,28 +116,32 @@ as_node_create(as_cluster* cluster, const char* name, struct sockaddr_in* addr)
 	as_vector_init(&node->addresses, sizeof(as_address), 2);
 	as_node_add_address(node, addr);
 		
-	node->conn_q = cf_queue_create(sizeof(int), true);
+	as_conn_pool* pool = &node->conn_pool;
+	pthread_mutex_init(&pool->lock, 0);
+	pool->capacity = cluster->conn_queue_size;
+	pool->conns = cf_malloc(sizeof(as_node_conn) * pool->capacity);
+	pool->size = 0;
+	pool->cached = 0;
 	// node->conn_q_asyncfd = cf_queue_create(sizeof(int), true);
 	// node->asyncwork_q = cf_queue_create(sizeof(cl_async_work*), true);
 	
 	node->info_fd = -1;
 	node->friends = 0;
 	node->failures = 0;
+	node->async_in_flight = 0;
 	node->active = true;
+	node->partition_index = 0;
 	return node;
 }
 
 void
 as_node_destroy(as_node* node)
 {
-	// Drain out the queue and close the FDs
-	int rv;
-	do {
-		int	fd;
-		rv = cf_queue_pop(node->conn_q, &fd, CF_QUEUE_NOWAIT);
-		if (rv == CF_QUEUE_OK)
-			cf_close(fd);
-	} while (rv == CF_QUEUE_OK);
+	// Drain out the pool and close the FDs
+	as_conn_pool* pool = &node->conn_pool;
+	for (uint32_t i = 0; i < pool->size; i++) {
+		cf_close(pool->conns[i].fd);
+	}
 	
 	/*
 	 do {
@@ -113,7 +169,8 @@ as_node_destroy(as_node* node)
 	 */
 	
 	as_vector_destroy(&node->addresses);
-	cf_queue_destroy(node->conn_q);
+	cf_free(pool->conns);
+	pthread_mutex_destroy(&pool->lock);
 	//cf_queue_destroy(node->conn_q_asyncfd);
 	//cf_queue_destroy(node->asyncwork_q);
 	
@@ -188,8 +245,9 @@ as_node_fd_authenticate(as_node* node, int fd)
 	return fd;
 }
 
+// Start a connection without waiting for it to complete.
 static int
-as_node_fd_create_and_connect(as_node* node)
+as_node_fd_connect(as_node* node)
 {
 	// Create a non-blocking socket.
 	int fd = cf_socket_create_nb();
@@ -204,7 +262,7 @@ as_node_fd_create_and_connect(as_node* node)
 	
 	if (cf_socket_start_connect_nb(fd, &primary->addr) == 0) {
 		// Connection started ok - we have our socket.
-		return as_node_fd_authenticate(node, fd);
+		return fd;
 	}
 	
 	// Try other addresses.
@@ -220,7 +278,7 @@ as_node_fd_create_and_connect(as_node* node)
 				// It's just a hint, not a requirement to try this new address first.
 				cf_debug("Change node address %s %s:%d", node->name, address->name, (int)cf_swap_from_be16(address->addr.sin_port));
 				ck_pr_store_32(&node->address_index, i);
-				return as_node_fd_authenticate(node, fd);
+				return fd;
 			}
 		}
 	}
@@ -231,64 +289,330 @@ as_node_fd_create_and_connect(as_node* node)
 	return -1;
 }
 
-int
-as_node_fd_get(as_node* node)
+static int
+as_node_fd_create_and_connect(as_node* node)
+{
+	int fd = as_node_fd_connect(node);
+	return fd >= 0 ? as_node_fd_authenticate(node, fd) : -1;
+}
+
+static inline uint64_t
+as_node_idle_limit_at(as_cluster* cluster, uint64_t now)
+{
+	uint64_t max_idle_ms = (uint64_t)cluster->max_socket_idle * 1000;
+	return (max_idle_ms && now > max_idle_ms) ? now - max_idle_ms : 0;
+}
+
+// Check a pooled connection, closing it if it can't be used.
+static bool
+as_node_fd_check(int fd)
+{
+	switch (is_connected(fd)) {
+		case CONNECTED:
+			// It's still good.
+			return true;
+		case CONNECTED_BADFD:
+			// Local problem, don't try closing.
+			cf_warn("Found bad file descriptor in queue: fd %d", fd);
+			return false;
+		case CONNECTED_NOT:
+			// Can't use it - the remote end closed it.
+		case CONNECTED_ERROR:
+			// Some other problem, could have to do with remote end.
+		default:
+			cf_close(fd);
+			return false;
+	}
+}
+
+// Take the most recently used connection from the node's shared pool.
+static bool
+as_node_pool_pop(as_node* node, as_node_conn* conn)
+{
+	as_conn_pool* pool = &node->conn_pool;
+	bool found = false;
+	
+	pthread_mutex_lock(&pool->lock);
+	
+	if (pool->size > 0) {
+		*conn = pool->conns[--pool->size];
+		found = true;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return found;
+}
+
+// Put a connection into the node's shared pool, or close it if the pool and
+// the thread caches already hold the node's capacity.  Connections flushed from
+// a thread cache may be older than some in the pool, so the position is found
+// by last_used, keeping the least recently used at the front.
+static void
+as_node_fd_put_shared(as_node* node, int fd, uint64_t last_used)
+{
+	as_conn_pool* pool = &node->conn_pool;
+	bool full = false;
+	
+	pthread_mutex_lock(&pool->lock);
+	
+	if (pool->size + ck_pr_load_32(&pool->cached) < pool->capacity) {
+		uint32_t i = pool->size;
+		
+		while (i > 0 && pool->conns[i - 1].last_used > last_used) {
+			i--;
+		}
+		memmove(&pool->conns[i + 1], &pool->conns[i], sizeof(as_node_conn) * (pool->size - i));
+		pool->conns[i].fd = fd;
+		pool->conns[i].last_used = last_used;
+		pool->size++;
+	}
+	else {
+		full = true;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	
+	if (full) {
+		cf_close(fd);
+	}
+}
+
+static inline bool
+as_node_cache_enter(as_node_cache* cache)
+{
+	// Only the tend thread ever shares the flag's cache line, once a tend.
+	if (ck_pr_fas_32(&cache->busy, 1) != 0) {
+		return false;
+	}
+	ck_pr_fence_acquire();
+	return true;
+}
+
+static inline void
+as_node_cache_leave(as_node_cache* cache)
+{
+	ck_pr_fence_release();
+	ck_pr_store_32(&cache->busy, 0);
+}
+
+// Return cached connections to the node's shared pool, or close them if the
+// node has left the cluster, and free the entry.
+static void
+as_node_cache_flush(as_node_cache_entry* entry)
+{
+	as_node* node = entry->node;
+	bool active = ck_pr_load_8(&node->active);
+	
+	uint32_t size = entry->size;
+	
+	// Give back the capacity reserved for the entry first, so the pool has
+	// room for its connections.
+	ck_pr_sub_32(&node->conn_pool.cached, AS_NODE_CACHE_FDS);
+	entry->node = 0;
+	entry->size = 0;
+	
+	for (uint32_t i = 0; i < size; i++) {
+		if (active) {
+			as_node_fd_put_shared(node, entry->conns[i].fd, entry->conns[i].last_used);
+		}
+		else {
+			cf_close(entry->conns[i].fd);
+		}
+	}
+	as_node_release(node);
+}
+
+static void
+as_node_cache_destroy(void* udata)
+{
+	as_node_cache* cache = (as_node_cache*)udata;
+	
+	pthread_mutex_lock(&g_node_caches_lock);
+	
+	if (cache->prev) {
+		cache->prev->next = cache->next;
+	}
+	else {
+		g_node_caches = cache->next;
+	}
+	
+	if (cache->next) {
+		cache->next->prev = cache->prev;
+	}
+	pthread_mutex_unlock(&g_node_caches_lock);
+	
+	for (uint32_t i = 0; i < AS_NODE_CACHE_NODES; i++) {
+		if (cache->entries[i].node) {
+			as_node_cache_flush(&cache->entries[i]);
+		}
+	}
+}
+
+static void
+as_node_cache_key_create()
+{
+	pthread_key_create(&g_node_cache_key, as_node_cache_destroy);
+}
+
+// Find the calling thread's cache entry for node, with the cache entered.
+// Entries of nodes that have left the cluster are flushed on the way.  If
+// create is set and the node has no entry, a free entry is assigned if there
+// is one and the node's capacity has room for its connections.
+static as_node_cache_entry*
+as_node_cache_find(as_node* node, bool create)
 {
-	int fd = -1;
+	as_node_cache* cache = &g_node_cache;
+	as_node_cache_entry* free_entry = 0;
+	
+	for (uint32_t i = 0; i < AS_NODE_CACHE_NODES; i++) {
+		as_node_cache_entry* entry = &cache->entries[i];
+		
+		if (entry->node == node) {
+			return entry;
+		}
+		
+		if (entry->node && ! ck_pr_load_8(&entry->node->active)) {
+			as_node_cache_flush(entry);
+		}
 		
-	//cf_queue* q = asyncfd ? node->conn_q_asyncfd : node->conn_q;
-	cf_queue* q = node->conn_q;
+		if (! entry->node && ! free_entry) {
+			free_entry = entry;
+		}
+	}
+	
+	if (! create || ! free_entry) {
+		return 0;
+	}
+	
+	// Cached connections count against the node's capacity.  Room for a full
+	// entry is reserved up front, so connections coming and going from the
+	// cache don't touch the shared count.  The check races with other
+	// threads, so the capacity may be passed by a few connections.
+	as_conn_pool* pool = &node->conn_pool;
+	
+	if (ck_pr_load_32(&pool->size) + ck_pr_load_32(&pool->cached) + AS_NODE_CACHE_FDS > pool->capacity) {
+		return 0;
+	}
+	ck_pr_add_32(&pool->cached, AS_NODE_CACHE_FDS);
 	
-	while (fd == -1) {
-		int rv = cf_queue_pop(q, &fd, CF_QUEUE_NOWAIT);
+	if (! cache->registered) {
+		// Make sure cached connections are given back when the thread exits.
+		cache->registered = true;
+		pthread_once(&g_node_cache_once, as_node_cache_key_create);
+		pthread_setspecific(g_node_cache_key, cache);
 		
-		if (rv == CF_QUEUE_OK) {
-			int rv2 = is_connected(fd);
-			
-			switch (rv2) {
-				case CONNECTED:
-					// It's still good.
-					break;
-				case CONNECTED_BADFD:
-					// Local problem, don't try closing.
-					cf_warn("Found bad file descriptor in queue: fd %d", fd);
-					fd = -1;
-					break;
-				case CONNECTED_NOT:
-					// Can't use it - the remote end closed it.
-				case CONNECTED_ERROR:
-					// Some other problem, could have to do with remote end.
-				default:
-					cf_close(fd);
-					fd = -1;
-					break;
-			}
+		pthread_mutex_lock(&g_node_caches_lock);
+		cache->prev = 0;
+		cache->next = g_node_caches;
+		
+		if (g_node_caches) {
+			g_node_caches->prev = cache;
 		}
-		else if (rv == CF_QUEUE_EMPTY) {
-			fd = as_node_fd_create_and_connect(node);
-			
-			// We exhausted the queue and can't open a fresh socket.
-			if (fd == -1) {
-				break;
+		g_node_caches = cache;
+		pthread_mutex_unlock(&g_node_caches_lock);
+	}
+	
+	as_node_reserve(node);
+	free_entry->node = node;
+	return free_entry;
+}
+
+// Decide if a pooled connection can be handed out, closing it if not.
+// Connections used since trust_limit are assumed to still be connected.
+static bool
+as_node_conn_usable(as_node_conn* conn, uint64_t idle_limit, uint64_t trust_limit, bool* unchecked)
+{
+	if (conn->last_used < idle_limit) {
+		// Idle too long - the server may have closed it.
+		cf_close(conn->fd);
+		return false;
+	}
+	
+	if (conn->last_used >= trust_limit) {
+		*unchecked = true;
+		return true;
+	}
+	g_node_cache.stats.checks++;
+	return as_node_fd_check(conn->fd);
+}
+
+static int
+as_node_fd_get_internal(as_node* node, uint64_t trust_ms, bool* unchecked)
+{
+	as_cluster* cluster = node->cluster;
+	uint64_t now = cf_getms();
+	uint64_t idle_limit = as_node_idle_limit_at(cluster, now);
+	uint64_t trust_limit = (trust_ms && now > trust_ms) ? now - trust_ms : UINT64_MAX;
+	
+	*unchecked = false;
+	
+	if (as_node_cache_enter(&g_node_cache)) {
+		as_node_cache_entry* entry = as_node_cache_find(node, false);
+		
+		if (entry) {
+			while (entry->size > 0) {
+				as_node_conn* conn = &entry->conns[--entry->size];
+				
+				if (as_node_conn_usable(conn, idle_limit, trust_limit, unchecked)) {
+					as_node_cache_leave(&g_node_cache);
+					g_node_cache.stats.hits++;
+					return conn->fd;
+				}
 			}
 		}
-		else {
-			// Since we can't assert:
-			cf_error("Bad return value from cf_queue_pop");
-			fd = -1;
-			break;
+		as_node_cache_leave(&g_node_cache);
+	}
+	g_node_cache.stats.misses++;
+	
+	as_node_conn conn;
+	
+	while (as_node_pool_pop(node, &conn)) {
+		if (as_node_conn_usable(&conn, idle_limit, trust_limit, unchecked)) {
+			return conn.fd;
 		}
 	}
-	return fd;
+	
+	// We exhausted the pool - open a fresh socket.
+	return as_node_fd_create_and_connect(node);
+}
+
+int
+as_node_fd_get(as_node* node)
+{
+	bool unchecked;
+	return as_node_fd_get_internal(node, 0, &unchecked);
+}
+
+int
+as_node_fd_get_unchecked(as_node* node, bool* unchecked)
+{
+	return as_node_fd_get_internal(node, node->cluster->conn_check_idle_ms, unchecked);
+}
+
+int
+as_node_fd_create(as_node* node)
+{
+	return as_node_fd_create_and_connect(node);
 }
 
 void
 as_node_fd_put(as_node* node, int fd)
 {
-	cf_queue *q = node->conn_q;
-	if (! cf_queue_push_limit(q, &fd, 300)) {
-		cf_close(fd);
+	uint64_t now = cf_getms();
+	
+	if (as_node_cache_enter(&g_node_cache)) {
+		// Don't start caching connections to a node that is leaving the cluster.
+		as_node_cache_entry* entry = ck_pr_load_8(&node->active) ? as_node_cache_find(node, true) : 0;
+		
+		if (entry && entry->size < AS_NODE_CACHE_FDS) {
+			as_node_conn* conn = &entry->conns[entry->size++];
+			conn->fd = fd;
+			conn->last_used = now;
+			as_node_cache_leave(&g_node_cache);
+			return;
+		}
+		as_node_cache_leave(&g_node_cache);
 	}
+	g_node_cache.stats.spills++;
+	as_node_fd_put_shared(node, fd, now);
 	
 	/*
 	if (asyncfd == true) {
@@ -304,6 +628,206 @@ as_node_fd_put(as_node* node, int fd)
 	}*/
 }
 
+as_node_fd_stats*
+as_node_fd_thread_stats()
+{
+	return &g_node_cache.stats;
+}
+
+// Close the node's connections that idle threads have kept cached since limit.
+static void
+as_node_cache_reap(as_node* node, uint64_t limit)
+{
+	as_vector fds;
+	as_vector_inita(&fds, sizeof(int), 64);
+	
+	pthread_mutex_lock(&g_node_caches_lock);
+	
+	for (as_node_cache* cache = g_node_caches; cache; cache = cache->next) {
+		if (! as_node_cache_enter(cache)) {
+			continue;
+		}
+		
+		for (uint32_t i = 0; i < AS_NODE_CACHE_NODES; i++) {
+			as_node_cache_entry* entry = &cache->entries[i];
+			
+			if (entry->node != node) {
+				continue;
+			}
+			
+			// Connections are cached in order of last use too.
+			uint32_t n = 0;
+			
+			while (n < entry->size && entry->conns[n].last_used < limit) {
+				as_vector_append(&fds, &entry->conns[n].fd);
+				n++;
+			}
+			
+			if (n > 0) {
+				entry->size -= n;
+				memmove(entry->conns, &entry->conns[n], sizeof(as_node_conn) * entry->size);
+			}
+			
+			if (entry->size == 0) {
+				// The caller has the node reserved.
+				ck_pr_sub_32(&node->conn_pool.cached, AS_NODE_CACHE_FDS);
+				entry->node = 0;
+				as_node_release(node);
+			}
+			break;
+		}
+		as_node_cache_leave(cache);
+	}
+	pthread_mutex_unlock(&g_node_caches_lock);
+	
+	for (uint32_t i = 0; i < fds.size; i++) {
+		cf_close(*(int*)as_vector_get(&fds, i));
+	}
+	as_vector_destroy(&fds);
+}
+
+void
+as_node_close_idle_connections(as_node* node)
+{
+	uint64_t limit = as_node_idle_limit(node->cluster);
+	
+	if (limit == 0) {
+		return;
+	}
+	
+	as_node_cache_reap(node, limit);
+	
+	// Least recently used connections are at the front.  Close them outside
+	// the lock, a batch at a time, so transactions aren't held up.
+	as_conn_pool* pool = &node->conn_pool;
+	int fds[AS_NODE_REAP_BATCH];
+	uint32_t n;
+	
+	do {
+		n = 0;
+		pthread_mutex_lock(&pool->lock);
+		
+		while (n < AS_NODE_REAP_BATCH && n < pool->size && pool->conns[n].last_used < limit) {
+			fds[n] = pool->conns[n].fd;
+			n++;
+		}
+		
+		if (n > 0) {
+			pool->size -= n;
+			memmove(pool->conns, &pool->conns[n], sizeof(as_node_conn) * pool->size);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		
+		for (uint32_t i = 0; i < n; i++) {
+			cf_close(fds[i]);
+		}
+	} while (n == AS_NODE_REAP_BATCH);
+}
+
+void
+as_node_fill_connections(as_node* node)
+{
+	as_cluster* cluster = node->cluster;
+	as_conn_pool* pool = &node->conn_pool;
+	uint32_t min = cluster->min_conns_per_node;
+	
+	if (min > pool->capacity) {
+		min = pool->capacity;
+	}
+	
+	pthread_mutex_lock(&pool->lock);
+	uint32_t size = pool->size;
+	pthread_mutex_unlock(&pool->lock);
+	
+	if (size >= min) {
+		return;
+	}
+	
+	// Start all the connections at once and wait for them together, so
+	// filling the pool takes about one round trip instead of one each.
+	uint32_t count = min - size;
+	struct pollfd* pfds = cf_malloc(sizeof(struct pollfd) * count);
+	uint32_t n = 0;
+	
+	if (! pfds) {
+		return;
+	}
+	
+	while (n < count) {
+		int fd = as_node_fd_connect(node);
+		
+		if (fd < 0) {
+			break;
+		}
+		pfds[n].fd = fd;
+		pfds[n].events = POLLOUT;
+		pfds[n].revents = 0;
+		n++;
+	}
+	
+	uint64_t deadline = cf_getms() + cluster->conn_timeout_ms;
+	uint32_t pending = n;
+	
+	while (pending > 0) {
+		uint64_t now = cf_getms();
+		
+		if (now >= deadline) {
+			break;
+		}
+		
+		int rv = poll(pfds, n, (int)(deadline - now));
+		
+		if (rv < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		
+		for (uint32_t i = 0; i < n && rv > 0; i++) {
+			struct pollfd* pfd = &pfds[i];
+			
+			if (pfd->fd < 0 || ! pfd->revents) {
+				continue;
+			}
+			rv--;
+			
+			int fd = pfd->fd;
+			int err = 0;
+			socklen_t len = sizeof(err);
+			
+			// Negative fds are ignored by poll().
+			pfd->fd = -1;
+			pending--;
+			
+			if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+				cf_debug("Failed to pre-connect to node %s: %d", node->name, err);
+				cf_close(fd);
+				continue;
+			}
+			
+			// Authentication still takes a round trip per connection.
+			if (as_node_fd_authenticate(node, fd) >= 0) {
+				as_node_fd_put_shared(node, fd, cf_getms());
+			}
+		}
+	}
+	
+	// Give up on connections that didn't complete in time.
+	for (uint32_t i = 0; i < n; i++) {
+		if (pfds[i].fd >= 0) {
+			cf_close(pfds[i].fd);
+		}
+	}
+	cf_free(pfds);
+}
+
+uint64_t
+as_node_idle_limit(as_cluster* cluster)
+{
+	return as_node_idle_limit_at(cluster, cf_getms());
+}
+
 static int
 as_node_fd_get_info(as_node* node)
 {
@@ -564,17 +1088,56 @@ as_node_process_partitions(as_cluster* cluster, as_node* node, as_vector* values
 const char INFO_STR_CHECK[] = "node\npartition-generation\nservices\n";
 const char INFO_STR_GET_REPLICAS[] = "partition-generation\nreplicas-master\nreplicas-prole\n";
 
+static char*
+as_node_info_keep(uint8_t* buf, uint8_t* stack_buf)
+{
+	// Responses must outlive the worker's stack buffer.
+	return buf == stack_buf ? cf_strdup((char*)buf) : (char*)buf;
+}
+
+static bool
+as_node_partitions_changed(as_node* node, as_vector* values)
+{
+	// Same checks as as_node_process_response(), without side effects.
+	bool name_ok = false;
+	bool changed = false;
+	
+	for (uint32_t i = 0; i < values->size; i++) {
+		as_name_value* nv = as_vector_get(values, i);
+		
+		if (strcmp(nv->name, "node") == 0) {
+			name_ok = nv->value && strcmp(node->name, nv->value) == 0;
+		}
+		else if (strcmp(nv->name, "partition-generation") == 0) {
+			changed = node->partition_generation != (uint32_t)atoi(nv->value);
+		}
+	}
+	return name_ok && changed;
+}
+
 /**
- *	Request current status from server node.
+ *	Request current status from server node.  Only touches the node's info
+ *	socket, so nodes may be fetched concurrently.  The node's partition
+ *	generation is read but only changed by as_node_info_apply(), which the
+ *	tend thread calls once all fetches have completed.
  */
-bool
-as_node_refresh(as_cluster* cluster, as_node* node, as_vector* /* <as_friend> */ friends)
+void
+as_node_info_fetch(as_cluster* cluster, as_node* node, as_node_info* info)
 {
+	uint64_t begin = cf_getus();
+	
+	info->check = 0;
+	info->replicas = 0;
+	info->replicas_failed = false;
+	as_vector_init(&info->check_values, sizeof(as_name_value), 4);
+	as_vector_init(&info->replicas_values, sizeof(as_name_value), 4);
+	
 	int fd = as_node_fd_get_info(node);
 	
 	if (fd < 0) {
 		cf_warn("Failed to get info fd for node %s", node->name);
-		return 0;
+		info->elapsed_us = cf_getus() - begin;
+		return;
 	}
 	
 	uint32_t info_timeout = cluster->conn_timeout_ms;
@@ -583,43 +1146,56 @@ as_node_refresh(as_cluster* cluster, as_node* node, as_vector* /* <as_friend> */
 	
 	if (! buf) {
 		as_node_fd_close_info(node);
-		return false;
+		info->elapsed_us = cf_getus() - begin;
+		return;
 	}
 	
-	as_vector values;
-	as_vector_inita(&values, sizeof(as_name_value), 4);
+	info->check = as_node_info_keep(buf, stack_buf);
+	as_info_parse_multi_response(info->check, &info->check_values);
 	
-	as_info_parse_multi_response((char*)buf, &values);
-	
-	bool update_partitions;
-	bool status = as_node_process_response(cluster, node, &values, friends, &update_partitions);
-		
-	if (buf != stack_buf) {
-		cf_free(buf);
-	}
-	
-	if (status && update_partitions) {
+	if (as_node_partitions_changed(node, &info->check_values)) {
 		buf = as_node_get_info(node, fd, INFO_STR_GET_REPLICAS, sizeof(INFO_STR_GET_REPLICAS) - 1, info_timeout, stack_buf);
 		
-		if (! buf) {
+		if (buf) {
+			info->replicas = as_node_info_keep(buf, stack_buf);
+			as_info_parse_multi_response(info->replicas, &info->replicas_values);
+		}
+		else {
 			as_node_fd_close_info(node);
-			as_vector_destroy(&values);
-			return false;
+			info->replicas_failed = true;
 		}
-		
-		as_vector_clear(&values);
-		
-		as_info_parse_multi_response((char*)buf, &values);
+	}
+	info->elapsed_us = cf_getus() - begin;
+}
 
-		if (buf) {
-			as_node_process_partitions(cluster, node, &values);
-			
-			if (buf != stack_buf) {
-				cf_free(buf);
+/**
+ *	Apply responses fetched by as_node_info_fetch() and free them.  Must be
+ *	called on the tend thread.  Returns false if the node failed to refresh.
+ */
+bool
+as_node_info_apply(as_cluster* cluster, as_node* node, as_node_info* info, as_vector* /* <as_friend> */ friends)
+{
+	bool status = false;
+	
+	if (info->check) {
+		bool update_partitions;
+		status = as_node_process_response(cluster, node, &info->check_values, friends, &update_partitions);
+		
+		if (status && update_partitions) {
+			if (info->replicas) {
+				as_node_process_partitions(cluster, node, &info->replicas_values);
+			}
+			else if (info->replicas_failed) {
+				status = false;
 			}
 		}
+		cf_free(info->check);
 	}
 	
-	as_vector_destroy(&values);
+	if (info->replicas) {
+		cf_free(info->replicas);
+	}
+	as_vector_destroy(&info->check_values);
+	as_vector_destroy(&info->replicas_values);
 	return status;
 }
@@ -23,6 +23,7 @@
 #include <aerospike/as_cluster.h>
 #include <aerospike/as_string.h>
 #include "citrusleaf/cf_b64.h"
+#include "citrusleaf/cf_byte_order.h"
 #include "citrusleaf/cf_log_internal.h"
 #include "ck_pr.h"
 
@@ -53,37 +54,97 @@ as_partition_table_create(const char* ns, uint32_t capacity)
 	memset(table, 0, len);
 	as_strncpy(table->ns, ns, AS_MAX_NAMESPACE_SIZE);
 	table->size = capacity;
+	table->owned = cf_malloc(sizeof(uint64_t*) * AS_PARTITION_NODES_SIZE * 2);
+	memset(table->owned, 0, sizeof(uint64_t*) * AS_PARTITION_NODES_SIZE * 2);
 	return table;
 }
 
 void
 as_partition_table_destroy(as_partition_table* table)
 {
-	for (uint32_t i = 0; i < table->size; i++) {
-		as_partition* p = &table->partitions[i];
-		
-		if (p->master) {
-			as_node_release(p->master);
-		}
-		
-		if (p->prole) {
-			as_node_release(p->prole);
-		}
+	// Nodes are reserved by the cluster's partition nodes, not the table.
+	for (uint32_t i = 0; i < AS_PARTITION_NODES_SIZE * 2; i++) {
+		cf_free(table->owned[i]);
 	}
+	cf_free(table->owned);
 	cf_free(table);
 }
 
+void
+as_partition_nodes_destroy(as_partition_nodes* nodes)
+{
+	for (uint32_t i = 1; i < AS_PARTITION_NODES_SIZE; i++) {
+		if (nodes->array[i]) {
+			as_node_release(nodes->array[i]);
+			nodes->array[i] = 0;
+		}
+	}
+}
+
 as_partition_tables*
 as_partition_tables_create(uint32_t capacity)
 {
-	size_t size = sizeof(as_partition_tables) + (sizeof(as_partition_table*) * capacity);
+	uint32_t n_slots = 0;
+	
+	if (capacity > 0) {
+		n_slots = 2;
+		
+		while (n_slots < capacity * 2) {
+			n_slots <<= 1;
+		}
+	}
+	
+	size_t size = sizeof(as_partition_tables) + (sizeof(as_partition_table*) * (capacity + n_slots));
 	as_partition_tables* tables = cf_malloc(size);
 	memset(tables, 0, size);
 	tables->ref_count = 1;
 	tables->size = capacity;
+	tables->slots_mask = n_slots - 1;
+	tables->slots = &tables->array[capacity];
 	return tables;
 }
 
+/**
+ *	Copy namespace into a zero padded buffer the size of a table's namespace
+ *	and hash it on the way.  Return false if the namespace is too long to
+ *	have a table.
+ */
+static inline bool
+as_partition_ns_key(const char* ns, char* key, uint32_t* hash)
+{
+	memset(key, 0, AS_MAX_NAMESPACE_SIZE);
+	
+	// 32 bit FNV-1a.
+	uint32_t h = 2166136261u;
+	uint32_t i = 0;
+	
+	for (; i < AS_MAX_NAMESPACE_SIZE && ns[i]; i++) {
+		key[i] = ns[i];
+		h = (h ^ (uint8_t)ns[i]) * 16777619u;
+	}
+	*hash = h;
+	return i < AS_MAX_NAMESPACE_SIZE;
+}
+
+void
+as_partition_tables_index(as_partition_tables* tables)
+{
+	char key[AS_MAX_NAMESPACE_SIZE];
+	uint32_t hash;
+	
+	for (uint32_t i = 0; i < tables->size; i++) {
+		as_partition_table* table = tables->array[i];
+		as_partition_ns_key(table->ns, key, &hash);
+		
+		uint32_t slot = hash & tables->slots_mask;
+		
+		while (tables->slots[slot]) {
+			slot = (slot + 1) & tables->slots_mask;
+		}
+		tables->slots[slot] = table;
+	}
+}
+
 static inline as_node*
 reserve_node(as_cluster* cluster, as_node* node)
 {
@@ -109,7 +170,70 @@ reserve_node_alternate(as_cluster* cluster, as_node* chosen, as_node* alternate)
 	return reserve_node(cluster, alternate);
 }
 
-static uint32_t g_randomizer = 0;
+static inline as_node*
+partition_node(as_cluster* cluster, uint8_t index)
+{
+	// Make volatile reference so changes to tend thread will be reflected in this thread.
+	return index ? (as_node*)ck_pr_load_ptr(&cluster->partition_nodes.array[index]) : 0;
+}
+
+// Per thread, so choosing a replica doesn't write a cache line shared by
+// every thread issuing reads.
+static __thread uint32_t g_replica_seed = 0;
+
+static inline uint32_t
+replica_random()
+{
+	uint32_t x = g_replica_seed;
+	
+	if (x == 0) {
+		// Each thread's copy is at its own address.
+		uintptr_t a = (uintptr_t)&g_replica_seed;
+		x = (uint32_t)(a ^ (a >> 32)) | 1;
+	}
+	
+	// xorshift32
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	g_replica_seed = x;
+	return x;
+}
+
+static inline uint64_t
+replica_cost(as_node* node)
+{
+	// Recent latency scaled by the commands waiting on the node, so a fast
+	// node that is piling up work loses to a slower idle one.
+	uint64_t latency = ck_pr_load_32(&node->latency_us);
+	uint64_t load = ck_pr_load_32(&node->in_flight) + ck_pr_load_32(&node->async_in_flight);
+	return (latency + 1) * (load + 1);
+}
+
+static as_node*
+reserve_node_fastest(as_cluster* cluster, as_node* master, as_node* prole)
+{
+	uint32_t r = replica_random();
+	
+	// One read in 32 goes to a random replica, so the average of a replica
+	// that was slow keeps being refreshed and it wins reads back once it
+	// has recovered.
+	if ((r & 31) == 0) {
+		if (r & 32) {
+			return reserve_node_alternate(cluster, master, prole);
+		}
+		return reserve_node_alternate(cluster, prole, master);
+	}
+	
+	// Power of two choices - the partition's two replicas are the choices.
+	uint64_t master_cost = replica_cost(master);
+	uint64_t prole_cost = replica_cost(prole);
+	
+	if (master_cost < prole_cost || (master_cost == prole_cost && (r & 32))) {
+		return reserve_node_alternate(cluster, master, prole);
+	}
+	return reserve_node_alternate(cluster, prole, master);
+}
 
 as_node*
 as_partition_table_get_node(as_cluster* cluster, as_partition_table* table, const cf_digest* d, bool write)
@@ -119,14 +243,14 @@ as_partition_table_get_node(as_cluster* cluster, as_partition_table* table, cons
 		as_partition* p = &table->partitions[partition_id];
 		
 		// Make volatile reference so changes to tend thread will be reflected in this thread.
-		as_node* master = ck_pr_load_ptr(&p->master);
+		as_node* master = partition_node(cluster, ck_pr_load_8(&p->master));
 		
 		if (write) {
 			// Writes always go to master.
 			return reserve_node(cluster, master);
 		}
 		
-		as_node* prole = ck_pr_load_ptr(&p->prole);
+		as_node* prole = partition_node(cluster, ck_pr_load_8(&p->prole));
 			
 		if (! prole) {
 			return reserve_node(cluster, master);
@@ -136,10 +260,8 @@ as_partition_table_get_node(as_cluster* cluster, as_partition_table* table, cons
 			return reserve_node(cluster, prole);
 		}
 
-		// Alternate between master and prole for reads.
-		uint32_t r = ck_pr_faa_32(&g_randomizer, 1);
-				
-		if (r & 1) {
+		// Spread reads evenly between master and prole.
+		if (replica_random() & 1) {
 			return reserve_node_alternate(cluster, master, prole);
 		}
 		return reserve_node_alternate(cluster, prole, master);
@@ -151,92 +273,198 @@ as_partition_table_get_node(as_cluster* cluster, as_partition_table* table, cons
 	return as_node_get_random(cluster);
 }
 
+as_node*
+as_partition_table_get_fastest(as_cluster* cluster, as_partition_table* table, const cf_digest* d)
+{
+	if (table) {
+		cl_partition_id partition_id = cl_partition_getid(cluster->n_partitions, d);
+		as_partition* p = &table->partitions[partition_id];
+		
+		// Make volatile reference so changes to tend thread will be reflected in this thread.
+		as_node* master = partition_node(cluster, ck_pr_load_8(&p->master));
+		as_node* prole = partition_node(cluster, ck_pr_load_8(&p->prole));
+		
+		if (! prole) {
+			return reserve_node(cluster, master);
+		}
+		
+		if (! master) {
+			return reserve_node(cluster, prole);
+		}
+		return reserve_node_fastest(cluster, master, prole);
+	}
+	
+#ifdef DEBUG_VERBOSE
+	cf_debug("Choose random node for null partition table");
+#endif
+	return as_node_get_random(cluster);
+}
+
+as_node*
+as_partition_table_get_other(as_cluster* cluster, as_partition_table* table, const cf_digest* d, as_node* node)
+{
+	cl_partition_id partition_id = cl_partition_getid(cluster->n_partitions, d);
+	as_partition* p = &table->partitions[partition_id];
+	
+	// Make volatile reference so changes to tend thread will be reflected in this thread.
+	as_node* master = partition_node(cluster, ck_pr_load_8(&p->master));
+	as_node* prole = partition_node(cluster, ck_pr_load_8(&p->prole));
+	as_node* other = (node == master)? prole : (node == prole)? master : 0;
+	
+	if (other && other != node && ck_pr_load_8(&other->active)) {
+		as_node_reserve(other);
+		return other;
+	}
+	return 0;
+}
+
 as_partition_table*
 as_partition_tables_get(as_partition_tables* tables, const char* ns)
 {
+	if (tables->size == 0) {
+		return 0;
+	}
+	
+	char key[AS_MAX_NAMESPACE_SIZE];
+	uint32_t hash;
+	
+	if (! as_partition_ns_key(ns, key, &hash)) {
+		return 0;
+	}
+	
+	// Table namespaces are zero padded too, so a fixed size compare matches
+	// exactly. At most half the slots are used, so probes are short.
+	uint32_t slot = hash & tables->slots_mask;
 	as_partition_table* table;
 	
-	for (uint32_t i = 0; i < tables->size; i++) {
-		table = tables->array[i];
-		
-		if (strcmp(table->ns, ns) == 0) {
+	while ((table = tables->slots[slot])) {
+		if (memcmp(table->ns, key, AS_MAX_NAMESPACE_SIZE) == 0) {
 			return table;
 		}
+		slot = (slot + 1) & tables->slots_mask;
 	}
 	return 0;
 }
 
-bool
-as_partition_tables_find_node(as_partition_tables* tables, as_node* node)
+static inline void
+force_replicas_refresh(as_node* node)
 {
-	as_partition_table* table;
-	as_partition* p;
+	node->partition_generation = (uint32_t)-1;
+}
+
+/**
+ *	Use non-inline function for garbarge collector function pointer reference.
+ *	Forward to inlined release.
+ */
+static void
+release_partition_node(as_node* node)
+{
+	as_node_release(node);
+}
+
+static uint8_t
+as_partition_node_index(as_cluster* cluster, as_node* node)
+{
+	if (node->partition_index) {
+		return node->partition_index;
+	}
 	
-	for (uint32_t i = 0; i < tables->size; i++) {
-		table = tables->array[i];
+	as_partition_nodes* nodes = &cluster->partition_nodes;
+	
+	for (uint32_t i = 1; i < AS_PARTITION_NODES_SIZE; i++) {
+		// Hand out indexes round robin, so a freed index is reused as late as possible.
+		uint32_t index = nodes->next % (AS_PARTITION_NODES_SIZE - 1) + 1;
+		nodes->next = index;
 		
-		for (uint32_t j = 0; j < table->size; j++) {
-			p = &table->partitions[j];
-			
-			// Use reference equality for performance.
-			if (p->master == node || p->prole == node) {
-				return true;
-			}
+		if (! nodes->array[index]) {
+			as_node_reserve(node);
+			set_node(&nodes->array[index], node);
+			node->partition_index = (uint8_t)index;
+			return (uint8_t)index;
 		}
 	}
-	return false;
+	cf_error("Partition update. More than %d nodes mapped to partitions", AS_PARTITION_NODES_SIZE - 1);
+	return 0;
+}
+
+static void
+as_partition_node_unref(as_cluster* cluster, uint8_t index)
+{
+	as_partition_nodes* nodes = &cluster->partition_nodes;
+	
+	if (--nodes->refs[index] == 0) {
+		// No partition maps to the node any more. Other threads may have just
+		// read its index, so release it on the next tend.
+		as_node* node = nodes->array[index];
+		set_node(&nodes->array[index], 0);
+		node->partition_index = 0;
+		
+		as_gc_item item;
+		item.data = node;
+		item.release_fn = (as_release_fn)release_partition_node;
+		as_vector_append(cluster->gc, &item);
+	}
+}
+
+static inline uint64_t*
+owned_get(as_partition_table* table, uint8_t index, bool master)
+{
+	uint64_t** owned = &table->owned[index * 2 + (master ? 0 : 1)];
+	
+	if (! *owned) {
+		// Freed indexes keep their bitmaps, which are empty by then.
+		size_t size = sizeof(uint64_t) * ((table->size + 63) / 64);
+		*owned = cf_malloc(size);
+		memset(*owned, 0, size);
+	}
+	return *owned;
 }
 
 static inline void
-force_replicas_refresh(as_node* node)
+owned_set(as_partition_table* table, uint8_t index, bool master, uint32_t pid, bool owns)
 {
-	node->partition_generation = (uint32_t)-1;
+	uint64_t* owned = owned_get(table, index, master);
+	uint64_t bit = 0x8000000000000000ULL >> (pid & 63);
+	
+	if (owns) {
+		owned[pid >> 6] |= bit;
+	}
+	else {
+		owned[pid >> 6] &= ~bit;
+	}
 }
 
 static void
-as_partition_update(as_partition* p, as_node* node, bool master, bool owns)
+as_partition_update(as_cluster* cluster, as_partition_table* table, uint32_t pid, as_node* node, bool master, bool owns)
 {
 	// Volatile reads are not necessary because the tend thread exclusively modifies partition.
 	// Volatile writes are used so other threads can view change.
-	if (master) {
-		if (node == p->master) {
-			if (! owns) {
-				set_node(&p->master, 0);
-				as_node_release(node);
-			}
+	as_partition* p = &table->partitions[pid];
+	uint8_t* trg = master ? &p->master : &p->prole;
+	uint8_t old = *trg;
+	
+	if (owns) {
+		uint8_t index = as_partition_node_index(cluster, node);
+		
+		if (! index) {
+			return;
 		}
-		else {
-			if (owns) {
-				as_node* tmp = p->master;
-				as_node_reserve(node);
-				set_node(&p->master, node);
-				
-				if (tmp) {
-					force_replicas_refresh(tmp);
-					as_node_release(tmp);
-				}
-			}
+		cluster->partition_nodes.refs[index]++;
+		owned_set(table, index, master, pid, true);
+		ck_pr_store_8(trg, index);
+		
+		if (old) {
+			// The displaced node no longer has the partition, so its next
+			// update claims it again if the node still owns it.
+			owned_set(table, old, master, pid, false);
+			force_replicas_refresh(cluster->partition_nodes.array[old]);
+			as_partition_node_unref(cluster, old);
 		}
 	}
 	else {
-		if (node == p->prole) {
-			if (! owns) {
-				set_node(&p->prole, 0);
-				as_node_release(node);
-			}
-		}
-		else {
-			if (owns) {
-				as_node* tmp = p->prole;
-				as_node_reserve(node);
-				set_node(&p->prole, node);
-				
-				if (tmp) {
-					force_replicas_refresh(tmp);
-					as_node_release(tmp);
-				}
-			}
-		}
+		ck_pr_store_8(trg, 0);
+		owned_set(table, old, master, pid, false);
+		as_partition_node_unref(cluster, old);
 	}
 }
 
@@ -255,24 +483,125 @@ as_partition_vector_get(as_vector* tables, const char* ns)
 	return 0;
 }
 
+/**
+ *	Base64 character values.  Invalid characters have the high bit set.  Padding
+ *	decodes as 0.
+ */
+static const uint8_t b64_values[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0x00, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/**
+ *	Decode base64 eight characters (six bytes) at a time.  out must have room
+ *	for two bytes more than len / 4 * 3.  Returns false if any character is
+ *	invalid.
+ */
+static bool
+as_partition_b64_decode(const char* in, uint32_t len, uint8_t* out)
+{
+	const uint8_t* p = (const uint8_t*)in;
+	const uint8_t* end = p + (len & ~7u);
+	uint32_t bad = 0;
+	
+	while (p < end) {
+		uint64_t v0 = b64_values[p[0]];
+		uint64_t v1 = b64_values[p[1]];
+		uint64_t v2 = b64_values[p[2]];
+		uint64_t v3 = b64_values[p[3]];
+		uint64_t v4 = b64_values[p[4]];
+		uint64_t v5 = b64_values[p[5]];
+		uint64_t v6 = b64_values[p[6]];
+		uint64_t v7 = b64_values[p[7]];
+		bad |= (uint32_t)(v0 | v1 | v2 | v3 | v4 | v5 | v6 | v7);
+		
+		// 48 decoded bits at the top of a word, written in one store.
+		uint64_t word = v0 << 58 | v1 << 52 | v2 << 46 | v3 << 40 | v4 << 34 | v5 << 28 | v6 << 22 | v7 << 16;
+		word = cf_swap_to_be64(word);
+		memcpy(out, &word, sizeof(word));
+		p += 8;
+		out += 6;
+	}
+	
+	if (len & 4) {
+		uint32_t v0 = b64_values[p[0]];
+		uint32_t v1 = b64_values[p[1]];
+		uint32_t v2 = b64_values[p[2]];
+		uint32_t v3 = b64_values[p[3]];
+		bad |= v0 | v1 | v2 | v3;
+		
+		uint32_t word = v0 << 18 | v1 << 12 | v2 << 6 | v3;
+		out[0] = (uint8_t)(word >> 16);
+		out[1] = (uint8_t)(word >> 8);
+		out[2] = (uint8_t)word;
+	}
+	return (bad & 0x80) == 0 && (len & 3) == 0;
+}
+
 static void
-decode_and_update(char* bitmap_b64, long len, as_partition_table* table, as_node* node, bool master)
+decode_and_update(as_cluster* cluster, char* bitmap_b64, long len, as_partition_table* table, as_node* node, bool master)
 {
-	// Size allows for padding - is actual size rounded up to multiple of 3.
-	uint8_t* bitmap = (uint8_t*)alloca(cf_b64_decoded_buf_size((uint32_t)len));
-
-	// For now - for speed - trust validity of encoded characters.
-	cf_b64_decode(bitmap_b64, (uint32_t)len, bitmap, NULL);
-
-	// Expand the bitmap.
-	for (uint32_t i = 0; i < table->size; i++) {
-		bool owns = ((bitmap[i >> 3] & (0x80 >> (i & 7))) != 0);
-		/*
-		if (owns) {
-			cf_debug("Set partition %s:%s:%u:%s", master? "master" : "prole", table->ns, i, node->name);
+	// Decode into whole 64 bit words, with room for the decoder's last store.
+	uint32_t bitmap_size = (table->size + 7) / 8;
+	uint32_t n_words = (table->size + 63) / 64;
+	uint32_t decoded_size = (uint32_t)len / 4 * 3;
+	uint32_t buf_size = (decoded_size > n_words * 8 ? decoded_size : n_words * 8) + 2;
+	uint8_t* bitmap = (uint8_t*)alloca(buf_size);
+	
+	if (! as_partition_b64_decode(bitmap_b64, (uint32_t)len, bitmap)) {
+		cf_error("Partition update. Invalid partition map encoding for namespace %s", table->ns);
+		return;
+	}
+	memset(bitmap + bitmap_size, 0, buf_size - bitmap_size);
+	
+	// Diff 64 partitions at a time against the partitions mapped to the node
+	// now, and only touch those which changed. Bit 63 is the word's first
+	// partition.
+	for (uint32_t w = 0; w < n_words; w++) {
+		uint64_t owns;
+		memcpy(&owns, &bitmap[w * 8], sizeof(owns));
+		owns = cf_swap_from_be64(owns);
+		
+		uint32_t count = table->size - w * 64;
+		
+		if (count < 64) {
+			owns &= ~0ULL << (64 - count);
+		}
+		
+		// Reload, as the node loses its index when it loses its last partition.
+		uint8_t index = node->partition_index;
+		uint64_t has = 0;
+		
+		if (index) {
+			uint64_t* owned = table->owned[index * 2 + (master ? 0 : 1)];
+			
+			if (owned) {
+				has = owned[w];
+			}
+		}
+		
+		uint64_t changed = owns ^ has;
+		
+		while (changed) {
+			uint32_t j = (uint32_t)__builtin_clzll(changed);
+			uint64_t bit = 0x8000000000000000ULL >> j;
+			changed &= ~bit;
+			as_partition_update(cluster, table, w * 64 + j, node, master, (owns & bit) != 0);
 		}
-		*/
-		as_partition_update(&table->partitions[i], node, master, owns);
 	}
 }
 
@@ -294,6 +623,9 @@ as_partition_tables_copy_add(as_cluster* cluster, as_partition_tables* tables_ol
 	// Add new tables.
 	memcpy(&tables_new->array[tables_old->size], tables_to_add->list, sizeof(as_partition_table*) * tables_to_add->size);
 	
+	// Index by namespace before other threads can see the copy.
+	as_partition_tables_index(tables_new);
+	
 	// Replace tables with copy.
 	set_partition_tables(cluster, tables_new);
 	
@@ -364,7 +696,7 @@ as_partition_tables_update(as_cluster* cluster, as_node* node, char* buf, bool m
 			}
 
 			// Decode partition bitmap and update client's view.
-			decode_and_update(bitmap_b64, len, table, node, master);
+			decode_and_update(cluster, bitmap_b64, len, table, node, master);
 
 			ns = ++p;
 		}
@@ -13,7 +13,11 @@
  */
 as_policy_read * as_policy_read_init(as_policy_read * p) {
 	p->timeout	= 0;
+	p->timeout_us	= 0;
 	p->key		= AS_POLICY_KEY_UNDEF;
+	p->hedge_delay	= 0;
+	p->cache_staleness	= 0;
+	p->replica	= AS_POLICY_REPLICA_UNDEF;
 	return p;
 }
 
@@ -32,6 +36,7 @@ as_policy_apply * as_policy_apply_init(as_policy_apply * p) {
 as_policy_write * as_policy_write_init(as_policy_write * p) 
 {
 	p->timeout	= 0;
+	p->timeout_us	= 0;
 	p->retry	= AS_POLICY_RETRY_UNDEF;
 	p->key		= AS_POLICY_KEY_UNDEF;
 	p->gen		= AS_POLICY_GEN_UNDEF;
@@ -45,6 +50,7 @@ as_policy_write * as_policy_write_init(as_policy_write * p)
 as_policy_operate * as_policy_operate_init(as_policy_operate * p)
 {
 	p->timeout		= 0;
+	p->timeout_us	= 0;
 	p->retry		= AS_POLICY_RETRY_UNDEF;
 	p->key			= AS_POLICY_KEY_UNDEF;
 	p->gen			= AS_POLICY_GEN_UNDEF;
@@ -57,6 +63,7 @@ as_policy_operate * as_policy_operate_init(as_policy_operate * p)
 as_policy_remove * as_policy_remove_init(as_policy_remove * p)
 {
 	p->timeout		= 0;
+	p->timeout_us	= 0;
 	p->generation	= 0;
 	p->retry		= AS_POLICY_RETRY_UNDEF;
 	p->key			= AS_POLICY_KEY_UNDEF;
@@ -120,6 +127,8 @@ as_policies * as_policies_init(as_policies * p)
 	// defaults
 	p->timeout	= AS_POLICY_TIMEOUT_DEFAULT;
 	p->retry	= AS_POLICY_RETRY_DEFAULT;
+	p->max_retries = AS_POLICY_MAX_RETRIES_DEFAULT;
+	p->sleep_between_retries = AS_POLICY_SLEEP_BETWEEN_RETRIES_DEFAULT;
 	p->key		= AS_POLICY_KEY_DEFAULT;
 	p->gen		= AS_POLICY_GEN_DEFAULT;
 	p->exists	= AS_POLICY_EXISTS_DEFAULT;
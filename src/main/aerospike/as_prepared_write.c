@@ -0,0 +1,348 @@
+/******************************************************************************
+ *	Copyright 2008-2013 by Aerospike.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy 
+ *	of this software and associated documentation files (the "Software"), to 
+ *	deal in the Software without restriction, including without limitation the 
+ *	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ *	sell copies of the Software, and to permit persons to whom the Software is 
+ *	furnished to do so, subject to the following conditions:
+ *	
+ *	The above copyright notice and this permission notice shall be included in 
+ *	all copies or substantial portions of the Software.
+ *	
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING 
+ *	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ *	IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/as_bytes.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_io_buffer.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_prepared_write.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+#include <aerospike/as_string.h>
+#include <aerospike/as_val.h>
+#include <citrusleaf/cf_byte_order.h>
+#include <citrusleaf/cf_digest.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cl_object.h>
+#include <citrusleaf/cl_write.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "_prepared_write.h"
+#include "_shim.h"
+
+#include "../citrusleaf/internal.h"
+
+/******************************************************************************
+ *	STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ *	Value of a bin, or NULL if it doesn't have the prepared bin's type.
+ */
+static const uint8_t * as_prepared_value(const as_prepared_bin * b, const as_val * val, uint64_t * int_be, uint32_t * sz)
+{
+	if ( ! val || val->type != b->type ) {
+		return NULL;
+	}
+
+	switch ( b->type ) {
+		case AS_INTEGER: {
+			*int_be = cf_swap_to_be64((uint64_t) ((as_integer *) val)->value);
+			*sz = sizeof(uint64_t);
+			return (const uint8_t *) int_be;
+		}
+		case AS_STRING: {
+			*sz = (uint32_t) as_string_len((as_string *) val);
+			return (const uint8_t *) ((as_string *) val)->value;
+		}
+		default: {
+			const as_bytes * bytes = (const as_bytes *) val;
+			if ( bytes->type != b->particle_type ) {
+				return NULL;
+			}
+			*sz = bytes->size;
+			return bytes->value;
+		}
+	}
+}
+
+/**
+ *	Lay out a field with an optional leading type byte. Returns the end of
+ *	the field.
+ */
+static uint8_t * as_prepared_field(uint8_t * p, uint8_t type, const uint8_t * data_type, const uint8_t * data, uint32_t data_sz)
+{
+	cl_msg_field * mf = (cl_msg_field *) p;
+	uint8_t * d = mf->data;
+	uint32_t field_sz = 1 + data_sz;
+
+	if ( data_type ) {
+		*d++ = *data_type;
+		field_sz++;
+	}
+
+	memcpy(d, data, data_sz);
+	mf->type = type;
+	mf->field_sz = cf_swap_to_be32(field_sz);
+	return d + data_sz;
+}
+
+/******************************************************************************
+ *	FUNCTIONS
+ *****************************************************************************/
+
+as_status as_prepared_write_init(as_prepared_write * pw, as_error * err, const as_policy_write * policy,
+	const char * ns, const char * set, const as_record * rec)
+{
+	memset(pw, 0, sizeof(as_prepared_write));
+
+	if ( strlen(ns) >= sizeof(pw->ns) ) {
+		return as_error_update(err, AEROSPIKE_ERR_PARAM, "namespace too long");
+	}
+
+	if ( set && strlen(set) >= sizeof(pw->set) ) {
+		return as_error_update(err, AEROSPIKE_ERR_PARAM, "set too long");
+	}
+
+	pw->policy = *policy;
+	strcpy(pw->ns, ns);
+	strcpy(pw->set, set ? set : "");
+	pw->n_bins = rec->bins.size;
+	pw->use_generation = policy->gen == AS_POLICY_GEN_EQ || policy->gen == AS_POLICY_GEN_GT ||
+			policy->gen == AS_POLICY_GEN_DUP;
+
+	// Bin names and op headers.
+	pw->bins = (as_prepared_bin *) malloc(sizeof(as_prepared_bin) * (pw->n_bins ? pw->n_bins : 1));
+	size_t ops_sz = 0;
+
+	if ( ! pw->bins ) {
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate prepared write");
+	}
+
+	for ( int i = 0; i < pw->n_bins; i++ ) {
+		const as_bin * bin = &rec->bins.entries[i];
+		const as_val * val = (const as_val *) bin->valuep;
+		as_prepared_bin * b = &pw->bins[i];
+
+		switch ( val ? val->type : AS_NIL ) {
+			case AS_INTEGER:
+				b->particle_type = CL_INT;
+				break;
+			case AS_STRING:
+				b->particle_type = CL_STR;
+				break;
+			case AS_BYTES:
+				b->particle_type = (uint8_t) ((const as_bytes *) val)->type;
+				break;
+			default:
+				as_prepared_write_destroy(pw);
+				return as_error_update(err, AEROSPIKE_ERR_PARAM, "prepared writes only take integer, string and bytes bins");
+		}
+
+		b->type = (uint8_t) val->type;
+		b->name_sz = (uint8_t) strlen(bin->name);
+		ops_sz += sizeof(cl_msg_op) + b->name_sz;
+	}
+
+	pw->ops = (uint8_t *) malloc(ops_sz ? ops_sz : 1);
+	pw->ops_sz = (uint32_t) ops_sz;
+
+	if ( ! pw->ops ) {
+		as_prepared_write_destroy(pw);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate prepared write");
+	}
+
+	uint8_t * p = pw->ops;
+
+	for ( int i = 0; i < pw->n_bins; i++ ) {
+		const as_prepared_bin * b = &pw->bins[i];
+		cl_msg_op * op = (cl_msg_op *) p;
+
+		// op_sz depends on the value, and is filled in for each write.
+		op->op_sz = 0;
+		op->op = CL_MSG_OP_WRITE;
+		op->particle_type = b->particle_type;
+		op->version = 0;
+		op->name_sz = b->name_sz;
+		memcpy(op->name, rec->bins.entries[i].name, b->name_sz);
+		p = op->name + b->name_sz;
+	}
+
+	// Header and namespace and set fields - compiled as a request with no
+	// key, digest or ops, then counted in.
+	cl_write_parameters wp;
+	aspolicywrite_to_clwriteparameters(policy, rec, &wp);
+
+	uint8_t * buf = NULL;
+	size_t buf_sz = 0;
+
+	if ( cl_compile(0, CL_MSG_INFO2_WRITE, 0, ns, set, NULL, NULL, NULL, 0, NULL, 0, &buf, &buf_sz, &wp, NULL, 0, NULL, NULL, 0) != 0 ) {
+		as_prepared_write_destroy(pw);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to compile request");
+	}
+
+	as_msg * msg = (as_msg *) buf;
+	cl_msg_swap_header_from_be(&msg->m);
+	msg->m.n_fields += policy->key == AS_POLICY_KEY_SEND ? 2 : 1;
+	msg->m.n_ops = pw->n_bins;
+	msg->m.generation = 0;
+	msg->m.record_ttl = 0;
+	cl_msg_swap_header_to_be(&msg->m);
+
+	pw->header = (uint8_t *) malloc(buf_sz);
+
+	if ( ! pw->header ) {
+		as_io_buffer_put(buf);
+		as_prepared_write_destroy(pw);
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate prepared write");
+	}
+
+	memcpy(pw->header, buf, buf_sz);
+	pw->header_sz = (uint32_t) buf_sz;
+	as_io_buffer_put(buf);
+
+	return AEROSPIKE_OK;
+}
+
+void as_prepared_write_destroy(as_prepared_write * pw)
+{
+	free(pw->header);
+	free(pw->ops);
+	free(pw->bins);
+	pw->header = NULL;
+	pw->ops = NULL;
+	pw->bins = NULL;
+}
+
+as_status as_prepared_write_compile(const as_prepared_write * pw, as_error * err, as_key * key, const as_record * rec,
+	uint8_t ** buf_r, size_t * buf_sz_r)
+{
+	// The namespace and set fields and the digest must agree.
+	if ( strcmp(key->ns, pw->ns) != 0 || strcmp(key->set, pw->set) != 0 ) {
+		return as_error_update(err, AEROSPIKE_ERR_PARAM, "key's namespace or set doesn't match prepared write");
+	}
+
+	if ( rec->bins.size != pw->n_bins ) {
+		return as_error_update(err, AEROSPIKE_ERR_PARAM, "record's bins don't match prepared write");
+	}
+
+	// Check the bins against the prepared bins, and size the values.
+	size_t msg_sz = pw->header_sz + sizeof(cl_msg_field) + sizeof(cf_digest) + pw->ops_sz;
+	const uint8_t * op_p = pw->ops;
+
+	for ( int i = 0; i < pw->n_bins; i++ ) {
+		const as_prepared_bin * b = &pw->bins[i];
+		const as_bin * bin = &rec->bins.entries[i];
+		const cl_msg_op * op = (const cl_msg_op *) op_p;
+		uint64_t int_be;
+		uint32_t sz;
+
+		if ( strncmp(bin->name, (const char *) op->name, b->name_sz) != 0 || bin->name[b->name_sz] != '\0' ) {
+			return as_error_update(err, AEROSPIKE_ERR_PARAM, "record's bins don't match prepared write");
+		}
+
+		if ( ! as_prepared_value(b, (const as_val *) bin->valuep, &int_be, &sz) ) {
+			return as_error_update(err, AEROSPIKE_ERR_PARAM, "record's values don't match prepared write");
+		}
+		msg_sz += sz;
+		op_p = op->name + b->name_sz;
+	}
+
+	// The key is sent as asval_to_clobject() would convert it.
+	const uint8_t * key_data = NULL;
+	uint32_t key_sz = 0;
+	uint8_t key_type = CL_NULL;
+	uint64_t key_int;
+
+	if ( pw->policy.key == AS_POLICY_KEY_SEND ) {
+		const as_val * kv = (const as_val *) key->valuep;
+
+		switch ( kv ? kv->type : AS_NIL ) {
+			case AS_INTEGER: {
+				key_int = cf_swap_to_be64((uint64_t) ((as_integer *) kv)->value);
+				key_type = CL_INT;
+				key_data = (const uint8_t *) &key_int;
+				key_sz = sizeof(key_int);
+				break;
+			}
+			case AS_STRING: {
+				key_type = CL_STR;
+				key_data = (const uint8_t *) ((as_string *) kv)->value;
+				key_sz = (uint32_t) as_string_len((as_string *) kv);
+				break;
+			}
+			case AS_BYTES: {
+				key_type = (uint8_t) ((as_bytes *) kv)->type;
+				key_data = ((as_bytes *) kv)->value;
+				key_sz = ((as_bytes *) kv)->size;
+				break;
+			}
+			default: {
+				return as_error_update(err, AEROSPIKE_ERR_PARAM, "key type not supported");
+			}
+		}
+
+		msg_sz += sizeof(cl_msg_field) + 1 + key_sz;
+	}
+
+	as_digest * digest = as_key_digest(key);
+
+	size_t capacity;
+	uint8_t * buf = as_io_buffer_get(msg_sz, &capacity);
+
+	if ( ! buf ) {
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "failed to allocate request");
+	}
+
+	memcpy(buf, pw->header, pw->header_sz);
+
+	as_msg * msg = (as_msg *) buf;
+	msg->proto.version = CL_PROTO_VERSION;
+	msg->proto.type = CL_PROTO_TYPE_CL_MSG;
+	msg->proto.sz = msg_sz - sizeof(cl_proto);
+	cl_proto_swap_to_be(&msg->proto);
+	msg->m.generation = cf_swap_to_be32(pw->use_generation ? rec->gen : 0);
+	msg->m.record_ttl = cf_swap_to_be32(rec->ttl);
+
+	uint8_t * p = buf + pw->header_sz;
+
+	if ( key_data ) {
+		p = as_prepared_field(p, CL_MSG_FIELD_TYPE_KEY, &key_type, key_data, key_sz);
+	}
+
+	p = as_prepared_field(p, CL_MSG_FIELD_TYPE_DIGEST_RIPE, NULL, digest->value, sizeof(cf_digest));
+
+	op_p = pw->ops;
+
+	for ( int i = 0; i < pw->n_bins; i++ ) {
+		const as_prepared_bin * b = &pw->bins[i];
+		size_t op_hdr_sz = sizeof(cl_msg_op) + b->name_sz;
+		uint64_t int_be;
+		uint32_t value_sz;
+		const uint8_t * value = as_prepared_value(b, (const as_val *) rec->bins.entries[i].valuep, &int_be, &value_sz);
+
+		memcpy(p, op_p, op_hdr_sz);
+		((cl_msg_op *) p)->op_sz = cf_swap_to_be32(4 + b->name_sz + value_sz);
+		memcpy(p + op_hdr_sz, value, value_sz);
+		p += op_hdr_sz + value_sz;
+		op_p += op_hdr_sz;
+	}
+
+	*buf_r = buf;
+	*buf_sz_r = msg_sz;
+	return AEROSPIKE_OK;
+}
@@ -0,0 +1,382 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <aerospike/as_read_cache.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ck_pr.h"
+
+// Hash buckets a shard starts with, doubled when the entries outnumber them.
+#define AS_READ_CACHE_MIN_BUCKETS 64
+
+/******************************************************************************
+ *	Functions.
+ *****************************************************************************/
+
+// Digests are uniformly distributed, so their bytes are used as the hash -
+// the first picks the shard, the next four the bucket.
+static inline as_read_cache_shard*
+as_read_cache_shard_get(as_read_cache* cache, const cf_digest* digest)
+{
+	return &cache->shards[digest->digest[0] & (AS_READ_CACHE_SHARDS - 1)];
+}
+
+static inline uint32_t
+as_read_cache_bucket(as_read_cache_shard* shard, const cf_digest* digest)
+{
+	uint32_t h;
+	memcpy(&h, &digest->digest[1], sizeof(h));
+	return h & (shard->n_buckets - 1);
+}
+
+static as_read_cache_entry*
+as_read_cache_find(as_read_cache_shard* shard, const char* ns, const cf_digest* digest, as_read_cache_entry*** link_r)
+{
+	as_read_cache_entry** link = &shard->table[as_read_cache_bucket(shard, digest)];
+	
+	for (as_read_cache_entry* e = *link; e; link = &e->next, e = e->next) {
+		if (memcmp(&e->digest, digest, sizeof(cf_digest)) == 0 && strcmp(e->ns, ns) == 0) {
+			if (link_r) {
+				*link_r = link;
+			}
+			return e;
+		}
+	}
+	return 0;
+}
+
+static void
+as_read_cache_lru_remove(as_read_cache_shard* shard, as_read_cache_entry* e)
+{
+	if (e->lru_prev) {
+		e->lru_prev->lru_next = e->lru_next;
+	}
+	else {
+		shard->head = e->lru_next;
+	}
+	
+	if (e->lru_next) {
+		e->lru_next->lru_prev = e->lru_prev;
+	}
+	else {
+		shard->tail = e->lru_prev;
+	}
+}
+
+static void
+as_read_cache_lru_push(as_read_cache_shard* shard, as_read_cache_entry* e)
+{
+	e->lru_prev = 0;
+	e->lru_next = shard->head;
+	
+	if (shard->head) {
+		shard->head->lru_prev = e;
+	}
+	else {
+		shard->tail = e;
+	}
+	shard->head = e;
+}
+
+// Take an entry out of the shard. The shard's reference is handed to the
+// caller, to be released once the lock is dropped.
+static void
+as_read_cache_unlink(as_read_cache_shard* shard, as_read_cache_entry* e)
+{
+	as_read_cache_entry** link = 0;
+	as_read_cache_find(shard, e->ns, &e->digest, &link);
+	*link = e->next;
+	
+	as_read_cache_lru_remove(shard, e);
+	shard->bytes -= e->size;
+	shard->n_entries--;
+}
+
+static void
+as_read_cache_grow(as_read_cache_shard* shard)
+{
+	uint32_t n_buckets = shard->n_buckets * 2;
+	as_read_cache_entry** table = cf_malloc(sizeof(as_read_cache_entry*) * n_buckets);
+	
+	if (! table) {
+		// Chains just get longer.
+		return;
+	}
+	memset(table, 0, sizeof(as_read_cache_entry*) * n_buckets);
+	
+	as_read_cache_entry** old = shard->table;
+	uint32_t old_n_buckets = shard->n_buckets;
+	
+	shard->table = table;
+	shard->n_buckets = n_buckets;
+	
+	for (uint32_t i = 0; i < old_n_buckets; i++) {
+		as_read_cache_entry* e = old[i];
+		
+		while (e) {
+			as_read_cache_entry* next = e->next;
+			uint32_t b = as_read_cache_bucket(shard, &e->digest);
+			e->next = table[b];
+			table[b] = e;
+			e = next;
+		}
+	}
+	cf_free(old);
+}
+
+as_read_cache*
+as_read_cache_create(uint32_t max_bytes)
+{
+	as_read_cache* cache = cf_malloc(sizeof(as_read_cache));
+	
+	if (! cache) {
+		return 0;
+	}
+	memset(cache, 0, sizeof(as_read_cache));
+	
+	for (uint32_t i = 0; i < AS_READ_CACHE_SHARDS; i++) {
+		as_read_cache_shard* shard = &cache->shards[i];
+		shard->table = cf_malloc(sizeof(as_read_cache_entry*) * AS_READ_CACHE_MIN_BUCKETS);
+		
+		if (! shard->table) {
+			as_read_cache_destroy(cache);
+			return 0;
+		}
+		memset(shard->table, 0, sizeof(as_read_cache_entry*) * AS_READ_CACHE_MIN_BUCKETS);
+		shard->n_buckets = AS_READ_CACHE_MIN_BUCKETS;
+		shard->max_bytes = max_bytes / AS_READ_CACHE_SHARDS;
+		pthread_mutex_init(&shard->lock, 0);
+	}
+	return cache;
+}
+
+void
+as_read_cache_destroy(as_read_cache* cache)
+{
+	for (uint32_t i = 0; i < AS_READ_CACHE_SHARDS; i++) {
+		as_read_cache_shard* shard = &cache->shards[i];
+		
+		if (! shard->table) {
+			continue;
+		}
+		
+		as_read_cache_entry* e = shard->head;
+		
+		while (e) {
+			as_read_cache_entry* next = e->lru_next;
+			cf_free(e);
+			e = next;
+		}
+		cf_free(shard->table);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	cf_free(cache);
+}
+
+as_read_cache_entry*
+as_read_cache_get(as_read_cache* cache, const char* ns, const cf_digest* digest, uint32_t max_staleness_ms,
+	uint64_t* epoch)
+{
+	as_read_cache_shard* shard = as_read_cache_shard_get(cache, digest);
+	uint64_t now = cf_getms();
+	as_read_cache_entry* expired = 0;
+	
+	pthread_mutex_lock(&shard->lock);
+	*epoch = shard->epoch;
+	
+	as_read_cache_entry* e = as_read_cache_find(shard, ns, digest, 0);
+	
+	if (e && e->expires_ms && now >= e->expires_ms) {
+		// Gone on the server too.
+		as_read_cache_unlink(shard, e);
+		expired = e;
+		e = 0;
+	}
+	else if (e && now - e->fetched_ms > max_staleness_ms) {
+		// Too old for this read - the read will replace it.
+		e = 0;
+	}
+	
+	if (e) {
+		as_read_cache_lru_remove(shard, e);
+		as_read_cache_lru_push(shard, e);
+		ck_pr_inc_32(&e->ref_count);
+		shard->hits++;
+	}
+	else {
+		shard->misses++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	
+	if (expired) {
+		as_read_cache_release(expired);
+	}
+	return e;
+}
+
+void
+as_read_cache_release(as_read_cache_entry* entry)
+{
+	bool destroy;
+	ck_pr_dec_32_zero(&entry->ref_count, &destroy);
+	
+	if (destroy) {
+		cf_free(entry);
+	}
+}
+
+void
+as_read_cache_put(as_read_cache* cache, const char* ns, const cf_digest* digest, uint64_t epoch,
+	const cl_msg* msg, const uint8_t* buf, size_t buf_size)
+{
+	as_read_cache_shard* shard = as_read_cache_shard_get(cache, digest);
+	size_t size = sizeof(as_read_cache_entry) + buf_size;
+	
+	if (size > shard->max_bytes || strlen(ns) >= sizeof(as_namespace)) {
+		return;
+	}
+	
+	uint64_t now = cf_getms();
+	uint64_t expires = 0;
+	
+	// The server sends when the record expires, in seconds since the
+	// citrusleaf epoch, 0 if never.
+	if (msg->record_ttl) {
+		uint64_t void_ms = (uint64_t)msg->record_ttl * 1000;
+		uint64_t clepoch_ms = cf_clepoch_milliseconds();
+		
+		if (void_ms <= clepoch_ms) {
+			return;
+		}
+		expires = now + (void_ms - clepoch_ms);
+	}
+	
+	as_read_cache_entry* entry = cf_malloc(size);
+	
+	if (! entry) {
+		return;
+	}
+	
+	entry->fetched_ms = now;
+	entry->expires_ms = expires;
+	entry->size = size;
+	entry->buf_size = buf_size;
+	entry->msg = *msg;
+	entry->digest = *digest;
+	strcpy(entry->ns, ns);
+	entry->ref_count = 1;
+	memcpy(entry->buf, buf, buf_size);
+	
+	// Entries dropped under the lock are released after it.
+	as_read_cache_entry* dropped = 0;
+	
+	pthread_mutex_lock(&shard->lock);
+	
+	if (shard->epoch != epoch) {
+		// Written while the read was in flight - the record may be old.
+		pthread_mutex_unlock(&shard->lock);
+		cf_free(entry);
+		return;
+	}
+	
+	as_read_cache_entry* old = as_read_cache_find(shard, ns, digest, 0);
+	
+	if (old) {
+		if (old->msg.generation > msg->generation) {
+			// Another read got a later version.
+			pthread_mutex_unlock(&shard->lock);
+			cf_free(entry);
+			return;
+		}
+		as_read_cache_unlink(shard, old);
+		old->next = dropped;
+		dropped = old;
+	}
+	
+	if (shard->n_entries >= shard->n_buckets) {
+		as_read_cache_grow(shard);
+	}
+	
+	uint32_t b = as_read_cache_bucket(shard, digest);
+	entry->next = shard->table[b];
+	shard->table[b] = entry;
+	as_read_cache_lru_push(shard, entry);
+	shard->bytes += size;
+	shard->n_entries++;
+	
+	while (shard->bytes > shard->max_bytes) {
+		as_read_cache_entry* victim = shard->tail;
+		as_read_cache_unlink(shard, victim);
+		victim->next = dropped;
+		dropped = victim;
+		shard->evictions++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	
+	while (dropped) {
+		as_read_cache_entry* next = dropped->next;
+		as_read_cache_release(dropped);
+		dropped = next;
+	}
+}
+
+void
+as_read_cache_remove(as_read_cache* cache, const char* ns, const cf_digest* digest)
+{
+	as_read_cache_shard* shard = as_read_cache_shard_get(cache, digest);
+	
+	pthread_mutex_lock(&shard->lock);
+	shard->epoch++;
+	
+	as_read_cache_entry* e = as_read_cache_find(shard, ns, digest, 0);
+	
+	if (e) {
+		as_read_cache_unlink(shard, e);
+		shard->invalidations++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	
+	if (e) {
+		as_read_cache_release(e);
+	}
+}
+
+void
+as_read_cache_get_stats(as_read_cache* cache, as_cluster_read_cache_stats* stats)
+{
+	memset(stats, 0, sizeof(as_cluster_read_cache_stats));
+	
+	for (uint32_t i = 0; i < AS_READ_CACHE_SHARDS; i++) {
+		as_read_cache_shard* shard = &cache->shards[i];
+		
+		pthread_mutex_lock(&shard->lock);
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->evictions += shard->evictions;
+		stats->invalidations += shard->invalidations;
+		stats->entries += shard->n_entries;
+		stats->bytes += shard->bytes;
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
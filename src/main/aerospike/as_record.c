@@ -40,6 +40,9 @@
 
 extern const as_rec_hooks as_record_rec_hooks;
 
+// Smallest arena block. Blocks double in size after that.
+#define AS_RECORD_ARENA_MIN_SIZE 1024
+
 /******************************************************************************
  *	INLINE FUNCTIONS
  *****************************************************************************/
@@ -78,6 +81,7 @@ static as_record * as_record_defaults(as_record * rec, bool free, uint16_t nbins
 
 	rec->gen = 0;
 	rec->ttl = 0;
+	rec->arena = NULL;
 
 	if ( nbins > 0 ) {
 		rec->bins._free = true;
@@ -106,6 +110,11 @@ static as_bin * as_record_bin_forupdate(as_record * rec, const as_bin_name name)
 		return NULL;
 	}
 
+	if ( rec->arena ) {
+		// The new value won't be in the arena.
+		rec->arena->heap_values = true;
+	}
+
 	// look for bin of same name
 	for(int i = 0; i < rec->bins.size; i++) {
 		if ( strcmp(rec->bins.entries[i].name, name) == 0 ) {
@@ -133,9 +142,13 @@ void as_record_release(as_record * rec)
 	if ( rec ) {
 
 		if ( rec->bins.entries ) {
-			for ( int i = 0; i < rec->bins.size; i++ ) {
-				as_val_destroy((as_val *) rec->bins.entries[i].valuep);
-				rec->bins.entries[i].valuep = NULL;
+			// Values in the arena go with it, so the bins only need visiting
+			// if some were allocated elsewhere.
+			if ( ! rec->arena || rec->arena->heap_values ) {
+				for ( int i = 0; i < rec->bins.size; i++ ) {
+					as_val_destroy((as_val *) rec->bins.entries[i].valuep);
+					rec->bins.entries[i].valuep = NULL;
+				}
 			}
 			if ( rec->bins._free ) {
 				free(rec->bins.entries);
@@ -145,6 +158,14 @@ void as_record_release(as_record * rec)
 		rec->bins.capacity = 0;
 		rec->bins.size = 0;
 
+		as_record_arena * block = rec->arena;
+		while ( block ) {
+			as_record_arena * next = block->next;
+			free(block);
+			block = next;
+		}
+		rec->arena = NULL;
+
 		rec->key.ns[0] = '\0';
 		rec->key.set[0] = '\0';
 
@@ -199,6 +220,36 @@ void as_record_destroy(as_record * rec)
  *	VALUE FUNCTIONS
  *****************************************************************************/
 
+void * as_record_arena_alloc(as_record * rec, size_t size) 
+{
+	as_record_arena * block = rec->arena;
+	size_t offset = block ? (block->used + 7) & ~(size_t) 7 : 0;
+
+	if ( ! block || offset + size > block->capacity ) {
+		size_t capacity = block ? (size_t) block->capacity * 2 : AS_RECORD_ARENA_MIN_SIZE;
+		if ( capacity < size ) {
+			capacity = size;
+		}
+		if ( capacity > UINT32_MAX ) {
+			return NULL;
+		}
+
+		as_record_arena * next = (as_record_arena *) malloc(sizeof(as_record_arena) + capacity);
+		if ( ! next ) {
+			return NULL;
+		}
+		next->next = block;
+		next->capacity = (uint32_t) capacity;
+		next->used = 0;
+		next->heap_values = block ? block->heap_values : false;
+		rec->arena = block = next;
+		offset = 0;
+	}
+
+	block->used = (uint32_t) (offset + size);
+	return (uint8_t *) block->data + offset;
+}
+
 /**
  *	Get the number of bins in the record.
  *	@param rec - the record
@@ -381,6 +432,89 @@ bool as_record_set_nil(as_record * rec, const as_bin_name name)
 	return as_record_set(rec, name, (as_bin_value *) &as_nil);
 }
 
+/**
+ *	Take a bin's value out of the record, leaving the bin nil.
+ *	Values the record owns on the heap are moved, others are copied.
+ *	@param rec 	- the record containing the bin
+ *	@param name 	- the name of the bin
+ *	@return the value, owned by the caller, or NULL.
+ */
+as_val * as_record_detach(as_record * rec, const as_bin_name name)
+{
+	as_bin * bin = NULL;
+	for ( int i = 0; i < rec->bins.size; i++ ) {
+		if ( strcmp(rec->bins.entries[i].name, name) == 0 ) {
+			bin = &rec->bins.entries[i];
+			break;
+		}
+	}
+	if ( !bin ) return NULL;
+
+	as_val * val = (as_val *) bin->valuep;
+	as_val * detached = NULL;
+
+	switch ( val ? as_val_type(val) : AS_NIL ) {
+		case AS_NIL: {
+			detached = (as_val *) &as_nil;
+			break;
+		}
+		case AS_INTEGER: {
+			detached = (as_val *) as_integer_new(((as_integer *) val)->value);
+			break;
+		}
+		case AS_STRING: {
+			as_string * s = (as_string *) val;
+			size_t len = as_string_len(s);
+			char * str = s->free ? s->value : (char *) malloc(len + 1);
+			if ( !str ) break;
+			if ( s->free ) {
+				s->free = false;
+			}
+			else {
+				memcpy(str, s->value, len + 1);
+			}
+			detached = (as_val *) as_string_new_wlen(str, len, true);
+			break;
+		}
+		case AS_BYTES: {
+			as_bytes * b = (as_bytes *) val;
+			uint8_t * bytes = b->free ? b->value : (uint8_t *) malloc(b->size);
+			if ( !bytes && b->size ) break;
+			if ( b->free ) {
+				b->free = false;
+			}
+			else if ( b->size ) {
+				memcpy(bytes, b->value, b->size);
+			}
+			as_bytes * copy = as_bytes_new_wrap(bytes, b->size, true);
+			if ( copy ) {
+				copy->type = b->type;
+			}
+			detached = (as_val *) copy;
+			break;
+		}
+		default: {
+			// Lists and maps are always allocated on their own.
+			if ( val->free ) {
+				detached = val;
+				val = NULL;
+			}
+			break;
+		}
+	}
+
+	if ( !detached ) return NULL;
+
+	if ( val ) {
+		as_val_destroy(val);
+	}
+
+	as_bin_name bin_name;
+	strcpy(bin_name, bin->name);
+	as_bin_init_nil(bin, bin_name);
+	return detached;
+}
+
 /******************************************************************************
  *	GETTER FUNCTIONS
  *****************************************************************************/
@@ -39,6 +39,7 @@
 #include <citrusleaf/cf_atomic.h>
 #include <citrusleaf/cf_hist.h>
 #include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cf_random.h>
 #include <citrusleaf/cf_socket.h>
 
 #include <citrusleaf/citrusleaf.h>
@@ -49,6 +50,9 @@
 // This is a per-transaction deadline kind of thing
 #define DEFAULT_TIMEOUT 200
 
+// Retry backoff stops doubling after this many retries.
+#define CL_RETRY_BACKOFF_MAX_SHIFT 6
+
 // #define DEBUG_HISTOGRAM 1 // histogram printed in citrusleaf_print_stats()
 // #define DEBUG 1
 // #define DEBUG_VERBOSE 1
@@ -60,13 +64,13 @@
 
 #ifdef DEBUG_TIME
 static void debug_printf(long before_write_time, long after_write_time, long before_read_header_time, long after_read_header_time, 
-		long before_read_body_time, long after_read_body_time, long deadline_ms, int progress_timeout_ms)
+		long before_read_body_time, long after_read_body_time, uint64_t deadline_ns, uint64_t progress_ns)
 {
-	cf_info("tid %zu - Before Write - deadline %"PRIu64" progress_timeout %d now is %"PRIu64, (uint64_t)pthread_self(), deadline_ms, progress_timeout_ms, before_write_time);
+	cf_info("tid %zu - Before Write - deadline %"PRIu64" progress_timeout %"PRIu64" now is %"PRIu64, (uint64_t)pthread_self(), deadline_ns, progress_ns, before_write_time);
 	cf_info("tid %zu - After Write - now is %"PRIu64, (uint64_t)pthread_self(), after_write_time);
-	cf_info("tid %zu - Before Read header - deadline %"PRIu64" progress_timeout %d now is %"PRIu64, (uint64_t)pthread_self(), deadline_ms, progress_timeout_ms, before_read_header_time);
+	cf_info("tid %zu - Before Read header - deadline %"PRIu64" progress_timeout %"PRIu64" now is %"PRIu64, (uint64_t)pthread_self(), deadline_ns, progress_ns, before_read_header_time);
 	cf_info("tid %zu - After Read header - now is %"PRIu64, (uint64_t)pthread_self(), after_read_header_time);
-	cf_info("tid %zu - Before Read body - deadline %"PRIu64" progress_timeout %d now is %"PRIu64, (uint64_t)pthread_self(), deadline_ms, progress_timeout_ms, before_read_body_time);
+	cf_info("tid %zu - Before Read body - deadline %"PRIu64" progress_timeout %"PRIu64" now is %"PRIu64, (uint64_t)pthread_self(), deadline_ns, progress_ns, before_read_body_time);
 	cf_info("tid %zu - After Read body - now is %"PRIu64, (uint64_t)pthread_self(), after_read_body_time);
 }
 #endif
@@ -692,9 +696,11 @@ cl_object_get_size(cl_object *obj, size_t *sz)
 }
 
 // Lay an C structure bin into network order operation
+// If copy_value is false, op_sz covers the value but the value itself is left
+// for the caller to send from where it is.
 
-int
-cl_value_to_op(cl_bin *v, cl_operator operator, cl_operation *operation, cl_msg_op *op)
+static int
+value_to_op(cl_bin *v, cl_operator operator, cl_operation *operation, cl_msg_op *op, bool copy_value)
 {
 	cl_bin *bin = v?v:&operation->bin;
 	int	bin_len = (int)strlen(bin->bin_name);
@@ -760,7 +766,9 @@ cl_value_to_op(cl_bin *v, cl_operator operator, cl_operation *operation, cl_msg_
 			break;
 		case CL_STR:
 			op->op_sz += tmpValue->object.sz;
-			memcpy(data, tmpValue->object.u.str, tmpValue->object.sz);
+			if (copy_value) {
+				memcpy(data, tmpValue->object.u.str, tmpValue->object.sz);
+			}
 			break;
 		case CL_LIST:
 		case CL_MAP:
@@ -775,7 +783,9 @@ cl_value_to_op(cl_bin *v, cl_operator operator, cl_operation *operation, cl_msg_
 				op->op_sz += value_to_op_two_ints(tmpValue->object.u.blob, data);
 			} else {
 				op->op_sz += tmpValue->object.sz;
-				memcpy(data, tmpValue->object.u.blob, tmpValue->object.sz);
+				if (copy_value) {
+					memcpy(data, tmpValue->object.u.blob, tmpValue->object.sz);
+				}
 			}
 			break;
 		default:
@@ -787,6 +797,57 @@ cl_value_to_op(cl_bin *v, cl_operator operator, cl_operation *operation, cl_msg_
 	return(0);
 }
 
+int
+cl_value_to_op(cl_bin *v, cl_operator operator, cl_operation *operation, cl_msg_op *op)
+{
+	return value_to_op(v, operator, operation, op, true);
+}
+
+bool
+cl_gather_check(const cl_gather *gather, int n_refs, size_t sz)
+{
+	return gather && gather->threshold != 0 && n_refs < CL_GATHER_MAX_VALUES && sz >= gather->threshold;
+}
+
+void
+cl_gather_ref(cl_gather *gather, uint8_t **seg, uint8_t *value_p, const void *value, size_t sz)
+{
+	// the buffer up to the value, then the value from where it is
+	gather->iov[gather->n_iov].iov_base = *seg;
+	gather->iov[gather->n_iov].iov_len = value_p - *seg;
+	gather->n_iov++;
+	gather->iov[gather->n_iov].iov_base = (void *) value;
+	gather->iov[gather->n_iov].iov_len = sz;
+	gather->n_iov++;
+	*seg = value_p;
+}
+
+// Should this bin value be sent from the caller's memory rather than copied
+// into the request buffer? Only large string and blob values are worth it.
+static bool
+gather_value(const cl_gather *gather, int n_refs, const cl_bin *v, cl_operator operator)
+{
+	if (! cl_gather_check(gather, n_refs, v->object.sz) || operator == CL_OP_MC_INCR) {
+		return false;
+	}
+
+	switch (v->object.type) {
+		case CL_STR:
+		case CL_LIST:
+		case CL_MAP:
+		case CL_BLOB:
+		case CL_JAVA_BLOB:
+		case CL_CSHARP_BLOB:
+		case CL_PYTHON_BLOB:
+		case CL_RUBY_BLOB:
+		case CL_PHP_BLOB:
+		case CL_LUA_BLOB:
+			return true;
+		default:
+			return false;
+	}
+}
+
 int
 cl_object_to_buf (cl_object *obj, uint8_t *data)
 {
@@ -825,13 +886,19 @@ cl_object_to_buf (cl_object *obj, uint8_t *data)
 // n_values can be passed in 0, and then values is undefined / probably 0.
 //
 // The DIGEST is filled *in* by this function - should be passed in uninitialized
+//
+// If gather is set, large values are not copied into the buffer - gather->iov
+// is filled in to describe the whole message, and *buf_sz_r is only the size
+// of the part in the buffer.
+//
+// If *buf_r is NULL, the buffer is one of the thread's I/O buffers.
 
 
-int
-cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
-	cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,  
+static int
+compile(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
+	cl_bin *values, cl_operator operator, cl_operation *operations, int n_values, cl_ops_encoder *encoder,
 	uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret, uint64_t trid, cl_scan_param_field *scan_param_field, as_call * call, 
-	uint8_t udf_type)
+	uint8_t udf_type, cl_gather *gather)
 {
 	// I hate strlen
 	int		ns_len = ns ? (int)strlen(ns) : 0;
@@ -857,12 +924,25 @@ cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set,
 	if (udf_type) msg_sz += sizeof(cl_msg_field) + sizeof(udf_type);
 
 	// ops
-	for (i=0;i<n_values;i++) {
+	size_t	gather_sz = 0;
+	int		n_refs = 0;
+
+	if (encoder) {
+		n_values = encoder->n_ops;
+		if (0 != encoder->size(encoder, gather, &msg_sz, &gather_sz)) {
+			cf_error("illegal parameter: bad bin value");
+			return(-1);
+		}
+	}
+
+	for (i=0;i<n_values && ! encoder;i++) {
 		cl_bin *tmpValue = 0;
+		cl_operator tmpOp = operator;
 		if( values ){
 			tmpValue = &values[i];
 		}else if( operations ){
 			tmpValue = &operations[i].bin;
+			tmpOp = operations[i].op;
 		}
 		
 		msg_sz += sizeof(cl_msg_op) + strlen(tmpValue->bin_name);
@@ -871,23 +951,44 @@ cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set,
 			cf_error("illegal parameter: bad type %d write op %d", tmpValue->object.type,i);
 			return(-1);
 		}
+
+		if (gather_value(gather, n_refs, tmpValue, tmpOp)) {
+			gather_sz += tmpValue->object.sz;
+			n_refs++;
+		}
 	}
+
+	// referenced values don't need space in the buffer
+	size_t	buf_sz = msg_sz - gather_sz;
 	
 	// size too small? malloc!
 	uint8_t	*buf;
 	uint8_t *mbuf = 0;
-	if ((*buf_r) && (msg_sz > *buf_sz_r)) {
-		mbuf = buf = malloc(msg_sz);
+	bool	iobuf = ! *buf_r;
+	if (iobuf) {
+		size_t capacity;
+		buf = as_io_buffer_get(buf_sz, &capacity);
+		if (!buf) 			return(-1);
+		*buf_r = buf;
+	}
+	else if (buf_sz > *buf_sz_r) {
+		mbuf = buf = malloc(buf_sz);
 		if (!buf) 			return(-1);
 		*buf_r = buf;
 	}
 	else
 		buf = *buf_r;
 	
-	*buf_sz_r = msg_sz;
+	*buf_sz_r = buf_sz;
 	
 	// debug - shouldn't be required
-	memset(buf, 0, msg_sz);
+	memset(buf, 0, buf_sz);
+
+	uint8_t *seg = buf;	// start of the buffer not yet in gather->iov
+	uint8_t *buf_end = buf + buf_sz;
+	if (gather) {
+		gather->n_iov = 0;
+	}
 	
 	// lay in some parameters
 	uint32_t generation = 0;
@@ -917,7 +1018,8 @@ cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set,
 	}
 	
 	uint32_t record_ttl = cl_w_p ? cl_w_p->record_ttl : 0;
-	uint32_t transaction_ttl = cl_w_p ? cl_w_p->timeout_ms : 0;
+	// The server's timeout is in milliseconds - round up.
+	uint32_t transaction_ttl = (uint32_t)((cl_write_parameters_timeout_us(cl_w_p) + 999) / 1000);
 
 	// lay out the header
 	int n_fields = ( ns ? 1 : 0 ) + (set ? 1 : 0) + (key ? 1 : 0) + (digest ? 1 : 0) + (trid ? 1 : 0) + (scan_param_field ? 1 : 0) + (call ? 3 : 0) + (udf_type ? 1 : 0); 
@@ -927,28 +1029,83 @@ cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set,
 	buf = write_fields(buf, ns, ns_len, set, set_len, key, digest, d_ret, trid,scan_param_field, call, udf_type);
 	if (!buf) {
 		if (mbuf)	free(mbuf);
+		if (iobuf) {
+			as_io_buffer_put(*buf_r);
+			*buf_r = NULL;
+		}
 		return(-1);
 	}
 
 	// lay out the ops
-	if (n_values) {
+	if (encoder) {
+		encoder->write(encoder, buf, gather, &seg);
+	}
+	else if (n_values) {
 		cl_msg_op *op = (cl_msg_op *) buf;
 		cl_msg_op *op_tmp;
+		n_refs = 0;
 		for (i = 0; i< n_values;i++) {
+			cl_bin *tmpValue = values ? &values[i] : &operations[i].bin;
+			cl_operator tmpOp = values ? operator : operations[i].op;
+			bool ref = gather_value(gather, n_refs, tmpValue, tmpOp);
+
 			if( values ) {
-				cl_value_to_op( &values[i], operator, NULL, op);
+				value_to_op( &values[i], operator, NULL, op, ! ref);
 			}else if (operations) {
-				cl_value_to_op( NULL, 0, &operations[i], op);
+				value_to_op( NULL, 0, &operations[i], op, ! ref);
 			}
 	
-			op_tmp = cl_msg_op_get_next(op);
+			if (ref) {
+				uint8_t *value_p = cl_msg_op_get_value_p(op);
+				cl_gather_ref(gather, &seg, value_p, tmpValue->object.u.blob, tmpValue->object.sz);
+				n_refs++;
+				op_tmp = (cl_msg_op *) value_p;
+			}
+			else {
+				op_tmp = cl_msg_op_get_next(op);
+			}
 			cl_msg_swap_op_to_be(op);
 			op = op_tmp;
 		}
 	}
+
+	if (gather && buf_end > seg) {
+		gather->iov[gather->n_iov].iov_base = seg;
+		gather->iov[gather->n_iov].iov_len = buf_end - seg;
+		gather->n_iov++;
+	}
 	return(0);	
 }
 
+int
+cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
+	cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,  
+	uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret, uint64_t trid, cl_scan_param_field *scan_param_field, as_call * call, 
+	uint8_t udf_type)
+{
+	return compile(info1, info2, info3, ns, set, key, digest, values, operator, operations, n_values, NULL,
+		buf_r, buf_sz_r, cl_w_p, d_ret, trid, scan_param_field, call, udf_type, NULL);
+}
+
+int
+cl_compile_gather(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
+	cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,  
+	uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret, uint64_t trid, as_call * call,
+	cl_gather *gather)
+{
+	return compile(info1, info2, info3, ns, set, key, digest, values, operator, operations, n_values, NULL,
+		buf_r, buf_sz_r, cl_w_p, d_ret, trid, NULL, call, 0, gather);
+}
+
+int
+cl_compile_ops(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
+	cl_ops_encoder *encoder, uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret,
+	cl_gather *gather)
+{
+	return compile(info1, info2, info3, ns, set, key, digest, NULL, 0, NULL, 0, encoder,
+		buf_r, buf_sz_r, cl_w_p, d_ret, 0, NULL, NULL, 0, gather);
+}
+
 // A special version that compiles for a list of multiple digests instead of a single
 // 
 
@@ -1266,6 +1423,134 @@ cl_parse(cl_msg *msg, uint8_t *buf, size_t buf_len, cl_bin **values_r, cl_operat
 	return(0);
 }
 
+//
+// Errors from a socket the server has closed - socket reads report the
+// server's close as EBADF.
+//
+static inline bool
+cl_conn_closed(int rv)
+{
+	return rv == EBADF || rv == ECONNRESET || rv == EPIPE;
+}
+
+//
+// Back off before retrying a transaction that has made try attempts. The sleep
+// starts at sleep_ms and doubles with every retry, with jitter so threads that
+// failed together don't retry together. Never sleeps past the deadline - return
+// false if the deadline has passed, or would have by the time the sleep ends.
+//
+static bool
+cl_retry_sleep(uint32_t sleep_ms, int try, uint64_t deadline_ns)
+{
+	uint64_t sleep_us = 0;
+
+	if (sleep_ms) {
+		int shift = try - 1 < CL_RETRY_BACKOFF_MAX_SHIFT ? try - 1 : CL_RETRY_BACKOFF_MAX_SHIFT;
+		uint64_t backoff_us = ((uint64_t)sleep_ms * 1000) << shift;
+
+		// Sleep between half and all of the backoff.
+		sleep_us = backoff_us / 2 + cf_get_rand32() % (backoff_us / 2 + 1);
+	}
+
+	if (deadline_ns) {
+		uint64_t now = cf_socket_getns();
+
+		if (now >= deadline_ns || sleep_us * 1000 >= deadline_ns - now) {
+			return false;
+		}
+	}
+
+	if (sleep_us) {
+		usleep((useconds_t)sleep_us);
+	}
+	return true;
+}
+
+//
+// Hedged read - if the node hasn't started to respond within the hedge delay,
+// send the request to the partition's other replica as well, and keep
+// whichever connection responds first. The other connection is closed rather
+// than pooled, since its response may still be on the way.
+//
+// Waiting is bounded by the attempt's share of the timeout, counted from
+// *attempt_ns_r, so an attempt neither replica answers in time can be retried.
+//
+// On return *node_r and *fd_r are the connection to read the response from,
+// and *attempt_ns_r is when the request was sent on it. If fastest is set, the
+// nodes' latencies are tracked across the switch. Return 1 if that is
+// now the other replica's, -1 if neither replica responded within the
+// attempt, otherwise 0.
+//
+static int
+cl_hedge_read(as_cluster *asc, const char *ns, const cf_digest *d, uint8_t *wr_buf, size_t wr_buf_sz,
+	uint32_t hedge_ms, uint64_t deadline_ns, uint64_t progress_ns, as_node **node_r, int *fd_r,
+	uint64_t *attempt_ns_r, bool fastest)
+{
+	uint64_t hedge_deadline = cf_socket_getns() + (uint64_t)hedge_ms * 1000000;
+	uint64_t attempt_deadline = *attempt_ns_r + progress_ns;
+
+	if (deadline_ns && deadline_ns < attempt_deadline) {
+		attempt_deadline = deadline_ns;
+	}
+
+	// Not worth hedging if the attempt would time out first.
+	if (hedge_deadline >= attempt_deadline) {
+		return 0;
+	}
+
+	if (cf_socket_wait_readable(fd_r, 1, hedge_deadline) == 0) {
+		return 0;
+	}
+
+	as_node *other = as_node_get_other(asc, ns, d, *node_r);
+
+	if (! other) {
+		return 0;
+	}
+
+	int fd = as_node_fd_get(other);
+
+	if (fd == -1) {
+		as_node_release(other);
+		return 0;
+	}
+
+	uint64_t hedge_ns = cf_socket_getns();
+
+	if (cf_socket_write_timeout_ns(fd, wr_buf, wr_buf_sz, deadline_ns, progress_ns) != 0) {
+		cf_close(fd);
+		as_node_release(other);
+		return 0;
+	}
+
+	ck_pr_inc_64(&asc->hedge_stats.issued);
+
+	int fds[2] = { *fd_r, fd };
+	int ready = cf_socket_wait_readable(fds, 2, attempt_deadline);
+
+	if (ready != 1) {
+		// The first node responded first, or neither did in time.
+		cf_close(fd);
+		as_node_release(other);
+		return ready == 0 ? 0 : -1;
+	}
+
+	ck_pr_inc_64(&asc->hedge_stats.won);
+
+	if (fastest) {
+		// The first node's response time is at least this long.
+		as_node_attempt_end(*node_r, cf_socket_getns() - *attempt_ns_r);
+		as_node_attempt_begin(other);
+	}
+
+	cf_close(*fd_r);
+	as_node_release(*node_r);
+	*node_r = other;
+	*fd_r = fd;
+	*attempt_ns_r = hedge_ns;
+	return 1;
+}
+
 
 //
 // Omnibus (!beep!! !beep!!) internal function that the externals can map to
@@ -1278,11 +1563,17 @@ cl_parse(cl_msg *msg, uint8_t *buf, size_t buf_len, cl_bin **values_r, cl_operat
 // EITHER set + key must be set, or digest must be set! not both!
 //
 // Similarly, either values or operations must be set, but not both.
+//
+// If parse is set, it decodes a successful response in place of cl_parse().
+//
+// If compiled is set, the request has already been compiled - only the
+// digest and namespace are used, to find the node.
 
-int
-do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *ns, const char *set, const cl_object *key,
+static int
+full_monte(as_cluster *asc, int info1, int info2, int info3, const char *ns, const char *set, const cl_object *key,
 	const cf_digest *digest, cl_bin **values, cl_operator operator, cl_operation **operations, int *n_values, 
-	uint32_t *cl_gen, const cl_write_parameters *cl_w_p, uint64_t *trid, char **setname_r, as_call * call, uint32_t* cl_ttl)
+	uint32_t *cl_gen, const cl_write_parameters *cl_w_p, uint64_t *trid, char **setname_r, as_call * call, uint32_t* cl_ttl,
+	cl_ops_encoder *encoder, cl_compiled *compiled, cl_parse_fn parse, void *parse_udata)
 {
 	int rv = -1;
 #ifdef DEBUG_HISTOGRAM	
@@ -1290,21 +1581,24 @@ do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *
 #endif	
 	
 
-	uint8_t		rd_stack_buf[STACK_BUF_SZ];	
-	uint8_t		*rd_buf = rd_stack_buf;
+	// The request is compiled into, and the response read into, the thread's
+	// I/O buffers, which are kept at the size of the largest record seen.
+	cl_recv_buf	rb;
+	cl_proto	*proto;
+	uint8_t		*rd_buf = 0;
 	size_t		rd_buf_sz = 0;
     
-	uint8_t		wr_stack_buf[STACK_BUF_SZ];
-	uint8_t		*wr_buf = wr_stack_buf;
-	size_t		wr_buf_sz = sizeof(wr_stack_buf);
+	uint8_t		*wr_buf = NULL;
+	size_t		wr_buf_sz = 0;
 
-	as_msg 		msg;
+	as_msg 		*msg = 0;
     
-    uint        progress_timeout_ms;
-	uint64_t deadline_ms;
+	uint64_t	progress_ns;
+	uint64_t	deadline_ns;
 	as_node *node = 0;
 	
 	int fd = -1;
+	bool unchecked = false;
 
 //	if( *values ){
 //		dump_values(*values, null, *n_values);
@@ -1312,14 +1606,32 @@ do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *
 //		dump_values(null, *operations, *n_values);
 //	}	
 
+	// Large values are sent straight from the caller's bins.
+	cl_gather	gather;
+	gather.threshold = asc->write_gather_threshold;
+
+	cl_recv_buf_init(&rb, NULL, 0);
+
 	cf_digest d_ret;	
-	if (n_values && ( values || operations) ){
-		if (cl_compile(info1, info2, info3, ns, set, key, digest, values?*values:NULL, operator, operations?*operations:NULL,
-				*n_values , &wr_buf, &wr_buf_sz, cl_w_p, &d_ret, *trid, NULL, call, 0 /* udf_type */)) {
+	if (compiled) {
+		// The buffer is ours to give back.
+		wr_buf = compiled->buf;
+		wr_buf_sz = compiled->buf_sz;
+		d_ret = *digest;
+		gather.n_iov = 0;
+	}
+	else if (encoder) {
+		if (cl_compile_ops(info1, info2, info3, ns, set, key, digest, encoder, &wr_buf, &wr_buf_sz, cl_w_p, &d_ret, &gather)) {
+			return(rv);
+		}
+	}
+	else if (n_values && ( values || operations) ){
+		if (cl_compile_gather(info1, info2, info3, ns, set, key, digest, values?*values:NULL, operator, operations?*operations:NULL,
+				*n_values , &wr_buf, &wr_buf_sz, cl_w_p, &d_ret, *trid, call, &gather)) {
 			return(rv);
 		}
 	}else{
-		if (cl_compile(info1, info2, info3, ns, set, key, digest, 0, 0, 0, 0, &wr_buf, &wr_buf_sz, cl_w_p, &d_ret, *trid, NULL, call, 0 /*udf_type*/)) {
+		if (cl_compile_gather(info1, info2, info3, ns, set, key, digest, 0, 0, 0, 0, &wr_buf, &wr_buf_sz, cl_w_p, &d_ret, *trid, call, &gather)) {
 			return(rv);
 		}
 	}	
@@ -1339,26 +1651,46 @@ do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *
     uint64_t after_read_body_time = 0;	
 #endif
 
-    deadline_ms = 0;
-    progress_timeout_ms = 0;
-    if (cl_w_p && cl_w_p->timeout_ms) {
-    	// policy: if asking for a long timeout, give enough time to try two servers
-    	if (cl_w_p->timeout_ms > 700 && cl_w_p->w_pol == CL_WRITE_RETRY) {
-			deadline_ms = cf_getms() + cl_w_p->timeout_ms;
-			progress_timeout_ms = cl_w_p->timeout_ms / 2;
-		}
-		else {
-			deadline_ms = cf_getms() + cl_w_p->timeout_ms;
-			progress_timeout_ms = cl_w_p->timeout_ms;
-		}
-#ifdef DEBUG_VERBOSE        
-        cf_debug("transaction has deadline: in %d deadlinems %"PRIu64" progress %d",
-        	(int)cl_w_p->timeout_ms,deadline_ms,progress_timeout_ms);
-#endif        
-    }
-    else {
-        progress_timeout_ms = DEFAULT_PROGRESS_TIMEOUT;
-    }
+	// Retries are bounded by the cluster's retry policy as well as the
+	// deadline - one-shot writes are never retried.
+	uint32_t max_retries = (cl_w_p && cl_w_p->w_pol == CL_WRITE_ONESHOT) ? 0 : asc->max_retries;
+
+	// Deadlines are kept in nanoseconds so budgets of a millisecond or less
+	// work, and socket waits sleep until exactly the deadline.
+	uint64_t timeout_us = cl_write_parameters_timeout_us(cl_w_p);
+
+	deadline_ns = 0;
+	if (timeout_us) {
+		// policy: give each attempt an equal share of the timeout, so there's
+		// time to try another server
+		deadline_ns = cf_socket_getns() + timeout_us * 1000;
+		progress_ns = timeout_us * 1000 / (max_retries + 1);
+#ifdef DEBUG_VERBOSE
+		cf_debug("transaction has deadline: in %"PRIu64"us deadline %"PRIu64"ns progress %"PRIu64"ns",
+			timeout_us, deadline_ns, progress_ns);
+#endif
+	}
+	else {
+		progress_ns = DEFAULT_PROGRESS_TIMEOUT * 1000000ULL;
+	}
+
+	bool read = (info1 & CL_MSG_INFO1_READ) && ! (info2 & CL_MSG_INFO2_WRITE);
+
+	// Reads may be hedged against the partition's other replica.
+	uint32_t hedge_ms = 0;
+	if (cl_w_p && cl_w_p->hedge_delay_ms && read && gather.n_iov <= 1) {
+		hedge_ms = cl_w_p->hedge_delay_ms;
+	}
+
+	// Reads may go to whichever replica has been responding faster.
+	bool fastest = read && cl_w_p && cl_w_p->read_fastest;
+
+	// Reads are retried on the other replica of a node that failed.
+	as_node *retry_node = 0;
+
+	// When the request was sent to node, 0 if it hasn't been or the attempt
+	// isn't timed.
+	uint64_t attempt_ns = 0;
 	
 	// retry request based on the write_policy
 	do {
@@ -1379,20 +1711,29 @@ do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *
 		try++;
 		
 		// Get an FD from a cluster
-		node = as_node_get(asc, ns, &d_ret, info2 & CL_MSG_INFO2_WRITE ? true : false);
+		if (retry_node) {
+			node = retry_node;
+			retry_node = 0;
+		}
+		else if (fastest) {
+			node = as_node_get_fastest(asc, ns, &d_ret);
+		}
+		else {
+			node = as_node_get(asc, ns, &d_ret, info2 & CL_MSG_INFO2_WRITE ? true : false);
+		}
 		if (!node) {
 #ifdef DEBUG_VERBOSE
 			cf_debug("warning: no healthy nodes in cluster, retrying");
 #endif
-			usleep(10000);
+			rv = CITRUSLEAF_FAIL_CLIENT;
 			goto Retry;
 		}
-		fd = as_node_fd_get(node);
+		fd = as_node_fd_get_unchecked(node, &unchecked);
 		if (fd == -1) {
 #ifdef DEBUG_VERBOSE			
 			cf_debug("warning: node %s has no file descriptors, retrying transaction (tid %zu)", node->name, (uint64_t)pthread_self());
 #endif			
-			usleep(1000);
+			rv = CITRUSLEAF_FAIL_CLIENT;
 			goto Retry;
 		}
 
@@ -1406,15 +1747,32 @@ do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *
 			as_msg *msgp = (as_msg *)wr_buf;
 			msgp->m.info1 &= ~CL_MSG_INFO1_VERIFY;
 		}
+
+		// Time the attempt - a reconnect is part of it. The node's latency
+		// is only tracked for reads that choose replicas by it, so other
+		// commands don't write to the shared node.
+		if (fastest) {
+			as_node_attempt_begin(node);
+			attempt_ns = cf_socket_getns();
+		}
+		else if (hedge_ms) {
+			attempt_ns = cf_socket_getns();
+		}
 		
 		// send it to the cluster - non blocking socket, but we're blocking
+Send:
 
 #ifdef DEBUG_TIME
-        before_write_time = cf_getms();
+        before_write_time = cf_socket_getns();
 #endif
-		rv = cf_socket_write_timeout(fd, wr_buf, wr_buf_sz, deadline_ms, progress_timeout_ms);
+		if (gather.n_iov > 1) {
+			rv = cf_socket_writev_timeout_ns(fd, gather.iov, gather.n_iov, deadline_ns, progress_ns);
+		}
+		else {
+			rv = cf_socket_write_timeout_ns(fd, wr_buf, wr_buf_sz, deadline_ns, progress_ns);
+		}
 #ifdef DEBUG_TIME
-        after_write_time = cf_getms();
+        after_write_time = cf_socket_getns();
 #endif
 
 		if (rv != 0) {
@@ -1423,95 +1781,101 @@ do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *
 #endif
 #ifdef DEBUG_TIME
             debug_printf(before_write_time, after_write_time, before_read_header_time, after_read_header_time, before_read_body_time, after_read_body_time,
-                         deadline_ms, progress_timeout_ms);           	
+                         deadline_ns, progress_ns);           	
 #endif
 
+			if (unchecked && cl_conn_closed(rv)) {
+				goto Reconnect;
+			}
 			goto Retry;
 		}
 
-#ifdef DEBUG_VERBOSE		
-		memset(&msg, 0, sizeof(as_msg));
-#endif
 #ifdef DEBUG_TIME
-        before_read_header_time = cf_getms();
+        before_read_header_time = cf_socket_getns();
 #endif		
+
+		if (hedge_ms) {
+			int hedged = cl_hedge_read(asc, ns, &d_ret, wr_buf, wr_buf_sz, hedge_ms, deadline_ns,
+					progress_ns, &node, &fd, &attempt_ns, fastest);
+
+			if (hedged < 0) {
+				// The attempt's time is up - same as the read timing out.
+				rv = ETIMEDOUT;
+				goto Retry;
+			}
+
+			if (hedged) {
+				// The other replica's connection was checked when taken.
+				unchecked = false;
+			}
+		}
 		
-		// Now turn around and read into this fine cl_msg, which is the short header
-		rv = cf_socket_read_timeout(fd, (uint8_t *) &msg, sizeof(as_msg), deadline_ms, progress_timeout_ms);
+		// Now turn around and read the response. Header and body are read
+		// together - a small response typically takes a single read.
+		cl_recv_buf_reset(&rb);
+		rv = cl_recv_proto(&rb, fd, deadline_ns, progress_ns, &proto);
 #ifdef DEBUG_TIME
-        after_read_header_time = cf_getms();
+        after_read_header_time = cf_socket_getns();
 #endif
 
+		if (rv == 0 && proto->sz < sizeof(cl_msg)) {
+			cf_warn("received message too short for header: %zu bytes", (size_t)proto->sz);
+			rv = EPROTO;
+		}
+
 		if (rv) {
 
 #ifdef DEBUG_VERBOSE            
-			cf_debug("Citrusleaf: error when reading header from server - rv %d fd %d", rv, fd);
+			cf_debug("Citrusleaf: error when reading response from server - rv %d fd %d", rv, fd);
 #endif
 #ifdef DEBUG_TIME
             debug_printf(before_write_time, after_write_time, before_read_header_time, after_read_header_time, before_read_body_time, after_read_body_time,
-                         deadline_ms, progress_timeout_ms);           	
+                         deadline_ns, progress_ns);           	
 #endif            
 
+			if (unchecked && rb.end == 0 && cl_conn_closed(rv)) {
+				goto Reconnect;
+			}
 			goto Retry;
 	
 		}
+
+		msg = (as_msg *) proto;
 #ifdef DEBUG_VERBOSE
-		dump_buf("read header from cluster", (uint8_t *) &msg, sizeof(cl_msg));
+		dump_buf("read header from cluster", (uint8_t *) &msg->m, sizeof(cl_msg));
 #endif	
-		cl_proto_swap_from_be(&msg.proto);
-		cl_msg_swap_header_from_be(&msg.m);
+		cl_msg_swap_header_from_be(&msg->m);
 
 		if (/*(info1 & CL_MSG_INFO1_READ) &&*/ cl_gen) {
-			*cl_gen = msg.m.generation;
+			*cl_gen = msg->m.generation;
 		}
 
 		if (cl_ttl) {
-			*cl_ttl = cf_server_void_time_to_ttl(msg.m.record_ttl);
+			*cl_ttl = cf_server_void_time_to_ttl(msg->m.record_ttl);
 		}
 
-		// second read for the remainder of the message - expect this to cover everything requested
+		// the remainder of the message - expect this to cover everything requested
 		// if there's no error
-		rd_buf_sz =  msg.proto.sz  - msg.m.header_sz;
-		if (rd_buf_sz > 0) {
-			if (rd_buf_sz > sizeof(rd_stack_buf)) {
-				rd_buf = malloc(rd_buf_sz);
-				if (!rd_buf) {
-                    cf_error("malloc fail: trying %zu", rd_buf_sz);
-                    rv = -1; 
-                    goto Error; 
-                }
-			}
-#ifdef DEBUG_TIME
-        before_read_body_time = cf_getms();
-#endif            
-			rv = cf_socket_read_timeout(fd, rd_buf, rd_buf_sz, deadline_ms, progress_timeout_ms);
-#ifdef DEBUG_TIME
-        after_read_body_time = cf_getms();
-#endif
-			if (rv) {
-				if (rd_buf != rd_stack_buf) { free(rd_buf); }
-                rd_buf = 0;
-                
-#ifdef DEBUG_VERBOSE            
-                cf_debug("Citrusleaf: error when reading from server - rv %d fd %d", rv, fd);
-#endif
-#ifdef DEBUG_TIME
-				debug_printf(before_write_time, after_write_time, before_read_header_time, after_read_header_time, before_read_body_time, after_read_body_time, 
-                             deadline_ms, progress_timeout_ms);           	
-#endif
-
-				goto Retry;
-			}
+		rd_buf = (uint8_t *) msg + sizeof(as_msg);
+		rd_buf_sz =  msg->proto.sz  - msg->m.header_sz;
 
 #ifdef DEBUG_VERBOSE
-			dump_buf("read body from cluster", rd_buf, rd_buf_sz);
+		dump_buf("read body from cluster", rd_buf, rd_buf_sz);
 #endif	
-			
-			// todo: check error!!?!?!
-		}
 
         goto Ok;
 		
+Reconnect:
+		// The pooled socket was handed out unchecked and the server had
+		// already closed it, so the request wasn't processed. Send it once
+		// more on a fresh connection to the same node - this isn't a retry.
+		cf_close(fd);
+		unchecked = false;
+		fd = as_node_fd_create(node);
+		if (fd != -1) {
+			goto Send;
+		}
+
 Retry:		
 
 		if (fd != -1) {
@@ -1519,50 +1883,85 @@ Retry:
 			fd = -1;
 		}
 
+		if (fastest && attempt_ns) {
+			// Failures count as taking until now, so a node that times out
+			// looks slow.
+			as_node_attempt_end(node, cf_socket_getns() - attempt_ns);
+		}
+		attempt_ns = 0;
+
 		if (node) {
+			if (read && try <= max_retries) {
+				retry_node = as_node_get_other(asc, ns, &d_ret, node);
+			}
             as_node_release(node);
             node = 0; 
         }
 
-        if (deadline_ms && (deadline_ms < cf_getms() ) ) {
+		if (try > max_retries) {
+#ifdef DEBUG_VERBOSE
+			cf_debug("out of retries: tries %d rv %d", try, rv);
+#endif
+			// The last attempt failed with an errno from the socket layer -
+			// report that as a timeout, as running out of time would be.
+			if (rv > 0) {
+				rv = CITRUSLEAF_FAIL_TIMEOUT;
+			}
+			goto Error;
+		}
+
+        if (! cl_retry_sleep(asc->retry_sleep_ms, try, deadline_ns)) {
 #ifdef DEBUG_VERBOSE            
             cf_debug("out of luck out of time : deadline %"PRIu64" now %"PRIu64,
-                deadline_ms, cf_getms());
+                deadline_ns, cf_socket_getns());
 #endif            
             rv = CITRUSLEAF_FAIL_TIMEOUT;
             goto Error;
         }
 		
-	} while ( (cl_w_p == 0) || (cl_w_p->w_pol == CL_WRITE_RETRY) );
+	} while (true);
 	
 Error:	
+
+	if (retry_node) {
+		as_node_release(retry_node);
+	}
 	
 #ifdef DEBUG_VERBOSE	
 	cf_debug("exiting with failure: wpol %d timeleft %d rv %d",
 		(int)(cl_w_p ? cl_w_p->w_pol : 0),
-		(int)(deadline_ms - cf_getms() ), rv );
+		(int)((int64_t)(deadline_ns - cf_socket_getns()) / 1000000), rv );
 #endif	
 
     if (fd != -1)   cf_close(fd);
 
-	if (wr_buf != wr_stack_buf)		free(wr_buf);
-	if (rd_buf && (rd_buf != rd_stack_buf))		free(rd_buf);
+	as_io_buffer_put(wr_buf);
+	cl_recv_buf_destroy(&rb);
 	
 	return(rv);
     
 Ok:    
 
+	if (fastest) {
+		as_node_attempt_end(node, cf_socket_getns() - attempt_ns);
+	}
     as_node_fd_put(node, fd);
 	as_node_release(node);
    
-	if (wr_buf != wr_stack_buf)		free(wr_buf);
+	as_io_buffer_put(wr_buf);
 
-	if (rd_buf) {
-		if (0 != cl_parse(&msg.m, rd_buf, rd_buf_sz, values, operations, n_values, trid, setname_r)) {
+	if (rd_buf && parse) {
+		rv = msg->m.result_code;
+		if (rv == 0 && 0 != parse(&msg->m, rd_buf, rd_buf_sz, parse_udata)) {
+			rv = CITRUSLEAF_FAIL_UNKNOWN;
+		}
+	}
+	else if (rd_buf) {
+		if (0 != cl_parse(&msg->m, rd_buf, rd_buf_sz, values, operations, n_values, trid, setname_r)) {
 			rv = CITRUSLEAF_FAIL_UNKNOWN;
 		}
 		else {
-			rv = msg.m.result_code;
+			rv = msg->m.result_code;
 			// special case: if there was a retry, and we're doing a delete, force 'not found'
 			// errors to 'ok' because the first delete might have succeeded
 			if ((try > 1) && (rv == 2) && (info2 & CL_MSG_INFO2_DELETE)) {
@@ -1574,7 +1973,8 @@ Ok:
     else {
         rv = CITRUSLEAF_FAIL_UNKNOWN;
     }    
-	if (rd_buf && (rd_buf != rd_stack_buf))		free(rd_buf);
+
+	cl_recv_buf_destroy(&rb);
 	
 	// if (rv == 0 && (values || operations) && n_values) {
 	// 	for (int i=0;i<*n_values;i++) {
@@ -1591,13 +1991,46 @@ Ok:
 	if (rv != 0) {
 		cf_debug("exiting OK clause with failure: wpol %d timeleft %d rv %d",
 			(int)(cl_w_p ? cl_w_p->w_pol : 0),
-			(int)(deadline_ms - cf_getms() ), rv );
+			(int)((int64_t)(deadline_ns - cf_socket_getns()) / 1000000), rv );
 	}
 #endif	
 
 	return(rv);
 }
 
+int
+do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const char *ns, const char *set, const cl_object *key,
+	const cf_digest *digest, cl_bin **values, cl_operator operator, cl_operation **operations, int *n_values, 
+	uint32_t *cl_gen, const cl_write_parameters *cl_w_p, uint64_t *trid, char **setname_r, as_call * call, uint32_t* cl_ttl)
+{
+	return full_monte(asc, info1, info2, info3, ns, set, key, digest, values, operator, operations, n_values,
+			cl_gen, cl_w_p, trid, setname_r, call, cl_ttl, NULL, NULL, NULL, NULL);
+}
+
+int
+do_the_full_monte_parse(as_cluster *asc, int info1, int info2, int info3, const char *ns, const char *set, const cl_object *key,
+	const cf_digest *digest, cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,
+	cl_ops_encoder *encoder, const cl_write_parameters *cl_w_p, cl_parse_fn parse, void *parse_udata)
+{
+	uint64_t trid = 0;
+
+	return full_monte(asc, info1, info2, info3, ns, set, key, digest, &values, operator, &operations, &n_values,
+			NULL, cl_w_p, &trid, NULL, NULL, NULL, encoder, NULL, parse, parse_udata);
+}
+
+int
+do_the_full_monte_compiled(as_cluster *asc, int info1, int info2, const char *ns, const cf_digest *digest,
+	cl_compiled *compiled, const cl_write_parameters *cl_w_p, cl_parse_fn parse, void *parse_udata)
+{
+	uint64_t trid = 0;
+	cl_bin *values = NULL;
+	cl_operation *operations = NULL;
+	int n_values = 0;
+
+	return full_monte(asc, info1, info2, 0, ns, NULL, NULL, digest, &values, 0, &operations, &n_values,
+			NULL, cl_w_p, &trid, NULL, NULL, NULL, NULL, compiled, parse, parse_udata);
+}
+
 
 //
 // head functions
@@ -158,10 +158,17 @@ batch_compile(uint info1, uint info2, char *ns, cf_digest *digests, as_node **no
         }
 	}
 	
-	// size too small? malloc!
+	// no buffer? use one of the thread's. size too small? malloc!
 	uint8_t	*buf;
 	uint8_t *mbuf = 0;
-	if ((*buf_r) && (msg_sz > *buf_sz_r)) {
+	bool	iobuf = ! *buf_r;
+	if (iobuf) {
+		size_t capacity;
+		buf = as_io_buffer_get(msg_sz, &capacity);
+		if (!buf) 			return(-1);
+		*buf_r = buf;
+	}
+	else if (msg_sz > *buf_sz_r) {
 		mbuf = buf = malloc(msg_sz);
 		if (!buf) 			return(-1);
 		*buf_r = buf;
@@ -221,6 +228,10 @@ batch_compile(uint info1, uint info2, char *ns, cf_digest *digests, as_node **no
 	buf = write_fields_batch_digests(buf, ns, ns_len, digests, nodes, n_digests,n_my_digests, my_node);
 	if (!buf) {
 		if (mbuf)	free(mbuf);
+		if (iobuf) {
+			as_io_buffer_put(*buf_r);
+			*buf_r = NULL;
+		}
 		return(-1);
 	}
 
@@ -248,7 +259,6 @@ batch_compile(uint info1, uint info2, char *ns, cf_digest *digests, as_node **no
 
 
 
-#define STACK_BUF_SZ (1024 * 16) // provide a safe number for your system - linux tends to have 8M stacks these days
 #define STACK_BINS 100
 
 //
@@ -274,12 +284,12 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 {
 	int rv = -1;
 
-	uint8_t		rd_stack_buf[STACK_BUF_SZ];	
 	uint8_t		*rd_buf = 0;
 	size_t		rd_buf_sz = 0;
-	uint8_t		wr_stack_buf[STACK_BUF_SZ];
-	uint8_t		*wr_buf = wr_stack_buf;
-	size_t		wr_buf_sz = sizeof(wr_stack_buf);
+	uint8_t		*decomp_buf = 0;
+	cl_recv_buf	rb;
+	uint8_t		*wr_buf = NULL;
+	size_t		wr_buf_sz = 0;
 
 	// we have a list of many keys
 //	if (0 == bins && CL_MSG_INFO1_READ == info1) info1 |= CL_MSG_INFO1_GET_ALL;
@@ -300,11 +310,18 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 #ifdef DEBUG			
 		cf_debug("warning: node %s has no file descriptors, retrying transaction", node->name);
 #endif
+		as_io_buffer_put(wr_buf);
 		return(-1);
 	}
 	
 	// send it to the cluster - non blocking socket, but we're blocking
-	if (0 != cf_socket_write_forever(fd, wr_buf, wr_buf_sz)) {
+	rv = cf_socket_write_forever(fd, wr_buf, wr_buf_sz);
+
+	// The request buffer is free for the callbacks' own transactions.
+	as_io_buffer_put(wr_buf);
+	wr_buf = NULL;
+
+	if (0 != rv) {
 #ifdef DEBUG			
 		cf_debug("Citrusleaf: write timeout or error when writing header to server - %d fd %d errno %d", rv, fd, errno);
 #endif
@@ -313,58 +330,38 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 	}
 
 	cl_proto 		proto;
+	cl_proto		*proto_p;
 	bool done = false;
+
+	// Protos are read greedily into one of the thread's I/O buffers, so it
+	// usually holds several.
+	cl_recv_buf_init(&rb, NULL, 0);
 	
 	do { // multiple CL proto per response
 		
-		// Now turn around and read a fine cl_pro - that's the first 8 bytes that has types and lenghts
-		if ((rv = cf_socket_read_forever(fd, (uint8_t *) &proto, sizeof(cl_proto) ) ) ) {
+		// Now turn around and read a whole proto - header and body
+		if ((rv = cl_recv_proto_forever(&rb, fd, &proto_p))) {
 			cf_error("network error: errno %d fd %d", rv, fd);
+			cl_recv_buf_destroy(&rb);
 			cf_close(fd);
 			return(-1);
 		}
-#ifdef DEBUG_VERBOSE
-		dump_buf("read proto header from cluster", (uint8_t *) &proto, sizeof(cl_proto));
-#endif	
-		cl_proto_swap_from_be(&proto);
+		proto = *proto_p;
 
-		if (proto.version != CL_PROTO_VERSION) {
-			cf_error("network error: received protocol message of wrong version %d", proto.version);
-			cf_close(fd);
-			return(-1);
-		}
 		if ((proto.type != CL_PROTO_TYPE_CL_MSG) && (proto.type != CL_PROTO_TYPE_CL_MSG_COMPRESSED)) {
 			cf_error("network error: received incorrect message version %d", proto.type);
+			cl_recv_buf_destroy(&rb);
 			cf_close(fd);
 			return(-1);
 		}
 		
-		// second read for the remainder of the message - expect this to cover lots of data, many lines
-		//
-		// if there's no error
+		// the remainder of the message - expect this to cover lots of data, many lines
+		rd_buf = (uint8_t *) proto_p + sizeof(cl_proto);
 		rd_buf_sz =  proto.sz;
-		if (rd_buf_sz > 0) {
-                                                         
-			if (rd_buf_sz > sizeof(rd_stack_buf))
-				rd_buf = malloc(rd_buf_sz);
-			else
-				rd_buf = rd_stack_buf;
-			if (rd_buf == NULL) {
-				cf_close(fd);
-				return (-1);
-			}
-
-			if ((rv = cf_socket_read_forever(fd, rd_buf, rd_buf_sz))) {
-				cf_error("network error: errno %d fd %d", rv, fd);
-				if (rd_buf != rd_stack_buf)	{ free(rd_buf); }
-				cf_close(fd);
-				return(-1);
-			}
 // this one's a little much: printing the entire body before printing the other bits			
 #ifdef DEBUG_VERBOSE
-			dump_buf("read msg body header (multiple msgs)", rd_buf, rd_buf_sz);
+		dump_buf("read msg body header (multiple msgs)", rd_buf, rd_buf_sz);
 #endif	
-		}
 		
 		if (proto.type == CL_PROTO_TYPE_CL_MSG_COMPRESSED) {
 			
@@ -374,13 +371,12 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 			rv = batch_decompress(rd_buf, rd_buf_sz, &new_rd_buf, &new_rd_buf_sz);
 			if (rv != 0) {
 				cf_error("could not decompress compressed message: error %d", rv);
-				if (rd_buf != rd_stack_buf)	{ free(rd_buf); }
+				cl_recv_buf_destroy(&rb);
 				cf_close(fd);
 				return -1;
 			}				
 				
-			if (rd_buf != rd_stack_buf)	{ free(rd_buf); }
-			rd_buf = new_rd_buf;
+			decomp_buf = rd_buf = new_rd_buf;
 			rd_buf_sz = new_rd_buf_sz;
 			
 			// also re-touch the proto - not certain if this matters
@@ -409,6 +405,8 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 			if (msg->header_sz != sizeof(cl_msg)) {
 				cf_error("received cl msg of unexpected size: expecting %zd found %d, internal error",
 					sizeof(cl_msg),msg->header_sz);
+				if (decomp_buf) { free(decomp_buf); }
+				cl_recv_buf_destroy(&rb);
 				cf_close(fd);
 				return(-1);
 			}
@@ -455,6 +453,8 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 				if (set_ret) {
 					free(set_ret);
 				}
+				if (decomp_buf) { free(decomp_buf); }
+				cl_recv_buf_destroy(&rb);
 				cf_close(fd);
 				return (-1);
 			}
@@ -516,17 +516,14 @@ do_batch_monte(as_cluster *asc, int info1, int info2, char *ns, cf_digest *diges
 			
 		}
 		
-		if (rd_buf && (rd_buf != rd_stack_buf))	{
-			free(rd_buf);
-			rd_buf = 0;
+		if (decomp_buf) {
+			free(decomp_buf);
+			decomp_buf = 0;
 		}
 
 	} while ( done == false );
 
-	if (wr_buf != wr_stack_buf) {
-		free(wr_buf);
-		wr_buf = 0;
-	}
+	cl_recv_buf_destroy(&rb);
 
 	// We should close the connection fd in case of error
 	// to throw away any unread data on connection socket.
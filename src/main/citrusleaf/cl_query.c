@@ -679,9 +679,9 @@ const as_rec_hooks query_response_hooks = {
  */
 static int cl_query_worker_do(as_node * node, cl_query_task * task) {
 
-    uint8_t     rd_stack_buf[STACK_BUF_SZ] = {0};    
-    uint8_t *   rd_buf = rd_stack_buf;
+    uint8_t *   rd_buf = NULL;
     size_t      rd_buf_sz = 0;
+    cl_recv_buf rb;
 
     int fd = as_node_fd_get(node);
     if ( fd == -1 ) { 
@@ -696,49 +696,34 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
     }
 
     cl_proto  proto;
+    cl_proto *proto_p;
     int       rc   = CITRUSLEAF_OK;
     bool      done = false;
 
+    // Protos are read greedily into one of the thread's I/O buffers, so it
+    // usually holds several.
+    cl_recv_buf_init(&rb, NULL, 0);
+
     do {
         // multiple CL proto per response
-        // Now turn around and read a fine cl_proto - that's the first 8 bytes 
-        // that has types and lengths
-        if ( (rc = cf_socket_read_forever(fd, (uint8_t *) &proto, sizeof(cl_proto) ) ) ) {
+        // Now turn around and read a whole proto - header and body
+        if ( (rc = cl_recv_proto_forever(&rb, fd, &proto_p)) ) {
             LOG("[ERROR] cl_query_worker_do: network error: errno %d fd %d\n", rc, fd);
+            cl_recv_buf_destroy(&rb);
             return CITRUSLEAF_FAIL_CLIENT;
         }
-        cl_proto_swap_from_be(&proto);
-
-        if ( proto.version != CL_PROTO_VERSION) {
-            LOG("[ERROR] cl_query_worker_do: network error: received protocol message of wrong version %d\n",proto.version);
-            return CITRUSLEAF_FAIL_CLIENT;
-        }
+        proto = *proto_p;
 
         if ( proto.type != CL_PROTO_TYPE_CL_MSG && proto.type != CL_PROTO_TYPE_CL_MSG_COMPRESSED ) {
             LOG("[ERROR] cl_query_worker_do: network error: received incorrect message version %d\n",proto.type);
+            cl_recv_buf_destroy(&rb);
             return CITRUSLEAF_FAIL_CLIENT;
         }
 
-        // second read for the remainder of the message - expect this to cover 
+        // the remainder of the message - expect this to cover 
         // lots of data, many lines if there's no error
+        rd_buf = (uint8_t *) proto_p + sizeof(cl_proto);
         rd_buf_sz =  proto.sz;
-        if (rd_buf_sz > 0) {
-
-            if (rd_buf_sz > sizeof(rd_stack_buf)){
-                rd_buf = malloc(rd_buf_sz);
-            }
-            else {
-                rd_buf = rd_stack_buf;
-            }
-
-            if (rd_buf == NULL) return CITRUSLEAF_FAIL_CLIENT;
-
-            if ( (rc = cf_socket_read_forever(fd, rd_buf, rd_buf_sz)) ) {
-                LOG("[ERROR] cl_query_worker_do: network error: errno %d fd %d\n", rc, fd);
-                if ( rd_buf != rd_stack_buf ) free(rd_buf);
-                return CITRUSLEAF_FAIL_CLIENT;
-            }
-        }
 
         // process all the cl_msg in this proto
         uint8_t *   buf = rd_buf;
@@ -759,6 +744,7 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
             if ( msg->header_sz != sizeof(cl_msg) ) {
                 LOG("[ERROR] cl_query_worker_do: received cl msg of unexpected size: expecting %zd found %d, internal error\n",
                         sizeof(cl_msg),msg->header_sz);
+                cl_recv_buf_destroy(&rb);
                 return CITRUSLEAF_FAIL_CLIENT;
             }
 
@@ -818,6 +804,7 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
             }
 
             if (bins == NULL) {
+                cl_recv_buf_destroy(&rb);
                 return CITRUSLEAF_FAIL_CLIENT;
             }
 
@@ -867,7 +854,7 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
                 record->ttl = cf_server_void_time_to_ttl(msg->record_ttl);
     			record->gen = msg->generation;
 
-                clbins_to_asrecord(bins, msg->n_ops, record);
+                clbins_to_asrecord(bins, msg->n_ops, record, task->asc->record_arena);
 
                 // TODO:
                 //      Fix the following block of code. It is really lame 
@@ -879,67 +866,16 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
                 //
                 // got one good value? call it a success!
                 // (Note:  In the key exists case, there is no bin data.)
-                as_val * v = (as_val *) as_record_get(record, "SUCCESS");
-
-                if ( v  != NULL ) {
+                if ( as_record_get(record, "SUCCESS") != NULL ) {
                     // I only need this value. The rest of the record is useless.
-                    // Need to detach the value from the record (result)
-                    // then release the record back to the wild... or wherever
-                    // it came from.
-					as_val * vp = NULL;
-					if ( !v->free ) {
-						switch(as_val_type(v)) {
-							case AS_INTEGER:
-								vp = (as_val *) as_integer_new(as_integer_get((as_integer *)v));
-								break;
-							case AS_STRING: {
-								as_string * s = (as_string *)v;
-								vp = (as_val *) as_string_new(as_string_get(s), true);
-								s->value = NULL;
-								break;
-							}
-							case AS_BYTES: {
-								as_bytes * b = (as_bytes *)v;
-								vp = (as_val *) as_bytes_new_wrap(as_bytes_get(b), as_bytes_size(b), true);
-								b->value = NULL;
-								b->size = 0;
-								break;
-							}
-							default:
-								LOG("[WARNING] unknown stack as_val type\n");
-								break;
-						}
-					}
-					else {
-						vp = as_val_reserve(v);
-					}
-					task->callback(vp, task->udata);
+                    // Detach the value, so it outlives the record.
+                    task->callback(as_record_detach(record, "SUCCESS"), task->udata);
                 }
                 else {
-                    as_val * v_fail = (as_val *) as_record_get(record, "FAILURE");
-                    if(v_fail != NULL) {
+                    if ( as_record_get(record, "FAILURE") != NULL ) {
                         done = true;
                         rc = CITRUSLEAF_FAIL_UNKNOWN;
-                        as_val * vp = NULL;
-                        if ( !v_fail->free ) {
-                            switch (as_val_type(v_fail)) {
-
-                                case AS_STRING: {
-                                    as_string * s = (as_string *)v_fail;
-                                    vp = (as_val *) as_string_new(as_string_get(s), true);
-                                    s->value = NULL;
-                                    break;
-                                    }    
-                                default:
-                                    LOG("[WARNING] unknown stack as_val type\n");
-                                    break;
-                            }    
-                        }    
-                        else {
-                            vp = as_val_reserve(v_fail);
-                        }    
-                        task->err_val = vp;
-
+                        task->err_val = as_record_detach(record, "FAILURE");
                     }    
                     else {
                         task->callback((as_val *) record, task->udata);
@@ -969,11 +905,6 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
 
         }
 
-        if (rd_buf && (rd_buf != rd_stack_buf))    {
-            free(rd_buf);
-            rd_buf = 0;
-        }
-
         // abort requested by the user
         if (task->abort || gasq_abort) {
 			cf_close(fd);
@@ -986,6 +917,7 @@ static int cl_query_worker_do(as_node * node, cl_query_task * task) {
     goto Final;
 
 Final:    
+    cl_recv_buf_destroy(&rb);
 
 #ifdef DEBUG_VERBOSE    
     LOG("[DEBUG] exited loop: rc %d\n", rc );
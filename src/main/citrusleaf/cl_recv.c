@@ -0,0 +1,212 @@
+/******************************************************************************
+ * Copyright 2008-2014 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_proto.h>
+#include <citrusleaf/cf_socket.h>
+
+#include "internal.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ ******************************************************************************/
+
+//
+// Make room for need bytes from begin, moving unconsumed bytes to the front
+// of the buffer and growing it if necessary.
+//
+static int
+cl_recv_reserve(cl_recv_buf *rb, size_t need)
+{
+	size_t avail = rb->end - rb->begin;
+
+	if (need > rb->capacity) {
+		uint8_t *keep = rb->buf + rb->begin;
+		uint8_t *buf;
+		size_t capacity;
+
+		if (rb->buf == rb->stack_buf) {
+			buf = as_io_buffer_get(need, &capacity);
+
+			if (buf && avail) {
+				memcpy(buf, keep, avail);
+			}
+		}
+		else {
+			buf = as_io_buffer_grow(rb->buf, need, keep, avail, &capacity);
+		}
+
+		if (! buf) {
+			return ENOMEM;
+		}
+
+		rb->buf = buf;
+		rb->capacity = capacity;
+	}
+	else if (avail) {
+		memmove(rb->buf, rb->buf + rb->begin, avail);
+	}
+
+	rb->begin = 0;
+	rb->end = avail;
+	return 0;
+}
+
+//
+// Make sure at least need bytes from begin are in the buffer. Reads are
+// greedy - anything else that has already arrived is read too, so a small
+// response usually takes one read for its header and body together.
+//
+static int
+cl_recv_fill(cl_recv_buf *rb, int fd, size_t need, uint64_t deadline_ns, uint64_t attempt_ns, bool forever)
+{
+	size_t avail = rb->end - rb->begin;
+
+	if (avail >= need) {
+		return 0;
+	}
+
+	if (rb->begin + need > rb->capacity) {
+		int rv = cl_recv_reserve(rb, need);
+
+		if (rv) {
+			return rv;
+		}
+	}
+
+	uint8_t *p = rb->buf + rb->end;
+	size_t min_len = need - avail;
+	size_t max_len = rb->capacity - rb->end;
+	size_t read = 0;
+	int rv;
+
+	if (forever) {
+		rv = cf_socket_read_greedy_forever(fd, p, min_len, max_len, &read);
+	}
+	else {
+		rv = cf_socket_read_greedy_timeout_ns(fd, p, min_len, max_len, deadline_ns, attempt_ns, &read);
+	}
+
+	rb->end += read;
+	return rv;
+}
+
+static int
+cl_recv_proto_internal(cl_recv_buf *rb, int fd, uint64_t deadline_ns, uint64_t attempt_ns, bool forever, cl_proto **proto_r)
+{
+	int rv = cl_recv_fill(rb, fd, sizeof(cl_proto), deadline_ns, attempt_ns, forever);
+
+	if (rv) {
+		return rv;
+	}
+
+	cl_proto *proto = (cl_proto *)(rb->buf + rb->begin);
+	cl_proto_swap_from_be(proto);
+
+	// Don't trust the size of something that isn't a proto.
+	if (proto->version != CL_PROTO_VERSION) {
+		cf_warn("received protocol message of wrong version %d", proto->version);
+		return EPROTO;
+	}
+
+	size_t msg_sz = sizeof(cl_proto) + proto->sz;
+
+	if ((rv = cl_recv_fill(rb, fd, msg_sz, deadline_ns, attempt_ns, forever))) {
+		return rv;
+	}
+
+	// The buffer may have moved.
+	*proto_r = (cl_proto *)(rb->buf + rb->begin);
+	rb->begin += msg_sz;
+
+	if (rb->begin == rb->end) {
+		// Nothing buffered - the next read can start at the front.
+		rb->begin = rb->end = 0;
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ ******************************************************************************/
+
+//
+// The buffer starts out as stack_buf, which may be NULL, and moves to one of
+// the thread's I/O buffers if it needs to grow. cl_recv_buf_destroy() gives
+// that back.
+//
+void
+cl_recv_buf_init(cl_recv_buf *rb, uint8_t *stack_buf, size_t stack_buf_sz)
+{
+	rb->buf = stack_buf;
+	rb->capacity = stack_buf ? stack_buf_sz : 0;
+	rb->begin = 0;
+	rb->end = 0;
+	rb->stack_buf = stack_buf;
+}
+
+void
+cl_recv_buf_destroy(cl_recv_buf *rb)
+{
+	if (rb->buf != rb->stack_buf) {
+		as_io_buffer_put(rb->buf);
+	}
+
+	cl_recv_buf_init(rb, rb->stack_buf, 0);
+}
+
+//
+// Discard anything buffered, e.g. left over from a failed transaction on
+// another socket.
+//
+void
+cl_recv_buf_reset(cl_recv_buf *rb)
+{
+	rb->begin = 0;
+	rb->end = 0;
+}
+
+//
+// Read a complete proto message - header and body. On success *proto_r points
+// to the message in the buffer with the proto header in host byte order, and
+// is valid until the next call with this buffer. The deadline is on the
+// cf_socket_getns() clock, and each read may take up to attempt_ns.
+//
+// Returns 0 on success, otherwise the error number.
+//
+int
+cl_recv_proto(cl_recv_buf *rb, int fd, uint64_t deadline_ns, uint64_t attempt_ns, cl_proto **proto_r)
+{
+	return cl_recv_proto_internal(rb, fd, deadline_ns, attempt_ns, false, proto_r);
+}
+
+int
+cl_recv_proto_forever(cl_recv_buf *rb, int fd, cl_proto **proto_r)
+{
+	return cl_recv_proto_internal(rb, fd, 0, 0, true, proto_r);
+}
@@ -221,9 +221,9 @@ const as_rec_hooks scan_response_hooks = {
  */
 static int cl_scan_worker_do(as_node * node, cl_scan_task * task) {
 
-    uint8_t     rd_stack_buf[STACK_BUF_SZ] = {0};    
-    uint8_t *   rd_buf = rd_stack_buf;
+    uint8_t *   rd_buf = NULL;
     size_t      rd_buf_sz = 0;
+    cl_recv_buf rb;
 
     int fd = as_node_fd_get(node);
     if ( fd == -1 ) { 
@@ -238,56 +238,36 @@ static int cl_scan_worker_do(as_node * node, cl_scan_task * task) {
     }
 
     cl_proto  proto;
+    cl_proto *proto_p;
     int       rc   = CITRUSLEAF_OK;
     bool      done = false;
 
+    // Protos are read greedily into one of the thread's I/O buffers, so it
+    // usually holds several.
+    cl_recv_buf_init(&rb, NULL, 0);
+
     do {
         // multiple CL proto per response
-        // Now turn around and read a fine cl_proto - that's the first 8 bytes 
-        // that has types and lengths
-        if ( (rc = cf_socket_read_forever(fd, (uint8_t *) &proto, sizeof(cl_proto) ) ) ) {
+        // Now turn around and read a whole proto - header and body
+        if ( (rc = cl_recv_proto_forever(&rb, fd, &proto_p)) ) {
             LOG("[ERROR] cl_scan_worker_do: network error: errno %d fd %d node name %s\n", rc, fd, node->name);
+            cl_recv_buf_destroy(&rb);
             cf_close(fd);
             return CITRUSLEAF_FAIL_CLIENT;
         }
-        cl_proto_swap_from_be(&proto);
-
-        if ( proto.version != CL_PROTO_VERSION) {
-            LOG("[ERROR] cl_scan_worker_do: network error: received protocol message of wrong version %d from node %s\n", proto.version, node->name);
-            cf_close(fd);
-            return CITRUSLEAF_FAIL_CLIENT;
-        }
+        proto = *proto_p;
 
         if ( proto.type != CL_PROTO_TYPE_CL_MSG && proto.type != CL_PROTO_TYPE_CL_MSG_COMPRESSED ) {
             LOG("[ERROR] cl_scan_worker_do: network error: received incorrect message version %d from node %s \n",proto.type, node->name);
+            cl_recv_buf_destroy(&rb);
             cf_close(fd);
             return CITRUSLEAF_FAIL_CLIENT;
         }
 
-        // second read for the remainder of the message - expect this to cover 
+        // the remainder of the message - expect this to cover 
         // lots of data, many lines if there's no error
+        rd_buf = (uint8_t *) proto_p + sizeof(cl_proto);
         rd_buf_sz =  proto.sz;
-        if (rd_buf_sz > 0) {
-
-            if (rd_buf_sz > sizeof(rd_stack_buf)){
-                rd_buf = malloc(rd_buf_sz);
-            }
-            else {
-                rd_buf = rd_stack_buf;
-            }
-
-            if (rd_buf == NULL) {
-            	cf_close(fd);
-            	return CITRUSLEAF_FAIL_CLIENT;
-            }
-
-            if ( (rc = cf_socket_read_forever(fd, rd_buf, rd_buf_sz)) ) {
-                LOG("[ERROR] cl_scan_worker_do: network error: errno %d fd %d node name %s\n", rc, fd, node->name);
-                if ( rd_buf != rd_stack_buf ) free(rd_buf);
-                cf_close(fd);
-                return CITRUSLEAF_FAIL_CLIENT;
-            }
-        }
 
         // process all the cl_msg in this proto
         uint8_t *   buf = rd_buf;
@@ -306,6 +286,7 @@ static int cl_scan_worker_do(as_node * node, cl_scan_task * task) {
             if ( msg->header_sz != sizeof(cl_msg) ) {
                 LOG("[ERROR] cl_scan_worker_do: received cl msg of unexpected size: expecting %zd found %d, internal error\n",
                         sizeof(cl_msg),msg->header_sz);
+                cl_recv_buf_destroy(&rb);
                 cf_close(fd);
                 return CITRUSLEAF_FAIL_CLIENT;
             }
@@ -349,6 +330,7 @@ static int cl_scan_worker_do(as_node * node, cl_scan_task * task) {
                 if (set_ret) {
                     free(set_ret);
                 }
+                cl_recv_buf_destroy(&rb);
                 cf_close(fd);
                return CITRUSLEAF_FAIL_CLIENT;
             }
@@ -439,12 +421,8 @@ static int cl_scan_worker_do(as_node * node, cl_scan_task * task) {
 
         }
 
-        if (rd_buf && (rd_buf != rd_stack_buf))    {
-            free(rd_buf);
-            rd_buf = 0;
-        }
-
     } while ( done == false );
+    cl_recv_buf_destroy(&rb);
     as_node_fd_put(node, fd);
 
 #ifdef DEBUG_VERBOSE    
@@ -25,6 +25,7 @@
 #include <inttypes.h>
 #include <stdbool.h>
 #include <netinet/in.h>
+#include <sys/uio.h>
 
 #include <citrusleaf/cf_atomic.h>
 #include <citrusleaf/cf_ll.h>
@@ -39,6 +40,7 @@
 
 #include <citrusleaf/citrusleaf.h>
 #include <aerospike/as_cluster.h>
+#include <aerospike/as_io_buffer.h>
 #include <citrusleaf/cl_udf.h>
 #include <citrusleaf/cl_scan.h>
 
@@ -53,6 +55,10 @@
 #define CL_MSG_FIELD_TYPE_UDF_FUNCTION          31
 #define CL_MSG_FIELD_TYPE_UDF_ARGLIST           32
 
+// Most bin values a gathered request sends from the caller's memory - any
+// more large values are copied into the request buffer as usual.
+#define CL_GATHER_MAX_VALUES 16
+
 #pragma GCC diagnostic warning "-Wformat"
 
 #define DO_PRAGMA(x) _Pragma (#x)
@@ -66,6 +72,14 @@
 typedef struct cl_async_work cl_async_work;
 typedef struct cl_batch_work cl_batch_work;
 typedef struct as_call_s as_call;
+typedef struct cl_recv_buf_s cl_recv_buf;
+typedef struct cl_gather_s cl_gather;
+typedef struct cl_ops_encoder_s cl_ops_encoder;
+typedef struct cl_compiled_s cl_compiled;
+
+// Decodes a successful response - msg is in host byte order and buf holds the
+// fields and ops. Returns 0 on success.
+typedef int (*cl_parse_fn)(cl_msg *msg, uint8_t *buf, size_t buf_len, void *udata);
 
 struct cl_async_work {
 	uint64_t			trid;		//Transaction-id of the submitted work
@@ -109,6 +123,45 @@ struct as_call_s {
     as_buffer * args;
 };
 
+// Receive buffer for proto messages. Socket reads are greedy, so bytes
+// belonging to the next proto of a multi-proto response may already be in
+// the buffer - [begin, end) is what has been read but not yet consumed.
+struct cl_recv_buf_s {
+	uint8_t *	buf;
+	size_t		capacity;
+	size_t		begin;
+	size_t		end;
+	uint8_t *	stack_buf;	// initial caller-owned storage or NULL, never freed
+};
+
+// Layout of a request compiled by cl_compile_gather() - the request buffer
+// split around large bin values, which are referenced where they are.
+struct cl_gather_s {
+	uint32_t		threshold;	// in: smallest value to reference, 0 to copy all
+	int				n_iov;		// out: entries used in iov
+	struct iovec	iov[CL_GATHER_MAX_VALUES * 2 + 1];
+};
+
+// Source of a request's ops, for requests compiled straight from the
+// caller's structures rather than from cl_bin or cl_operation arrays. Both
+// callbacks must make the same gather decisions, in the same order.
+struct cl_ops_encoder_s {
+	int			n_ops;
+	// add the size of the whole ops to *msg_sz, and of the values that will
+	// be referenced in gather to *gather_sz - return 0 on success
+	int			(*size)(cl_ops_encoder *encoder, const cl_gather *gather, size_t *msg_sz, size_t *gather_sz);
+	// lay out the ops in network order from buf, referencing values in gather
+	// with cl_gather_ref() - return the end of the ops in the buffer
+	uint8_t *	(*write)(cl_ops_encoder *encoder, uint8_t *buf, cl_gather *gather, uint8_t **seg);
+};
+
+// A request compiled by the caller into one of the thread's I/O buffers, which
+// the transaction gives back.
+struct cl_compiled_s {
+	uint8_t *	buf;
+	size_t		buf_sz;
+};
+
 /******************************************************************************
  * VARIABLES
  ******************************************************************************/
@@ -152,18 +205,69 @@ int do_the_full_monte(as_cluster *asc, int info1, int info2, int info3, const ch
 	uint32_t *cl_gen, const cl_write_parameters *cl_w_p, uint64_t *trid, char **setname_r, as_call * call, uint32_t* cl_ttl
 	);
 
+// As do_the_full_monte(), but a successful response is handed to parse
+// instead of being copied into the values or operations. If encoder is set,
+// it supplies the ops in place of values or operations.
+int do_the_full_monte_parse(as_cluster *asc, int info1, int info2, int info3, const char *ns, const char *set, const cl_object *key,
+	const cf_digest *digest, cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,
+	cl_ops_encoder *encoder, const cl_write_parameters *cl_w_p, cl_parse_fn parse, void *parse_udata
+	);
+
+// As do_the_full_monte_parse(), but the request was compiled by the caller -
+// ns and digest only pick the node.
+int do_the_full_monte_compiled(as_cluster *asc, int info1, int info2, const char *ns, const cf_digest *digest,
+	cl_compiled *compiled, const cl_write_parameters *cl_w_p, cl_parse_fn parse, void *parse_udata
+	);
+
 int citrusleaf_info_host_limit(int fd, char *names, char **values, int timeout_ms, bool send_asis, uint64_t max_response_length, bool check_bounds);
 
+// If *buf_r is NULL the request is compiled into one of the thread's I/O
+// buffers, to be given back with as_io_buffer_put(*buf_r). Otherwise a request
+// larger than *buf_sz_r is compiled into a malloc'd *buf_r.
 int cl_compile(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
 	cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,  
 	uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret, uint64_t trid, 
 	cl_scan_param_field *scan_field, as_call * as_call, uint8_t udf_type
 	);
 
+// As cl_compile(), but large values are left out of the buffer - send the
+// message with cf_socket_writev_timeout(gather->iov, gather->n_iov).
+int cl_compile_gather(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
+	cl_bin *values, cl_operator operator, cl_operation *operations, int n_values,
+	uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret, uint64_t trid, as_call * call,
+	cl_gather *gather
+	);
+
+// As cl_compile_gather(), but the ops come from encoder. gather may be NULL
+// to copy all values into the buffer.
+int cl_compile_ops(uint info1, uint info2, uint info3, const char *ns, const char *set, const cl_object *key, const cf_digest *digest,
+	cl_ops_encoder *encoder, uint8_t **buf_r, size_t *buf_sz_r, const cl_write_parameters *cl_w_p, cf_digest *d_ret,
+	cl_gather *gather
+	);
+
+// Should a value of sz bytes be sent from where it is, n_refs values having
+// already been referenced?
+bool cl_gather_check(const cl_gather *gather, int n_refs, size_t sz);
+
+// Reference a value in gather - the buffer from *seg up to value_p is added
+// first, and *seg moves on to value_p.
+void cl_gather_ref(cl_gather *gather, uint8_t **seg, uint8_t *value_p, const void *value, size_t sz);
+
 int cl_parse(cl_msg *msg, uint8_t *buf, size_t buf_len, cl_bin **values_r, cl_operation **operations_r, 
 	int *n_values_r, uint64_t *trid, char **setname_r
 	);
 
+// cl_recv.c - proto message receive layer
+void cl_recv_buf_init(cl_recv_buf *rb, uint8_t *stack_buf, size_t stack_buf_sz);
+
+void cl_recv_buf_destroy(cl_recv_buf *rb);
+
+void cl_recv_buf_reset(cl_recv_buf *rb);
+
+int cl_recv_proto(cl_recv_buf *rb, int fd, uint64_t deadline_ns, uint64_t attempt_ns, cl_proto **proto_r);
+
+int cl_recv_proto_forever(cl_recv_buf *rb, int fd, cl_proto **proto_r);
+
 // // Get a map reduce state - the instance - based on the job description
 // cl_mr_state * cl_mr_state_get(const cl_mr_job *mrj);
 // void cl_mr_state_put(cl_mr_state *mrs);
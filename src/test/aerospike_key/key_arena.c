@@ -0,0 +1,255 @@
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+
+#include <aerospike/as_error.h>
+#include <aerospike/as_status.h>
+
+#include <aerospike/as_record.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_string.h>
+#include <aerospike/as_bytes.h>
+#include <aerospike/as_list.h>
+#include <aerospike/as_arraylist.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_val.h>
+
+#include <string.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/**
+ * Client decoding records into arenas.
+ */
+static aerospike * arena_as = NULL;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static bool before(atf_suite * suite) {
+
+	as_config config;
+	test_config_init(&config);
+	config.record_arena = true;
+
+	as_error err;
+	as_error_reset(&err);
+
+	arena_as = aerospike_new(&config);
+
+	if ( aerospike_connect(arena_as, &err) != AEROSPIKE_OK ) {
+		error("%s @ %s[%s:%d]", err.message, err.func, err.file, err.line);
+		aerospike_destroy(arena_as);
+		arena_as = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static bool after(atf_suite * suite) {
+
+	if ( ! arena_as ) {
+		return true;
+	}
+
+	as_error err;
+	as_error_reset(&err);
+
+	aerospike_close(arena_as, &err);
+	aerospike_destroy(arena_as);
+	arena_as = NULL;
+
+	return true;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_arena_put , "put: (test,test,key_arena) = {a: 123, b: 'abc', c: <1,2,3,4>, e: [1,2,3]}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	static const uint8_t bytes[] = { 1, 2, 3, 4 };
+
+	as_arraylist list;
+	as_arraylist_init(&list, 3, 0);
+	as_arraylist_append_int64(&list, 1);
+	as_arraylist_append_int64(&list, 2);
+	as_arraylist_append_int64(&list, 3);
+
+	as_record rec;
+	as_record_init(&rec, 4);
+	as_record_set_int64(&rec, "a", 123);
+	as_record_set_str(&rec, "b", "abc");
+	as_record_set_raw(&rec, "c", bytes, sizeof(bytes));
+	as_record_set_list(&rec, "e", (as_list *) &list);
+
+	as_key key;
+	as_key_init(&key, "test", "test", "key_arena");
+
+	as_status rc = aerospike_key_put(as, &err, NULL, &key, &rec);
+
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+}
+
+TEST( key_arena_get , "get: (test,test,key_arena) into an arena" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", "key_arena");
+
+	as_record * rec = NULL;
+	as_status rc = aerospike_key_get(arena_as, &err, NULL, &key, &rec);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_not_null( rec );
+	assert_not_null( rec->arena );
+	assert_int_eq( as_record_numbins(rec), 4 );
+
+	assert_int_eq( as_record_get_int64(rec, "a", 0), 123 );
+	assert_string_eq( as_record_get_str(rec, "b"), "abc" );
+
+	as_bytes * b = as_record_get_bytes(rec, "c");
+	assert_not_null( b );
+	assert_int_eq( b->size, 4 );
+	assert_int_eq( b->value[3], 4 );
+
+	as_list * list = as_record_get_list(rec, "e");
+	assert_not_null( list );
+	assert_int_eq( as_list_size(list), 3 );
+
+	// Values set after decoding live outside the arena.
+	as_record_set_str(rec, "b", "xyz");
+	assert_string_eq( as_record_get_str(rec, "b"), "xyz" );
+
+	as_record_destroy(rec);
+}
+
+TEST( key_arena_detach , "get: (test,test,key_arena), then detach bins and destroy the record" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", "key_arena");
+
+	as_record * rec = NULL;
+	as_status rc = aerospike_key_get(arena_as, &err, NULL, &key, &rec);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_not_null( rec );
+	assert_not_null( rec->arena );
+
+	as_val * a = as_record_detach(rec, "a");
+	as_val * b = as_record_detach(rec, "b");
+	as_val * c = as_record_detach(rec, "c");
+	as_val * e = as_record_detach(rec, "e");
+	as_val * missing = as_record_detach(rec, "z");
+
+	as_val_t b_left = as_val_type((as_val *) as_record_get(rec, "b"));
+
+	as_record_destroy(rec);
+
+	assert_null( missing );
+	assert_int_eq( b_left, AS_NIL );
+
+	assert_not_null( a );
+	assert_int_eq( as_val_type(a), AS_INTEGER );
+	assert_int_eq( as_integer_toint((as_integer *) a), 123 );
+
+	assert_not_null( b );
+	assert_int_eq( as_val_type(b), AS_STRING );
+	assert_string_eq( as_string_tostring((as_string *) b), "abc" );
+
+	assert_not_null( c );
+	assert_int_eq( as_val_type(c), AS_BYTES );
+	assert_int_eq( ((as_bytes *) c)->size, 4 );
+	assert_int_eq( ((as_bytes *) c)->value[0], 1 );
+
+	assert_not_null( e );
+	assert_int_eq( as_val_type(e), AS_LIST );
+	assert_int_eq( as_list_size((as_list *) e), 3 );
+
+	as_val_destroy(a);
+	as_val_destroy(b);
+	as_val_destroy(c);
+	as_val_destroy(e);
+}
+
+TEST( key_arena_operate , "operate: (test,test,key_arena) => {a: incr(1)}, read a into an arena" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_operations ops;
+	as_operations_inita(&ops, 2);
+	as_operations_add_incr(&ops, "a", 1);
+	as_operations_add_read(&ops, "a");
+
+	as_key key;
+	as_key_init(&key, "test", "test", "key_arena");
+
+	as_record * rec = NULL;
+	as_status rc = aerospike_key_operate(arena_as, &err, NULL, &key, &ops, &rec);
+
+	as_key_destroy(&key);
+	as_operations_destroy(&ops);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_not_null( rec );
+	assert_not_null( rec->arena );
+	assert_int_eq( as_record_get_int64(rec, "a", 0), 124 );
+
+	as_record_destroy(rec);
+}
+
+TEST( key_arena_remove , "remove: (test,test,key_arena)" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", "key_arena");
+
+	as_status rc = aerospike_key_remove(as, &err, NULL, &key);
+
+	as_key_destroy(&key);
+
+	assert_true( rc == AEROSPIKE_OK || rc == AEROSPIKE_ERR_RECORD_NOT_FOUND );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_arena, "arena-backed record tests" ) {
+
+	suite_before( before );
+	suite_after( after );
+
+	suite_add( key_arena_remove );
+	suite_add( key_arena_put );
+	suite_add( key_arena_get );
+	suite_add( key_arena_detach );
+	suite_add( key_arena_operate );
+	suite_add( key_arena_remove );
+}
@@ -0,0 +1,429 @@
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+
+#include <aerospike/as_error.h>
+#include <aerospike/as_status.h>
+
+#include <aerospike/as_record.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_string.h>
+#include <aerospike/as_list.h>
+#include <aerospike/as_arraylist.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_val.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+#include "../util/udf.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/**
+ * Client running asynchronous commands.
+ */
+static aerospike * async_as = NULL;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define LUA_FILE "src/test/lua/key_apply.lua"
+#define UDF_FILE "key_apply"
+
+#define KEY "key_async"
+
+// Bigger than a command's initial buffer, so the request is compiled into a
+// buffer of its own.
+#define STR_SZ 4096
+
+#define N_GETS 100
+
+#define WAIT_SEC 5
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Results of asynchronous commands, filled in by the listeners.
+ */
+typedef struct key_async_result_s {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t pending;
+	as_status status;
+	int64_t a;
+	size_t c_len;
+	uint32_t n_bins;
+} key_async_result;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static bool before(atf_suite * suite) {
+
+	if ( ! udf_put(LUA_FILE) ) {
+		error("failure while uploading: %s", LUA_FILE);
+		return false;
+	}
+
+	as_config config;
+	test_config_init(&config);
+	config.async_loops = 2;
+
+	as_error err;
+	as_error_reset(&err);
+
+	async_as = aerospike_new(&config);
+
+	if ( aerospike_connect(async_as, &err) != AEROSPIKE_OK ) {
+		error("%s @ %s[%s:%d]", err.message, err.func, err.file, err.line);
+		aerospike_destroy(async_as);
+		async_as = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static bool after(atf_suite * suite) {
+
+	if ( async_as ) {
+		as_error err;
+		as_error_reset(&err);
+
+		aerospike_close(async_as, &err);
+		aerospike_destroy(async_as);
+		async_as = NULL;
+	}
+
+	if ( ! udf_remove(LUA_FILE) ) {
+		error("failure while removing: %s", LUA_FILE);
+		return false;
+	}
+
+	return true;
+}
+
+static void key_async_result_init(key_async_result * res, uint32_t pending)
+{
+	pthread_mutex_init(&res->lock, NULL);
+	pthread_cond_init(&res->cond, NULL);
+	res->pending = pending;
+	res->status = AEROSPIKE_OK;
+	res->a = -1;
+	res->c_len = 0;
+	res->n_bins = 0;
+}
+
+static void key_async_result_destroy(key_async_result * res)
+{
+	pthread_cond_destroy(&res->cond);
+	pthread_mutex_destroy(&res->lock);
+}
+
+/**
+ * Wait for all the commands to complete.  Returns false if they don't within
+ * WAIT_SEC - the result can't be destroyed then, as listeners may still run.
+ */
+static bool key_async_result_wait(key_async_result * res)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += WAIT_SEC;
+
+	pthread_mutex_lock(&res->lock);
+
+	int rv = 0;
+
+	while ( res->pending && rv == 0 ) {
+		rv = pthread_cond_timedwait(&res->cond, &res->lock, &deadline);
+	}
+
+	bool done = res->pending == 0;
+	pthread_mutex_unlock(&res->lock);
+	return done;
+}
+
+/**
+ * Record a command's completion.  Call with the lock held.
+ */
+static void key_async_result_done(key_async_result * res, as_error * err)
+{
+	if ( err && res->status == AEROSPIKE_OK ) {
+		res->status = err->code;
+	}
+
+	if ( --res->pending == 0 ) {
+		pthread_cond_signal(&res->cond);
+	}
+}
+
+static void key_async_record_listener(as_error * err, as_record * rec, void * udata)
+{
+	key_async_result * res = (key_async_result *) udata;
+
+	pthread_mutex_lock(&res->lock);
+
+	if ( rec ) {
+		res->a = as_record_get_int64(rec, "a", -1);
+		res->n_bins = as_record_numbins(rec);
+
+		char * c = as_record_get_str(rec, "c");
+		res->c_len = c ? strlen(c) : 0;
+	}
+
+	key_async_result_done(res, err);
+	pthread_mutex_unlock(&res->lock);
+}
+
+static void key_async_write_listener(as_error * err, void * udata)
+{
+	key_async_result * res = (key_async_result *) udata;
+
+	pthread_mutex_lock(&res->lock);
+	key_async_result_done(res, err);
+	pthread_mutex_unlock(&res->lock);
+}
+
+static void key_async_value_listener(as_error * err, as_val * val, void * udata)
+{
+	key_async_result * res = (key_async_result *) udata;
+
+	pthread_mutex_lock(&res->lock);
+
+	as_integer * i = val ? as_integer_fromval(val) : NULL;
+
+	if ( i ) {
+		res->a = as_integer_toint(i);
+	}
+
+	key_async_result_done(res, err);
+	pthread_mutex_unlock(&res->lock);
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_async_remove , "remove: (test,test,key_async)" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	as_status rc = aerospike_key_remove(as, &err, NULL, &key);
+
+	as_key_destroy(&key);
+
+	assert_true( rc == AEROSPIKE_OK || rc == AEROSPIKE_ERR_RECORD_NOT_FOUND );
+}
+
+TEST( key_async_put , "put async: (test,test,key_async) = {a: 1, b: 'abc', c: 4KB string}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	static char str[STR_SZ];
+	memset(str, 'c', STR_SZ - 1);
+	str[STR_SZ - 1] = '\0';
+
+	as_record rec;
+	as_record_inita(&rec, 3);
+	as_record_set_int64(&rec, "a", 1);
+	as_record_set_str(&rec, "b", "abc");
+	as_record_set_str(&rec, "c", str);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	key_async_result res;
+	key_async_result_init(&res, 1);
+
+	as_status rc = aerospike_key_put_async(async_as, &err, NULL, &key, &rec, key_async_write_listener, &res);
+
+	// The request was compiled when the command was started.
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_true( key_async_result_wait(&res) );
+	assert_int_eq( res.status, AEROSPIKE_OK );
+
+	key_async_result_destroy(&res);
+}
+
+TEST( key_async_get , "get async: (test,test,key_async) = {a: 1, b: 'abc', c: 4KB string}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	key_async_result res;
+	key_async_result_init(&res, 1);
+
+	as_status rc = aerospike_key_get_async(async_as, &err, NULL, &key, key_async_record_listener, &res);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_true( key_async_result_wait(&res) );
+	assert_int_eq( res.status, AEROSPIKE_OK );
+	assert_int_eq( res.n_bins, 3 );
+	assert_int_eq( res.a, 1 );
+	assert_int_eq( res.c_len, STR_SZ - 1 );
+
+	key_async_result_destroy(&res);
+}
+
+TEST( key_async_get_many , "get async: (test,test,key_async) 100 times at once" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	key_async_result res;
+	key_async_result_init(&res, N_GETS);
+
+	as_status rc = AEROSPIKE_OK;
+	uint32_t started = 0;
+
+	for ( ; started < N_GETS; started++ ) {
+		rc = aerospike_key_get_async(async_as, &err, NULL, &key, key_async_record_listener, &res);
+
+		if ( rc != AEROSPIKE_OK ) {
+			break;
+		}
+	}
+
+	as_key_destroy(&key);
+
+	// Commands that weren't started won't complete.
+	pthread_mutex_lock(&res.lock);
+	res.pending -= N_GETS - started;
+	pthread_mutex_unlock(&res.lock);
+
+	assert_true( key_async_result_wait(&res) );
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( res.status, AEROSPIKE_OK );
+	assert_int_eq( res.a, 1 );
+
+	key_async_result_destroy(&res);
+}
+
+TEST( key_async_operate , "operate async: (test,test,key_async) => {a: incr(10)}, read a = 11" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_operations ops;
+	as_operations_inita(&ops, 2);
+	as_operations_add_incr(&ops, "a", 10);
+	as_operations_add_read(&ops, "a");
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	key_async_result res;
+	key_async_result_init(&res, 1);
+
+	as_status rc = aerospike_key_operate_async(async_as, &err, NULL, &key, &ops, key_async_record_listener, &res);
+
+	as_key_destroy(&key);
+	as_operations_destroy(&ops);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_true( key_async_result_wait(&res) );
+	assert_int_eq( res.status, AEROSPIKE_OK );
+	assert_int_eq( res.n_bins, 1 );
+	assert_int_eq( res.a, 11 );
+
+	key_async_result_destroy(&res);
+}
+
+TEST( key_async_apply , "apply async: (test,test,key_async) <!> key_apply.add(1,2) => 3" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_arraylist arglist;
+	as_arraylist_init(&arglist, 2, 0);
+	as_arraylist_append_int64(&arglist, 1);
+	as_arraylist_append_int64(&arglist, 2);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	key_async_result res;
+	key_async_result_init(&res, 1);
+
+	as_status rc = aerospike_key_apply_async(async_as, &err, NULL, &key, UDF_FILE, "add", (as_list *) &arglist,
+			key_async_value_listener, &res);
+
+	as_key_destroy(&key);
+	as_arraylist_destroy(&arglist);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_true( key_async_result_wait(&res) );
+	assert_int_eq( res.status, AEROSPIKE_OK );
+	assert_int_eq( res.a, 3 );
+
+	key_async_result_destroy(&res);
+}
+
+TEST( key_async_notexists , "get async: (test,test,key_async_notexists) fails with not found" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", "key_async_notexists");
+
+	key_async_result res;
+	key_async_result_init(&res, 1);
+
+	as_status rc = aerospike_key_get_async(async_as, &err, NULL, &key, key_async_record_listener, &res);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_true( key_async_result_wait(&res) );
+	assert_int_eq( res.status, AEROSPIKE_ERR_RECORD_NOT_FOUND );
+	assert_int_eq( res.n_bins, 0 );
+
+	key_async_result_destroy(&res);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_async, "asynchronous aerospike_key tests" ) {
+
+	suite_before( before );
+	suite_after( after );
+
+	suite_add( key_async_remove );
+	suite_add( key_async_put );
+	suite_add( key_async_get );
+	suite_add( key_async_get_many );
+	suite_add( key_async_operate );
+	suite_add( key_async_apply );
+	suite_add( key_async_notexists );
+	suite_add( key_async_remove );
+}
@@ -0,0 +1,133 @@
+#include <aerospike/as_key.h>
+#include <aerospike/as_val.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+
+// Keys of up to N_KEYS bytes cross several RIPEMD-160 blocks.
+#define N_KEYS 200
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static char key_digest_str[N_KEYS + 1];
+static uint8_t key_digest_raw[N_KEYS];
+
+static const char * key_digest_sets[] = {
+	"",
+	"test",
+	"a-set-name-which-is-sixty-three-characters-long-xxxxxxxxxxxxxxx"
+};
+
+/**
+ *	Make key i of a mix of string, integer and bytes keys of varying length.
+ */
+static void key_digest_init(as_key * key, uint32_t i, const char * set)
+{
+	switch ( i % 3 ) {
+		case 0:
+			as_key_init_strp(key, NAMESPACE, set, strndup(key_digest_str, i), true);
+			break;
+		case 1:
+			as_key_init_int64(key, NAMESPACE, set, (int64_t) i * 0x123456789LL - 1000);
+			break;
+		default:
+			as_key_init_raw(key, NAMESPACE, set, key_digest_raw, i);
+			break;
+	}
+}
+
+/**
+ *	Digest keys with as_keys_digest_many(), n at a time, and compare with
+ *	as_key_digest().
+ */
+static bool key_digest_check(const char * set, uint32_t n)
+{
+	as_key keys[N_KEYS];
+	as_key * ptrs[N_KEYS];
+	bool ok = true;
+
+	for ( uint32_t i = 0; i < N_KEYS; i++ ) {
+		key_digest_str[i] = 'a' + i % 26;
+		key_digest_raw[i] = (uint8_t) (i * 7);
+	}
+
+	for ( uint32_t i = 0; i < N_KEYS; i++ ) {
+		key_digest_init(&keys[i], i, set);
+		ptrs[i] = &keys[i];
+	}
+
+	for ( uint32_t i = 0; i < N_KEYS; i += n ) {
+		as_keys_digest_many(&ptrs[i], i + n < N_KEYS ? n : N_KEYS - i);
+	}
+
+	for ( uint32_t i = 0; i < N_KEYS; i++ ) {
+		as_key key;
+		key_digest_init(&key, i, set);
+
+		if ( ! keys[i].digest.init ||
+			memcmp(keys[i].digest.value, as_key_digest(&key)->value, AS_DIGEST_VALUE_SIZE) != 0 ) {
+			error("key %u in set '%s' digested %u at a time doesn't match", i, set, n);
+			ok = false;
+		}
+
+		as_key_destroy(&key);
+		as_key_destroy(&keys[i]);
+	}
+	return ok;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_digest_many , "as_keys_digest_many() matches as_key_digest()" ) {
+
+	uint32_t sizes[] = {1, 2, 3, 7, 8, 9, 16, 100, N_KEYS};
+
+	for ( int s = 0; s < sizeof(key_digest_sets) / sizeof(key_digest_sets[0]); s++ ) {
+		for ( int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ ) {
+			assert_true( key_digest_check(key_digest_sets[s], sizes[i]) );
+		}
+	}
+}
+
+TEST( key_digest_many_skip , "as_keys_digest_many() skips computed digests" ) {
+
+	as_digest_value value;
+	memset(value, 0xAB, sizeof(value));
+
+	as_key keys[3];
+	as_key_init_digest(&keys[0], NAMESPACE, "test", value);
+	as_key_init_str(&keys[1], NAMESPACE, "test", "abc");
+	as_key_init_int64(&keys[2], NAMESPACE, "test", 123);
+
+	as_key * ptrs[4] = { &keys[0], NULL, &keys[1], &keys[2] };
+	as_keys_digest_many(ptrs, 4);
+
+	assert_int_eq( memcmp(keys[0].digest.value, value, AS_DIGEST_VALUE_SIZE), 0 );
+	assert_true( keys[1].digest.init );
+	assert_true( keys[2].digest.init );
+
+	as_key_destroy(&keys[0]);
+	as_key_destroy(&keys[1]);
+	as_key_destroy(&keys[2]);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_digest, "as_key digest tests" ) {
+    suite_add( key_digest_many );
+    suite_add( key_digest_many_skip );
+}
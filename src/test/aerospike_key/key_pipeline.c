@@ -0,0 +1,222 @@
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/aerospike_pipeline.h>
+
+#include <aerospike/as_error.h>
+#include <aerospike/as_status.h>
+
+#include <aerospike/as_record.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_string.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_val.h>
+
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+// Enough 2KB records that every node's window is split, whatever the
+// cluster size.
+#define N_KEYS 64
+#define STR_SZ 2048
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void key_pipeline_str(char * buf, int i)
+{
+	memset(buf, 'a' + (i % 26), STR_SZ - 1);
+	buf[STR_SZ - 1] = '\0';
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_pipeline_remove , "remove: (test,test,1..64)" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	for ( int i = 1; i <= N_KEYS; i++ ) {
+		as_key key;
+		as_key_init_int64(&key, "test", "test", i);
+
+		as_status rc = aerospike_key_remove(as, &err, NULL, &key);
+
+		as_key_destroy(&key);
+
+		assert_true( rc == AEROSPIKE_OK || rc == AEROSPIKE_ERR_RECORD_NOT_FOUND );
+	}
+}
+
+TEST( key_pipeline_put , "pipeline put: (test,test,1..64) = {i: n, s: 2KB string}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	static char strs[N_KEYS][STR_SZ];
+
+	as_key keys[N_KEYS];
+	as_record recs[N_KEYS];
+	as_pipeline_command cmds[N_KEYS];
+
+	for ( int i = 0; i < N_KEYS; i++ ) {
+		key_pipeline_str(strs[i], i);
+		as_key_init_int64(&keys[i], "test", "test", i + 1);
+		as_record_init(&recs[i], 2);
+		as_record_set_int64(&recs[i], "i", i + 1);
+		as_record_set_str(&recs[i], "s", strs[i]);
+		as_pipeline_put(&cmds[i], &keys[i], &recs[i]);
+	}
+
+	as_status rc = aerospike_pipeline(as, &err, NULL, cmds, N_KEYS);
+
+	for ( int i = 0; i < N_KEYS; i++ ) {
+		as_key_destroy(&keys[i]);
+		as_record_destroy(&recs[i]);
+	}
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	for ( int i = 0; i < N_KEYS; i++ ) {
+		assert_int_eq( cmds[i].status, AEROSPIKE_OK );
+		assert_null( cmds[i].result );
+	}
+}
+
+TEST( key_pipeline_get , "pipeline get: (test,test,1..64) = {i: n, s: 2KB string}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	char str[STR_SZ];
+
+	as_key keys[N_KEYS];
+	as_pipeline_command cmds[N_KEYS];
+
+	for ( int i = 0; i < N_KEYS; i++ ) {
+		as_key_init_int64(&keys[i], "test", "test", i + 1);
+		as_pipeline_get(&cmds[i], &keys[i]);
+	}
+
+	as_status rc = aerospike_pipeline(as, &err, NULL, cmds, N_KEYS);
+
+	for ( int i = 0; i < N_KEYS; i++ ) {
+		as_key_destroy(&keys[i]);
+	}
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	for ( int i = 0; i < N_KEYS; i++ ) {
+		as_record * rec = cmds[i].result;
+
+		assert_int_eq( cmds[i].status, AEROSPIKE_OK );
+		assert_not_null( rec );
+		assert_int_eq( as_record_numbins(rec), 2 );
+		assert_int_eq( as_record_get_int64(rec, "i", 0), i + 1 );
+
+		key_pipeline_str(str, i);
+		assert_string_eq( as_record_get_str(rec, "s"), str );
+
+		as_record_destroy(rec);
+	}
+}
+
+TEST( key_pipeline_mixed , "pipeline: put (test,test,1), get (test,test,2), operate (test,test,3), get (test,test,notexists)" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key keys[4];
+	as_key_init_int64(&keys[0], "test", "test", 1);
+	as_key_init_int64(&keys[1], "test", "test", 2);
+	as_key_init_int64(&keys[2], "test", "test", 3);
+	as_key_init(&keys[3], "test", "test", "key_pipeline_notexists");
+
+	as_record rec;
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "i", 100);
+
+	as_operations ops;
+	as_operations_inita(&ops, 2);
+	as_operations_add_incr(&ops, "i", 10);
+	as_operations_add_read(&ops, "i");
+
+	as_pipeline_command cmds[4];
+	as_pipeline_put(&cmds[0], &keys[0], &rec);
+	as_pipeline_get(&cmds[1], &keys[1]);
+	as_pipeline_operate(&cmds[2], &keys[2], &ops);
+	as_pipeline_get(&cmds[3], &keys[3]);
+
+	as_status rc = aerospike_pipeline(as, &err, NULL, cmds, 4);
+
+	as_operations_destroy(&ops);
+	as_record_destroy(&rec);
+
+	for ( int i = 0; i < 4; i++ ) {
+		as_key_destroy(&keys[i]);
+	}
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	assert_int_eq( cmds[0].status, AEROSPIKE_OK );
+	assert_null( cmds[0].result );
+
+	assert_int_eq( cmds[1].status, AEROSPIKE_OK );
+	assert_not_null( cmds[1].result );
+	assert_int_eq( as_record_get_int64(cmds[1].result, "i", 0), 2 );
+	as_record_destroy(cmds[1].result);
+
+	assert_int_eq( cmds[2].status, AEROSPIKE_OK );
+	assert_not_null( cmds[2].result );
+	assert_int_eq( as_record_get_int64(cmds[2].result, "i", 0), 13 );
+	as_record_destroy(cmds[2].result);
+
+	assert_int_eq( cmds[3].status, AEROSPIKE_ERR_RECORD_NOT_FOUND );
+	assert_null( cmds[3].result );
+}
+
+TEST( key_pipeline_get2 , "get: (test,test,1) = {i: 100}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init_int64(&key, "test", "test", 1);
+
+	as_record * rec = NULL;
+	as_status rc = aerospike_key_get(as, &err, NULL, &key, &rec);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_not_null( rec );
+	assert_int_eq( as_record_get_int64(rec, "i", 0), 100 );
+
+	as_record_destroy(rec);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_pipeline, "aerospike_pipeline tests" ) {
+	suite_add( key_pipeline_remove );
+	suite_add( key_pipeline_put );
+	suite_add( key_pipeline_get );
+	suite_add( key_pipeline_mixed );
+	suite_add( key_pipeline_get2 );
+	suite_add( key_pipeline_remove );
+}
@@ -0,0 +1,284 @@
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+
+#include <aerospike/as_error.h>
+#include <aerospike/as_status.h>
+
+#include <aerospike/as_record.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_string.h>
+#include <aerospike/as_list.h>
+#include <aerospike/as_arraylist.h>
+#include <aerospike/as_prepared_write.h>
+#include <aerospike/as_val.h>
+
+#include <stdio.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define N_KEYS 10
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * Prepare writes of {a: integer, b: string} to (test,test).
+ */
+static as_status key_prepared_init(as_prepared_write * pw, as_error * err)
+{
+	as_record rec;
+	as_record_inita(&rec, 2);
+	as_record_set_int64(&rec, "a", 0);
+	as_record_set_str(&rec, "b", "");
+
+	as_status rc = aerospike_key_put_prepare(as, err, NULL, "test", "test", &rec, pw);
+
+	as_record_destroy(&rec);
+	return rc;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_prepared_remove , "remove: (test,test,101..110)" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	for ( int i = 1; i <= N_KEYS; i++ ) {
+		as_key key;
+		as_key_init_int64(&key, "test", "test", 100 + i);
+
+		as_status rc = aerospike_key_remove(as, &err, NULL, &key);
+
+		as_key_destroy(&key);
+
+		assert_true( rc == AEROSPIKE_OK || rc == AEROSPIKE_ERR_RECORD_NOT_FOUND );
+	}
+}
+
+TEST( key_prepared_put , "put prepared: (test,test,101..110) = {a: n, b: 'value-n'}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_prepared_write pw;
+	as_status rc = key_prepared_init(&pw, &err);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	char str[32];
+
+	as_record rec;
+	as_record_inita(&rec, 2);
+
+	for ( int i = 1; i <= N_KEYS; i++ ) {
+		as_key key;
+		as_key_init_int64(&key, "test", "test", 100 + i);
+
+		snprintf(str, sizeof(str), "value-%d", i);
+		as_record_set_int64(&rec, "a", i);
+		as_record_set_str(&rec, "b", str);
+
+		rc = aerospike_key_put_prepared(as, &err, &pw, &key, &rec);
+
+		as_key_destroy(&key);
+
+		if ( rc != AEROSPIKE_OK ) {
+			break;
+		}
+	}
+
+	as_record_destroy(&rec);
+	as_prepared_write_destroy(&pw);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+}
+
+TEST( key_prepared_get , "get: (test,test,101..110) = {a: n, b: 'value-n'}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	char str[32];
+
+	for ( int i = 1; i <= N_KEYS; i++ ) {
+		as_key key;
+		as_key_init_int64(&key, "test", "test", 100 + i);
+
+		as_record * rec = NULL;
+		as_status rc = aerospike_key_get(as, &err, NULL, &key, &rec);
+
+		as_key_destroy(&key);
+
+		assert_int_eq( rc, AEROSPIKE_OK );
+		assert_not_null( rec );
+		assert_int_eq( as_record_numbins(rec), 2 );
+		assert_int_eq( as_record_get_int64(rec, "a", 0), i );
+
+		snprintf(str, sizeof(str), "value-%d", i);
+		assert_string_eq( as_record_get_str(rec, "b"), str );
+
+		as_record_destroy(rec);
+	}
+}
+
+TEST( key_prepared_reject_bins , "put prepared: records without the prepared bins are rejected" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_prepared_write pw;
+	as_status rc = key_prepared_init(&pw, &err);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_key key;
+	as_key_init_int64(&key, "test", "test", 101);
+
+	// Same bin count and types, different name.
+	as_record rec1;
+	as_record_inita(&rec1, 2);
+	as_record_set_int64(&rec1, "a", 1);
+	as_record_set_str(&rec1, "c", "value-1");
+
+	as_status rc1 = aerospike_key_put_prepared(as, &err, &pw, &key, &rec1);
+
+	// Same names, different order.
+	as_record rec2;
+	as_record_inita(&rec2, 2);
+	as_record_set_str(&rec2, "b", "value-1");
+	as_record_set_int64(&rec2, "a", 1);
+
+	as_status rc2 = aerospike_key_put_prepared(as, &err, &pw, &key, &rec2);
+
+	// Missing bin.
+	as_record rec3;
+	as_record_inita(&rec3, 1);
+	as_record_set_int64(&rec3, "a", 1);
+
+	as_status rc3 = aerospike_key_put_prepared(as, &err, &pw, &key, &rec3);
+
+	// Value of a different type.
+	as_record rec4;
+	as_record_inita(&rec4, 2);
+	as_record_set_int64(&rec4, "a", 1);
+	as_record_set_int64(&rec4, "b", 1);
+
+	as_status rc4 = aerospike_key_put_prepared(as, &err, &pw, &key, &rec4);
+
+	as_record_destroy(&rec1);
+	as_record_destroy(&rec2);
+	as_record_destroy(&rec3);
+	as_record_destroy(&rec4);
+	as_key_destroy(&key);
+	as_prepared_write_destroy(&pw);
+
+	assert_int_eq( rc1, AEROSPIKE_ERR_PARAM );
+	assert_int_eq( rc2, AEROSPIKE_ERR_PARAM );
+	assert_int_eq( rc3, AEROSPIKE_ERR_PARAM );
+	assert_int_eq( rc4, AEROSPIKE_ERR_PARAM );
+}
+
+TEST( key_prepared_reject_key , "put prepared: keys outside the prepared namespace and set are rejected" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_prepared_write pw;
+	as_status rc = key_prepared_init(&pw, &err);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_record rec;
+	as_record_inita(&rec, 2);
+	as_record_set_int64(&rec, "a", 1);
+	as_record_set_str(&rec, "b", "value-1");
+
+	as_key key1;
+	as_key_init_int64(&key1, "test", "key_prepared", 101);
+
+	as_status rc1 = aerospike_key_put_prepared(as, &err, &pw, &key1, &rec);
+
+	as_key key2;
+	as_key_init_int64(&key2, "key_prepared", "test", 101);
+
+	as_status rc2 = aerospike_key_put_prepared(as, &err, &pw, &key2, &rec);
+
+	as_key_destroy(&key1);
+	as_key_destroy(&key2);
+	as_record_destroy(&rec);
+	as_prepared_write_destroy(&pw);
+
+	assert_int_eq( rc1, AEROSPIKE_ERR_PARAM );
+	assert_int_eq( rc2, AEROSPIKE_ERR_PARAM );
+}
+
+TEST( key_prepared_reject_type , "put prepare: list bins are rejected" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_arraylist list;
+	as_arraylist_init(&list, 1, 0);
+	as_arraylist_append_int64(&list, 1);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_list(&rec, "e", (as_list *) &list);
+
+	as_prepared_write pw;
+	as_status rc = aerospike_key_put_prepare(as, &err, NULL, "test", "test", &rec, &pw);
+
+	as_record_destroy(&rec);
+
+	assert_int_eq( rc, AEROSPIKE_ERR_PARAM );
+}
+
+TEST( key_prepared_get2 , "get: (test,test,101) = {a: 1, b: 'value-1'}" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init_int64(&key, "test", "test", 101);
+
+	as_record * rec = NULL;
+	as_status rc = aerospike_key_get(as, &err, NULL, &key, &rec);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_not_null( rec );
+	assert_int_eq( as_record_get_int64(rec, "a", 0), 1 );
+	assert_string_eq( as_record_get_str(rec, "b"), "value-1" );
+
+	as_record_destroy(rec);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_prepared, "aerospike_key_put_prepared tests" ) {
+	suite_add( key_prepared_remove );
+	suite_add( key_prepared_put );
+	suite_add( key_prepared_get );
+	suite_add( key_prepared_reject_bins );
+	suite_add( key_prepared_reject_key );
+	suite_add( key_prepared_reject_type );
+	suite_add( key_prepared_get2 );
+	suite_add( key_prepared_remove );
+}
@@ -0,0 +1,306 @@
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_status.h>
+
+#include <aerospike/as_record.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_val.h>
+
+#include <time.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+#include "../util/udf.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/**
+ * Client with a read cache.  Records written through the shared client are
+ * writes by another client, which the cache only sees once stale.
+ */
+static aerospike * cache_as = NULL;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define KEY "key_read_cache"
+
+// Long enough that no entry goes stale during the suite.
+#define STALENESS_MS 600000
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static bool before(atf_suite * suite) {
+
+	as_config config;
+	test_config_init(&config);
+	config.read_cache_max_bytes = 1024 * 1024;
+
+	as_error err;
+	as_error_reset(&err);
+
+	cache_as = aerospike_new(&config);
+
+	if ( aerospike_connect(cache_as, &err) != AEROSPIKE_OK ) {
+		error("%s @ %s[%s:%d]", err.message, err.func, err.file, err.line);
+		aerospike_destroy(cache_as);
+		cache_as = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static bool after(atf_suite * suite) {
+
+	if ( ! cache_as ) {
+		return true;
+	}
+
+	as_error err;
+	as_error_reset(&err);
+
+	aerospike_close(cache_as, &err);
+	aerospike_destroy(cache_as);
+	cache_as = NULL;
+
+	return true;
+}
+
+/**
+ * Read bin a of the record through the read cache, or -1 if the read fails.
+ */
+static int64_t key_read_cache_get(aerospike * client, uint32_t staleness_ms, as_status * rc)
+{
+	as_error err;
+	as_error_reset(&err);
+
+	as_policy_read policy;
+	as_policy_read_init(&policy);
+	policy.cache_staleness = staleness_ms;
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	as_record * rec = NULL;
+	*rc = aerospike_key_get(client, &err, &policy, &key, &rec);
+
+	as_key_destroy(&key);
+
+	int64_t a = rec ? as_record_get_int64(rec, "a", -1) : -1;
+	as_record_destroy(rec);
+	return a;
+}
+
+static as_status key_read_cache_put(aerospike * client, int64_t a)
+{
+	as_error err;
+	as_error_reset(&err);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_int64(&rec, "a", a);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	as_status rc = aerospike_key_put(client, &err, NULL, &key, &rec);
+
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+	return rc;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_read_cache_remove , "remove: (test,test,key_read_cache)" ) {
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	as_status rc = aerospike_key_remove(as, &err, NULL, &key);
+
+	as_key_destroy(&key);
+
+	assert_true( rc == AEROSPIKE_OK || rc == AEROSPIKE_ERR_RECORD_NOT_FOUND );
+}
+
+TEST( key_read_cache_hit , "get: (test,test,key_read_cache) twice, the second from the cache" ) {
+
+	as_status rc = key_read_cache_put(as, 1);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_cluster_read_cache_stats before;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &before);
+
+	int64_t a1 = key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a1, 1 );
+
+	int64_t a2 = key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a2, 1 );
+
+	as_cluster_read_cache_stats stats;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &stats);
+
+	assert_int_eq( stats.misses - before.misses, 1 );
+	assert_int_eq( stats.hits - before.hits, 1 );
+	assert_int_eq( stats.entries, 1 );
+	assert_true( stats.bytes > 0 );
+}
+
+TEST( key_read_cache_stale , "get: (test,test,key_read_cache) written by another client, within and past the staleness" ) {
+
+	// Not seen by cache_as, which keeps serving the cached record.
+	as_status rc = key_read_cache_put(as, 2);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	int64_t a1 = key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a1, 1 );
+
+	// Older than 10ms, so read from the server.
+	WAIT_MS(50);
+
+	int64_t a2 = key_read_cache_get(cache_as, 10, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a2, 2 );
+
+	// Without a staleness the cache isn't used.
+	key_read_cache_put(as, 3);
+
+	int64_t a3 = key_read_cache_get(cache_as, 0, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a3, 3 );
+}
+
+TEST( key_read_cache_put_invalidates , "put: (test,test,key_read_cache) drops the cached record" ) {
+
+	as_status rc;
+	key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_cluster_read_cache_stats before;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &before);
+
+	rc = key_read_cache_put(cache_as, 4);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	int64_t a = key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	as_cluster_read_cache_stats stats;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &stats);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a, 4 );
+	assert_int_eq( stats.invalidations - before.invalidations, 1 );
+}
+
+TEST( key_read_cache_operate_invalidates , "operate: (test,test,key_read_cache) => {a: incr(1)} drops the cached record" ) {
+
+	as_status rc;
+	key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_cluster_read_cache_stats before;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &before);
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_operations ops;
+	as_operations_inita(&ops, 1);
+	as_operations_add_incr(&ops, "a", 1);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	rc = aerospike_key_operate(cache_as, &err, NULL, &key, &ops, NULL);
+
+	as_key_destroy(&key);
+	as_operations_destroy(&ops);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	int64_t a = key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	as_cluster_read_cache_stats stats;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &stats);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( a, 5 );
+	assert_int_eq( stats.invalidations - before.invalidations, 1 );
+}
+
+TEST( key_read_cache_remove_invalidates , "remove: (test,test,key_read_cache) drops the cached record" ) {
+
+	as_status rc;
+	key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_error err;
+	as_error_reset(&err);
+
+	as_key key;
+	as_key_init(&key, "test", "test", KEY);
+
+	rc = aerospike_key_remove(cache_as, &err, NULL, &key);
+
+	as_key_destroy(&key);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	key_read_cache_get(cache_as, STALENESS_MS, &rc);
+
+	as_cluster_read_cache_stats stats;
+	as_cluster_get_read_cache_stats(cache_as->cluster, &stats);
+
+	assert_int_eq( rc, AEROSPIKE_ERR_RECORD_NOT_FOUND );
+	assert_int_eq( stats.entries, 0 );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_read_cache, "read cache tests" ) {
+
+	suite_before( before );
+	suite_after( after );
+
+	suite_add( key_read_cache_remove );
+	suite_add( key_read_cache_hit );
+	suite_add( key_read_cache_stale );
+	suite_add( key_read_cache_put_invalidates );
+	suite_add( key_read_cache_operate_invalidates );
+	suite_add( key_read_cache_remove_invalidates );
+	suite_add( key_read_cache_remove );
+}
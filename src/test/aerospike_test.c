@@ -122,13 +122,7 @@ static bool before(atf_plan * plan) {
     }
 	
 	as_config config;
-	as_config_init(&config);
-	as_config_add_host(&config, g_host, g_port);
-	as_config_set_user(&config, g_user, g_password);
-	config.lua.cache_enabled = false;
-	strcpy(config.lua.system_path, "modules/lua-core/src");
-	strcpy(config.lua.user_path, "src/test/lua");
-    as_policies_init(&config.policies);
+	test_config_init(&config);
 
 	as_error err;
 	as_error_reset(&err);
@@ -175,6 +169,21 @@ static bool after(atf_plan * plan) {
     return true;
 }
 
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+as_config * test_config_init(as_config * config) {
+	as_config_init(config);
+	as_config_add_host(config, g_host, g_port);
+	as_config_set_user(config, g_user, g_password);
+	config->lua.cache_enabled = false;
+	strcpy(config->lua.system_path, "modules/lua-core/src");
+	strcpy(config->lua.user_path, "src/test/lua");
+    as_policies_init(&config->policies);
+	return config;
+}
+
 /******************************************************************************
  * TEST PLAN
  *****************************************************************************/
@@ -188,6 +197,12 @@ PLAN( aerospike_test ) {
     plan_add( key_basics );
     plan_add( key_apply );
     plan_add( key_apply2 );
+    plan_add( key_digest );
+    plan_add( key_pipeline );
+    plan_add( key_prepared );
+    plan_add( key_arena );
+    plan_add( key_read_cache );
+    plan_add( key_async );
     
     // aerospike_info module
     plan_add( info_basics );
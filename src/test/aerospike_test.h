@@ -1,4 +1,12 @@
 #pragma once
 
+#include <aerospike/as_config.h>
+
 #define MAX_HOST_SIZE 1024
 extern char g_host[MAX_HOST_SIZE];
+
+/**
+ * Initialize a config for the cluster under test, as used by the shared
+ * aerospike instance, for suites that need a client of their own.
+ */
+as_config * test_config_init(as_config * config);